@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <limits>
+
+namespace LinAlg
+{
+    // Cache line on x86-64 and the width of one AVX-512 register.
+    inline constexpr std::size_t DEFAULT_ALIGNMENT = 64;
+
+    // Minimal std-compatible allocator that hands out over-aligned memory.
+    // Used as the storage allocator of MatrixX / VectorX so that every row buffer
+    // starts on a cache line (no split loads at the start of a SIMD loop).
+    template<typename T, std::size_t Alignment = DEFAULT_ALIGNMENT>
+    struct AlignedAllocator
+    {
+        static_assert(Alignment >= alignof(T), "Alignment must not be weaker than alignof(T)");
+        static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+        using value_type = T;
+
+        template<typename U>
+        struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+        constexpr AlignedAllocator() noexcept = default;
+        template<typename U>
+        constexpr AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+        [[nodiscard]] T* allocate(std::size_t count)
+        {
+            if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+                throw std::bad_array_new_length();
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+        }
+        void deallocate(T* ptr, std::size_t) noexcept
+        {
+            ::operator delete(ptr, std::align_val_t{Alignment});
+        }
+
+        template<typename U>
+        friend constexpr bool operator==(const AlignedAllocator&, const AlignedAllocator<U, Alignment>&) noexcept
+        {
+            return true;
+        }
+    };
+}
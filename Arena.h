@@ -0,0 +1,316 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <bit>
+#include <array>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+namespace LinAlg
+{
+    // Memory resources for per-step temporaries, so a steady-state training loop never calls the
+    // global allocator:
+    //   Arena         : bump allocator over a chain of blocks. Allocation is a pointer increment,
+    //                   freeing is rewinding to a mark (ArenaScope) or reset(). Blocks are kept,
+    //                   so after the first step every later step of the same shape reuses them.
+    //   SizeClassPool : power-of-two size classes with intrusive free lists, for buffers whose
+    //                   lifetimes do not nest (a layer's activations resized between steps, ...).
+    // ResourceAllocator plugs either of them into MatrixX / VectorX / std::vector:
+    //   LinAlg::Arena arena;
+    //   LinAlg::MatrixX<float, LinAlg::ArenaAllocator<float>> tmp(rows, cols, LinAlg::ArenaAllocator<float>(arena));
+    // A default-constructed ResourceAllocator uses the thread's current resource (set by
+    // ArenaScope / PoolScope) and plain aligned new when there is none.
+    // Resources are not thread-safe: use one per thread.
+
+    // Counters of one resource since the last takeStats() ("per step" when called once per step).
+    struct AllocationStats
+    {
+        size_t allocations = 0;
+        size_t bytesAllocated = 0;     // requested bytes handed out
+        size_t bytesInUse = 0;         // live bytes right now
+        size_t peakBytes = 0;          // highest bytesInUse
+        size_t systemAllocations = 0;  // calls to the global allocator (0 in steady state)
+    };
+
+    class Arena
+    {
+    public:
+        // Remembers a position to rewind to.
+        struct Marker
+        {
+            size_t block = 0;
+            size_t offset = 0;
+            size_t inUse = 0;
+        };
+
+        explicit Arena(size_t blockSize = size_t{1} << 20) noexcept : m_blockSize(std::max<size_t>(blockSize, DEFAULT_ALIGNMENT)) {}
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena()
+        {
+            for (const Block& block : m_blocks)
+                ::operator delete(block.data, std::align_val_t{DEFAULT_ALIGNMENT});
+        }
+
+        [[nodiscard]] void* allocate(size_t bytes, size_t alignment = DEFAULT_ALIGNMENT)
+        {
+            assert(std::has_single_bit(alignment) && alignment <= DEFAULT_ALIGNMENT);
+            bytes = std::max<size_t>(bytes, 1);
+            // Current block first, then the blocks left over from earlier (bigger) steps.
+            for (; m_block < m_blocks.size(); ++m_block, m_offset = 0)
+            {
+                const size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+                if (offset <= m_blocks[m_block].size && bytes <= m_blocks[m_block].size - offset)
+                    return bump(offset, bytes);
+            }
+            // Out of blocks: grow. Block sizes double so the chain stays short.
+            const size_t size = std::max({bytes, m_blockSize, m_capacity});
+            m_blocks.push_back({static_cast<std::byte*>(::operator new(size, std::align_val_t{DEFAULT_ALIGNMENT})), size});
+            m_capacity += size;
+            ++m_stats.systemAllocations;
+            m_block = m_blocks.size() - 1;
+            m_offset = 0;
+            return bump(0, bytes);
+        }
+        // Only the most recent allocation is actually given back; everything else is released
+        // by rewind() / reset().
+        void deallocate(void* ptr, size_t bytes, size_t = DEFAULT_ALIGNMENT) noexcept
+        {
+            bytes = std::max<size_t>(bytes, 1);
+            if (m_block < m_blocks.size() && static_cast<std::byte*>(ptr) + bytes == m_blocks[m_block].data + m_offset)
+            {
+                m_offset -= bytes;
+                m_stats.bytesInUse -= bytes;
+            }
+        }
+
+        [[nodiscard]] Marker mark() const noexcept { return {m_block, m_offset, m_stats.bytesInUse}; }
+        void rewind(const Marker& marker) noexcept
+        {
+            m_block = marker.block;
+            m_offset = marker.offset;
+            m_stats.bytesInUse = marker.inUse;
+        }
+        // Frees everything, keeps the blocks.
+        void reset() noexcept { rewind({}); }
+
+        // Counters since the previous call; the peak restarts from what is live now.
+        AllocationStats takeStats() noexcept
+        {
+            const AllocationStats stats = m_stats;
+            m_stats = {};
+            m_stats.bytesInUse = m_stats.peakBytes = stats.bytesInUse;
+            return stats;
+        }
+        [[nodiscard]] const AllocationStats& stats() const noexcept { return m_stats; }
+        [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+        // Resource used by default-constructed ArenaAllocators on this thread (see ArenaScope).
+        static Arena*& current() noexcept
+        {
+            thread_local Arena* arena = nullptr;
+            return arena;
+        }
+    private:
+        struct Block
+        {
+            std::byte* data;
+            size_t size;
+        };
+        void* bump(size_t offset, size_t bytes) noexcept
+        {
+            // Padding in front of an aligned allocation counts as in use until the next rewind.
+            m_stats.bytesInUse += offset + bytes - m_offset;
+            m_stats.peakBytes = std::max(m_stats.peakBytes, m_stats.bytesInUse);
+            m_stats.bytesAllocated += bytes;
+            ++m_stats.allocations;
+            m_offset = offset + bytes;
+            return m_blocks[m_block].data + offset;
+        }
+
+        std::vector<Block> m_blocks;
+        size_t m_block = 0;
+        size_t m_offset = 0;
+        size_t m_blockSize;
+        size_t m_capacity = 0;
+        AllocationStats m_stats;
+    };
+
+    // Scoped reset: everything allocated from 'arena' inside the scope is released when it ends,
+    // and the arena is the thread's current one meanwhile.
+    //   for (step ...) { LinAlg::ArenaScope scope(arena); ... temporaries ... }
+    class ArenaScope
+    {
+    public:
+        explicit ArenaScope(Arena& arena) noexcept
+            : m_arena(arena), m_marker(arena.mark()), m_previous(Arena::current())
+        {
+            Arena::current() = &arena;
+        }
+        ~ArenaScope()
+        {
+            m_arena.rewind(m_marker);
+            Arena::current() = m_previous;
+        }
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+    private:
+        Arena& m_arena;
+        Arena::Marker m_marker;
+        Arena* m_previous;
+    };
+
+    class SizeClassPool
+    {
+    public:
+        // Class c holds blocks of MIN_BLOCK << c bytes.
+        static constexpr size_t MIN_BLOCK = DEFAULT_ALIGNMENT;
+        static constexpr size_t CLASSES = std::numeric_limits<size_t>::digits - std::countr_zero(MIN_BLOCK);
+        static constexpr size_t MAX_BYTES = MIN_BLOCK << (CLASSES - 1);
+
+        SizeClassPool() noexcept = default;
+        SizeClassPool(const SizeClassPool&) = delete;
+        SizeClassPool& operator=(const SizeClassPool&) = delete;
+        // Every block must have been given back by now.
+        ~SizeClassPool()
+        {
+            assert(m_stats.bytesInUse == 0);
+            release();
+        }
+
+        // Throws std::bad_alloc for more than MAX_BYTES (no class holds it).
+        [[nodiscard]] void* allocate(size_t bytes, [[maybe_unused]] size_t alignment = DEFAULT_ALIGNMENT)
+        {
+            assert(std::has_single_bit(alignment) && alignment <= DEFAULT_ALIGNMENT);
+            if (bytes > MAX_BYTES)
+                throw std::bad_alloc();
+            const size_t sizeClass = classOf(bytes);
+            const size_t blockSize = MIN_BLOCK << sizeClass;
+            void* block = m_free[sizeClass];
+            if (block != nullptr)
+                m_free[sizeClass] = *static_cast<void**>(block);
+            else
+            {
+                block = ::operator new(blockSize, std::align_val_t{DEFAULT_ALIGNMENT});
+                ++m_stats.systemAllocations;
+            }
+            ++m_stats.allocations;
+            m_stats.bytesAllocated += bytes;
+            m_stats.bytesInUse += blockSize;
+            m_stats.peakBytes = std::max(m_stats.peakBytes, m_stats.bytesInUse);
+            return block;
+        }
+        void deallocate(void* ptr, size_t bytes, size_t = DEFAULT_ALIGNMENT) noexcept
+        {
+            assert(bytes <= MAX_BYTES);
+            const size_t sizeClass = classOf(bytes);
+            *static_cast<void**>(ptr) = m_free[sizeClass];
+            m_free[sizeClass] = ptr;
+            m_stats.bytesInUse -= MIN_BLOCK << sizeClass;
+        }
+        // Returns the cached (free) blocks to the global allocator.
+        void release() noexcept
+        {
+            for (size_t c = 0; c < CLASSES; ++c)
+            {
+                while (m_free[c] != nullptr)
+                {
+                    void* next = *static_cast<void**>(m_free[c]);
+                    ::operator delete(m_free[c], std::align_val_t{DEFAULT_ALIGNMENT});
+                    m_free[c] = next;
+                }
+            }
+        }
+
+        AllocationStats takeStats() noexcept
+        {
+            const AllocationStats stats = m_stats;
+            m_stats = {};
+            m_stats.bytesInUse = m_stats.peakBytes = stats.bytesInUse;
+            return stats;
+        }
+        [[nodiscard]] const AllocationStats& stats() const noexcept { return m_stats; }
+
+        static SizeClassPool*& current() noexcept
+        {
+            thread_local SizeClassPool* pool = nullptr;
+            return pool;
+        }
+    private:
+        static size_t classOf(size_t bytes) noexcept
+        {
+            return bytes <= MIN_BLOCK ? 0 : std::bit_width(bytes - 1) - std::countr_zero(MIN_BLOCK);
+        }
+
+        std::array<void*, CLASSES> m_free{};
+        AllocationStats m_stats;
+    };
+
+    // Makes 'pool' the thread's current pool for the scope (nothing is freed on exit).
+    class PoolScope
+    {
+    public:
+        explicit PoolScope(SizeClassPool& pool) noexcept : m_previous(SizeClassPool::current())
+        {
+            SizeClassPool::current() = &pool;
+        }
+        ~PoolScope() { SizeClassPool::current() = m_previous; }
+        PoolScope(const PoolScope&) = delete;
+        PoolScope& operator=(const PoolScope&) = delete;
+    private:
+        SizeClassPool* m_previous;
+    };
+
+    // std-compatible allocator drawing from an Arena or a SizeClassPool. Containers keep the
+    // resource they were created with: a copy-constructed or moved-from container brings its
+    // source's along, copy assignment keeps the target's own.
+    template<typename T, typename Resource>
+    class ResourceAllocator
+    {
+    public:
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        template<typename U>
+        struct rebind { using other = ResourceAllocator<U, Resource>; };
+
+        ResourceAllocator() noexcept : m_resource(Resource::current()) {}
+        explicit ResourceAllocator(Resource& resource) noexcept : m_resource(&resource) {}
+        template<typename U>
+        ResourceAllocator(const ResourceAllocator<U, Resource>& other) noexcept : m_resource(other.resource()) {}
+
+        [[nodiscard]] T* allocate(size_t count)
+        {
+            if (count > std::numeric_limits<size_t>::max() / sizeof(T))
+                throw std::bad_array_new_length();
+            if (m_resource == nullptr)
+                return AlignedAllocator<T>{}.allocate(count);
+            return static_cast<T*>(m_resource->allocate(count * sizeof(T), std::max(alignof(T), DEFAULT_ALIGNMENT)));
+        }
+        void deallocate(T* ptr, size_t count) noexcept
+        {
+            if (m_resource == nullptr)
+                AlignedAllocator<T>{}.deallocate(ptr, count);
+            else
+                m_resource->deallocate(ptr, count * sizeof(T), std::max(alignof(T), DEFAULT_ALIGNMENT));
+        }
+        [[nodiscard]] Resource* resource() const noexcept { return m_resource; }
+
+        friend bool operator==(const ResourceAllocator& a, const ResourceAllocator& b) noexcept
+        {
+            return a.m_resource == b.m_resource;
+        }
+    private:
+        Resource* m_resource;
+    };
+
+    template<typename T>
+    using ArenaAllocator = ResourceAllocator<T, Arena>;
+    template<typename T>
+    using PoolAllocator = ResourceAllocator<T, SizeClassPool>;
+}
@@ -0,0 +1,394 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "AlignedAllocator.h"
+#include "Matrices.h"
+#include "Vectors.h"
+#include "DynamicMatrices.h"
+#include "MatMul.h"
+#include "SimdKernels.h"
+#include "Layers.h"
+#include <span>
+#include <vector>
+#include <limits>
+#include <concepts>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+namespace ML
+{
+    // Reverse-mode automatic differentiation (define-by-run).
+    // Every operation on a Var is computed immediately and appended to the Tape; backward(loss)
+    // then walks the tape once from the end and accumulates d loss / d node into every node that
+    // depends on a parameter.
+    //
+    //   ML::Tape<double> tape;
+    //   for (step ...)
+    //   {
+    //       tape.reset();                                   // keeps all memory from the last step
+    //       auto x = tape.constant(inputs);                 // batch x features
+    //       auto w = tape.parameter(weights);               // features x 1
+    //       auto loss = tape.mse(tape.addBias(tape.matmul(x, w), tape.parameter(bias)), tape.constant(targets));
+    //       tape.backward(loss);
+    //       LinAlg::Simd::axpy(weights.data(), tape.grad(w).data(), -lr, weights.size());
+    //   }
+    //
+    // Every value is a rows x cols row-major block (vectors are n x 1, scalars 1 x 1).
+    // Values and gradients of intermediate nodes live in ONE aligned arena addressed by offsets, and
+    // reset() only rewinds it: once the first step has sized the arena and the node list, further
+    // steps of the same shape allocate nothing.
+    // constant() / parameter() do not copy: the node reads the caller's memory, which therefore has
+    // to stay alive and unchanged until backward() has run. Spans returned by value() / grad() are
+    // invalidated by the next recorded operation (the arena may grow) and by reset().
+    template<std::floating_point Number>
+    class Tape;
+
+    template<std::floating_point Number>
+    struct Var
+    {
+        Tape<Number>* tape = nullptr;
+        uint32_t id = 0;
+
+        [[nodiscard]] size_t rows() const noexcept { return tape->rows(*this); }
+        [[nodiscard]] size_t cols() const noexcept { return tape->cols(*this); }
+        [[nodiscard]] size_t size() const noexcept { return rows() * cols(); }
+    };
+
+    template<std::floating_point Number>
+    class Tape
+    {
+    public:
+        Tape() = default;
+        Tape(const Tape&) = delete;
+        Tape& operator=(const Tape&) = delete;
+
+        // Leaves. A parameter receives a gradient, a constant does not.
+        Var<Number> constant(const Number* data, size_t rows, size_t cols) { return leaf(data, rows, cols, false); }
+        Var<Number> parameter(const Number* data, size_t rows, size_t cols) { return leaf(data, rows, cols, true); }
+        template<typename Allocator>
+        Var<Number> constant(const LinAlg::MatrixX<Number, Allocator>& m) { return constant(m.data(), m.rows(), m.cols()); }
+        template<typename Allocator>
+        Var<Number> parameter(const LinAlg::MatrixX<Number, Allocator>& m) { return parameter(m.data(), m.rows(), m.cols()); }
+        template<typename Allocator>
+        Var<Number> constant(const LinAlg::VectorX<Number, Allocator>& v) { return constant(v.data(), v.size(), 1); }
+        template<typename Allocator>
+        Var<Number> parameter(const LinAlg::VectorX<Number, Allocator>& v) { return parameter(v.data(), v.size(), 1); }
+        template<uint8_t size>
+        Var<Number> constant(const LinAlg::Matrix<size, Number>& m) { return constant(m.view().data(), size, size); }
+        template<uint8_t size>
+        Var<Number> parameter(const LinAlg::Matrix<size, Number>& m) { return parameter(m.view().data(), size, size); }
+        template<size_t size>
+        Var<Number> constant(const LinAlg::Vector<size, Number>& v) { return constant(v.data.data(), size, 1); }
+        template<size_t size>
+        Var<Number> parameter(const LinAlg::Vector<size, Number>& v) { return parameter(v.data.data(), size, 1); }
+
+        // Element-wise (same shape)
+        Var<Number> add(Var<Number> a, Var<Number> b) { return binary(Op::Add, a, b); }
+        Var<Number> sub(Var<Number> a, Var<Number> b) { return binary(Op::Sub, a, b); }
+        Var<Number> mul(Var<Number> a, Var<Number> b) { return binary(Op::Mul, a, b); }
+        Var<Number> scale(Var<Number> a, Number scalar)
+        {
+            const uint32_t id = record(Op::Scale, a.id, NONE, rows(a), cols(a));
+            m_nodes[id].scalar = scalar;
+            LinAlg::Simd::mulScalar(result(id), data(a.id), scalar, size(id));
+            return {this, id};
+        }
+        // a (m x k) times b (k x n)
+        Var<Number> matmul(Var<Number> a, Var<Number> b)
+        {
+            assert(cols(a) == rows(b));
+            const uint32_t id = record(Op::MatMul, a.id, b.id, rows(a), cols(b));
+            LinAlg::gemm(rows(a), cols(b), cols(a), Number{1},
+                         data(a.id), cols(a), size_t{1},
+                         data(b.id), cols(b), size_t{1},
+                         Number{}, result(id), cols(b), size_t{1});
+            return {this, id};
+        }
+        // x (n x m) plus the bias b (m values, any shape) added to every row.
+        Var<Number> addBias(Var<Number> x, Var<Number> b)
+        {
+            assert(size(b.id) == cols(x));
+            const uint32_t id = record(Op::AddBias, x.id, b.id, rows(x), cols(x));
+            for (size_t r = 0; r < rows(x); ++r)
+                LinAlg::Simd::add(result(id) + r * cols(x), data(x.id) + r * cols(x), data(b.id), cols(x));
+            return {this, id};
+        }
+        Var<Number> activate(Var<Number> a, Activation activation)
+        {
+            const uint32_t id = record(Op::Activate, a.id, NONE, rows(a), cols(a));
+            m_nodes[id].activation = activation;
+            withActivation(activation, [&](auto act)
+            {
+                const Number* x = data(a.id);
+                Number* y = result(id);
+                for (size_t i = 0; i < size(id); ++i)
+                    y[i] = ML::activate<decltype(act)::value>(x[i]);
+            });
+            return {this, id};
+        }
+        Var<Number> relu(Var<Number> a) { return activate(a, Activation::ReLU); }
+        Var<Number> sigmoid(Var<Number> a) { return activate(a, Activation::Sigmoid); }
+        Var<Number> tanh(Var<Number> a) { return activate(a, Activation::Tanh); }
+
+        // Reductions to a 1 x 1 value
+        Var<Number> sum(Var<Number> a)
+        {
+            const uint32_t id = record(Op::Sum, a.id, NONE, 1, 1);
+            *result(id) = total(data(a.id), size(a.id));
+            return {this, id};
+        }
+        Var<Number> mean(Var<Number> a)
+        {
+            const uint32_t id = record(Op::Mean, a.id, NONE, 1, 1);
+            *result(id) = total(data(a.id), size(a.id)) / static_cast<Number>(size(a.id));
+            return {this, id};
+        }
+        // mean((prediction - target)^2)
+        Var<Number> mse(Var<Number> prediction, Var<Number> target)
+        {
+            assert(size(prediction.id) == size(target.id));
+            const uint32_t id = record(Op::Mse, prediction.id, target.id, 1, 1);
+            const Number* p = data(prediction.id);
+            const Number* t = data(target.id);
+            Number sum{};
+            for (size_t i = 0; i < size(prediction.id); ++i)
+                sum += (p[i] - t[i]) * (p[i] - t[i]);
+            *result(id) = sum / static_cast<Number>(size(prediction.id));
+            return {this, id};
+        }
+
+        // d output / d node for every node that depends on a parameter. 'output' must be 1 x 1.
+        // Gradients from an earlier backward() on the same tape are overwritten, not accumulated.
+        void backward(Var<Number> output)
+        {
+            assert(output.tape == this && size(output.id) == 1);
+            for (uint32_t id = 0; id <= output.id; ++id)
+                if (m_nodes[id].requiresGrad)
+                    std::fill_n(grad(id), size(id), Number{});
+            if (!m_nodes[output.id].requiresGrad)
+                return;
+            *grad(output.id) = Number{1};
+            for (uint32_t id = output.id + 1; id-- > 0;)
+                if (m_nodes[id].requiresGrad)
+                    propagate(id);
+        }
+
+        [[nodiscard]] size_t rows(Var<Number> v) const noexcept { return m_nodes[v.id].rows; }
+        [[nodiscard]] size_t cols(Var<Number> v) const noexcept { return m_nodes[v.id].cols; }
+        [[nodiscard]] std::span<const Number> value(Var<Number> v) const noexcept { return {data(v.id), size(v.id)}; }
+        [[nodiscard]] Number scalar(Var<Number> v) const noexcept { return *data(v.id); }
+        // Empty for nodes that do not depend on a parameter.
+        [[nodiscard]] std::span<const Number> grad(Var<Number> v) const noexcept
+        {
+            return m_nodes[v.id].requiresGrad ? std::span<const Number>{grad(v.id), size(v.id)} : std::span<const Number>{};
+        }
+
+        // Forgets every node but keeps the memory for the next step.
+        void reset() noexcept
+        {
+            m_nodes.clear();
+            m_used = 0;
+        }
+        [[nodiscard]] size_t nodeCount() const noexcept { return m_nodes.size(); }
+        [[nodiscard]] size_t arenaBytes() const noexcept { return m_arena.size() * sizeof(Number); }
+    private:
+        enum class Op : uint8_t
+        {
+            Leaf,
+            Add,
+            Sub,
+            Mul,
+            Scale,
+            MatMul,
+            AddBias,
+            Activate,
+            Sum,
+            Mean,
+            Mse
+        };
+        static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+        static constexpr size_t NO_OFFSET = std::numeric_limits<size_t>::max();
+        // Every block starts on a 64-byte boundary of the arena.
+        static constexpr size_t ALIGN = std::max<size_t>(1, 64 / sizeof(Number));
+
+        struct Node
+        {
+            Op op = Op::Leaf;
+            Activation activation = Activation::Identity;
+            bool requiresGrad = false;
+            uint32_t lhs = NONE;
+            uint32_t rhs = NONE;
+            size_t rows = 0;
+            size_t cols = 0;
+            const Number* external = nullptr; // leaves read the caller's memory
+            size_t value = NO_OFFSET;         // arena offsets
+            size_t grad = NO_OFFSET;
+            Number scalar{};
+        };
+
+        size_t size(uint32_t id) const noexcept { return m_nodes[id].rows * m_nodes[id].cols; }
+        // data() reads any node, result() writes the value of a node that was just recorded.
+        const Number* data(uint32_t id) const noexcept
+        {
+            const Node& node = m_nodes[id];
+            return node.external != nullptr ? node.external : m_arena.data() + node.value;
+        }
+        Number* result(uint32_t id) noexcept { return m_arena.data() + m_nodes[id].value; }
+        const Number* grad(uint32_t id) const noexcept { return m_arena.data() + m_nodes[id].grad; }
+        Number* grad(uint32_t id) noexcept { return m_arena.data() + m_nodes[id].grad; }
+
+        // Bump allocation out of the arena; it only grows while the first steps find their size.
+        size_t allocate(size_t count)
+        {
+            const size_t offset = m_used;
+            m_used += (count + ALIGN - 1) / ALIGN * ALIGN;
+            if (m_used > m_arena.size())
+                m_arena.resize(std::max(m_used, m_arena.size() * 2));
+            return offset;
+        }
+
+        Var<Number> leaf(const Number* data, size_t rows, size_t cols, bool requiresGrad)
+        {
+            Node node;
+            node.requiresGrad = requiresGrad;
+            node.rows = rows;
+            node.cols = cols;
+            node.external = data;
+            if (requiresGrad)
+                node.grad = allocate(rows * cols);
+            m_nodes.push_back(node);
+            return {this, static_cast<uint32_t>(m_nodes.size() - 1)};
+        }
+        uint32_t record(Op op, uint32_t lhs, uint32_t rhs, size_t rows, size_t cols)
+        {
+            assert(m_nodes.size() < NONE);
+            Node node;
+            node.op = op;
+            node.lhs = lhs;
+            node.rhs = rhs;
+            node.rows = rows;
+            node.cols = cols;
+            node.requiresGrad = m_nodes[lhs].requiresGrad || (rhs != NONE && m_nodes[rhs].requiresGrad);
+            node.value = allocate(rows * cols);
+            if (node.requiresGrad)
+                node.grad = allocate(rows * cols);
+            m_nodes.push_back(node);
+            return static_cast<uint32_t>(m_nodes.size() - 1);
+        }
+        Var<Number> binary(Op op, Var<Number> a, Var<Number> b)
+        {
+            assert(a.tape == this && b.tape == this);
+            assert(rows(a) == rows(b) && cols(a) == cols(b));
+            const uint32_t id = record(op, a.id, b.id, rows(a), cols(a));
+            const Number* x = data(a.id);
+            const Number* y = data(b.id);
+            switch (op)
+            {
+                case Op::Add: LinAlg::Simd::add(result(id), x, y, size(id)); break;
+                case Op::Sub: LinAlg::Simd::sub(result(id), x, y, size(id)); break;
+                default:      LinAlg::Simd::mul(result(id), x, y, size(id)); break;
+            }
+            return {this, id};
+        }
+        static Number total(const Number* x, size_t n) noexcept
+        {
+            Number sum{};
+            for (size_t i = 0; i < n; ++i)
+                sum += x[i];
+            return sum;
+        }
+
+        // Adds node id's contribution to the gradients of its inputs.
+        void propagate(uint32_t id)
+        {
+            const Node& node = m_nodes[id];
+            const Number* g = grad(id);
+            const size_t n = size(id);
+            const bool lhsGrad = node.lhs != NONE && m_nodes[node.lhs].requiresGrad;
+            const bool rhsGrad = node.rhs != NONE && m_nodes[node.rhs].requiresGrad;
+            Number* gl = lhsGrad ? grad(node.lhs) : nullptr;
+            Number* gr = rhsGrad ? grad(node.rhs) : nullptr;
+            switch (node.op)
+            {
+                case Op::Leaf:
+                    break;
+                case Op::Add:
+                    if (lhsGrad) LinAlg::Simd::add(gl, gl, g, n);
+                    if (rhsGrad) LinAlg::Simd::add(gr, gr, g, n);
+                    break;
+                case Op::Sub:
+                    if (lhsGrad) LinAlg::Simd::add(gl, gl, g, n);
+                    if (rhsGrad) LinAlg::Simd::sub(gr, gr, g, n);
+                    break;
+                case Op::Mul:
+                    if (lhsGrad) LinAlg::Simd::fma(gl, g, data(node.rhs), gl, n);
+                    if (rhsGrad) LinAlg::Simd::fma(gr, g, data(node.lhs), gr, n);
+                    break;
+                case Op::Scale:
+                    LinAlg::Simd::axpy(gl, g, node.scalar, n);
+                    break;
+                case Op::MatMul:
+                {
+                    // C = A B  ->  dA += dC B^T,  dB += A^T dC
+                    const size_t m = node.rows, k = m_nodes[node.lhs].cols, cols = node.cols;
+                    if (lhsGrad)
+                        LinAlg::gemm(m, k, cols, Number{1}, g, cols, size_t{1},
+                                     data(node.rhs), size_t{1}, cols, Number{1}, gl, k, size_t{1});
+                    if (rhsGrad)
+                        LinAlg::gemm(k, cols, m, Number{1}, data(node.lhs), size_t{1}, k,
+                                     g, cols, size_t{1}, Number{1}, gr, cols, size_t{1});
+                    break;
+                }
+                case Op::AddBias:
+                    if (lhsGrad) LinAlg::Simd::add(gl, gl, g, n);
+                    if (rhsGrad)
+                        for (size_t r = 0; r < node.rows; ++r)
+                            LinAlg::Simd::add(gr, gr, g + r * node.cols, node.cols);
+                    break;
+                case Op::Activate:
+                    withActivation(node.activation, [&](auto act)
+                    {
+                        const Number* y = result(id);
+                        for (size_t i = 0; i < n; ++i)
+                            gl[i] += g[i] * derivativeFromOutput<decltype(act)::value>(y[i]);
+                    });
+                    break;
+                case Op::Sum:
+                    LinAlg::Simd::addScalar(gl, gl, *g, size(node.lhs));
+                    break;
+                case Op::Mean:
+                    LinAlg::Simd::addScalar(gl, gl, *g / static_cast<Number>(size(node.lhs)), size(node.lhs));
+                    break;
+                case Op::Mse:
+                {
+                    const size_t count = size(node.lhs);
+                    const Number factor = Number{2} * *g / static_cast<Number>(count);
+                    const Number* p = data(node.lhs);
+                    const Number* t = data(node.rhs);
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        const Number d = factor * (p[i] - t[i]);
+                        if (lhsGrad) gl[i] += d;
+                        if (rhsGrad) gr[i] -= d;
+                    }
+                    break;
+                }
+            }
+        }
+
+        std::vector<Node> m_nodes;
+        std::vector<Number, LinAlg::AlignedAllocator<Number>> m_arena;
+        size_t m_used = 0;
+    };
+
+    // Operator sugar over the tape the operands were recorded on.
+    template<std::floating_point Number>
+    Var<Number> operator+(Var<Number> a, Var<Number> b) { return a.tape->add(a, b); }
+    template<std::floating_point Number>
+    Var<Number> operator-(Var<Number> a, Var<Number> b) { return a.tape->sub(a, b); }
+    template<std::floating_point Number>
+    Var<Number> operator*(Var<Number> a, Var<Number> b) { return a.tape->mul(a, b); }
+    template<std::floating_point Number>
+    Var<Number> operator*(Var<Number> a, std::type_identity_t<Number> scalar) { return a.tape->scale(a, scalar); }
+    template<std::floating_point Number>
+    Var<Number> operator*(std::type_identity_t<Number> scalar, Var<Number> a) { return a.tape->scale(a, scalar); }
+}
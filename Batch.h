@@ -0,0 +1,554 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "AlignedAllocator.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Profiling.h"
+#include "Vectors.h"
+#include "Matrices.h"
+#include "DynamicMatrices.h"
+#include <array>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+#include <concepts>
+namespace LinAlg
+{
+    // Many small Vectors / Matrices of one type in structure-of-arrays layout:
+    //   std::vector<V3f> : x0 y0 z0 x1 y1 z1 x2 ...      one element per struct
+    //   Batch<V3f>       : x0 x1 x2 ... | y0 y1 y2 ... | z0 z1 z2 ...
+    // Every component is one contiguous, 64-byte aligned array (padded to a whole number of cache
+    // lines), so a batched operation is a Simd kernel over the component arrays with one element
+    // per SIMD lane: a full register of V3f dot products per instruction instead of one dot
+    // product squeezed into 3 lanes.
+    // Transforms that read or write several components run over blocks of BATCH_BLOCK elements:
+    // all the components of one block stay in L1 while every output component is computed, so
+    // the layout costs no extra memory traffic over the array-of-structures loop.
+    template<typename T>
+    struct BatchTraits;
+
+    template<size_t size, Numeric Number>
+    struct BatchTraits<Vector<size, Number>>
+    {
+        using value_type = Number;
+        static constexpr size_t COMPONENTS = size;
+        static constexpr auto& component(auto& v, size_t c) noexcept { return v.data[c]; }
+    };
+    template<uint8_t size, Numeric Number>
+    struct BatchTraits<Matrix<size, Number>>
+    {
+        using value_type = Number;
+        static constexpr size_t COMPONENTS = size_t{size} * size;
+        // Component r * size + c is element (r, c).
+        static constexpr auto& component(auto& m, size_t c) noexcept { return m(c / size, c % size); }
+    };
+
+    template<typename T>
+    concept BatchElement = requires { BatchTraits<T>::COMPONENTS; };
+
+    namespace detail
+    {
+        // Elements per block of the multi-component transforms: 3 operands of Mat4f are 48 KiB.
+        inline constexpr size_t BATCH_BLOCK = 256;
+
+        // kernel(first, last) over blocks of elements, across the pool when the batch is large
+        // enough ('work' is compared against Parallel::current().minElements).
+        template<typename Kernel>
+        void forBatchBlocks(size_t count, size_t work, Kernel&& kernel)
+        {
+            parallelFor((count + BATCH_BLOCK - 1) / BATCH_BLOCK, Parallel::current(), [&](size_t b0, size_t b1)
+            {
+                for (size_t b = b0; b < b1; ++b)
+                    kernel(b * BATCH_BLOCK, std::min(count, (b + 1) * BATCH_BLOCK));
+            }, work);
+        }
+
+        // Simd's map without the per-call profiling: the public batch functions count themselves.
+        template<typename Op, typename T, typename... Src>
+        void batchMap(T* dst, size_t n, const Op& op, const Src*... src) noexcept
+        {
+            if constexpr (ReducedFloat<T>)
+                Simd::detail::mapWidened(dst, n, op, src...);
+            else
+                Simd::detail::mapRuntime(dst, n, op, src...);
+        }
+
+        // Ops of the batched transforms, written like the Simd ops: the same body runs on whole
+        // registers and on single (tail) elements.
+        // sum_k src_k * weights[k]  (one row of a fixed matrix times the components of a batch)
+        template<typename F, size_t N>
+        struct WeightedSumOp
+        {
+            std::array<F, N> weights;
+            template<typename A, typename... B>
+            [[gnu::always_inline]] constexpr A operator()(A first, B... rest) const noexcept
+            {
+                static_assert(sizeof...(B) + 1 == N);
+                const A src[N]{first, rest...};
+                A sum = static_cast<A>(src[0] * weights[0]);
+                for (size_t k = 1; k < N; ++k)
+                    sum = static_cast<A>(sum + src[k] * weights[k]);
+                return sum;
+            }
+        };
+        // sum_k a_k * b_k with the 2N sources a_0 .. a_N-1, b_0 .. b_N-1
+        template<size_t N>
+        struct DotOp
+        {
+            template<typename A, typename... B>
+            [[gnu::always_inline]] constexpr A operator()(A first, B... rest) const noexcept
+            {
+                static_assert(sizeof...(B) + 1 == 2 * N);
+                const A src[2 * N]{first, rest...};
+                A sum = static_cast<A>(src[0] * src[N]);
+                for (size_t k = 1; k < N; ++k)
+                    sum = static_cast<A>(sum + src[k] * src[N + k]);
+                return sum;
+            }
+        };
+        // a * b - c * d  (one component of a cross product)
+        struct CrossTermOp
+        {
+            template<typename A, typename B, typename C, typename D>
+            [[gnu::always_inline]] constexpr A operator()(A a, B b, C c, D d) const noexcept { return static_cast<A>(a * b - c * d); }
+        };
+
+        // size x size matrix of registers (or of single elements on the tail) for the Matrices.h
+        // determinant / cofactor expansions.
+        template<size_t size, typename A>
+        struct LaneMatrix
+        {
+            A elements[size * size];
+            [[gnu::always_inline]] constexpr const A& operator()(size_t row, size_t col) const noexcept { return elements[row * size + col]; }
+        };
+        template<size_t size>
+        struct DeterminantOp
+        {
+            template<typename A, typename... B>
+            [[gnu::always_inline]] constexpr A operator()(A first, B... rest) const noexcept
+            {
+                constexpr unsigned all = (1u << size) - 1;
+                const LaneMatrix<size, A> m{{first, rest...}};
+                return minorDeterminant<all, all>(m);
+            }
+        };
+        // cofactor(row, col) * inverseDeterminant, the last source being 1 / det
+        template<size_t size, size_t row, size_t col>
+        struct ScaledCofactorOp
+        {
+            template<typename A, typename... B>
+            [[gnu::always_inline]] constexpr A operator()(A first, B... rest) const noexcept
+            {
+                const A src[size * size + 1]{first, rest...};
+                LaneMatrix<size, A> m;
+                std::copy_n(src, size * size, m.elements);
+                return static_cast<A>(cofactor<row, col, size>(m) * src[size * size]);
+            }
+        };
+    }
+
+    template<BatchElement Element, typename Allocator = AlignedAllocator<typename BatchTraits<Element>::value_type>>
+    class Batch
+    {
+    public:
+        using Traits = BatchTraits<Element>;
+        using value_type = typename Traits::value_type;
+        using element_type = Element;
+        using allocator_type = Allocator;
+        using Storage = std::vector<value_type, Allocator>;
+        static constexpr size_t COMPONENTS = Traits::COMPONENTS;
+
+        Batch() noexcept = default;
+        explicit Batch(size_t count, const Allocator& allocator = Allocator())
+            : m_count(count), m_stride(strideOf(count)), m_data(COMPONENTS * m_stride, T_zero_init<value_type>(), allocator) {}
+        Batch(size_t count, const Element& fill, const Allocator& allocator = Allocator()) : Batch(count, allocator)
+        {
+            for (size_t c = 0; c < COMPONENTS; ++c)
+                std::fill_n(component(c), m_count, Traits::component(fill, c));
+        }
+        // From / to the array-of-structures form.
+        explicit Batch(std::span<const Element> elements, const Allocator& allocator = Allocator()) : Batch(elements.size(), allocator)
+        {
+            for (size_t i = 0; i < m_count; ++i)
+                set(i, elements[i]);
+        }
+        [[nodiscard]] auto elements() const -> std::vector<Element>
+        {
+            std::vector<Element> result(m_count);
+            for (size_t i = 0; i < m_count; ++i)
+                result[i] = (*this)[i];
+            return result;
+        }
+
+        // Keeps the first min(size(), count) elements; new ones are zero.
+        void resize(size_t count)
+        {
+            if (count == m_count)
+                return;
+            Batch resized(count, get_allocator());
+            for (size_t c = 0; c < COMPONENTS; ++c)
+                std::copy_n(component(c), std::min(m_count, count), resized.component(c));
+            *this = std::move(resized);
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return m_count; }
+        [[nodiscard]] bool empty() const noexcept { return m_count == 0; }
+        // Distance (in elements) between two component arrays.
+        [[nodiscard]] size_t stride() const noexcept { return m_stride; }
+        [[nodiscard]] auto get_allocator() const noexcept -> Allocator { return m_data.get_allocator(); }
+
+        // Component c (Vector: c-th coordinate, Matrix: element (c / size, c % size)) of every element.
+        [[nodiscard]] auto component(this auto&& self, size_t c) noexcept
+        {
+            assert(c < COMPONENTS);
+            return self.m_data.data() + c * self.m_stride;
+        }
+        [[nodiscard]] auto components(this auto&& self, size_t c) noexcept
+        {
+            return std::span(self.component(c), self.m_count);
+        }
+
+        // Element i, gathered from the component arrays.
+        [[nodiscard]] auto operator[](size_t i) const noexcept -> Element
+        {
+            assert(i < m_count);
+            Element e;
+            for (size_t c = 0; c < COMPONENTS; ++c)
+                Traits::component(e, c) = component(c)[i];
+            return e;
+        }
+        void set(size_t i, const Element& e) noexcept
+        {
+            assert(i < m_count);
+            for (size_t c = 0; c < COMPONENTS; ++c)
+                component(c)[i] = Traits::component(e, c);
+        }
+
+        // Element-wise operators. The layout is the same for every batch of this type and size,
+        // so batch (op) batch and batch (op) scalar are one Simd kernel over the whole storage,
+        // split across the pool like the MatrixX operators. batch (op) element applies component c
+        // of the element to component array c.
+        auto operator+=(const Batch& other) -> Batch& { return apply(other, [](auto* d, const auto* a, const auto* b, size_t n) { Simd::add(d, a, b, n); }); }
+        auto operator-=(const Batch& other) -> Batch& { return apply(other, [](auto* d, const auto* a, const auto* b, size_t n) { Simd::sub(d, a, b, n); }); }
+        auto operator*=(const Batch& other) -> Batch& { return apply(other, [](auto* d, const auto* a, const auto* b, size_t n) { Simd::mul(d, a, b, n); }); }
+        auto operator+=(value_type scalar) -> Batch& { return apply(scalar, [](auto* d, const auto* a, auto s, size_t n) { Simd::addScalar(d, a, s, n); }); }
+        auto operator-=(value_type scalar) -> Batch& { return apply(scalar, [](auto* d, const auto* a, auto s, size_t n) { Simd::subScalar(d, a, s, n); }); }
+        auto operator*=(value_type scalar) -> Batch& { return apply(scalar, [](auto* d, const auto* a, auto s, size_t n) { Simd::mulScalar(d, a, s, n); }); }
+        auto operator+=(const Element& e) -> Batch& { return broadcast(e, [](auto* d, const auto* a, auto s, size_t n) { Simd::addScalar(d, a, s, n); }); }
+        auto operator-=(const Element& e) -> Batch& { return broadcast(e, [](auto* d, const auto* a, auto s, size_t n) { Simd::subScalar(d, a, s, n); }); }
+        auto operator*=(const Element& e) -> Batch& { return broadcast(e, [](auto* d, const auto* a, auto s, size_t n) { Simd::mulScalar(d, a, s, n); }); }
+
+        template<typename Other>
+        friend auto operator+(Batch a, const Other& b) -> Batch requires requires { a += b; } { return a += b; }
+        template<typename Other>
+        friend auto operator-(Batch a, const Other& b) -> Batch requires requires { a -= b; } { return a -= b; }
+        template<typename Other>
+        friend auto operator*(Batch a, const Other& b) -> Batch requires requires { a *= b; } { return a *= b; }
+
+        friend void roundOff(Batch& batch, uint8_t decimalDigit) noexcept
+        {
+            if constexpr (std::is_floating_point_v<value_type> || ReducedFloat<value_type>)
+            {
+                LINALG_PROFILE_SCOPE("Batch::roundOff");
+                parallelFor(batch.m_data.size(), Parallel::current(), [&](size_t first, size_t last)
+                {
+                    Simd::roundOff(batch.m_data.data() + first, batch.m_data.data() + first, decimalDigit, last - first);
+                });
+            }
+        }
+    private:
+        // Component arrays start on a cache line.
+        static constexpr size_t strideOf(size_t count) noexcept
+        {
+            constexpr size_t lanes = std::max<size_t>(1, 64 / sizeof(value_type));
+            return (count + lanes - 1) / lanes * lanes;
+        }
+
+        template<typename Kernel>
+        auto apply(const Batch& other, const Kernel& kernel) -> Batch&
+        {
+            assert(m_count == other.m_count);
+            LINALG_PROFILE_SCOPE("Batch::elementwise");
+            parallelFor(m_data.size(), Parallel::current(), [&](size_t first, size_t last)
+            {
+                kernel(m_data.data() + first, m_data.data() + first, other.m_data.data() + first, last - first);
+            });
+            return *this;
+        }
+        template<typename Kernel>
+        auto apply(value_type scalar, const Kernel& kernel) -> Batch&
+        {
+            LINALG_PROFILE_SCOPE("Batch::elementwise");
+            parallelFor(m_data.size(), Parallel::current(), [&](size_t first, size_t last)
+            {
+                kernel(m_data.data() + first, m_data.data() + first, scalar, last - first);
+            });
+            return *this;
+        }
+        template<typename Kernel>
+        auto broadcast(const Element& e, const Kernel& kernel) -> Batch&
+        {
+            LINALG_PROFILE_SCOPE("Batch::elementwise");
+            detail::forBatchBlocks(m_count, m_count * COMPONENTS, [&](size_t first, size_t last)
+            {
+                for (size_t c = 0; c < COMPONENTS; ++c)
+                    kernel(component(c) + first, component(c) + first, Traits::component(e, c), last - first);
+            });
+            return *this;
+        }
+
+        size_t m_count = 0;
+        size_t m_stride = 0;
+        Storage m_data;
+    };
+
+    namespace detail
+    {
+        // Pointers to the given components of a batch, offset to the first element of a block.
+        template<typename B, size_t... c>
+        [[gnu::always_inline]] inline auto componentPointers(const B& batch, size_t first, std::index_sequence<c...>) noexcept
+        {
+            return std::array<const typename B::value_type*, sizeof...(c)>{(batch.component(c) + first)...};
+        }
+    }
+
+    // Batched transforms: one output element per input element (per lane).
+    // Every transform writes into a caller-provided result (resized when its size differs, must
+    // not alias an input), so a loop reuses one set of buffers; the value-returning overloads
+    // allocate the result with the first argument's allocator.
+
+    // dot(a[i], b[i]) for every i.
+    template<size_t size, Numeric Number, typename AllocA, typename AllocB, typename AllocR>
+    void dot(const Batch<Vector<size, Number>, AllocA>& a, const Batch<Vector<size, Number>, AllocB>& b, VectorX<Number, AllocR>& result)
+    {
+        assert(a.size() == b.size());
+        LINALG_PROFILE_KERNEL("Batch::dot", (2 * size + 1) * a.size() * sizeof(Number), 2 * size * a.size());
+        if (result.size() != a.size())
+            result.resize(a.size());
+        detail::forBatchBlocks(a.size(), a.size() * size, [&](size_t first, size_t last)
+        {
+            [&]<size_t... c>(std::index_sequence<c...>)
+            {
+                detail::batchMap(result.data() + first, last - first, detail::DotOp<size>{},
+                                 (a.component(c) + first)..., (b.component(c) + first)...);
+            }(std::make_index_sequence<size>{});
+        });
+    }
+    template<size_t size, Numeric Number, typename AllocA, typename AllocB>
+    auto dot(const Batch<Vector<size, Number>, AllocA>& a, const Batch<Vector<size, Number>, AllocB>& b) -> VectorX<Number>
+    {
+        VectorX<Number> result(a.size());
+        dot(a, b, result);
+        return result;
+    }
+
+    // |a[i]|^2 for every i.
+    template<size_t size, Numeric Number, typename Alloc>
+    auto squaredNorm(const Batch<Vector<size, Number>, Alloc>& a) -> VectorX<Number>
+    {
+        return dot(a, a);
+    }
+
+    // cross(a[i], b[i]) for every i.
+    template<Numeric Number, typename AllocA, typename AllocB, typename AllocR>
+    void cross(const Batch<Vector<3, Number>, AllocA>& a, const Batch<Vector<3, Number>, AllocB>& b, Batch<Vector<3, Number>, AllocR>& result)
+    {
+        assert(a.size() == b.size());
+        LINALG_PROFILE_KERNEL("Batch::cross", 9 * a.size() * sizeof(Number), 9 * a.size());
+        result.resize(a.size());
+        detail::forBatchBlocks(a.size(), 3 * a.size(), [&](size_t first, size_t last)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                const size_t u = (c + 1) % 3, v = (c + 2) % 3;
+                detail::batchMap(result.component(c) + first, last - first, detail::CrossTermOp{},
+                                 a.component(u) + first, b.component(v) + first, a.component(v) + first, b.component(u) + first);
+            }
+        });
+    }
+    template<Numeric Number, typename AllocA, typename AllocB>
+    auto cross(const Batch<Vector<3, Number>, AllocA>& a, const Batch<Vector<3, Number>, AllocB>& b) -> Batch<Vector<3, Number>, AllocA>
+    {
+        Batch<Vector<3, Number>, AllocA> result(a.size(), a.get_allocator());
+        cross(a, b, result);
+        return result;
+    }
+
+    // The size of the transforms is deduced from the matrix only (Matrix counts in uint8_t, Vector
+    // in size_t), like the fixed-size matvec.
+    // m * v[i] for every i: one fixed matrix applied to a batch of vectors (points, directions).
+    template<uint8_t size, Numeric Number, typename AllocV, typename AllocR>
+    void transform(const Matrix<size, Number>& m, const Batch<Vector<size_t{size}, Number>, AllocV>& v, Batch<Vector<size_t{size}, Number>, AllocR>& result)
+    {
+        using F = ComputeType<Number>;
+        LINALG_PROFILE_KERNEL("Batch::transform", 2 * size * v.size() * sizeof(Number), 2 * size * size * v.size());
+        result.resize(v.size());
+        std::array<detail::WeightedSumOp<F, size>, size> rows{};
+        for (size_t r = 0; r < size; ++r)
+            for (size_t c = 0; c < size; ++c)
+                rows[r].weights[c] = static_cast<F>(m(r, c));
+        detail::forBatchBlocks(v.size(), v.size() * size * size, [&](size_t first, size_t last)
+        {
+            const auto src = detail::componentPointers(v, first, std::make_index_sequence<size>{});
+            for (size_t r = 0; r < size; ++r)
+                std::apply([&](const auto*... s) { detail::batchMap(result.component(r) + first, last - first, rows[r], s...); }, src);
+        });
+    }
+    template<uint8_t size, Numeric Number, typename Alloc>
+    auto transform(const Matrix<size, Number>& m, const Batch<Vector<size_t{size}, Number>, Alloc>& v) -> Batch<Vector<size_t{size}, Number>, Alloc>
+    {
+        Batch<Vector<size_t{size}, Number>, Alloc> result(v.size(), v.get_allocator());
+        transform(m, v, result);
+        return result;
+    }
+
+    // m[i] * v[i] for every i.
+    template<uint8_t size, Numeric Number, typename AllocM, typename AllocV, typename AllocR>
+    void transform(const Batch<Matrix<size, Number>, AllocM>& m, const Batch<Vector<size_t{size}, Number>, AllocV>& v,
+                   Batch<Vector<size_t{size}, Number>, AllocR>& result)
+    {
+        assert(m.size() == v.size());
+        LINALG_PROFILE_KERNEL("Batch::transform", (size * size + 2 * size) * v.size() * sizeof(Number), 2 * size * size * v.size());
+        result.resize(v.size());
+        detail::forBatchBlocks(v.size(), v.size() * size * size, [&](size_t first, size_t last)
+        {
+            [&]<size_t... r>(std::index_sequence<r...>)
+            {
+                // Row r of m[i] (components r * size .. r * size + size - 1) dotted with v[i].
+                const auto row = [&]<size_t row>(std::integral_constant<size_t, row>)
+                {
+                    [&]<size_t... c>(std::index_sequence<c...>)
+                    {
+                        detail::batchMap(result.component(row) + first, last - first, detail::DotOp<size>{},
+                                         (m.component(row * size + c) + first)..., (v.component(c) + first)...);
+                    }(std::make_index_sequence<size>{});
+                };
+                (row(std::integral_constant<size_t, r>{}), ...);
+            }(std::make_index_sequence<size>{});
+        });
+    }
+    template<uint8_t size, Numeric Number, typename AllocM, typename AllocV>
+    auto transform(const Batch<Matrix<size, Number>, AllocM>& m, const Batch<Vector<size_t{size}, Number>, AllocV>& v) -> Batch<Vector<size_t{size}, Number>, AllocV>
+    {
+        Batch<Vector<size_t{size}, Number>, AllocV> result(v.size(), v.get_allocator());
+        transform(m, v, result);
+        return result;
+    }
+
+    // a[i] * b[i] for every i.
+    template<uint8_t size, Numeric Number, typename AllocA, typename AllocB, typename AllocR>
+    void matmul(const Batch<Matrix<size, Number>, AllocA>& a, const Batch<Matrix<size, Number>, AllocB>& b, Batch<Matrix<size, Number>, AllocR>& result)
+    {
+        assert(a.size() == b.size());
+        LINALG_PROFILE_KERNEL("Batch::matmul", 3 * size * size * a.size() * sizeof(Number), 2 * size * size * size * a.size());
+        result.resize(a.size());
+        detail::forBatchBlocks(a.size(), a.size() * size * size * size, [&](size_t first, size_t last)
+        {
+            [&]<size_t... e>(std::index_sequence<e...>)
+            {
+                const auto element = [&]<size_t out>(std::integral_constant<size_t, out>)
+                {
+                    constexpr size_t row = out / size, col = out % size;
+                    [&]<size_t... k>(std::index_sequence<k...>)
+                    {
+                        detail::batchMap(result.component(out) + first, last - first, detail::DotOp<size>{},
+                                         (a.component(row * size + k) + first)..., (b.component(k * size + col) + first)...);
+                    }(std::make_index_sequence<size>{});
+                };
+                (element(std::integral_constant<size_t, e>{}), ...);
+            }(std::make_index_sequence<size * size>{});
+        });
+    }
+    template<uint8_t size, Numeric Number, typename AllocA, typename AllocB>
+    auto matmul(const Batch<Matrix<size, Number>, AllocA>& a, const Batch<Matrix<size, Number>, AllocB>& b) -> Batch<Matrix<size, Number>, AllocA>
+    {
+        Batch<Matrix<size, Number>, AllocA> result(a.size(), a.get_allocator());
+        matmul(a, b, result);
+        return result;
+    }
+
+    // transpose(m[i]) for every i: component arrays swap places, nothing is computed.
+    template<uint8_t size, Numeric Number, typename Alloc>
+    auto transpose(const Batch<Matrix<size, Number>, Alloc>& m) -> Batch<Matrix<size, Number>, Alloc>
+    {
+        Batch<Matrix<size, Number>, Alloc> result(m.size(), m.get_allocator());
+        for (size_t r = 0; r < size; ++r)
+            for (size_t c = 0; c < size; ++c)
+                std::copy_n(m.component(c * size + r), m.size(), result.component(r * size + c));
+        return result;
+    }
+
+    // determinant(m[i]) for every i (same expansion as the fixed-size determinant).
+    template<uint8_t size, Numeric Number, typename AllocM, typename AllocR> requires std::is_signed_v<ComputeType<Number>>
+    void determinant(const Batch<Matrix<size, Number>, AllocM>& m, VectorX<Number, AllocR>& result)
+    {
+        LINALG_PROFILE_SCOPE("Batch::determinant");
+        if (result.size() != m.size())
+            result.resize(m.size());
+        detail::forBatchBlocks(m.size(), m.size() * size * size * size, [&](size_t first, size_t last)
+        {
+            std::apply([&](const auto*... s) { detail::batchMap(result.data() + first, last - first, detail::DeterminantOp<size>{}, s...); },
+                       detail::componentPointers(m, first, std::make_index_sequence<size * size>{}));
+        });
+    }
+    template<uint8_t size, Numeric Number, typename Alloc> requires std::is_signed_v<ComputeType<Number>>
+    auto determinant(const Batch<Matrix<size, Number>, Alloc>& m) -> VectorX<Number>
+    {
+        VectorX<Number> result(m.size());
+        determinant(m, result);
+        return result;
+    }
+
+    // inverse(m[i]) for every i: adjugate over determinant like the fixed-size inverse. Singular
+    // matrices yield inf / nan in their slot.
+    template<uint8_t size, Numeric Number, typename AllocM, typename AllocR> requires std::floating_point<ComputeType<Number>>
+    void inverse(const Batch<Matrix<size, Number>, AllocM>& m, Batch<Matrix<size, Number>, AllocR>& result)
+    {
+        LINALG_PROFILE_SCOPE("Batch::inverse");
+        result.resize(m.size());
+        detail::forBatchBlocks(m.size(), m.size() * size * size * size * size, [&](size_t first, size_t last)
+        {
+            const size_t n = last - first;
+            const auto src = detail::componentPointers(m, first, std::make_index_sequence<size * size>{});
+            alignas(64) Number invDet[detail::BATCH_BLOCK];
+            std::apply([&](const auto*... s) { detail::batchMap(invDet, n, detail::DeterminantOp<size>{}, s...); }, src);
+            for (size_t i = 0; i < n; ++i)
+                invDet[i] = static_cast<Number>(ComputeType<Number>{1} / static_cast<ComputeType<Number>>(invDet[i]));
+            [&]<size_t... e>(std::index_sequence<e...>)
+            {
+                // inverse(r, c) = cofactor(c, r) / det
+                const auto element = [&]<size_t out>(std::integral_constant<size_t, out>)
+                {
+                    std::apply([&](const auto*... s)
+                    {
+                        detail::batchMap(result.component(out) + first, n, detail::ScaledCofactorOp<size, out % size, out / size>{},
+                                         s..., static_cast<const Number*>(invDet));
+                    }, src);
+                };
+                (element(std::integral_constant<size_t, e>{}), ...);
+            }(std::make_index_sequence<size * size>{});
+        });
+    }
+    template<uint8_t size, Numeric Number, typename Alloc> requires std::floating_point<ComputeType<Number>>
+    auto inverse(const Batch<Matrix<size, Number>, Alloc>& m) -> Batch<Matrix<size, Number>, Alloc>
+    {
+        Batch<Matrix<size, Number>, Alloc> result(m.size(), m.get_allocator());
+        inverse(m, result);
+        return result;
+    }
+
+    using BatchV2f      =  Batch<V2f>;
+    using BatchV3f      =  Batch<V3f>;
+    using BatchV4f      =  Batch<V4f>;
+    using BatchV2d      =  Batch<V2d>;
+    using BatchV3d      =  Batch<V3d>;
+    using BatchV4d      =  Batch<V4d>;
+    using BatchMat2f    =  Batch<Mat2f>;
+    using BatchMat3f    =  Batch<Mat3f>;
+    using BatchMat4f    =  Batch<Mat4f>;
+    using BatchMat2d    =  Batch<Mat2d>;
+    using BatchMat3d    =  Batch<Mat3d>;
+    using BatchMat4d    =  Batch<Mat4d>;
+}
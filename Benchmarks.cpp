@@ -0,0 +1,1006 @@
+// Benchmark suite: every Vector / Matrix operator over the alias sizes and element types,
+// roundOff, the product kernels (gemm, gemv, matmul, matvec), transpose / determinant /
+// inverse of the fixed sizes, Batch against loops over arrays of them, the dynamic containers
+// (also in float16 / bfloat16), training throughput (Start::Run-style SGD, mini-batch linear
+// direct and through the DataPipeline, MLP), float vs int8 MLP inference, the sparse kernels
+// (SpMV, transposed SpMV, SpMM, sparse linear training), the reductions (sum / dot / norm / max
+// in every summation mode), checkpoint open / verify / load, the direct solvers (LU,
+// Cholesky, QR, closed-form least squares), fused against multi-pass optimizer steps and
+// strided views (transposed add, products of blocks) against loops and copies.
+//
+//   LinAlgBenchmarks [--filter <text>] [--json <path>] [--quick] [--samples <n>]
+//
+// Every case is run in batches calibrated to take ~2 ms; the batch is repeated 'samples' times
+// and the per-op time of each batch is one sample. Reported: median / p99 / min ns per op and,
+// from the median, GB/s (minimum memory traffic of the op), GFLOP/s and items/s (training
+// samples). --json writes the same numbers in a stable schema for comparing two builds.
+
+#include "Vectors.h"
+#include "Matrices.h"
+#include "DynamicMatrices.h"
+#include "MatMul.h"
+#include "ThreadPool.h"
+#include "Training.h"
+#include "Layers.h"
+#include "QuantizedLayers.h"
+#include "SparseMatrices.h"
+#include "Batch.h"
+#include "Reductions.h"
+#include "Checkpoint.h"
+#include "Pipeline.h"
+#include "Solvers.h"
+#include "Optimizers.h"
+#include "Views.h"
+#include <print>
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <limits>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Keeps the compiler from deleting or hoisting the measured work: 'value' is treated as read
+    // and every escaped object as possibly modified.
+    template<typename T>
+    inline void doNotOptimize(T& value) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r"(&value) : "memory");
+#else
+        static const void* volatile sink;
+        sink = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    constexpr std::string_view compilerName() noexcept
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc";
+#else
+        return "unknown";
+#endif
+    }
+
+    constexpr std::string_view isaName(LinAlg::Simd::Isa isa) noexcept
+    {
+        switch (isa)
+        {
+            case LinAlg::Simd::Isa::SSE41: return "sse4.1";
+            case LinAlg::Simd::Isa::AVX2: return "avx2";
+            case LinAlg::Simd::Isa::AVX512: return "avx512";
+            default: return "scalar";
+        }
+    }
+
+    // JSON has no inf / nan: a value without one (a rate over a 0 ns median) is written as null.
+    std::string jsonNumber(double value)
+    {
+        return std::isfinite(value) ? std::format("{}", value) : std::string("null");
+    }
+
+    // Threads one call of a parallel kernel may use under the current policy.
+    size_t policyThreads() noexcept
+    {
+        const size_t pool = LinAlg::ThreadPool::global().concurrency();
+        const size_t threads = LinAlg::Parallel::current().threads;
+        return threads == 0 ? pool : std::min(threads, pool);
+    }
+
+    struct Options
+    {
+        std::string filter;
+        std::string json;
+        double sampleSeconds = 2e-3;   // calibrated length of one sample
+        size_t samples = 31;
+        double caseSeconds = 1.0;      // budget per case; slow cases stop early (but keep >= 5 samples)
+    };
+
+    struct Case
+    {
+        std::string group;     // vector, matrix, vectorx, matrixx, gemm, gemv, batch, reduce, train, quantized, sparse, checkpoint, solve, optimizer, view, threads, isa
+        std::string name;      // "V3f a += b", "gemm 512", ...
+        std::string type;      // element type suffix of the aliases (f, d, u8, ...)
+        size_t size = 0;       // elements per operand, or n for n x n products
+        double bytes = 0.0;    // memory traffic per op
+        double flops = 0.0;    // arithmetic per op
+        double items = 0.0;    // training samples per op
+        size_t threads = 1;
+    };
+
+    struct Result
+    {
+        Case info;
+        std::string isa;
+        size_t iterations = 0; // ops per sample
+        size_t samples = 0;
+        double medianNs = 0.0;
+        double p99Ns = 0.0;
+        double minNs = 0.0;
+
+        // NaN when the median rounds to 0 ns (an op faster than the clock resolves): no rate.
+        [[nodiscard]] double gbPerSecond() const noexcept { return perNs(info.bytes); }
+        [[nodiscard]] double gflopPerSecond() const noexcept { return perNs(info.flops); }
+        [[nodiscard]] double itemsPerSecond() const noexcept { return perNs(info.items * 1e9); }
+        [[nodiscard]] double perNs(double amount) const noexcept
+        {
+            return medianNs > 0.0 ? amount / medianNs : std::numeric_limits<double>::quiet_NaN();
+        }
+    };
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options& options) : m_options(options)
+        {
+            std::println("{:<8} {:<34} {:>12} {:>12} {:>9} {:>9} {:>12}", "group", "case", "median ns", "p99 ns", "GB/s", "GFLOP/s", "items/s");
+        }
+
+        template<typename Op>
+        void run(const Case& info, Op&& op)
+        {
+            if (!m_options.filter.empty() && (info.group + '/' + info.name).find(m_options.filter) == std::string::npos)
+                return;
+
+            // Grow the batch until one sample is long enough to time reliably.
+            size_t iterations = 1;
+            for (double seconds = time(op, iterations); seconds < m_options.sampleSeconds && iterations < (size_t{1} << 32);
+                 seconds = time(op, iterations))
+            {
+                const double scale = seconds <= 0.0 ? 10.0 : std::clamp(m_options.sampleSeconds / seconds * 1.1, 2.0, 10.0);
+                iterations = static_cast<size_t>(static_cast<double>(iterations) * scale);
+            }
+
+            std::vector<double> perOp;
+            perOp.reserve(m_options.samples);
+            const auto begin = Clock::now();
+            while (perOp.size() < m_options.samples &&
+                   (perOp.size() < MIN_SAMPLES || std::chrono::duration<double>(Clock::now() - begin).count() < m_options.caseSeconds))
+                perOp.push_back(time(op, iterations) * 1e9 / static_cast<double>(iterations));
+            std::ranges::sort(perOp);
+
+            Result result{info, std::string(isaName(LinAlg::Simd::activeIsa())), iterations, perOp.size(),
+                          percentile(perOp, 0.5), percentile(perOp, 0.99), perOp.front()};
+            std::println("{:<8} {:<34} {:>12.1f} {:>12.1f} {:>9.2f} {:>9.2f} {:>12.4g}", info.group, info.name,
+                         result.medianNs, result.p99Ns, result.gbPerSecond(), result.gflopPerSecond(), result.itemsPerSecond());
+            m_results.push_back(std::move(result));
+        }
+
+        void writeJson(std::FILE* file) const
+        {
+            std::println(file, "{{");
+            std::println(file, "  \"schema\": 1,");
+            std::println(file, "  \"compiler\": \"{}\",", compilerName());
+            std::println(file, "  \"isa\": \"{}\",", isaName(LinAlg::Simd::detectIsa()));
+            std::println(file, "  \"poolThreads\": {},", LinAlg::ThreadPool::global().concurrency());
+            std::println(file, "  \"results\": [");
+            for (size_t i = 0; i < m_results.size(); ++i)
+            {
+                const Result& r = m_results[i];
+                std::println(file, "    {{\"group\": \"{}\", \"name\": \"{}\", \"type\": \"{}\", \"size\": {}, \"threads\": {}, \"isa\": \"{}\", "
+                                   "\"iterations\": {}, \"samples\": {}, \"median_ns\": {}, \"p99_ns\": {}, \"min_ns\": {}, "
+                                   "\"gb_per_s\": {}, \"gflop_per_s\": {}, \"items_per_s\": {}}}{}",
+                             r.info.group, r.info.name, r.info.type, r.info.size, r.info.threads, r.isa,
+                             r.iterations, r.samples, jsonNumber(r.medianNs), jsonNumber(r.p99Ns), jsonNumber(r.minNs),
+                             jsonNumber(r.gbPerSecond()), jsonNumber(r.gflopPerSecond()), jsonNumber(r.itemsPerSecond()),
+                             i + 1 < m_results.size() ? "," : "");
+            }
+            std::println(file, "  ]");
+            std::println(file, "}}");
+        }
+    private:
+        static constexpr size_t MIN_SAMPLES = 5;
+
+        template<typename Op>
+        static double time(Op& op, size_t iterations)
+        {
+            const auto begin = Clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                op();
+            return std::chrono::duration<double>(Clock::now() - begin).count();
+        }
+        // Nearest rank on sorted samples.
+        static double percentile(const std::vector<double>& sorted, double p) noexcept
+        {
+            const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+        }
+
+        const Options& m_options;
+        std::vector<Result> m_results;
+    };
+
+    // Calls fn.template operator()<T>(suffix) for every element type of the Vector / Matrix aliases.
+    template<typename Fn>
+    void forEachElementType(Fn&& fn)
+    {
+        fn.template operator()<uint8_t>("u8");
+        fn.template operator()<uint16_t>("u16");
+        fn.template operator()<uint32_t>("u32");
+        fn.template operator()<uint64_t>("u64");
+        fn.template operator()<short>("s");
+        fn.template operator()<int>("i");
+        fn.template operator()<long>("l");
+        fn.template operator()<size_t>("st");
+        fn.template operator()<float>("f");
+        fn.template operator()<double>("d");
+    }
+
+    // Operands start at one and scalars are one, and a case runs its op millions of times on the
+    // same operands, so the values must stay finite: sums grow by one per op (a float settles at
+    // 2^24, integers wrap, neither changes the timing) and every product multiplies by one.
+    // 'a *= b + s' therefore adds zero rather than s: doubling a per op would reach inf (floats)
+    // or 0 (integers) within a few dozen ops and time those instead.
+    template<size_t size, typename Number>
+    void benchVector(Runner& runner, std::string_view suffix)
+    {
+        using V = LinAlg::Vector<size, Number>;
+        const std::string alias = "V" + std::to_string(size) + std::string(suffix);
+        V a, b, c;
+        const Number s{1};
+        Number zero{};  // opaque, so 'b + zero' is not folded into 'b'
+        const auto reset = [&]
+        {
+            std::ranges::fill(a.data, Number{1});
+            std::ranges::fill(b.data, Number{1});
+        };
+        doNotOptimize(a);
+        doNotOptimize(b);
+        doNotOptimize(c);
+        doNotOptimize(zero);
+        // 'operands' arrays of 'size' elements touched, 'flops' operations per element.
+        const auto bench = [&](std::string_view op, double operands, double flops, auto&& fn)
+        {
+            reset();
+            runner.run({"vector", alias + " " + std::string(op), std::string(suffix), size,
+                        operands * size * sizeof(Number), flops * size}, fn);
+        };
+        bench("a += b", 3, 1, [&] { a += b; doNotOptimize(a); });
+        bench("a += s", 2, 1, [&] { a += s; doNotOptimize(a); });
+        bench("a += b * s", 3, 2, [&] { a += b * s; doNotOptimize(a); });
+        bench("a -= b", 3, 1, [&] { a -= b; doNotOptimize(a); });
+        bench("a -= s", 2, 1, [&] { a -= s; doNotOptimize(a); });
+        bench("a -= b * s", 3, 2, [&] { a -= b * s; doNotOptimize(a); });
+        bench("a *= b", 3, 1, [&] { a *= b; doNotOptimize(a); });
+        bench("a *= s", 2, 1, [&] { a *= s; doNotOptimize(a); });
+        bench("a *= b + s", 3, 2, [&] { a *= b + zero; doNotOptimize(a); });
+        bench("c = a + b", 3, 1, [&] { c = a + b; doNotOptimize(c); });
+        bench("c = a - b", 3, 1, [&] { c = a - b; doNotOptimize(c); });
+        bench("c = a * b", 3, 1, [&] { c = a * b; doNotOptimize(c); });
+        bench("c = a * s", 2, 1, [&] { c = a * s; doNotOptimize(c); });
+        bench("c = a + b * s", 3, 2, [&] { c = a + b * s; doNotOptimize(c); });
+        if constexpr (std::is_floating_point_v<Number>)
+            bench("roundOff", 2, 1, [&] { roundOff(a, 2); doNotOptimize(a); });
+    }
+
+    template<uint8_t size, typename Number>
+    void benchMatrix(Runner& runner, std::string_view suffix)
+    {
+        using M = LinAlg::Matrix<size, Number>;
+        constexpr size_t elements = size_t{size} * size;
+        const std::string alias = "Mat" + std::to_string(size) + std::string(suffix);
+        M a, b, c;
+        const Number s{1};
+        doNotOptimize(a);
+        doNotOptimize(b);
+        doNotOptimize(c);
+        const auto bench = [&](std::string_view op, double operands, double flops, auto&& fn)
+        {
+            a = M(Number{1});
+            b = M(Number{1});
+            runner.run({"matrix", alias + " " + std::string(op), std::string(suffix), elements,
+                        operands * elements * sizeof(Number), flops * elements}, fn);
+        };
+        bench("a += b", 3, 1, [&] { a += b; doNotOptimize(a); });
+        bench("a += s", 2, 1, [&] { a += s; doNotOptimize(a); });
+        bench("a += b * s", 3, 2, [&] { a += b * s; doNotOptimize(a); });
+        bench("a -= b", 3, 1, [&] { a -= b; doNotOptimize(a); });
+        bench("a -= s", 2, 1, [&] { a -= s; doNotOptimize(a); });
+        bench("a -= b * s", 3, 2, [&] { a -= b * s; doNotOptimize(a); });
+        bench("a *= s", 2, 1, [&] { a *= s; doNotOptimize(a); });
+        bench("c = a + b", 3, 1, [&] { c = a + b; doNotOptimize(c); });
+        bench("c = a - b", 3, 1, [&] { c = a - b; doNotOptimize(c); });
+        bench("c = a * s", 2, 1, [&] { c = a * s; doNotOptimize(c); });
+        bench("c = a + b * s", 3, 2, [&] { c = a + b * s; doNotOptimize(c); });
+        // n^3 multiply-adds over 3 n^2 elements.
+        bench("matmul", 3, 2.0 * size, [&] { c = LinAlg::matmul(a, b); doNotOptimize(c); });
+        bench("transpose", 2, 0, [&] { c = LinAlg::transpose(a); doNotOptimize(c); });
+        LinAlg::Vector<size, Number> x, y;
+        std::ranges::fill(x.data, Number{1});
+        doNotOptimize(x);
+        // n^2 multiply-adds over n^2 + 2n elements.
+        bench("matvec", 1.0 + 2.0 / size, 2, [&] { y = LinAlg::matvec(a, x); doNotOptimize(y); });
+        if constexpr (std::is_signed_v<Number>)
+        {
+            Number det{};
+            bench("determinant", 1, 0, [&] { det = LinAlg::determinant(a); doNotOptimize(det); });
+        }
+        if constexpr (std::is_floating_point_v<Number>)
+        {
+            // Diagonally dominant, so the inverse is finite.
+            M invertible(Number{1});
+            for (size_t i = 0; i < size; ++i)
+                invertible(i, i) += Number{size};
+            doNotOptimize(invertible);
+            bench("inverse", 2, 0, [&] { c = LinAlg::inverse(invertible); doNotOptimize(c); });
+            bench("roundOff", 2, 1, [&] { roundOff(a, 2); doNotOptimize(a); });
+        }
+    }
+
+    void benchFixed(Runner& runner)
+    {
+        forEachElementType([&]<typename Number>(std::string_view suffix)
+        {
+            benchVector<1, Number>(runner, suffix);
+            benchVector<2, Number>(runner, suffix);
+            benchVector<3, Number>(runner, suffix);
+            benchVector<4, Number>(runner, suffix);
+            benchVector<10, Number>(runner, suffix);
+            benchMatrix<2, Number>(runner, suffix);
+            benchMatrix<3, Number>(runner, suffix);
+            benchMatrix<4, Number>(runner, suffix);
+            benchMatrix<5, Number>(runner, suffix);
+        });
+    }
+
+    // VectorX / MatrixX element-wise operators (parallel above Parallel::minElements).
+    template<typename Number>
+    void benchDynamic(Runner& runner, std::string_view suffix)
+    {
+        const Number s{1};
+        for (const size_t size : {size_t{1} << 10, size_t{1} << 16, size_t{1} << 22})
+        {
+            LinAlg::VectorX<Number> a(size, Number{1}), b(size, Number{1}), c(size);
+            const std::string name = "VectorX<" + std::string(suffix) + "> " + std::to_string(size);
+            const auto bench = [&](std::string_view op, double operands, double flops, auto&& fn)
+            {
+                runner.run({"vectorx", name + " " + std::string(op), std::string(suffix), size,
+                            operands * size * sizeof(Number), flops * size, 0.0, policyThreads()}, fn);
+            };
+            bench("a += b", 3, 1, [&] { a += b; doNotOptimize(a); });
+            bench("a -= b", 3, 1, [&] { a -= b; doNotOptimize(a); });
+            bench("a *= s", 2, 1, [&] { a *= s; doNotOptimize(a); });
+            bench("c = a + b * s", 3, 2, [&] { c = a + b * s; doNotOptimize(c); });
+            bench("c = a * b", 3, 1, [&] { c = a * b; doNotOptimize(c); });
+        }
+        for (const size_t n : {size_t{32}, size_t{256}, size_t{2048}})
+        {
+            LinAlg::MatrixX<Number> a(n, n, Number{1}), b(n, n, Number{1}), c(n, n);
+            const size_t size = n * n;
+            const std::string name = "MatrixX<" + std::string(suffix) + "> " + std::to_string(n) + "x" + std::to_string(n);
+            const auto bench = [&](std::string_view op, double operands, double flops, auto&& fn)
+            {
+                runner.run({"matrixx", name + " " + std::string(op), std::string(suffix), size,
+                            operands * size * sizeof(Number), flops * size, 0.0, policyThreads()}, fn);
+            };
+            bench("a += b", 3, 1, [&] { a += b; doNotOptimize(a); });
+            bench("a += s", 2, 1, [&] { a += s; doNotOptimize(a); });
+            bench("a -= s", 2, 1, [&] { a -= s; doNotOptimize(a); });
+            bench("a *= s", 2, 1, [&] { a *= s; doNotOptimize(a); });
+            bench("a += b * s", 3, 2, [&] { a += b * s; doNotOptimize(a); });
+            bench("c = a + b * s", 3, 2, [&] { c = a + b * s; doNotOptimize(c); });
+            bench("roundOff", 2, 1, [&] { roundOff(a, 2); doNotOptimize(a); });
+        }
+    }
+
+    template<typename Number>
+    void benchProducts(Runner& runner, std::string_view suffix, const LinAlg::Parallel& policy = LinAlg::Parallel::current(),
+                       std::string_view group = "gemm", std::initializer_list<size_t> sizes = {64, 128, 256, 512, 1024})
+    {
+        const size_t threads = policy.threads == 0 ? LinAlg::ThreadPool::global().concurrency()
+                                                   : std::min(policy.threads, LinAlg::ThreadPool::global().concurrency());
+        for (const size_t n : sizes)
+        {
+            LinAlg::MatrixX<Number> a(n, n, Number{1}), b(n, n, Number{1}), c(n, n);
+            const double bytes = 3.0 * n * n * sizeof(Number);
+            const double flops = 2.0 * n * n * n;
+            const std::string suffixName = "<" + std::string(suffix) + "> " + std::to_string(n);
+            runner.run({std::string(group), "gemm" + suffixName, std::string(suffix), n, bytes, flops, 0.0, threads}, [&]
+            {
+                LinAlg::gemm(n, n, n, Number{1}, a.data(), n, size_t{1}, b.data(), n, size_t{1},
+                             Number{}, c.data(), n, size_t{1}, policy);
+                doNotOptimize(c);
+            });
+        }
+    }
+
+    template<typename Number>
+    void benchMatVec(Runner& runner, std::string_view suffix)
+    {
+        for (const size_t n : {size_t{256}, size_t{1024}, size_t{4096}})
+        {
+            LinAlg::MatrixX<Number> a(n, n, Number{1});
+            LinAlg::VectorX<Number> x(n, Number{1}), y(n);
+            const double bytes = (n * n + 2.0 * n) * sizeof(Number);
+            const double flops = 2.0 * n * n;
+            const std::string suffixName = "<" + std::string(suffix) + "> " + std::to_string(n);
+            runner.run({"gemv", "gemv" + suffixName, std::string(suffix), n, bytes, flops, 0.0, policyThreads()}, [&]
+            {
+                LinAlg::gemv(n, n, Number{1}, a.data(), n, size_t{1}, x.data(), size_t{1}, Number{}, y.data(), size_t{1});
+                doNotOptimize(y);
+            });
+            runner.run({"gemv", "matvec" + suffixName, std::string(suffix), n, bytes, flops, 0.0, policyThreads()}, [&]
+            {
+                auto result = LinAlg::matvec(a, x);
+                doNotOptimize(result);
+            });
+        }
+        // matmul = gemm plus the allocation of its result.
+        const size_t n = 256;
+        LinAlg::MatrixX<Number> a(n, n, Number{1}), b(n, n, Number{1});
+        runner.run({"gemm", "matmul<" + std::string(suffix) + "> 256", std::string(suffix), n,
+                    3.0 * n * n * sizeof(Number), 2.0 * n * n * n, 0.0, policyThreads()}, [&]
+        {
+            auto result = LinAlg::matmul(a, b);
+            doNotOptimize(result);
+        });
+    }
+
+    // Reproducible synthetic regression data: y = sum_f (f + 1) * x_f + 0.5 with x in [-1, 1).
+    template<typename Number>
+    struct SyntheticData
+    {
+        std::vector<Number> inputs;
+        std::vector<Number> targets;
+        size_t features = 0;
+
+        SyntheticData(size_t rows, size_t features) : inputs(rows * features), targets(rows, Number(0.5)), features(features)
+        {
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+            for (size_t f = 0; f < features; ++f)
+            {
+                for (size_t r = 0; r < rows; ++r)
+                {
+                    state = state * 6364136223846793005ull + 1442695040888963407ull;
+                    const Number x = static_cast<Number>(static_cast<double>(state >> 11) * 0x1.0p-52 - 1.0);
+                    inputs[f * rows + r] = x;
+                    targets[r] += static_cast<Number>(f + 1) * x / static_cast<Number>(features);
+                }
+            }
+        }
+        [[nodiscard]] auto view() const noexcept { return ML::DatasetView<Number>::packed(inputs, targets, features); }
+    };
+
+    void benchTraining(Runner& runner)
+    {
+        // Start::Run: four samples, per-sample SGD, 500 epochs per call.
+        {
+            const std::array<double, 4> inputs{1.0, 2.0, 4.0, 6.0};
+            const std::array<double, 4> targets{7.0, 14.0, 28.0, 42.0};
+            const auto data = ML::DatasetView<double>::packed(inputs, targets, 1);
+            const ML::TrainConfig config{.epochs = 500, .batchSize = 1, .learningRate = 0.05};
+            runner.run({"train", "Start::Run sgd 4x1", "d", 4, 0.0, 0.0, 500.0 * 4}, [&]
+            {
+                ML::LinearModel<double> model(1, 0.5, 0.0);
+                auto result = ML::trainLinear(model, data, config);
+                doNotOptimize(result);
+            });
+        }
+        // Mini-batch linear regression, one epoch per call.
+        const auto linear = [&]<typename Number>(std::string_view suffix)
+        {
+            const size_t rows = size_t{1} << 16, features = 16;
+            const SyntheticData<Number> data(rows, features);
+            ML::LinearModel<Number> model(features);
+            const ML::TrainConfig config{.epochs = 1, .batchSize = 256, .learningRate = 0.05};
+            runner.run({"train", "linear<" + std::string(suffix) + "> 65536x16 batch 256", std::string(suffix), rows,
+                        static_cast<double>((features + 1) * rows * sizeof(Number)), 4.0 * features * rows,
+                        static_cast<double>(rows), policyThreads()}, [&]
+            {
+                auto result = ML::trainLinear(model, data.view(), config);
+                doNotOptimize(result);
+            });
+            // The same epoch from a DataPipeline that reshuffles and gathers the rows on two producer threads.
+            ML::DataPipeline<Number> pipeline(data.view(), {.batchSize = 256, .workers = 2});
+            runner.run({"train", "linear<" + std::string(suffix) + "> 65536x16 batch 256 pipeline", std::string(suffix), rows,
+                        static_cast<double>((features + 1) * rows * sizeof(Number)), 4.0 * features * rows,
+                        static_cast<double>(rows), policyThreads()}, [&]
+            {
+                auto result = ML::trainLinear(model, pipeline, config);
+                doNotOptimize(result);
+            });
+        };
+        linear.template operator()<float>("f");
+        linear.template operator()<double>("d");
+        // 16 -> 32 (tanh) -> 1 MLP, one epoch per call.
+        const auto mlp = [&]<typename Number>(std::string_view suffix)
+        {
+            const size_t rows = size_t{1} << 13, features = 16, hidden = 32;
+            const SyntheticData<Number> data(rows, features);
+            ML::Mlp<Number> net({{features, hidden, ML::Activation::Tanh}, {hidden, 1, ML::Activation::Identity}}, 1);
+            const ML::TrainConfig config{.epochs = 1, .batchSize = 64, .learningRate = 0.05};
+            // forward + backward = 3 products of 2 * in * out flops per sample and layer
+            const double flops = 6.0 * (features * hidden + hidden) * rows;
+            runner.run({"train", "mlp<" + std::string(suffix) + "> 16-32-1 batch 64", std::string(suffix), rows,
+                        static_cast<double>((features + 1) * rows * sizeof(Number)), flops,
+                        static_cast<double>(rows), policyThreads()}, [&]
+            {
+                auto result = ML::trainMlp(net, data.view(), config);
+                doNotOptimize(result);
+            });
+        };
+        mlp.template operator()<float>("f");
+        mlp.template operator()<double>("d");
+    }
+
+    // One op over 2^20 small elements: the std::vector of Vector / Matrix loop against Batch
+    // (structure of arrays, results written into preallocated buffers on both sides).
+    void benchBatch(Runner& runner)
+    {
+        const size_t n = size_t{1} << 20;
+        std::vector<LinAlg::V3f> a(n, LinAlg::V3f{1.0f, 2.0f, 3.0f}), b(n, LinAlg::V3f{3.0f, 2.0f, 1.0f});
+        std::vector<float> dots(n);
+        const LinAlg::BatchV3f batchA(a), batchB(b);
+        LinAlg::VectorX<float> batchDots(n);
+        const double dotBytes = 7.0 * n * sizeof(float), dotFlops = 5.0 * n;
+        runner.run({"batch", "aos V3f dot 1M", "f", n, dotBytes, dotFlops}, [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+                dots[i] = a[i].x() * b[i].x() + a[i].y() * b[i].y() + a[i].z() * b[i].z();
+            doNotOptimize(dots);
+        });
+        runner.run({"batch", "BatchV3f dot 1M", "f", n, dotBytes, dotFlops, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::dot(batchA, batchB, batchDots);
+            doNotOptimize(batchDots);
+        });
+
+        LinAlg::Mat4f m(0.5f);
+        std::vector<LinAlg::V4f> points(n, LinAlg::V4f{1.0f, 2.0f, 3.0f, 1.0f}), moved(n);
+        const LinAlg::BatchV4f batchPoints(points);
+        LinAlg::BatchV4f batchMoved(n);
+        const double transformBytes = 8.0 * n * sizeof(float), transformFlops = 32.0 * n;
+        runner.run({"batch", "aos Mat4f * V4f 1M", "f", n, transformBytes, transformFlops}, [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+                moved[i] = LinAlg::matvec(m, points[i]);
+            doNotOptimize(moved);
+        });
+        runner.run({"batch", "BatchV4f transform 1M", "f", n, transformBytes, transformFlops, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::transform(m, batchPoints, batchMoved);
+            doNotOptimize(batchMoved);
+        });
+
+        for (size_t i = 0; i < 4; ++i)
+            m(i, i) += 4.0f;
+        std::vector<LinAlg::Mat4f> matrices(n, m), products(n);
+        const LinAlg::BatchMat4f batchMatrices(matrices);
+        LinAlg::BatchMat4f batchProducts(n);
+        const double matmulBytes = 48.0 * n * sizeof(float), matmulFlops = 128.0 * n;
+        runner.run({"batch", "aos Mat4f matmul 1M", "f", n, matmulBytes, matmulFlops}, [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+                products[i] = LinAlg::matmul(matrices[i], matrices[i]);
+            doNotOptimize(products);
+        });
+        runner.run({"batch", "BatchMat4f matmul 1M", "f", n, matmulBytes, matmulFlops, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::matmul(batchMatrices, batchMatrices, batchProducts);
+            doNotOptimize(batchProducts);
+        });
+        runner.run({"batch", "aos Mat4f inverse 1M", "f", n, 32.0 * n * sizeof(float), 0.0}, [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+                products[i] = LinAlg::inverse(matrices[i]);
+            doNotOptimize(products);
+        });
+        runner.run({"batch", "BatchMat4f inverse 1M", "f", n, 32.0 * n * sizeof(float), 0.0, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::inverse(batchMatrices, batchProducts);
+            doNotOptimize(batchProducts);
+        });
+    }
+
+    // Reductions over 2^22 elements, next to the one-accumulator loop they replace.
+    template<typename Number>
+    void benchReduce(Runner& runner, std::string_view suffix)
+    {
+        using F = LinAlg::ComputeType<Number>;
+        const size_t size = size_t{1} << 22;
+        LinAlg::VectorX<Number> a(size), b(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            a[i] = static_cast<Number>(static_cast<F>(i % 1000) * F(1e-3));
+            b[i] = static_cast<Number>(F(1) - static_cast<F>(i % 7) * F(0.125));
+        }
+        const std::string name = "VectorX<" + std::string(suffix) + "> " + std::to_string(size);
+        const auto bench = [&](std::string_view op, double operands, double flops, size_t threads, auto&& fn)
+        {
+            runner.run({"reduce", name + " " + std::string(op), std::string(suffix), size,
+                        operands * size * sizeof(Number), flops * size, 0.0, threads}, fn);
+        };
+        bench("loop sum", 1, 1, 1, [&]
+        {
+            F total{};
+            for (size_t i = 0; i < size; ++i)
+                total += static_cast<F>(a[i]);
+            doNotOptimize(total);
+        });
+        using LinAlg::Summation;
+        bench("sum", 1, 1, policyThreads(), [&] { auto r = a.sum(); doNotOptimize(r); });
+        bench("sum kahan", 1, 1, policyThreads(), [&] { auto r = a.sum({.summation = Summation::Kahan}); doNotOptimize(r); });
+        bench("sum reproducible", 1, 1, policyThreads(), [&] { auto r = a.sum({.reproducible = true}); doNotOptimize(r); });
+        bench("dot", 2, 2, policyThreads(), [&] { auto r = a.dot(b); doNotOptimize(r); });
+        bench("norm", 1, 2, policyThreads(), [&] { auto r = a.norm(); doNotOptimize(r); });
+        bench("argmax", 2, 1, policyThreads(), [&] { auto r = a.argmax(); doNotOptimize(r); });
+    }
+
+    // Inference of a 64-256-256-10 MLP: the float network against its int8 / uint8 version.
+    void benchQuantized(Runner& runner)
+    {
+        const size_t rows = 1024, features = 64, hidden = 256, classes = 10;
+        const SyntheticData<float> data(rows, features);
+        ML::Mlp<float> net({{features, hidden, ML::Activation::ReLU}, {hidden, hidden, ML::Activation::ReLU},
+                            {hidden, classes, ML::Activation::Identity}}, 1);
+        ML::QuantizedMlp<float> quantized(net, data.view());
+        const double flops = 2.0 * (features * hidden + hidden * hidden + hidden * classes) * rows;
+        const double weights = static_cast<double>(features * hidden + hidden * hidden + hidden * classes);
+        runner.run({"quantized", "mlp<f> 64-256-256-10 forward 1024", "f", rows, weights * sizeof(float) +
+                    static_cast<double>(rows * features * sizeof(float)), flops, static_cast<double>(rows), policyThreads()}, [&]
+        {
+            doNotOptimize(net.forward(data.inputs.data(), rows, size_t{1}, rows));
+        });
+        runner.run({"quantized", "mlp<u8*s8> 64-256-256-10 forward 1024", "u8", rows, static_cast<double>(quantized.weightBytes()) +
+                    static_cast<double>(rows * features * sizeof(float)), flops, static_cast<double>(rows), policyThreads()}, [&]
+        {
+            doNotOptimize(quantized.forward(data.inputs.data(), rows, size_t{1}, rows));
+        });
+    }
+
+    // 1% dense 16384 x 16384 matrix: CSR SpMV, transposed SpMV (scatter) and SpMM with 32 columns,
+    // then sparse linear regression over 2^16 rows of 2^16 hashed features (16 per row).
+    void benchSparse(Runner& runner)
+    {
+        const size_t n = 16384, perRow = n / 100, k = 32;
+        std::vector<LinAlg::Triplet<float>> triplets;
+        triplets.reserve(n * perRow);
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        const auto next = [&] { return (state = state * 6364136223846793005ull + 1442695040888963407ull) >> 33; };
+        for (size_t r = 0; r < n; ++r)
+            for (size_t e = 0; e < perRow; ++e)
+                triplets.push_back({r, next() % n, 1.0f});
+        const auto a = LinAlg::CsrMatrix<float>::fromTriplets(n, n, triplets);
+        const double nnz = static_cast<double>(a.nonZeros());
+        LinAlg::VectorX<float> x(n, 1.0f), y(n);
+        runner.run({"sparse", "spmv<f> csr 16384 1%", "f", n, static_cast<double>(a.bytes()) + 2.0 * n * sizeof(float),
+                    2.0 * nnz, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::spmv(1.0f, a.view(), x.data(), size_t{1}, 0.0f, y.data(), size_t{1});
+            doNotOptimize(y);
+        });
+        runner.run({"sparse", "spmvTransposed<f> csr 16384 1%", "f", n, static_cast<double>(a.bytes()) + 2.0 * n * sizeof(float),
+                    2.0 * nnz, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::spmvTransposed(1.0f, a.view(), x.data(), size_t{1}, 0.0f, y.data(), size_t{1});
+            doNotOptimize(y);
+        });
+        LinAlg::MatrixX<float> b(n, k, 1.0f), c(n, k);
+        runner.run({"sparse", "spmm<f> csr 16384 1% x 32", "f", n, static_cast<double>(a.bytes()) + 2.0 * n * k * sizeof(float),
+                    2.0 * nnz * k, 0.0, policyThreads()}, [&]
+        {
+            LinAlg::spmm(k, 1.0f, a.view(), b.data(), k, size_t{1}, 0.0f, c.data(), k, size_t{1});
+            doNotOptimize(c);
+        });
+
+        const size_t rows = size_t{1} << 16, features = size_t{1} << 16, active = 16;
+        triplets.clear();
+        std::vector<float> targets(rows, 0.5f);
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t e = 0; e < active; ++e)
+            {
+                const size_t f = next() % features;
+                triplets.push_back({r, f, 1.0f});
+                targets[r] += static_cast<float>(f % 7) / 7.0f;
+            }
+        const auto data = LinAlg::CsrMatrix<float>::fromTriplets(rows, features, triplets);
+        ML::LinearModel<float> model(features);
+        const ML::TrainConfig config{.epochs = 1, .batchSize = 256, .learningRate = 0.05};
+        runner.run({"train", "linear<f> sparse 65536x65536 16/row batch 256", "f", rows, static_cast<double>(data.bytes()),
+                    4.0 * static_cast<double>(data.nonZeros()), static_cast<double>(rows), policyThreads()}, [&]
+        {
+            auto result = ML::trainLinear(model, data.view(), std::span<const float>(targets), config);
+            doNotOptimize(result);
+        });
+    }
+
+    // Opening a checkpoint of a 512-2048-2048-10 MLP (~20 MB of float weights): the mapped,
+    // index-checked open that serving starts with, a full checksum pass and a copy into a net.
+    void benchCheckpoint(Runner& runner)
+    {
+        ML::Mlp<float> net({{512, 2048, ML::Activation::ReLU}, {2048, 2048, ML::Activation::ReLU}, {2048, 10}});
+        const auto path = std::filesystem::temp_directory_path() / "LinAlgBenchmarks.ckpt";
+        ML::saveCheckpoint(path, net);
+        const auto fileSize = static_cast<double>(std::filesystem::file_size(path));
+        runner.run({"checkpoint", "open mlp<f> 20 MB", "f", net.layers().size(), 4096.0, 0.0}, [&]
+        {
+            const ML::MappedCheckpoint checkpoint(path);
+            auto tensors = checkpoint.size();
+            doNotOptimize(tensors);
+        });
+        runner.run({"checkpoint", "open + verify mlp<f> 20 MB", "f", net.layers().size(), fileSize, 0.0}, [&]
+        {
+            const ML::MappedCheckpoint checkpoint(path, ML::CheckpointVerify::Full);
+            auto tensors = checkpoint.size();
+            doNotOptimize(tensors);
+        });
+        const ML::MappedCheckpoint checkpoint(path);
+        runner.run({"checkpoint", "load mlp<f> 20 MB", "f", net.layers().size(), 2.0 * fileSize, 0.0}, [&]
+        {
+            ML::loadCheckpoint(checkpoint, net);
+            doNotOptimize(net);
+        });
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+
+    // The direct solvers on n x n (QR: 2n x n) double matrices, and the closed-form fit against
+    // one epoch of trainLinear on the same data.
+    void benchSolvers(Runner& runner)
+    {
+        for (const size_t n : {256, 1024})
+        {
+            const SyntheticData<double> random(n, n);
+            LinAlg::MatrixX<double> a(n, n), spd(n, n), tall(2 * n, n);
+            std::copy_n(random.inputs.data(), n * n, a.data());
+            LinAlg::gemm(n, n, n, 1.0, a.data(), size_t{1}, n, a.data(), n, size_t{1}, 0.0, spd.data(), n, size_t{1});
+            for (size_t i = 0; i < n; ++i)
+                spd(i, i) += static_cast<double>(n);
+            for (size_t i = 0; i < 2 * n; ++i)
+                for (size_t j = 0; j < n; ++j)
+                    tall(i, j) = a(i % n, (j + i / n) % n);
+            const double cube = static_cast<double>(n) * n * n;
+            const std::string size = std::to_string(n);
+            runner.run({"solve", "lu " + size, "d", n, 16.0 * n * n, 2.0 * cube / 3.0, 0.0, policyThreads()}, [&]
+            {
+                LinAlg::LuDecomposition lu(a);
+                doNotOptimize(lu);
+            });
+            runner.run({"solve", "cholesky " + size, "d", n, 16.0 * n * n, cube / 3.0, 0.0, policyThreads()}, [&]
+            {
+                LinAlg::CholeskyDecomposition cholesky(spd);
+                doNotOptimize(cholesky);
+            });
+            runner.run({"solve", "qr " + std::to_string(2 * n) + "x" + size, "d", n, 32.0 * n * n,
+                        4.0 * cube - 2.0 * cube / 3.0, 0.0, policyThreads()}, [&]
+            {
+                LinAlg::QrDecomposition qr(tall);
+                doNotOptimize(qr);
+            });
+        }
+        const size_t rows = size_t{1} << 16, features = 256;
+        const SyntheticData<float> data(rows, features);
+        runner.run({"solve", "fitLinear<f> 65536x256 cholesky", "f", rows, static_cast<double>((features + 1) * rows * sizeof(float)),
+                    2.0 * features * features * rows, static_cast<double>(rows), policyThreads()}, [&]
+        {
+            auto model = ML::fitLinear(data.view(), {.ridge = 1e-3});
+            doNotOptimize(model);
+        });
+        ML::LinearModel<float> model(features);
+        runner.run({"solve", "trainLinear<f> 65536x256 1 epoch", "f", rows, static_cast<double>((features + 1) * rows * sizeof(float)),
+                    4.0 * features * rows, static_cast<double>(rows), policyThreads()}, [&]
+        {
+            auto result = ML::trainLinear(model, data.view(), {.epochs = 1, .batchSize = 256, .learningRate = 0.01});
+            doNotOptimize(result);
+        });
+    }
+
+    // The fused optimizer steps against the same update put together from the element-wise
+    // kernels, one pass per kernel (bytes: the fused pass's traffic), in cache and from memory.
+    void benchOptimizers(Runner& runner)
+    {
+        for (const size_t n : {size_t{1} << 16, size_t{1} << 22})
+        {
+            LinAlg::VectorX<float> w(n, 1.0f), g(n, 0.5f), m(n), v(n), scratch(n);
+            const ML::Parameter<float> slot[]{{w.data(), g.data(), n}};
+            const std::string size = std::to_string(n);
+            const float lr = 1e-6f, momentum = 0.9f, beta1 = 0.9f, beta2 = 0.999f;
+
+            runner.run({"optimizer", "sgd momentum 3 passes " + size, "f", n, 5.0 * n * sizeof(float), 3.0 * n}, [&]
+            {
+                LinAlg::Simd::mulScalar(m.data(), m.data(), momentum, n);
+                LinAlg::Simd::add(m.data(), m.data(), g.data(), n);
+                LinAlg::Simd::axpy(w.data(), m.data(), -lr, n);
+                doNotOptimize(w);
+            });
+            ML::Sgd<float> sgd({.learningRate = {.initial = lr}, .momentum = momentum});
+            runner.run({"optimizer", "sgd momentum fused " + size, "f", n, 5.0 * n * sizeof(float), 3.0 * n}, [&]
+            {
+                sgd.step(slot);
+                doNotOptimize(w);
+            });
+
+            runner.run({"optimizer", "adam 6 passes " + size, "f", n, 7.0 * n * sizeof(float), 11.0 * n}, [&]
+            {
+                LinAlg::Simd::mulScalar(m.data(), m.data(), beta1, n);
+                LinAlg::Simd::axpy(m.data(), g.data(), 1.0f - beta1, n);
+                LinAlg::Simd::mul(scratch.data(), g.data(), g.data(), n);
+                LinAlg::Simd::mulScalar(v.data(), v.data(), beta2, n);
+                LinAlg::Simd::axpy(v.data(), scratch.data(), 1.0f - beta2, n);
+                for (size_t i = 0; i < n; ++i)
+                    w[i] -= lr * m[i] / (std::sqrt(v[i]) + 1e-8f);
+                doNotOptimize(w);
+            });
+            ML::Adam<float> adam({.learningRate = {.initial = lr}});
+            runner.run({"optimizer", "adam fused " + size, "f", n, 7.0 * n * sizeof(float), 11.0 * n}, [&]
+            {
+                adam.step(slot);
+                doNotOptimize(w);
+            });
+        }
+    }
+
+    // Strided views: a transposed add through the gather blocks against the plain double loop,
+    // and a product of two blocks (one transposed) in place against copying them out first.
+    void benchViews(Runner& runner)
+    {
+        const size_t n = 2048, k = 512;
+        LinAlg::MatrixX<float> a(n, n, 1.0f), b(n, n, 0.5f), c(k, k);
+        runner.run({"view", "a += b^T loop 2048", "f", n * n, 3.0 * n * n * sizeof(float), 1.0 * n * n}, [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n; ++j)
+                    a(i, j) += b(j, i);
+            doNotOptimize(a);
+        });
+        runner.run({"view", "a += b^T view 2048", "f", n * n, 3.0 * n * n * sizeof(float), 1.0 * n * n}, [&]
+        {
+            a.view() += b.view().transpose();
+            doNotOptimize(a);
+        });
+
+        const double flops = 2.0 * k * k * k;
+        runner.run({"view", "block gemm copied 512", "f", k, 3.0 * k * k * sizeof(float), flops}, [&]
+        {
+            const LinAlg::MatrixX<float> left(a.block(k, 0, k, k)), right(b.block(0, k, k, k).transpose());
+            c = LinAlg::matmul(left, right);
+            doNotOptimize(c);
+        });
+        runner.run({"view", "block gemm view 512", "f", k, 3.0 * k * k * sizeof(float), flops}, [&]
+        {
+            LinAlg::gemm(1.0f, a.block(k, 0, k, k), b.block(0, k, k, k).transpose(), 0.0f, c.view());
+            doNotOptimize(c);
+        });
+    }
+
+    // Scaling of the parallel kernels with the number of threads one call may use.
+    void benchThreads(Runner& runner)
+    {
+        const size_t pool = LinAlg::ThreadPool::global().concurrency();
+        std::vector<size_t> counts;
+        for (size_t t = 1; t < pool; t *= 2)
+            counts.push_back(t);
+        counts.push_back(pool);
+
+        const size_t n = 2048;
+        LinAlg::MatrixX<float> a(n, n, 1.0f), b(n, n, 1.0f);
+        for (const size_t threads : counts)
+        {
+            const LinAlg::Parallel policy{.threads = threads};
+            benchProducts<double>(runner, "d", policy, "threads", {1024});
+            LinAlg::ParallelScope scope(policy);
+            runner.run({"threads", "MatrixX<f> 2048x2048 a += b * s", "f", n * n, 3.0 * n * n * sizeof(float),
+                        2.0 * n * n, 0.0, threads}, [&]
+            {
+                a += b * 1.0f;
+                doNotOptimize(a);
+            });
+        }
+    }
+
+    // The same kernels on every SIMD path the CPU supports (Simd::setActiveIsa).
+    void benchIsa(Runner& runner)
+    {
+        using LinAlg::Simd::Isa;
+        const size_t size = size_t{1} << 14;
+        LinAlg::VectorX<float> a(size, 1.0f), b(size, 1.0f), c(size);
+        for (const Isa isa : {Isa::Scalar, Isa::SSE41, Isa::AVX2, Isa::AVX512})
+        {
+            if (isa > LinAlg::Simd::detectIsa())
+                break;
+            LinAlg::Simd::setActiveIsa(isa);
+            const std::string prefix = std::string(isaName(isa)) + " ";
+            runner.run({"isa", prefix + "VectorX<f> 16384 a += b", "f", size, 3.0 * size * sizeof(float), 1.0 * size}, [&]
+            {
+                a += b;
+                doNotOptimize(a);
+            });
+            runner.run({"isa", prefix + "VectorX<f> 16384 c = a + b * s", "f", size, 3.0 * size * sizeof(float), 2.0 * size}, [&]
+            {
+                c = a + b * 1.0f;
+                doNotOptimize(c);
+            });
+            runner.run({"isa", prefix + "VectorX<f> 16384 roundOff", "f", size, 2.0 * size * sizeof(float), 1.0 * size}, [&]
+            {
+                roundOff(c, 2);
+                doNotOptimize(c);
+            });
+            benchProducts<float>(runner, "f", LinAlg::Parallel{.threads = 1}, "isa", {256});
+        }
+        LinAlg::Simd::setActiveIsa(LinAlg::Simd::detectIsa());
+    }
+
+    void usage()
+    {
+        std::println(stderr, "usage: LinAlgBenchmarks [--filter <text>] [--json <path>] [--quick] [--samples <n>]");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (arg == "--json" && i + 1 < argc)
+            options.json = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc)
+            options.samples = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--quick")
+        {
+            options.sampleSeconds = 2e-4;
+            options.samples = 7;
+            options.caseSeconds = 0.05;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    Runner runner(options);
+    benchFixed(runner);
+    benchDynamic<float>(runner, "f");
+    benchDynamic<double>(runner, "d");
+    benchDynamic<LinAlg::Float16>(runner, "h");
+    benchDynamic<LinAlg::BFloat16>(runner, "bf");
+    benchProducts<float>(runner, "f");
+    benchProducts<double>(runner, "d");
+    benchMatVec<float>(runner, "f");
+    benchMatVec<double>(runner, "d");
+    benchMatVec<LinAlg::Float16>(runner, "h");
+    benchMatVec<LinAlg::BFloat16>(runner, "bf");
+    benchBatch(runner);
+    benchReduce<float>(runner, "f");
+    benchReduce<double>(runner, "d");
+    benchReduce<LinAlg::Float16>(runner, "h");
+    benchTraining(runner);
+    benchQuantized(runner);
+    benchSparse(runner);
+    benchCheckpoint(runner);
+    benchSolvers(runner);
+    benchOptimizers(runner);
+    benchViews(runner);
+    benchThreads(runner);
+    benchIsa(runner);
+
+    if (!options.json.empty())
+    {
+        std::FILE* file = std::fopen(options.json.c_str(), "w");
+        if (file == nullptr)
+        {
+            std::println(stderr, "LinAlgBenchmarks: cannot write {}", options.json);
+            return 1;
+        }
+        runner.writeJson(file);
+        std::fclose(file);
+    }
+    return 0;
+}
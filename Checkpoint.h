@@ -0,0 +1,513 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "Training.h"
+#include "Layers.h"
+#include "Dataset.h"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <initializer_list>
+#include <limits>
+#include <cassert>
+namespace ML
+{
+    // Versioned binary checkpoint of named tensors, laid out so a serving process can map the file
+    // and run on the weights where they are:
+    //
+    //   [CheckpointHeader, 64 bytes]
+    //   [TensorEntry 0 .. n-1, 128 bytes each]        <- indexOffset
+    //   [tensor 0 values][padding up to 'alignment']   <- entry.offset
+    //   [tensor 1 values][padding]
+    //   ...
+    //
+    // Every tensor starts on an 'alignment' byte boundary (64 by default), row-major with shape[0]
+    // the slowest dimension, in the machine's native little-endian representation. XXH64 checksums
+    // cover the header, the index and every tensor.
+    // MappedCheckpoint maps the file read-only and its TensorViews point straight into the mapping:
+    // opening reads a header and an index, not the weights, and every process mapping the same file
+    // shares the same physical pages. MappedMlp serves an Mlp from those pages; loadCheckpoint
+    // copies them into a model that is trained further.
+    // A checkpoint is written to '<path>.tmp' and renamed over 'path', so readers never see half a
+    // file, and processes still mapping the previous version keep reading it undisturbed.
+    struct CheckpointHeader
+    {
+        static constexpr char MAGIC[8] = {'M', 'L', '2', '6', 'C', 'K', 'P', 'T'};
+        static constexpr uint32_t VERSION = 1;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t tensorCount;
+        uint64_t alignment;       // bytes, power of two
+        uint64_t indexOffset;     // bytes from the start of the file
+        uint64_t dataOffset;      // first tensor
+        uint64_t fileSize;
+        uint64_t indexChecksum;   // XXH64 of the tensorCount entries
+        uint64_t headerChecksum;  // XXH64 of the header bytes before this field
+    };
+    static_assert(sizeof(CheckpointHeader) == 64 && std::is_trivially_copyable_v<CheckpointHeader>);
+
+    struct TensorEntry
+    {
+        static constexpr size_t MAX_RANK = 4;
+
+        char name[64];              // NUL-terminated
+        DType dtype;
+        uint32_t rank;              // 0 for a scalar
+        uint64_t shape[MAX_RANK];   // dimensions past 'rank' are 1
+        uint64_t offset;            // bytes from the start of the file
+        uint64_t bytes;
+        uint64_t checksum;          // XXH64 of the values
+
+        [[nodiscard]] std::string_view key() const noexcept { return {name, ::strnlen(name, sizeof(name))}; }
+        [[nodiscard]] uint64_t elements() const noexcept { return shape[0] * shape[1] * shape[2] * shape[3]; }
+    };
+    static_assert(sizeof(TensorEntry) == 128 && std::is_trivially_copyable_v<TensorEntry>);
+
+    namespace detail
+    {
+        // XXH64 with seed 0, the reference algorithm (any xxhash tool can check a file).
+        inline constexpr uint64_t XXH_PRIME1 = 0x9E3779B185EBCA87ull;
+        inline constexpr uint64_t XXH_PRIME2 = 0xC2B2AE3D27D4EB4Full;
+        inline constexpr uint64_t XXH_PRIME3 = 0x165667B19E3779F9ull;
+        inline constexpr uint64_t XXH_PRIME4 = 0x85EBCA77C2B2AE63ull;
+        inline constexpr uint64_t XXH_PRIME5 = 0x27D4EB2F165667C5ull;
+
+        inline uint64_t xxhRound(uint64_t acc, uint64_t input) noexcept
+        {
+            return std::rotl(acc + input * XXH_PRIME2, 31) * XXH_PRIME1;
+        }
+        inline uint64_t xxhMerge(uint64_t acc, uint64_t value) noexcept
+        {
+            return (acc ^ xxhRound(0, value)) * XXH_PRIME1 + XXH_PRIME4;
+        }
+        template<typename T>
+        inline T readLittle(const std::byte* p) noexcept
+        {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        inline uint64_t xxh64(const std::byte* data, size_t size) noexcept
+        {
+            const std::byte* p = data;
+            const std::byte* const end = data + size;
+            uint64_t h;
+            if (size >= 32)
+            {
+                uint64_t v1 = XXH_PRIME1 + XXH_PRIME2, v2 = XXH_PRIME2, v3 = 0, v4 = 0 - XXH_PRIME1;
+                for (; p + 32 <= end; p += 32)
+                {
+                    v1 = xxhRound(v1, readLittle<uint64_t>(p));
+                    v2 = xxhRound(v2, readLittle<uint64_t>(p + 8));
+                    v3 = xxhRound(v3, readLittle<uint64_t>(p + 16));
+                    v4 = xxhRound(v4, readLittle<uint64_t>(p + 24));
+                }
+                h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+                h = xxhMerge(xxhMerge(xxhMerge(xxhMerge(h, v1), v2), v3), v4);
+            }
+            else
+                h = XXH_PRIME5;
+            h += size;
+            for (; p + 8 <= end; p += 8)
+                h = std::rotl(h ^ xxhRound(0, readLittle<uint64_t>(p)), 27) * XXH_PRIME1 + XXH_PRIME4;
+            if (p + 4 <= end)
+            {
+                h = std::rotl(h ^ readLittle<uint32_t>(p) * XXH_PRIME1, 23) * XXH_PRIME2 + XXH_PRIME3;
+                p += 4;
+            }
+            for (; p < end; ++p)
+                h = std::rotl(h ^ std::to_integer<uint64_t>(*p) * XXH_PRIME5, 11) * XXH_PRIME1;
+            h ^= h >> 33;
+            h *= XXH_PRIME2;
+            h ^= h >> 29;
+            h *= XXH_PRIME3;
+            h ^= h >> 32;
+            return h;
+        }
+        inline uint64_t xxh64(const void* data, size_t size) noexcept
+        {
+            return xxh64(static_cast<const std::byte*>(data), size);
+        }
+
+        constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    // Read-only tensor of a mapped checkpoint, seen as a row-major matrix: rows() is the first
+    // dimension, cols() the product of the others (a vector is a column, a scalar 1 x 1).
+    // values points into the mapping and stays valid for as long as the MappedCheckpoint lives.
+    template<TensorElement Number>
+    struct TensorView
+    {
+        std::span<const Number> values;
+        std::array<uint64_t, TensorEntry::MAX_RANK> shape{1, 1, 1, 1};
+        uint32_t rank = 0;
+
+        [[nodiscard]] size_t size() const noexcept { return values.size(); }
+        [[nodiscard]] const Number* data() const noexcept { return values.data(); }
+        [[nodiscard]] size_t rows() const noexcept { return shape[0]; }
+        [[nodiscard]] size_t cols() const noexcept { return shape[1] * shape[2] * shape[3]; }
+        [[nodiscard]] const Number& operator[](size_t i) const noexcept { return values[i]; }
+        [[nodiscard]] const Number& operator()(size_t r, size_t c) const noexcept
+        {
+            assert(r < rows() && c < cols());
+            return values[r * cols() + c];
+        }
+        // The same rows() x cols() elements as a LinAlg view, for gemm / matvec on the mapped pages.
+        [[nodiscard]] auto matrix() const noexcept -> LinAlg::MatrixView<const Number>
+        {
+            return {data(), rows(), cols(), cols()};
+        }
+    };
+
+    // Collects named tensors and writes them as one checkpoint. Only the spans are recorded: the
+    // values must stay alive (and unchanged) until write().
+    class CheckpointWriter
+    {
+    public:
+        // shape lists the dimensions ({} for a scalar); their product must be values.size().
+        // Throws std::invalid_argument for an empty, too long or repeated name, more than MAX_RANK
+        // dimensions or a shape that does not match the values.
+        template<TensorElement Number>
+        CheckpointWriter& add(std::string_view name, std::span<const Number> values, std::initializer_list<uint64_t> shape)
+        {
+            if (name.empty() || name.size() >= sizeof(TensorEntry::name))
+                throw std::invalid_argument("checkpoint tensor name must have 1 to " +
+                                            std::to_string(sizeof(TensorEntry::name) - 1) + " characters: '" + std::string(name) + "'");
+            if (shape.size() > TensorEntry::MAX_RANK)
+                throw std::invalid_argument("checkpoint tensor '" + std::string(name) + "' has more than " +
+                                            std::to_string(TensorEntry::MAX_RANK) + " dimensions");
+            if (std::ranges::any_of(m_tensors, [&](const Pending& t) { return t.entry.key() == name; }))
+                throw std::invalid_argument("duplicate checkpoint tensor '" + std::string(name) + "'");
+            TensorEntry entry{};
+            name.copy(entry.name, name.size());
+            entry.dtype = dtypeOf<Number>();
+            entry.rank = static_cast<uint32_t>(shape.size());
+            std::ranges::fill(entry.shape, uint64_t{1});
+            std::ranges::copy(shape, entry.shape);
+            entry.bytes = values.size_bytes();
+            if (entry.elements() != values.size())
+                throw std::invalid_argument("checkpoint tensor '" + std::string(name) + "': shape does not match its " +
+                                            std::to_string(values.size()) + " values");
+            m_tensors.push_back({entry, reinterpret_cast<const std::byte*>(values.data())});
+            return *this;
+        }
+        template<TensorElement Number>
+        CheckpointWriter& add(std::string_view name, std::span<const Number> values)
+        {
+            return add(name, values, {values.size()});
+        }
+        template<TensorElement Number, typename Allocator>
+        CheckpointWriter& add(std::string_view name, const LinAlg::MatrixX<Number, Allocator>& matrix)
+        {
+            return add(name, std::span<const Number>(matrix.data(), matrix.size()), {matrix.rows(), matrix.cols()});
+        }
+        template<TensorElement Number, typename Allocator>
+        CheckpointWriter& add(std::string_view name, const LinAlg::VectorX<Number, Allocator>& vector)
+        {
+            return add(name, std::span<const Number>(vector.data(), vector.size()));
+        }
+        template<TensorElement Number>
+        CheckpointWriter& addScalar(std::string_view name, const Number& value)
+        {
+            return add(name, std::span<const Number>(&value, 1), {});
+        }
+
+        // Throws std::runtime_error / std::filesystem::filesystem_error when the file cannot be written.
+        void write(const std::filesystem::path& path, size_t alignment = 64) const
+        {
+            CheckpointHeader header{};
+            std::memcpy(header.magic, CheckpointHeader::MAGIC, sizeof(CheckpointHeader::MAGIC));
+            header.version = CheckpointHeader::VERSION;
+            header.tensorCount = static_cast<uint32_t>(m_tensors.size());
+            header.alignment = std::max<uint64_t>(std::bit_ceil(alignment), alignof(TensorEntry));
+            header.indexOffset = sizeof(CheckpointHeader);
+            header.dataOffset = detail::alignUp(header.indexOffset + m_tensors.size() * sizeof(TensorEntry), header.alignment);
+            std::vector<TensorEntry> index;
+            index.reserve(m_tensors.size());
+            uint64_t offset = header.dataOffset;
+            for (const Pending& tensor : m_tensors)
+            {
+                index.push_back(tensor.entry);
+                index.back().offset = offset;
+                index.back().checksum = detail::xxh64(tensor.values, tensor.entry.bytes);
+                offset = detail::alignUp(offset + tensor.entry.bytes, header.alignment);
+            }
+            header.fileSize = offset;
+            header.indexChecksum = detail::xxh64(index.data(), index.size() * sizeof(TensorEntry));
+            header.headerChecksum = detail::xxh64(&header, offsetof(CheckpointHeader, headerChecksum));
+
+            std::filesystem::path staging = path;
+            staging += ".tmp";
+            try
+            {
+                {
+                    auto file = detail::FileMapping::create(staging, header.fileSize);
+                    std::memcpy(file.data(), &header, sizeof(header));
+                    if (!index.empty())
+                        std::memcpy(file.data() + header.indexOffset, index.data(), index.size() * sizeof(TensorEntry));
+                    for (size_t t = 0; t < m_tensors.size(); ++t)
+                        if (index[t].bytes != 0)
+                            std::memcpy(file.data() + index[t].offset, m_tensors[t].values, index[t].bytes);
+                    // On disk before the rename makes it the checkpoint: a crash leaves the old file or the new one.
+                    file.sync(staging);
+                }
+                std::filesystem::rename(staging, path);
+            }
+            catch (...)
+            {
+                // No half-written '<path>.tmp' is left behind (the existing checkpoint is untouched).
+                std::error_code ignored;
+                std::filesystem::remove(staging, ignored);
+                throw;
+            }
+        }
+    private:
+        struct Pending
+        {
+            TensorEntry entry;
+            const std::byte* values;
+        };
+        std::vector<Pending> m_tensors;
+    };
+
+    enum class CheckpointVerify : uint8_t
+    {
+        Index,   // header and index checksums: opening touches a page or two, whatever the size
+        Full     // and every tensor's checksum: reads the whole file once
+    };
+
+    // Read-only, zero-copy view of a checkpoint file. Malformed files (and, per 'verify',
+    // checksum mismatches) are rejected with std::runtime_error.
+    class MappedCheckpoint
+    {
+    public:
+        explicit MappedCheckpoint(const std::filesystem::path& path, CheckpointVerify verify = CheckpointVerify::Index)
+            : m_file(detail::FileMapping::openRead(path)), m_path(path.string())
+        {
+            if (m_file.size() < sizeof(CheckpointHeader))
+                fail("file smaller than the header");
+            std::memcpy(&m_header, m_file.data(), sizeof(CheckpointHeader));
+            if (std::memcmp(m_header.magic, CheckpointHeader::MAGIC, sizeof(CheckpointHeader::MAGIC)) != 0)
+                fail("bad magic");
+            if (m_header.version != CheckpointHeader::VERSION)
+                fail("unsupported version");
+            if (m_header.headerChecksum != detail::xxh64(&m_header, offsetof(CheckpointHeader, headerChecksum)))
+                fail("header checksum mismatch");
+            if (m_header.fileSize != m_file.size())
+                fail("file size does not match the header (truncated?)");
+            if (!std::has_single_bit(m_header.alignment) || m_header.alignment < alignof(TensorEntry))
+                fail("bad alignment");
+            // Checked in an order that cannot overflow for any header that got this far.
+            const uint64_t size = m_file.size();
+            if (m_header.indexOffset < sizeof(CheckpointHeader) || m_header.indexOffset % alignof(TensorEntry) != 0
+                || m_header.indexOffset > size || m_header.tensorCount > (size - m_header.indexOffset) / sizeof(TensorEntry))
+                fail("index extends past the end of the file");
+            const auto* entries = reinterpret_cast<const TensorEntry*>(m_file.data() + m_header.indexOffset);
+            m_index = std::span<const TensorEntry>(entries, m_header.tensorCount);
+            if (m_header.indexChecksum != detail::xxh64(m_index.data(), m_index.size_bytes()))
+                fail("index checksum mismatch");
+            for (const TensorEntry& entry : m_index)
+            {
+                const uint64_t element = dtypeSize(entry.dtype);
+                if (std::memchr(entry.name, '\0', sizeof(entry.name)) == nullptr || entry.key().empty())
+                    fail("unterminated tensor name");
+                if (element == 0 || entry.rank > TensorEntry::MAX_RANK)
+                    fail("bad dtype or rank");
+                // The product is checked against overflow, not against bytes: a {5, 0} tensor has no
+                // bytes but a nonzero first dimension.
+                uint64_t elements = 1;
+                for (size_t d = 0; d < TensorEntry::MAX_RANK; ++d)
+                {
+                    if (d >= entry.rank ? entry.shape[d] != 1
+                                        : entry.shape[d] != 0 && elements > std::numeric_limits<uint64_t>::max() / entry.shape[d])
+                        fail("shape does not match the tensor size");
+                    elements *= entry.shape[d];
+                }
+                if (entry.bytes % element != 0 || entry.bytes / element != elements)
+                    fail("shape does not match the tensor size");
+                if (entry.offset % m_header.alignment != 0
+                    || entry.offset > size || entry.bytes > size - entry.offset)
+                    fail("tensor extends past the end of the file");
+            }
+            if (verify == CheckpointVerify::Full)
+                this->verify();
+        }
+
+        [[nodiscard]] const CheckpointHeader& header() const noexcept { return m_header; }
+        [[nodiscard]] size_t size() const noexcept { return m_index.size(); }
+        [[nodiscard]] std::span<const TensorEntry> tensors() const noexcept { return m_index; }
+        // nullptr when there is no tensor of that name.
+        [[nodiscard]] const TensorEntry* find(std::string_view name) const noexcept
+        {
+            const auto it = std::ranges::find(m_index, name, &TensorEntry::key);
+            return it == m_index.end() ? nullptr : &*it;
+        }
+
+        // Throws std::runtime_error when the tensor is missing or Number is not its dtype.
+        template<TensorElement Number>
+        [[nodiscard]] auto view(std::string_view name) const -> TensorView<Number>
+        {
+            const TensorEntry* entry = find(name);
+            if (entry == nullptr)
+                fail("no tensor '" + std::string(name) + "'");
+            if (entry->dtype != dtypeOf<Number>())
+                fail("tensor '" + std::string(name) + "' does not hold the requested element type");
+            TensorView<Number> view;
+            view.values = std::span<const Number>(reinterpret_cast<const Number*>(m_file.data() + entry->offset), entry->elements());
+            std::ranges::copy(entry->shape, view.shape.begin());
+            view.rank = entry->rank;
+            return view;
+        }
+
+        // Checks every tensor against its checksum (reads the whole file).
+        void verify() const
+        {
+            for (const TensorEntry& entry : m_index)
+                if (entry.checksum != detail::xxh64(m_file.data() + entry.offset, entry.bytes))
+                    fail("checksum mismatch in tensor '" + std::string(entry.key()) + "'");
+        }
+    private:
+        [[noreturn]] void fail(const std::string& what) const
+        {
+            throw std::runtime_error("'" + m_path + "' is not a valid checkpoint: " + what);
+        }
+
+        detail::FileMapping m_file;
+        std::string m_path;
+        CheckpointHeader m_header{};
+        std::span<const TensorEntry> m_index;
+    };
+
+    // LinearModel: "weights" [features], "bias" [].
+    template<DatasetElement Number>
+    void saveCheckpoint(const std::filesystem::path& path, const LinearModel<Number>& model)
+    {
+        CheckpointWriter().add("weights", model.weights).addScalar("bias", model.bias).write(path);
+    }
+    // Copies the stored weights into 'model' (resized to the stored feature count).
+    template<DatasetElement Number>
+    void loadCheckpoint(const MappedCheckpoint& checkpoint, LinearModel<Number>& model)
+    {
+        const auto weights = checkpoint.view<Number>("weights");
+        const auto bias = checkpoint.view<Number>("bias");
+        if (weights.rank != 1 || bias.size() != 1)
+            throw std::runtime_error("checkpoint does not hold a linear model");
+        model.weights.resize(weights.size());
+        std::ranges::copy(weights.values, model.weights.data());
+        model.bias = bias[0];
+    }
+
+    // Mlp: per layer l, "layer<l>.weights" [inputs, outputs], "layer<l>.bias" [outputs] and
+    // "layer<l>.activation" [] (uint8, the Activation value).
+    template<DatasetElement Number, typename Allocator>
+    void saveCheckpoint(const std::filesystem::path& path, const Mlp<Number, Allocator>& net)
+    {
+        const auto& layers = net.layers();
+        std::vector<uint8_t> activations(layers.size());
+        CheckpointWriter writer;
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            const std::string prefix = "layer" + std::to_string(l);
+            activations[l] = static_cast<uint8_t>(layers[l].activation());
+            writer.add(prefix + ".weights", layers[l].weights())
+                  .add(prefix + ".bias", layers[l].bias())
+                  .addScalar(prefix + ".activation", activations[l]);
+        }
+        writer.write(path);
+    }
+    // Copies the stored weights into a net of the same architecture; a checkpoint with other layer
+    // shapes or activations throws std::runtime_error and leaves the net unchanged.
+    template<DatasetElement Number, typename Allocator>
+    void loadCheckpoint(const MappedCheckpoint& checkpoint, Mlp<Number, Allocator>& net)
+    {
+        auto& layers = net.layers();
+        std::vector<std::pair<TensorView<Number>, TensorView<Number>>> stored;
+        stored.reserve(layers.size());
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            const std::string prefix = "layer" + std::to_string(l);
+            const auto weights = checkpoint.view<Number>(prefix + ".weights");
+            const auto bias = checkpoint.view<Number>(prefix + ".bias");
+            const auto activation = checkpoint.view<uint8_t>(prefix + ".activation");
+            if (weights.rank != 2 || weights.rows() != layers[l].inputs() || weights.cols() != layers[l].outputs()
+                || bias.size() != layers[l].outputs() || activation.size() != 1
+                || activation[0] != static_cast<uint8_t>(layers[l].activation()))
+                throw std::runtime_error("checkpoint layer " + std::to_string(l) + " does not match the network");
+            stored.emplace_back(weights, bias);
+        }
+        if (checkpoint.find("layer" + std::to_string(layers.size()) + ".weights") != nullptr)
+            throw std::runtime_error("checkpoint has more layers than the network");
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            std::ranges::copy(stored[l].first.values, layers[l].weights().data());
+            std::ranges::copy(stored[l].second.values, layers[l].bias().data());
+        }
+    }
+
+    // Inference straight on the weights of an Mlp checkpoint (as saveCheckpoint writes it): the
+    // layers are views into the mapping, so nothing is copied and every process serving the same
+    // file shares its read-only pages. Only the layer outputs are owned. The MappedCheckpoint must
+    // outlive the net; a checkpoint that is not a chain of dense layers throws std::runtime_error.
+    template<DatasetElement Number, typename Allocator = LinAlg::AlignedAllocator<Number>>
+    class MappedMlp
+    {
+    public:
+        using Matrix = LinAlg::MatrixX<Number, Allocator>;
+
+        explicit MappedMlp(const MappedCheckpoint& checkpoint)
+        {
+            for (size_t l = 0; checkpoint.find("layer" + std::to_string(l) + ".weights") != nullptr; ++l)
+            {
+                const std::string prefix = "layer" + std::to_string(l);
+                const auto weights = checkpoint.view<Number>(prefix + ".weights");
+                const auto bias = checkpoint.view<Number>(prefix + ".bias");
+                const auto activation = checkpoint.view<uint8_t>(prefix + ".activation");
+                if (weights.rank != 2 || bias.size() != weights.cols() || activation.size() != 1
+                    || activation[0] > static_cast<uint8_t>(Activation::Tanh)
+                    || (l > 0 && weights.rows() != m_layers.back().weights.cols()))
+                    throw std::runtime_error("checkpoint layer " + std::to_string(l) + " is not a dense layer of the chain");
+                m_layers.push_back({weights.matrix(), bias.data(), static_cast<Activation>(activation[0]), Matrix()});
+            }
+            if (m_layers.empty())
+                throw std::runtime_error("checkpoint does not hold an Mlp");
+        }
+
+        [[nodiscard]] size_t inputs() const noexcept { return m_layers.front().weights.rows(); }
+        [[nodiscard]] size_t outputs() const noexcept { return m_layers.back().weights.cols(); }
+
+        // input: batch x inputs(), any strides. Valid until the next forward().
+        auto forward(LinAlg::MatrixView<const Number> input) -> const Matrix&
+        {
+            assert(input.cols() == inputs());
+            for (Layer& layer : m_layers)
+            {
+                denseForward(input, layer.weights, layer.bias, layer.activation, layer.output);
+                input = layer.output.view();
+            }
+            return m_layers.back().output;
+        }
+    private:
+        struct Layer
+        {
+            LinAlg::MatrixView<const Number> weights;
+            const Number* bias;
+            Activation activation;
+            Matrix output;
+        };
+        std::vector<Layer> m_layers;
+    };
+}
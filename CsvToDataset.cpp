@@ -0,0 +1,267 @@
+// Converts a CSV file (one sample per line, features first, expected output in the last column)
+// into the memory-mappable binary dataset format of Dataset.h.
+//
+//   CsvToDataset <input.csv> <output.bin> [--header] [--float32] [--align <bytes>] [--delimiter <char>]
+//
+// The CSV is memory mapped as well and parsed in parallel: the file is cut into newline-aligned
+// byte ranges, a first pass counts the rows of every range, and a second pass parses every range
+// straight into its rows of the (already sized) output mapping. Nothing is ever held in memory.
+
+#include "Dataset.h"
+#include "ThreadPool.h"
+#include <print>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    struct Options
+    {
+        std::string input;
+        std::string output;
+        bool header = false;
+        bool float32 = false;
+        size_t alignment = 64;
+        char delimiter = ',';
+    };
+
+    // [begin, end) byte range of the CSV made of whole lines.
+    struct Range
+    {
+        size_t begin = 0;
+        size_t end = 0;
+        size_t rows = 0;      // data rows inside the range (pass 1)
+        size_t firstRow = 0;  // index of the range's first row in the dataset
+        const char* error = nullptr; // set by a failing pass (the pool's kernels must not throw)
+        size_t errorLine = 0;        // 1-based line inside the range
+    };
+
+    bool isBlank(std::string_view line) noexcept
+    {
+        return line.find_first_not_of(" \t\r") == std::string_view::npos;
+    }
+
+    // Calls fn(line) for every line of [begin, end), without the trailing '\r' / '\n'.
+    template<typename Fn>
+    void forLines(std::string_view text, size_t begin, size_t end, Fn&& fn)
+    {
+        while (begin < end)
+        {
+            size_t lineEnd = text.find('\n', begin);
+            if (lineEnd == std::string_view::npos || lineEnd > end)
+                lineEnd = end;
+            std::string_view line = text.substr(begin, lineEnd - begin);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (!fn(line))
+                return;
+            begin = lineEnd + 1;
+        }
+    }
+
+    size_t countFields(std::string_view line, char delimiter) noexcept
+    {
+        return static_cast<size_t>(std::ranges::count(line, delimiter)) + 1;
+    }
+
+    template<ML::DatasetElement Number>
+    bool parseRow(std::string_view line, char delimiter, ML::DatasetWriter<Number>& writer, size_t row, size_t fields)
+    {
+        size_t field = 0;
+        for (size_t pos = 0; field < fields; ++field)
+        {
+            size_t end = line.find(delimiter, pos);
+            if (end == std::string_view::npos)
+                end = line.size();
+            std::string_view token = line.substr(pos, end - pos);
+            const size_t first = token.find_first_not_of(" \t");
+            if (first == std::string_view::npos)
+                return false;
+            token.remove_prefix(first);
+            token.remove_suffix(token.size() - token.find_last_not_of(" \t") - 1);
+            if (token.front() == '+')
+                token.remove_prefix(1);
+            Number value{};
+            const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (ec != std::errc{} || ptr != token.data() + token.size())
+                return false;
+            if (field + 1 == fields)
+                writer.targets()[row] = value;
+            else
+                writer.feature(field)[row] = value;
+            if (end == line.size())
+                return field + 1 == fields;
+            pos = end + 1;
+        }
+        return false; // more fields than the first row
+    }
+
+    template<ML::DatasetElement Number>
+    void convert(const Options& options)
+    {
+        const auto csv = ML::detail::FileMapping::openRead(options.input);
+        csv.adviseSequential();
+        const std::string_view text(reinterpret_cast<const char*>(csv.data()), csv.size());
+
+        // Header line and shape (from the first data line).
+        size_t dataBegin = 0;
+        if (options.header)
+            dataBegin = text.find('\n') == std::string_view::npos ? text.size() : text.find('\n') + 1;
+        size_t fields = 0;
+        forLines(text, dataBegin, text.size(), [&](std::string_view line)
+        {
+            if (isBlank(line))
+                return true;
+            fields = countFields(line, options.delimiter);
+            return false;
+        });
+        if (fields < 2)
+            throw std::runtime_error("the CSV needs at least one feature column and one output column");
+
+        // Newline-aligned ranges, a few per thread.
+        const size_t rangeCount = std::max<size_t>(1, std::min<size_t>(LinAlg::ThreadPool::global().concurrency() * 4,
+                                                                        (text.size() - dataBegin) / (1 << 20) + 1));
+        std::vector<Range> ranges(rangeCount);
+        size_t cursor = dataBegin;
+        for (size_t r = 0; r < rangeCount; ++r)
+        {
+            size_t end = r + 1 == rangeCount ? text.size() : std::max(cursor, dataBegin + (text.size() - dataBegin) * (r + 1) / rangeCount);
+            if (end < text.size())
+            {
+                const size_t newline = text.find('\n', end);
+                end = newline == std::string_view::npos ? text.size() : newline + 1;
+            }
+            ranges[r].begin = cursor;
+            ranges[r].end = end;
+            cursor = end;
+        }
+
+        const LinAlg::Parallel policy{.minElements = 0};
+        // Pass 1: rows per range (and the field count of every row).
+        LinAlg::parallelFor(rangeCount, policy, [&](size_t first, size_t last)
+        {
+            for (size_t r = first; r < last; ++r)
+            {
+                Range& range = ranges[r];
+                size_t line = 0;
+                forLines(text, range.begin, range.end, [&](std::string_view row)
+                {
+                    ++line;
+                    if (isBlank(row))
+                        return true;
+                    if (countFields(row, options.delimiter) != fields)
+                    {
+                        range.error = "wrong number of fields";
+                        range.errorLine = line;
+                        return false;
+                    }
+                    ++range.rows;
+                    return true;
+                });
+            }
+        });
+        // Line numbers are only worked out for the first failing range.
+        const auto reportErrors = [&]
+        {
+            const auto failed = std::ranges::find_if(ranges, [](const Range& range) { return range.error != nullptr; });
+            if (failed == ranges.end())
+                return;
+            const size_t line = static_cast<size_t>(std::count(text.begin(), text.begin() + static_cast<std::ptrdiff_t>(failed->begin), '\n'))
+                                + failed->errorLine;
+            throw std::runtime_error("line " + std::to_string(line) + ": " + failed->error
+                                     + " (expected " + std::to_string(fields) + " numeric fields)");
+        };
+        reportErrors();
+        size_t rows = 0;
+        for (Range& range : ranges)
+        {
+            range.firstRow = rows;
+            rows += range.rows;
+        }
+
+        // Pass 2: parse straight into the output mapping.
+        ML::DatasetWriter<Number> writer(options.output, rows, fields - 1, options.alignment);
+        LinAlg::parallelFor(rangeCount, policy, [&](size_t first, size_t last)
+        {
+            for (size_t r = first; r < last; ++r)
+            {
+                Range& range = ranges[r];
+                size_t row = range.firstRow;
+                size_t line = 0;
+                forLines(text, range.begin, range.end, [&](std::string_view current)
+                {
+                    ++line;
+                    if (isBlank(current))
+                        return true;
+                    if (!parseRow(current, options.delimiter, writer, row, fields))
+                    {
+                        range.error = "not a number";
+                        range.errorLine = line;
+                        return false;
+                    }
+                    ++row;
+                    return true;
+                });
+            }
+        });
+        reportErrors();
+        std::println("{}: {} rows x {} features ({}) -> {}", options.input, rows, fields - 1,
+                     options.float32 ? "float32" : "float64", options.output);
+    }
+
+    void usage()
+    {
+        std::println(stderr, "usage: CsvToDataset <input.csv> <output.bin> [--header] [--float32] [--align <bytes>] [--delimiter <char>]");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    std::vector<std::string_view> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--header")
+            options.header = true;
+        else if (arg == "--float32")
+            options.float32 = true;
+        else if (arg == "--align" && i + 1 < argc)
+            options.alignment = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--delimiter" && i + 1 < argc && argv[i + 1][0] != '\0')
+            options.delimiter = argv[++i][0];
+        else if (arg.starts_with("--"))
+        {
+            usage();
+            return 2;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.size() != 2)
+    {
+        usage();
+        return 2;
+    }
+    options.input = positional[0];
+    options.output = positional[1];
+    try
+    {
+        if (options.float32)
+            convert<float>(options);
+        else
+            convert<double>(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::println(stderr, "CsvToDataset: {}", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,379 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "HalfPrecision.h"
+#include "Training.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <utility>
+#include <concepts>
+#include <stdexcept>
+#include <filesystem>
+#include <algorithm>
+#include <bit>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace ML
+{
+    // On-disk columnar dataset, laid out exactly like a DatasetView so it can be memory mapped and
+    // trained on without parsing or copying anything:
+    //
+    //   [DatasetHeader, 64 bytes]
+    //   [feature 0 : rows values][padding up to 'alignment']   <- inputsOffset
+    //   [feature 1 : rows values][padding]                       featureStride elements apart
+    //   ...
+    //   [targets   : rows values][padding]                    <- targetsOffset
+    //
+    // Every column starts on an 'alignment' byte boundary (64 by default), so the SIMD kernels see
+    // aligned data. Values are stored in the machine's native little-endian representation.
+    // Datasets hold Float32 / Float64; the other element types appear in checkpoints (Checkpoint.h).
+    enum class DType : uint32_t
+    {
+        Float32 = 1,
+        Float64 = 2,
+        Float16 = 3,
+        BFloat16 = 4,
+        Int8 = 5,
+        UInt8 = 6,
+        Int32 = 7
+    };
+
+    template<typename Number>
+    concept DatasetElement = std::same_as<Number, float> || std::same_as<Number, double>;
+    template<typename Number>
+    concept TensorElement = DatasetElement<Number> || std::same_as<Number, LinAlg::Float16> ||
+                            std::same_as<Number, LinAlg::BFloat16> || std::same_as<Number, int8_t> ||
+                            std::same_as<Number, uint8_t> || std::same_as<Number, int32_t>;
+
+    template<TensorElement Number>
+    constexpr DType dtypeOf() noexcept
+    {
+        if constexpr (std::same_as<Number, float>)
+            return DType::Float32;
+        else if constexpr (std::same_as<Number, double>)
+            return DType::Float64;
+        else if constexpr (std::same_as<Number, LinAlg::Float16>)
+            return DType::Float16;
+        else if constexpr (std::same_as<Number, LinAlg::BFloat16>)
+            return DType::BFloat16;
+        else if constexpr (std::same_as<Number, int8_t>)
+            return DType::Int8;
+        else if constexpr (std::same_as<Number, uint8_t>)
+            return DType::UInt8;
+        else
+            return DType::Int32;
+    }
+    // 0 for values outside the enum (what a corrupt file may contain).
+    constexpr size_t dtypeSize(DType dtype) noexcept
+    {
+        switch (dtype)
+        {
+            case DType::Float32:  return sizeof(float);
+            case DType::Float64:  return sizeof(double);
+            case DType::Float16:
+            case DType::BFloat16: return 2;
+            case DType::Int8:
+            case DType::UInt8:    return 1;
+            case DType::Int32:    return sizeof(int32_t);
+        }
+        return 0;
+    }
+
+    struct DatasetHeader
+    {
+        static constexpr char MAGIC[8] = {'M', 'L', '2', '6', 'D', 'S', 'E', 'T'};
+        static constexpr uint32_t VERSION = 1;
+
+        char magic[8];
+        uint32_t version;
+        DType dtype;
+        uint64_t rows;
+        uint64_t features;
+        uint64_t alignment;      // bytes, power of two
+        uint64_t featureStride;  // elements between two feature columns
+        uint64_t inputsOffset;   // bytes from the start of the file
+        uint64_t targetsOffset;  // bytes from the start of the file
+
+        // Header of a dataset with the given shape; offsets and stride are derived from it.
+        static DatasetHeader describe(uint64_t rows, uint64_t features, DType dtype, uint64_t alignment = 64) noexcept
+        {
+            const uint64_t element = dtypeSize(dtype);
+            alignment = std::max<uint64_t>(std::bit_ceil(alignment), element);
+            const uint64_t columnBytes = (rows * element + alignment - 1) / alignment * alignment;
+            DatasetHeader header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.dtype = dtype;
+            header.rows = rows;
+            header.features = features;
+            header.alignment = alignment;
+            header.featureStride = columnBytes / element;
+            header.inputsOffset = (sizeof(DatasetHeader) + alignment - 1) / alignment * alignment;
+            header.targetsOffset = header.inputsOffset + features * columnBytes;
+            return header;
+        }
+        [[nodiscard]] uint64_t fileSize() const noexcept
+        {
+            return targetsOffset + featureStride * dtypeSize(dtype);
+        }
+    };
+    static_assert(sizeof(DatasetHeader) == 64 && std::is_trivially_copyable_v<DatasetHeader>);
+    static_assert(std::endian::native == std::endian::little, "the dataset format is little-endian");
+
+    namespace detail
+    {
+        // Move-only RAII mapping of a whole file, read-only or read-write.
+        class FileMapping
+        {
+        public:
+            FileMapping() noexcept = default;
+            FileMapping(FileMapping&& other) noexcept { swap(other); }
+            FileMapping& operator=(FileMapping&& other) noexcept
+            {
+                FileMapping(std::move(other)).swap(*this);
+                return *this;
+            }
+            FileMapping(const FileMapping&) = delete;
+            FileMapping& operator=(const FileMapping&) = delete;
+            ~FileMapping() { close(); }
+
+            static FileMapping openRead(const std::filesystem::path& path) { return FileMapping(path, 0, false); }
+            // Creates (or truncates) the file with exactly 'size' bytes and maps it writable.
+            static FileMapping create(const std::filesystem::path& path, size_t size) { return FileMapping(path, size, true); }
+
+            [[nodiscard]] std::byte* data() const noexcept { return static_cast<std::byte*>(m_data); }
+            [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+            // Writes the mapped pages and the file's metadata through to the device, e.g. before a
+            // rename publishes the file. Throws std::runtime_error when that fails.
+            void sync(const std::filesystem::path& path)
+            {
+#if defined(_WIN32)
+                if ((m_data != nullptr && !::FlushViewOfFile(m_data, 0)) || !::FlushFileBuffers(m_file))
+                    fail("cannot sync", path);
+#else
+                if ((m_data != nullptr && ::msync(m_data, m_size, MS_SYNC) != 0) || ::fsync(m_fd) != 0)
+                    fail("cannot sync", path);
+#endif
+            }
+            // Tells the kernel the mapping will be read front to back (read-ahead, early eviction).
+            void adviseSequential() const noexcept
+            {
+#if !defined(_WIN32)
+                if (m_data != nullptr)
+                    ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+#endif
+            }
+        private:
+            FileMapping(const std::filesystem::path& path, size_t size, bool writable)
+            {
+#if defined(_WIN32)
+                m_file = ::CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ,
+                                       nullptr, writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (m_file == INVALID_HANDLE_VALUE)
+                    fail("cannot open", path);
+                if (!writable)
+                {
+                    LARGE_INTEGER fileSize{};
+                    if (!::GetFileSizeEx(m_file, &fileSize))
+                        fail("cannot stat", path);
+                    size = static_cast<size_t>(fileSize.QuadPart);
+                }
+                m_size = size;
+                if (size == 0)
+                    return;
+                m_mapping = ::CreateFileMappingW(m_file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                                 static_cast<DWORD>(uint64_t{size} >> 32), static_cast<DWORD>(size), nullptr);
+                if (m_mapping == nullptr)
+                    fail("cannot map", path);
+                m_data = ::MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+                if (m_data == nullptr)
+                    fail("cannot map", path);
+#else
+                m_fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+                if (m_fd < 0)
+                    fail("cannot open", path);
+                if (writable)
+                {
+                    if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+                        fail("cannot resize", path);
+                }
+                else
+                {
+                    struct stat info{};
+                    if (::fstat(m_fd, &info) != 0)
+                        fail("cannot stat", path);
+                    size = static_cast<size_t>(info.st_size);
+                }
+                m_size = size;
+                if (size == 0)
+                    return;
+                void* data = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+                if (data == MAP_FAILED)
+                    fail("cannot map", path);
+                m_data = data;
+#endif
+            }
+            [[noreturn]] void fail(const char* what, const std::filesystem::path& path)
+            {
+                close();
+                throw std::runtime_error(std::string(what) + " '" + path.string() + "'");
+            }
+            void close() noexcept
+            {
+#if defined(_WIN32)
+                if (m_data != nullptr)
+                    ::UnmapViewOfFile(m_data);
+                if (m_mapping != nullptr)
+                    ::CloseHandle(m_mapping);
+                if (m_file != INVALID_HANDLE_VALUE)
+                    ::CloseHandle(m_file);
+                m_mapping = nullptr;
+                m_file = INVALID_HANDLE_VALUE;
+#else
+                if (m_data != nullptr)
+                    ::munmap(m_data, m_size);
+                if (m_fd >= 0)
+                    ::close(m_fd);
+                m_fd = -1;
+#endif
+                m_data = nullptr;
+                m_size = 0;
+            }
+            void swap(FileMapping& other) noexcept
+            {
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+                std::swap(m_file, other.m_file);
+                std::swap(m_mapping, other.m_mapping);
+#else
+                std::swap(m_fd, other.m_fd);
+#endif
+            }
+
+            void* m_data = nullptr;
+            size_t m_size = 0;
+#if defined(_WIN32)
+            HANDLE m_file = INVALID_HANDLE_VALUE;
+            HANDLE m_mapping = nullptr;
+#else
+            int m_fd = -1;
+#endif
+        };
+    }
+
+    // Read-only, zero-copy view of a dataset file. The spans handed out by view() point straight
+    // into the mapping: pages are loaded by the OS on first touch, nothing is parsed or copied,
+    // and they stay valid for as long as the MappedDataset lives.
+    // Malformed files are rejected with std::runtime_error.
+    class MappedDataset
+    {
+    public:
+        explicit MappedDataset(const std::filesystem::path& path) : m_file(detail::FileMapping::openRead(path))
+        {
+            const auto fail = [&](const char* what)
+            {
+                throw std::runtime_error("'" + path.string() + "' is not a valid dataset: " + what);
+            };
+            if (m_file.size() < sizeof(DatasetHeader))
+                fail("file smaller than the header");
+            std::memcpy(&m_header, m_file.data(), sizeof(DatasetHeader));
+            if (std::memcmp(m_header.magic, DatasetHeader::MAGIC, sizeof(DatasetHeader::MAGIC)) != 0)
+                fail("bad magic");
+            if (m_header.version != DatasetHeader::VERSION)
+                fail("unsupported version");
+            if (m_header.dtype != DType::Float32 && m_header.dtype != DType::Float64)
+                fail("unknown dtype");
+            const uint64_t element = dtypeSize(m_header.dtype);
+            if (!std::has_single_bit(m_header.alignment) || m_header.alignment < element)
+                fail("bad alignment");
+            if (m_header.featureStride < m_header.rows)
+                fail("feature stride smaller than the row count");
+            if (m_header.inputsOffset % m_header.alignment != 0 || m_header.targetsOffset % m_header.alignment != 0
+                || m_header.inputsOffset < sizeof(DatasetHeader))
+                fail("misaligned columns");
+            // Checked in an order that cannot overflow for any header that got this far.
+            const uint64_t size = m_file.size();
+            const uint64_t columnElements = size / element;
+            if (m_header.featureStride > columnElements
+                || (m_header.featureStride != 0 && m_header.features > columnElements / m_header.featureStride)
+                || m_header.inputsOffset > size
+                || m_header.features * m_header.featureStride * element > size - m_header.inputsOffset
+                || m_header.targetsOffset > size
+                || m_header.rows * element > size - m_header.targetsOffset)
+                fail("columns extend past the end of the file");
+        }
+
+        [[nodiscard]] const DatasetHeader& header() const noexcept { return m_header; }
+        [[nodiscard]] size_t rows() const noexcept { return m_header.rows; }
+        [[nodiscard]] size_t features() const noexcept { return m_header.features; }
+        [[nodiscard]] DType dtype() const noexcept { return m_header.dtype; }
+        void adviseSequential() const noexcept { m_file.adviseSequential(); }
+
+        // Throws std::runtime_error when Number is not the stored dtype.
+        template<DatasetElement Number>
+        [[nodiscard]] auto view() const -> DatasetView<Number>
+        {
+            if (dtypeOf<Number>() != m_header.dtype)
+                throw std::runtime_error("dataset dtype does not match the requested element type");
+            const auto* inputs = reinterpret_cast<const Number*>(m_file.data() + m_header.inputsOffset);
+            const auto* targets = reinterpret_cast<const Number*>(m_file.data() + m_header.targetsOffset);
+            const size_t inputCount = m_header.features == 0 ? 0 : (m_header.features - 1) * m_header.featureStride + m_header.rows;
+            return {std::span<const Number>(inputs, inputCount), std::span<const Number>(targets, m_header.rows),
+                    m_header.rows, m_header.features, m_header.featureStride};
+        }
+    private:
+        detail::FileMapping m_file;
+        DatasetHeader m_header{};
+    };
+
+    // Creates a dataset file of a known shape and maps it writable, so large datasets can be filled
+    // column by column (or scattered row by row) without ever being held in memory.
+    // The file is complete once every column has been written and the writer is destroyed.
+    template<DatasetElement Number>
+    class DatasetWriter
+    {
+    public:
+        DatasetWriter(const std::filesystem::path& path, size_t rows, size_t features, size_t alignment = 64)
+            : m_header(DatasetHeader::describe(rows, features, dtypeOf<Number>(), alignment)),
+              m_file(detail::FileMapping::create(path, m_header.fileSize()))
+        {
+            std::memcpy(m_file.data(), &m_header, sizeof(DatasetHeader));
+        }
+
+        [[nodiscard]] const DatasetHeader& header() const noexcept { return m_header; }
+        [[nodiscard]] Number* feature(size_t f) const noexcept
+        {
+            return reinterpret_cast<Number*>(m_file.data() + m_header.inputsOffset) + f * m_header.featureStride;
+        }
+        [[nodiscard]] Number* targets() const noexcept
+        {
+            return reinterpret_cast<Number*>(m_file.data() + m_header.targetsOffset);
+        }
+    private:
+        DatasetHeader m_header;
+        detail::FileMapping m_file;
+    };
+
+    // Writes an in-memory dataset in the binary format.
+    template<DatasetElement Number>
+    void writeDataset(const std::filesystem::path& path, const DatasetView<Number>& data, size_t alignment = 64)
+    {
+        DatasetWriter<Number> writer(path, data.rows, data.features, alignment);
+        for (size_t f = 0; f < data.features; ++f)
+            std::copy_n(data.feature(f), data.rows, writer.feature(f));
+        std::copy_n(data.targets.data(), data.rows, writer.targets());
+    }
+}
@@ -0,0 +1,482 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "AlignedAllocator.h"
+#include "Arena.h"
+#include "Expression.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Reductions.h"
+#include "Views.h"
+#include <print>
+#include <vector>
+#include <span>
+#include <ranges>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+namespace LinAlg
+{
+    namespace detail
+    {
+        // Runs kernel(begin, end) over the elements, split across the pool when the container is
+        // big enough (Parallel::current() decides) and on the calling thread otherwise.
+        template<typename Kernel>
+        void forElements(size_t count, Kernel&& kernel)
+        {
+            parallelFor(count, Parallel::current(), kernel);
+        }
+    }
+
+    // Runtime-sized counterparts of Matrix / Vector.
+    // Storage is ONE contiguous, 64-byte aligned, row-major buffer:
+    // Row0: [a,b,c], Row1: [d,e,f]  ->  Buffer: [a,b,c,d,e,f]
+    // so element (r, c) lives at data()[r * cols() + c].
+    // Allocator picks where that buffer comes from (aligned heap by default, or an Arena /
+    // SizeClassPool through ResourceAllocator, see Arena.h). Expressions do not care: every
+    // MatrixX<Number, *> evaluates as MatrixX<Number>, so containers with different allocators mix.
+    template<Numeric Number, typename Allocator = AlignedAllocator<Number>>
+    class MatrixX
+    {
+    public:
+        using value_type = Number;
+        using allocator_type = Allocator;
+        using Storage = std::vector<Number, Allocator>;
+
+        MatrixX() noexcept = default;
+        MatrixX(const MatrixX& other) = default;
+        MatrixX(MatrixX&& other) noexcept = default;
+        MatrixX& operator=(const MatrixX& other) = default;
+        MatrixX& operator=(MatrixX&& other) noexcept = default;
+        ~MatrixX() = default;
+        MatrixX(size_t rows, size_t cols)
+            : m_rows(rows), m_cols(cols), m_data(rows * cols, T_zero_init<Number>()) {}
+        MatrixX(size_t rows, size_t cols, Number scalar)
+            : m_rows(rows), m_cols(cols), m_data(rows * cols, scalar) {}
+        explicit MatrixX(const Allocator& allocator) noexcept : m_data(allocator) {}
+        MatrixX(size_t rows, size_t cols, const Allocator& allocator)
+            : m_rows(rows), m_cols(cols), m_data(rows * cols, T_zero_init<Number>(), allocator) {}
+        MatrixX(size_t rows, size_t cols, Number scalar, const Allocator& allocator)
+            : m_rows(rows), m_cols(cols), m_data(rows * cols, scalar, allocator) {}
+        // Rows may be ragged: the widest row decides cols(), missing entries stay zero.
+        explicit MatrixX(std::initializer_list<std::initializer_list<Number>> init)
+            : m_rows(init.size())
+        {
+            for (const auto& row : init)
+                m_cols = std::max(m_cols, row.size());
+            m_data.assign(m_rows * m_cols, T_zero_init<Number>());
+            size_t r = 0;
+            for (const auto& row : init)
+                std::ranges::copy(row, m_data.begin() + static_cast<std::ptrdiff_t>(r++ * m_cols));
+        }
+        // Copies the elements a view sees, e.g. 'MatXf t(a.view().transpose());'.
+        explicit MatrixX(MatrixView<const Number> view) : MatrixX(view.rows(), view.cols())
+        {
+            this->view().assign(view);
+        }
+        // Evaluates a lazy expression (e.g. 'MatXf r = a + b * 2.0f;') in a single pass.
+        template<Expression E> requires std::same_as<typename E::result_type, MatrixX<Number>>
+        MatrixX(const E& expr) : MatrixX(expr.rows(), expr.cols())
+        {
+            detail::forElements(expr.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(m_data.data(), expr, ExprAssign{}, begin, end);
+            });
+        }
+        template<Expression E> requires std::same_as<typename E::result_type, MatrixX<Number>>
+        MatrixX& operator=(const E& expr)
+        {
+            // Resizing first would clobber operands when the expression reads from *this.
+            if (m_rows != expr.rows() || m_cols != expr.cols())
+            {
+                MatrixX result(expr.rows(), expr.cols(), m_data.get_allocator());
+                detail::forElements(expr.size(), [&](size_t begin, size_t end)
+                {
+                    evaluateExpr(result.data(), expr, ExprAssign{}, begin, end);
+                });
+                return *this = std::move(result);
+            }
+            detail::forElements(expr.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(m_data.data(), expr, ExprAssign{}, begin, end);
+            });
+            return *this;
+        }
+        friend void printMatrix(const MatrixX& mat) noexcept
+        {
+            std::println("MatrixX {}x{}: ", mat.m_rows, mat.m_cols);
+            for (size_t r = 0; r < mat.m_rows; ++r)
+            {
+                std::println("{}", mat.row(r));
+            }
+            std::println();
+        }
+    public:
+        [[nodiscard]] constexpr size_t rows() const noexcept { return m_rows; }
+        [[nodiscard]] constexpr size_t cols() const noexcept { return m_cols; }
+        [[nodiscard]] constexpr size_t size() const noexcept { return m_data.size(); }
+        [[nodiscard]] constexpr auto data(this auto&& self) noexcept { return self.m_data.data(); }
+        [[nodiscard]] Allocator get_allocator() const noexcept { return m_data.get_allocator(); }
+        [[nodiscard]] constexpr auto& operator()(this auto&& self, size_t r, size_t c) noexcept
+        {
+            assert(r < self.m_rows && c < self.m_cols);
+            return self.m_data[r * self.m_cols + c];
+        }
+        // One row as a contiguous span (writable when the matrix is).
+        [[nodiscard]] constexpr auto row(this auto&& self, size_t r) noexcept
+        {
+            assert(r < self.m_rows);
+            return std::span{self.m_data.data() + r * self.m_cols, self.m_cols};
+        }
+        constexpr auto expr() const noexcept -> ExprLeaf<MatrixX<Number>, Number>
+        {
+            return {{}, m_data.data(), m_data.size(), m_rows, m_cols};
+        }
+        // Strided views (Views.h), writable when the matrix is: a column, a block or view().transpose()
+        // without copying. Valid until the matrix is resized or destroyed.
+        [[nodiscard]] constexpr auto view(this auto&& self) noexcept
+        {
+            return MatrixView{self.m_data.data(), self.m_rows, self.m_cols, self.m_cols};
+        }
+        [[nodiscard]] constexpr auto col(this auto&& self, size_t c) noexcept { return self.view().col(c); }
+        [[nodiscard]] constexpr auto block(this auto&& self, size_t row, size_t col, size_t rows, size_t cols) noexcept
+        {
+            return self.view().block(row, col, rows, cols);
+        }
+        // Shape changes discard the old contents (everything becomes zero).
+        void resize(size_t rows, size_t cols)
+        {
+            m_rows = rows;
+            m_cols = cols;
+            m_data.assign(rows * cols, T_zero_init<Number>());
+        }
+    public:
+        template<typename OtherAllocator>
+        auto operator+=(this auto& self, const MatrixX<Number, OtherAllocator>& other) noexcept -> MatrixX&
+        {
+            assert(self.rows() == other.rows() && self.cols() == other.cols());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::add(self.data() + begin, self.data() + begin, other.data() + begin, end - begin);
+            });
+            return self;
+        }
+        auto operator+=(this auto& self, const Expression auto& expr) noexcept -> MatrixX&
+        {
+            assert(self.rows() == expr.rows());
+            assert(self.cols() == expr.cols());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(self.data(), expr, std::plus{}, begin, end);
+            });
+            return self;
+        }
+        auto operator+=(this auto& self, Number scalar) noexcept -> MatrixX&
+        {
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::addScalar(self.data() + begin, self.data() + begin, scalar, end - begin);
+            });
+            return self;
+        }
+    public:
+        template<typename OtherAllocator>
+        auto operator-=(this auto& self, const MatrixX<Number, OtherAllocator>& other) noexcept -> MatrixX&
+        {
+            assert(self.rows() == other.rows() && self.cols() == other.cols());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::sub(self.data() + begin, self.data() + begin, other.data() + begin, end - begin);
+            });
+            return self;
+        }
+        auto operator-=(this auto& self, const Expression auto& expr) noexcept -> MatrixX&
+        {
+            assert(self.rows() == expr.rows());
+            assert(self.cols() == expr.cols());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(self.data(), expr, std::minus{}, begin, end);
+            });
+            return self;
+        }
+        auto operator-=(this auto& self, Number scalar) noexcept -> MatrixX&
+        {
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::subScalar(self.data() + begin, self.data() + begin, scalar, end - begin);
+            });
+            return self;
+        }
+    public:
+        auto operator*=(this auto& self, Number scalar) noexcept -> MatrixX&
+        {
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::mulScalar(self.data() + begin, self.data() + begin, scalar, end - begin);
+            });
+            return self;
+        }
+    public:
+        // Reductions over all elements (Reductions.h), split across the pool like the operators
+        // (Parallel::current() decides): norm() is the Frobenius norm, argmin / argmax
+        // the row-major position (row = index / cols(), col = index % cols()).
+        [[nodiscard]] auto sum(Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::sum(m_data.data(), m_data.size(), mode);
+        }
+        template<typename OtherAllocator>
+        [[nodiscard]] auto dot(const MatrixX<Number, OtherAllocator>& other, Reduction mode = {}) const -> ReduceType<Number>
+        {
+            assert(size() == other.size());
+            return LinAlg::dot(m_data.data(), other.data(), m_data.size(), mode);
+        }
+        [[nodiscard]] auto squaredNorm(Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::squaredNorm(m_data.data(), m_data.size(), mode);
+        }
+        [[nodiscard]] auto norm(Reduction mode = {}) const -> NormType<Number>
+        {
+            return LinAlg::norm(m_data.data(), m_data.size(), mode);
+        }
+        [[nodiscard]] auto minValue() const -> Number { return LinAlg::minValue(m_data.data(), m_data.size()); }
+        [[nodiscard]] auto maxValue() const -> Number { return LinAlg::maxValue(m_data.data(), m_data.size()); }
+        [[nodiscard]] auto argmin() const -> size_t { return LinAlg::argmin(m_data.data(), m_data.size()); }
+        [[nodiscard]] auto argmax() const -> size_t { return LinAlg::argmax(m_data.data(), m_data.size()); }
+    public:
+        friend void roundOff(MatrixX& mat, uint8_t decimalDigit) noexcept
+        {
+            detail::forElements(mat.size(), [&](size_t begin, size_t end)
+            {
+                Simd::roundOff(mat.data() + begin, mat.data() + begin, decimalDigit, end - begin);
+            });
+        }
+    private:
+        size_t m_rows{0};
+        size_t m_cols{0};
+        Storage m_data;
+    };
+
+    // Runtime-sized column vector, same contiguous aligned storage (and Allocator choice) as MatrixX.
+    // Like Vector, '*' between two vectors is element-wise (Hadamard).
+    // The binary operators of both types are the lazy ones from Expression.h.
+    template<Numeric Number, typename Allocator = AlignedAllocator<Number>>
+    class VectorX
+    {
+    public:
+        using value_type = Number;
+        using allocator_type = Allocator;
+        using Storage = std::vector<Number, Allocator>;
+
+        VectorX() noexcept = default;
+        VectorX(const VectorX& other) = default;
+        VectorX(VectorX&& other) noexcept = default;
+        VectorX& operator=(const VectorX& other) = default;
+        VectorX& operator=(VectorX&& other) noexcept = default;
+        ~VectorX() = default;
+        explicit VectorX(size_t size) : m_data(size, T_zero_init<Number>()) {}
+        VectorX(size_t size, Number scalar) : m_data(size, scalar) {}
+        VectorX(std::initializer_list<Number> init) : m_data(init.begin(), init.end()) {}
+        explicit VectorX(const Allocator& allocator) noexcept : m_data(allocator) {}
+        VectorX(size_t size, const Allocator& allocator) : m_data(size, T_zero_init<Number>(), allocator) {}
+        VectorX(size_t size, Number scalar, const Allocator& allocator) : m_data(size, scalar, allocator) {}
+        // Copies the elements a view sees, e.g. a column: 'VXf c(m.col(2));'.
+        explicit VectorX(VectorView<const Number> view) : VectorX(view.size())
+        {
+            this->view().assign(view);
+        }
+        template<Expression E> requires std::same_as<typename E::result_type, VectorX<Number>>
+        VectorX(const E& expr) : VectorX(expr.size())
+        {
+            detail::forElements(expr.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(m_data.data(), expr, ExprAssign{}, begin, end);
+            });
+        }
+        template<Expression E> requires std::same_as<typename E::result_type, VectorX<Number>>
+        VectorX& operator=(const E& expr)
+        {
+            if (size() != expr.size())
+            {
+                VectorX result(expr.size(), m_data.get_allocator());
+                detail::forElements(expr.size(), [&](size_t begin, size_t end)
+                {
+                    evaluateExpr(result.data(), expr, ExprAssign{}, begin, end);
+                });
+                return *this = std::move(result);
+            }
+            detail::forElements(expr.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(m_data.data(), expr, ExprAssign{}, begin, end);
+            });
+            return *this;
+        }
+        friend void printVector(const VectorX& v) noexcept
+        {
+            std::println("VectorX{}: {}", v.size(), std::span{v.m_data});
+        }
+    public:
+        [[nodiscard]] constexpr size_t size() const noexcept { return m_data.size(); }
+        [[nodiscard]] constexpr auto data(this auto&& self) noexcept { return self.m_data.data(); }
+        [[nodiscard]] Allocator get_allocator() const noexcept { return m_data.get_allocator(); }
+        [[nodiscard]] constexpr auto& operator[](this auto&& self, size_t i) noexcept
+        {
+            assert(i < self.m_data.size());
+            return self.m_data[i];
+        }
+        [[nodiscard]] constexpr auto span(this auto&& self) noexcept { return std::span{self.m_data}; }
+        constexpr auto begin(this auto&& self) noexcept { return self.m_data.begin(); }
+        constexpr auto end(this auto&& self) noexcept { return self.m_data.end(); }
+        void resize(size_t size) { m_data.assign(size, T_zero_init<Number>()); }
+        constexpr auto expr() const noexcept -> ExprLeaf<VectorX<Number>, Number>
+        {
+            return {{}, m_data.data(), m_data.size(), m_data.size(), 1};
+        }
+        [[nodiscard]] constexpr auto view(this auto&& self) noexcept { return VectorView{self.m_data.data(), self.m_data.size()}; }
+    public:
+        template<typename OtherAllocator>
+        auto operator+=(this auto& self, const VectorX<Number, OtherAllocator>& other) noexcept -> VectorX&
+        {
+            assert(self.size() == other.size());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::add(self.data() + begin, self.data() + begin, other.data() + begin, end - begin);
+            });
+            return self;
+        }
+        auto operator+=(this auto& self, const Expression auto& expr) noexcept -> VectorX&
+        {
+            assert(self.size() == expr.size());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(self.data(), expr, std::plus{}, begin, end);
+            });
+            return self;
+        }
+        auto operator+=(this auto& self, Number scalar) noexcept -> VectorX&
+        {
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::addScalar(self.data() + begin, self.data() + begin, scalar, end - begin);
+            });
+            return self;
+        }
+        template<typename OtherAllocator>
+        auto operator-=(this auto& self, const VectorX<Number, OtherAllocator>& other) noexcept -> VectorX&
+        {
+            assert(self.size() == other.size());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::sub(self.data() + begin, self.data() + begin, other.data() + begin, end - begin);
+            });
+            return self;
+        }
+        auto operator-=(this auto& self, const Expression auto& expr) noexcept -> VectorX&
+        {
+            assert(self.size() == expr.size());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(self.data(), expr, std::minus{}, begin, end);
+            });
+            return self;
+        }
+        auto operator-=(this auto& self, Number scalar) noexcept -> VectorX&
+        {
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::subScalar(self.data() + begin, self.data() + begin, scalar, end - begin);
+            });
+            return self;
+        }
+        template<typename OtherAllocator>
+        auto operator*=(this auto& self, const VectorX<Number, OtherAllocator>& other) noexcept -> VectorX&
+        {
+            assert(self.size() == other.size());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::mul(self.data() + begin, self.data() + begin, other.data() + begin, end - begin);
+            });
+            return self;
+        }
+        auto operator*=(this auto& self, const Expression auto& expr) noexcept -> VectorX&
+        {
+            assert(self.size() == expr.size());
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                evaluateExpr(self.data(), expr, std::multiplies{}, begin, end);
+            });
+            return self;
+        }
+        auto operator*=(this auto& self, Number scalar) noexcept -> VectorX&
+        {
+            detail::forElements(self.size(), [&](size_t begin, size_t end)
+            {
+                Simd::mulScalar(self.data() + begin, self.data() + begin, scalar, end - begin);
+            });
+            return self;
+        }
+    public:
+        // Reductions over all elements (Reductions.h), split across the pool like the operators
+        // (Parallel::current() decides).
+        [[nodiscard]] auto sum(Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::sum(m_data.data(), m_data.size(), mode);
+        }
+        template<typename OtherAllocator>
+        [[nodiscard]] auto dot(const VectorX<Number, OtherAllocator>& other, Reduction mode = {}) const -> ReduceType<Number>
+        {
+            assert(size() == other.size());
+            return LinAlg::dot(m_data.data(), other.data(), m_data.size(), mode);
+        }
+        [[nodiscard]] auto squaredNorm(Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::squaredNorm(m_data.data(), m_data.size(), mode);
+        }
+        [[nodiscard]] auto norm(Reduction mode = {}) const -> NormType<Number>
+        {
+            return LinAlg::norm(m_data.data(), m_data.size(), mode);
+        }
+        [[nodiscard]] auto minValue() const -> Number { return LinAlg::minValue(m_data.data(), m_data.size()); }
+        [[nodiscard]] auto maxValue() const -> Number { return LinAlg::maxValue(m_data.data(), m_data.size()); }
+        [[nodiscard]] auto argmin() const -> size_t { return LinAlg::argmin(m_data.data(), m_data.size()); }
+        [[nodiscard]] auto argmax() const -> size_t { return LinAlg::argmax(m_data.data(), m_data.size()); }
+    public:
+        friend void roundOff(VectorX& v, uint8_t decimalDigit) noexcept
+        {
+            detail::forElements(v.size(), [&](size_t begin, size_t end)
+            {
+                Simd::roundOff(v.data() + begin, v.data() + begin, decimalDigit, end - begin);
+            });
+        }
+    private:
+        Storage m_data;
+    };
+
+    template<typename Number>
+    inline constexpr bool ElementwiseProduct<VectorX<Number>> = true;
+
+    using MatXu8     =  MatrixX<uint8_t>;
+    using MatXu16    =  MatrixX<uint16_t>;
+    using MatXu32    =  MatrixX<uint32_t>;
+    using MatXu64    =  MatrixX<uint64_t>;
+    using MatXs      =  MatrixX<short>;
+    using MatXi      =  MatrixX<int>;
+    using MatXl      =  MatrixX<long>;
+    using MatXst     =  MatrixX<size_t>;
+    using MatXf      =  MatrixX<float>;
+    using MatXd      =  MatrixX<double>;
+    using MatXh      =  MatrixX<Float16>;
+    using MatXbf     =  MatrixX<BFloat16>;
+
+    using VXu8       =  VectorX<uint8_t>;
+    using VXu16      =  VectorX<uint16_t>;
+    using VXu32      =  VectorX<uint32_t>;
+    using VXu64      =  VectorX<uint64_t>;
+    using VXs        =  VectorX<short>;
+    using VXi        =  VectorX<int>;
+    using VXl        =  VectorX<long>;
+    using VXst       =  VectorX<size_t>;
+    using VXf        =  VectorX<float>;
+    using VXd        =  VectorX<double>;
+    using VXh        =  VectorX<Float16>;
+    using VXbf       =  VectorX<BFloat16>;
+}
@@ -0,0 +1,279 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "Profiling.h"
+#include "SimdKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <concepts>
+#include <functional>
+#include <utility>
+namespace LinAlg
+{
+    // Lazy element-wise expressions.
+    // 'a + b * c - d' no longer builds three temporaries: every operator returns a small node
+    // that only remembers its operands, and the whole tree is evaluated in ONE loop when it is
+    // assigned to a container (constructor, operator=, or a compound operator like +=).
+    //   ExprLeaf   -> read-only window over a container's contiguous elements
+    //   ExprBinary -> lhs[i] (op) rhs[i]
+    //   ExprScalar -> lhs[i] (op) scalar
+    // Nodes hold leaves by value and leaves hold raw pointers, so an expression must not outlive
+    // the containers it reads from: 'auto e = a + b;' is fine, 'auto e = a + makeTemp();' dangles.
+
+    // Marker base of every node.
+    struct ExprTag {};
+    template<typename T>
+    concept Expression = std::derived_from<std::remove_cvref_t<T>, ExprTag>;
+
+    // A container takes part in expressions by exposing 'expr()' that returns its leaf.
+    template<typename T>
+    concept ExprSource = requires(const T& t)
+    {
+        { t.expr() } -> Expression;
+    };
+    template<typename T>
+    concept ExprOperand = Expression<T> || ExprSource<T>;
+
+    // Element-wise '*' between two containers is only defined for vectors (Hadamard product, as
+    // the original Vector operators did). For matrices 'a * b' stays unavailable so nobody mistakes
+    // it for the matrix product (use matmul()).
+    template<typename Result>
+    inline constexpr bool ElementwiseProduct = false;
+
+    // Result = container type the expression evaluates into (Vector<3, float>, Matrix<4, double>, ...)
+    // LEAVES / OPS (operands read and operations per element) feed the profiler counters.
+    template<typename Result, typename Number>
+    struct ExprLeaf : ExprTag
+    {
+        using result_type = Result;
+        using value_type = Number;
+        using compute_type = ComputeType<Number>;
+        static constexpr size_t LEAVES = 1;
+        static constexpr size_t OPS = 0;
+        const Number* ptr;
+        size_t count;
+        size_t nRows;
+        size_t nCols;
+        constexpr compute_type operator[](size_t i) const noexcept { return static_cast<compute_type>(ptr[i]); }
+        constexpr size_t size() const noexcept { return count; }
+        constexpr size_t rows() const noexcept { return nRows; }
+        constexpr size_t cols() const noexcept { return nCols; }
+    };
+
+    template<typename Op, Expression L, Expression R>
+    struct ExprBinary : ExprTag
+    {
+        using result_type = typename L::result_type;
+        using value_type = typename L::value_type;
+        using compute_type = typename L::compute_type;
+        static constexpr size_t LEAVES = L::LEAVES + R::LEAVES;
+        static constexpr size_t OPS = L::OPS + R::OPS + 1;
+        L lhs;
+        R rhs;
+        [[no_unique_address]] Op op;
+        // Each node narrows back to compute_type (= value_type), so integer types wrap exactly
+        // like they did when every step was stored into a temporary. 16-bit floats stay in float
+        // until the final store.
+        constexpr compute_type operator[](size_t i) const noexcept { return static_cast<compute_type>(op(lhs[i], rhs[i])); }
+        constexpr size_t size() const noexcept { return lhs.size(); }
+        constexpr size_t rows() const noexcept { return lhs.rows(); }
+        constexpr size_t cols() const noexcept { return lhs.cols(); }
+    };
+
+    template<typename Op, Expression L>
+    struct ExprScalar : ExprTag
+    {
+        using result_type = typename L::result_type;
+        using value_type = typename L::value_type;
+        using compute_type = typename L::compute_type;
+        static constexpr size_t LEAVES = L::LEAVES;
+        static constexpr size_t OPS = L::OPS + 1;
+        L lhs;
+        value_type scalar;
+        [[no_unique_address]] Op op;
+        constexpr compute_type operator[](size_t i) const noexcept
+        {
+            return static_cast<compute_type>(op(lhs[i], static_cast<compute_type>(scalar)));
+        }
+        constexpr size_t size() const noexcept { return lhs.size(); }
+        constexpr size_t rows() const noexcept { return lhs.rows(); }
+        constexpr size_t cols() const noexcept { return lhs.cols(); }
+    };
+
+    template<ExprOperand T>
+    constexpr auto toExpr(const T& operand) noexcept
+    {
+        if constexpr (Expression<T>)
+            return operand;
+        else
+            return operand.expr();
+    }
+    template<typename T>
+    using ExprOf = decltype(toExpr(std::declval<const T&>()));
+    template<typename T>
+    using ExprResultOf = typename ExprOf<T>::result_type;
+    template<typename T>
+    using ExprValueOf = typename ExprOf<T>::value_type;
+
+    template<typename L, typename R>
+    concept SameShapeOperands = ExprOperand<L> && ExprOperand<R> && std::same_as<ExprResultOf<L>, ExprResultOf<R>>;
+
+    // Assignment "operator" for evaluateExpr: just take the expression's value.
+    struct ExprAssign
+    {
+        template<typename Lhs, typename Rhs>
+        constexpr Rhs operator()(const Lhs&, const Rhs& rhs) const noexcept { return rhs; }
+    };
+
+    namespace detail
+    {
+        // Copy of a 16-bit expression whose leaves read float blocks instead: elements
+        // [begin, begin + count) of every leaf are widened into the next free block (leaf order).
+        template<typename Op, typename L, typename R>
+        auto widenLeaves(const ExprBinary<Op, L, R>& node, typename L::compute_type* blocks, size_t& slot,
+                         size_t begin, size_t count) noexcept;
+        template<typename Op, typename L>
+        auto widenLeaves(const ExprScalar<Op, L>& node, typename L::compute_type* blocks, size_t& slot,
+                         size_t begin, size_t count) noexcept;
+        template<typename Result, typename Number>
+        auto widenLeaves(const ExprLeaf<Result, Number>& leaf, ComputeType<Number>* blocks, size_t& slot,
+                         size_t begin, size_t count) noexcept
+        {
+            ComputeType<Number>* block = blocks + slot++ * Simd::detail::WIDEN_BLOCK;
+            Simd::widen(block, leaf.ptr + begin, count);
+            return ExprLeaf<Result, ComputeType<Number>>{{}, block, count, leaf.nRows, leaf.nCols};
+        }
+        template<typename Op, typename L, typename R>
+        auto widenLeaves(const ExprBinary<Op, L, R>& node, typename L::compute_type* blocks, size_t& slot,
+                         size_t begin, size_t count) noexcept
+        {
+            auto lhs = widenLeaves(node.lhs, blocks, slot, begin, count);
+            auto rhs = widenLeaves(node.rhs, blocks, slot, begin, count);
+            return ExprBinary<Op, decltype(lhs), decltype(rhs)>{{}, lhs, rhs, node.op};
+        }
+        template<typename Op, typename L>
+        auto widenLeaves(const ExprScalar<Op, L>& node, typename L::compute_type* blocks, size_t& slot,
+                         size_t begin, size_t count) noexcept
+        {
+            auto lhs = widenLeaves(node.lhs, blocks, slot, begin, count);
+            return ExprScalar<Op, decltype(lhs)>{{}, lhs, static_cast<typename L::compute_type>(node.scalar), node.op};
+        }
+
+        // evaluateExpr for 16-bit containers: per block, the leaves (and dst, if op reads it) are
+        // widened with the vector conversions, the loop runs on floats and the block is narrowed
+        // once, instead of converting element by element.
+        template<ReducedFloat Number, Expression E, typename Op>
+        void evaluateWidened(Number* dst, const E& expr, Op op, size_t begin, size_t end) noexcept
+        {
+            using F = ComputeType<Number>;
+            constexpr size_t BLOCK = Simd::detail::WIDEN_BLOCK;
+            alignas(64) F blocks[E::LEAVES + 1][BLOCK];
+            F* out = blocks[E::LEAVES];
+            for (size_t i = begin; i < end; i += BLOCK)
+            {
+                const size_t count = std::min(BLOCK, end - i);
+                size_t slot = 0;
+                const auto wide = widenLeaves(expr, blocks[0], slot, i, count);
+                if constexpr (std::same_as<Op, ExprAssign>)
+                    for (size_t j = 0; j < count; ++j)
+                        out[j] = wide[j];
+                else
+                {
+                    Simd::widen(out, dst + i, count);
+                    for (size_t j = 0; j < count; ++j)
+                        out[j] = static_cast<F>(op(out[j], wide[j]));
+                }
+                Simd::narrow(dst + i, out, count);
+            }
+        }
+    }
+
+    // The single fused loop: dst[i] = dst[i] (op) expr[i] for i in [begin, end).
+    template<typename Number, Expression E, typename Op>
+    constexpr void evaluateExpr(Number* dst, const E& expr, Op op, size_t begin, size_t end) noexcept
+    {
+        const auto loop = [&]
+        {
+            for (size_t i = begin; i < end; ++i)
+                dst[i] = static_cast<Number>(op(static_cast<typename E::compute_type>(dst[i]), expr[i]));
+        };
+        if !consteval
+        {
+            [[maybe_unused]] constexpr bool assign = std::same_as<Op, ExprAssign>;
+            LINALG_PROFILE_KERNEL("evaluateExpr", (E::LEAVES + (assign ? 1 : 2)) * (end - begin) * sizeof(Number),
+                                  (E::OPS + (assign ? 0 : 1)) * (end - begin));
+            if constexpr (ReducedFloat<Number>)
+                detail::evaluateWidened(dst, expr, op, begin, end);
+            else
+                loop();
+            return;
+        }
+        loop();
+    }
+    template<typename Number, Expression E, typename Op>
+    constexpr void evaluateExpr(Number* dst, const E& expr, Op op) noexcept
+    {
+        evaluateExpr(dst, expr, op, 0, expr.size());
+    }
+
+    template<typename Op, typename L, typename R>
+    constexpr auto makeBinary(const L& lhs, const R& rhs) noexcept
+    {
+        auto l = toExpr(lhs);
+        auto r = toExpr(rhs);
+        // Checked per dimension: a 2x3 and a 3x2 matrix have the same size().
+        assert(l.rows() == r.rows());
+        assert(l.cols() == r.cols());
+        return ExprBinary<Op, decltype(l), decltype(r)>{{}, l, r, Op{}};
+    }
+    template<typename Op, typename L>
+    constexpr auto makeScalar(const L& lhs, ExprValueOf<L> scalar) noexcept
+    {
+        return ExprScalar<Op, ExprOf<L>>{{}, toExpr(lhs), scalar, Op{}};
+    }
+
+    // Addition
+    template<typename L, typename R> requires SameShapeOperands<L, R>
+    constexpr auto operator+(const L& lhs, const R& rhs) noexcept
+    {
+        return makeBinary<std::plus<>>(lhs, rhs);
+    }
+    template<ExprOperand L>
+    constexpr auto operator+(const L& lhs, ExprValueOf<L> scalar) noexcept
+    {
+        return makeScalar<std::plus<>>(lhs, scalar);
+    }
+    template<ExprOperand R>
+    constexpr auto operator+(ExprValueOf<R> scalar, const R& rhs) noexcept
+    {
+        return makeScalar<std::plus<>>(rhs, scalar);
+    }
+    // Subtraction
+    template<typename L, typename R> requires SameShapeOperands<L, R>
+    constexpr auto operator-(const L& lhs, const R& rhs) noexcept
+    {
+        return makeBinary<std::minus<>>(lhs, rhs);
+    }
+    template<ExprOperand L>
+    constexpr auto operator-(const L& lhs, ExprValueOf<L> scalar) noexcept
+    {
+        return makeScalar<std::minus<>>(lhs, scalar);
+    }
+    // Multiplication
+    template<typename L, typename R> requires SameShapeOperands<L, R> && ElementwiseProduct<ExprResultOf<L>>
+    constexpr auto operator*(const L& lhs, const R& rhs) noexcept
+    {
+        return makeBinary<std::multiplies<>>(lhs, rhs);
+    }
+    template<ExprOperand L>
+    constexpr auto operator*(const L& lhs, ExprValueOf<L> scalar) noexcept
+    {
+        return makeScalar<std::multiplies<>>(lhs, scalar);
+    }
+    template<ExprOperand R>
+    constexpr auto operator*(ExprValueOf<R> scalar, const R& rhs) noexcept
+    {
+        return makeScalar<std::multiplies<>>(rhs, scalar);
+    }
+}
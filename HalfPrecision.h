@@ -0,0 +1,164 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include <bit>
+#include <cstdint>
+#include <format>
+#if defined(__STDCPP_FLOAT16_T__) || defined(__STDCPP_BFLOAT16_T__)
+#include <stdfloat>
+#endif
+namespace LinAlg
+{
+    // 16-bit floating point storage types.
+    //   Float16  : IEEE binary16  (1 sign, 5 exponent, 10 mantissa bits, max 65504)
+    //   BFloat16 : bfloat16       (1 sign, 8 exponent,  7 mantissa bits, float's range)
+    // They only hold values: reading one gives a float, writing a float rounds to nearest even,
+    // so 'h = a + b * c' computes in float and narrows once. Containers of them (V4h, MatXbf, ...)
+    // go through the same operators as every other element type; the kernels widen blocks of
+    // elements to float with the F16C / AVX-512 conversions, compute and narrow the result (see
+    // Simd::widen / Simd::narrow), so memory traffic is half that of float.
+    enum class HalfFormat : uint8_t
+    {
+        Binary16,
+        BFloat16
+    };
+
+    namespace detail
+    {
+        // Round-to-nearest-even conversions on the bit patterns (F. Giesen's branch-light
+        // versions); constexpr so constant-evaluated containers keep working.
+        constexpr uint16_t floatToBinary16(float value) noexcept
+        {
+            constexpr uint32_t HALF_OVERFLOW = (127 + 16) << 23;   // 65536.0f: rounds to infinity
+            constexpr uint32_t HALF_NORMAL = 113 << 23;            // 2^-14: smallest normal half
+            constexpr float SUBNORMAL_MAGIC = 0.5f;                // aligns 2^-24 to the last mantissa bit
+            uint32_t bits = std::bit_cast<uint32_t>(value);
+            const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+            bits &= 0x7FFFFFFFu;
+            if (bits >= HALF_OVERFLOW)
+                return static_cast<uint16_t>(sign | (bits > 0x7F800000u ? 0x7E00u : 0x7C00u));   // NaN stays a (quiet) NaN
+            if (bits < HALF_NORMAL)
+            {
+                const float shifted = std::bit_cast<float>(bits) + SUBNORMAL_MAGIC;
+                return static_cast<uint16_t>(sign | (std::bit_cast<uint32_t>(shifted) - std::bit_cast<uint32_t>(SUBNORMAL_MAGIC)));
+            }
+            const uint32_t odd = (bits >> 13) & 1u;
+            bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu + odd;
+            return static_cast<uint16_t>(sign | (bits >> 13));
+        }
+        constexpr float binary16ToFloat(uint16_t half) noexcept
+        {
+            constexpr uint32_t EXPONENT = 0x7C00u << 13;
+            constexpr float SUBNORMAL_MAGIC = std::bit_cast<float>(uint32_t{113} << 23);
+            uint32_t bits = static_cast<uint32_t>(half & 0x7FFFu) << 13;
+            const uint32_t exponent = bits & EXPONENT;
+            bits += static_cast<uint32_t>(127 - 15) << 23;
+            if (exponent == EXPONENT)
+                bits += static_cast<uint32_t>(128 - 16) << 23;   // Inf / NaN
+            else if (exponent == 0)
+                bits = std::bit_cast<uint32_t>(std::bit_cast<float>(bits + (1u << 23)) - SUBNORMAL_MAGIC);
+            return std::bit_cast<float>(bits | static_cast<uint32_t>(half & 0x8000u) << 16);
+        }
+        constexpr uint16_t floatToBFloat16(float value) noexcept
+        {
+            const uint32_t bits = std::bit_cast<uint32_t>(value);
+            if ((bits & 0x7FFFFFFFu) > 0x7F800000u)
+                return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+            return static_cast<uint16_t>((bits + 0x7FFFu + ((bits >> 16) & 1u)) >> 16);
+        }
+        constexpr float bfloat16ToFloat(uint16_t bits) noexcept
+        {
+            return std::bit_cast<float>(static_cast<uint32_t>(bits) << 16);
+        }
+    }
+
+    struct Float16
+    {
+        uint16_t bits = 0;
+
+        Float16() noexcept = default;
+        constexpr Float16(float value) noexcept : bits(detail::floatToBinary16(value)) {}
+        [[nodiscard]] static constexpr Float16 fromBits(uint16_t raw) noexcept
+        {
+            Float16 h;
+            h.bits = raw;
+            return h;
+        }
+        constexpr operator float() const noexcept { return detail::binary16ToFloat(bits); }
+
+        constexpr Float16& operator+=(float other) noexcept { return *this = static_cast<float>(*this) + other; }
+        constexpr Float16& operator-=(float other) noexcept { return *this = static_cast<float>(*this) - other; }
+        constexpr Float16& operator*=(float other) noexcept { return *this = static_cast<float>(*this) * other; }
+        constexpr Float16& operator/=(float other) noexcept { return *this = static_cast<float>(*this) / other; }
+    };
+
+    struct BFloat16
+    {
+        uint16_t bits = 0;
+
+        BFloat16() noexcept = default;
+        constexpr BFloat16(float value) noexcept : bits(detail::floatToBFloat16(value)) {}
+        [[nodiscard]] static constexpr BFloat16 fromBits(uint16_t raw) noexcept
+        {
+            BFloat16 b;
+            b.bits = raw;
+            return b;
+        }
+        constexpr operator float() const noexcept { return detail::bfloat16ToFloat(bits); }
+
+        constexpr BFloat16& operator+=(float other) noexcept { return *this = static_cast<float>(*this) + other; }
+        constexpr BFloat16& operator-=(float other) noexcept { return *this = static_cast<float>(*this) - other; }
+        constexpr BFloat16& operator*=(float other) noexcept { return *this = static_cast<float>(*this) * other; }
+        constexpr BFloat16& operator/=(float other) noexcept { return *this = static_cast<float>(*this) / other; }
+    };
+
+    static_assert(sizeof(Float16) == 2 && sizeof(BFloat16) == 2);
+
+    template<>
+    inline constexpr bool is_reduced_float_v<Float16> = true;
+    template<>
+    inline constexpr bool is_reduced_float_v<BFloat16> = true;
+    template<>
+    struct ComputeTypeOf<Float16> { using type = float; };
+    template<>
+    struct ComputeTypeOf<BFloat16> { using type = float; };
+
+    // Bit layout of a 16-bit type, for the vector conversion kernels.
+    template<ReducedFloat T>
+    inline constexpr HalfFormat HALF_FORMAT_OF = HalfFormat::Binary16;
+    template<>
+    inline constexpr HalfFormat HALF_FORMAT_OF<BFloat16> = HalfFormat::BFloat16;
+
+    // The standard extended types share the layouts, so they get the same kernels.
+#ifdef __STDCPP_FLOAT16_T__
+    template<>
+    inline constexpr bool is_reduced_float_v<std::float16_t> = true;
+    template<>
+    struct ComputeTypeOf<std::float16_t> { using type = float; };
+#endif
+#ifdef __STDCPP_BFLOAT16_T__
+    template<>
+    inline constexpr bool is_reduced_float_v<std::bfloat16_t> = true;
+    template<>
+    struct ComputeTypeOf<std::bfloat16_t> { using type = float; };
+    template<>
+    inline constexpr HalfFormat HALF_FORMAT_OF<std::bfloat16_t> = HalfFormat::BFloat16;
+#endif
+}
+
+// Printed like the float they hold.
+template<typename CharT>
+struct std::formatter<LinAlg::Float16, CharT> : std::formatter<float, CharT>
+{
+    auto format(LinAlg::Float16 value, auto& context) const
+    {
+        return std::formatter<float, CharT>::format(static_cast<float>(value), context);
+    }
+};
+template<typename CharT>
+struct std::formatter<LinAlg::BFloat16, CharT> : std::formatter<float, CharT>
+{
+    auto format(LinAlg::BFloat16 value, auto& context) const
+    {
+        return std::formatter<float, CharT>::format(static_cast<float>(value), context);
+    }
+};
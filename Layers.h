@@ -0,0 +1,417 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "MatMul.h"
+#include "SimdKernels.h"
+#include "Training.h"
+#include <span>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <numeric>
+#include <concepts>
+#include <type_traits>
+#include <initializer_list>
+#include <algorithm>
+#include <cassert>
+namespace ML
+{
+    // Fully connected layers: Y = act(X W + b)
+    //   X : batch x inputs       (any strides, e.g. a column-major slice of a DatasetView)
+    //   W : inputs x outputs     (row-major MatrixX)
+    //   b : outputs
+    //   Y : batch x outputs      (row-major MatrixX owned by the layer)
+    // Forward is ONE gemm whose epilogue adds the bias and applies the activation to every register
+    // tile before it leaves L1, so the pre-activation X W never exists in memory.
+    // Backward never stores dZ = dY * act'(Z) either: the derivative is written in terms of the
+    // layer's output Y, and it is applied while dY is packed for the two gradient gemms
+    //   dW = X^T dZ          (dZ packed as the B operand)
+    //   dX = dZ W^T          (dZ packed as the A operand)
+    enum class Activation : uint8_t
+    {
+        Identity,
+        ReLU,
+        Sigmoid,
+        Tanh
+    };
+
+    template<Activation act, std::floating_point Number>
+    constexpr Number activate(Number z) noexcept
+    {
+        if constexpr (act == Activation::ReLU)
+            return z > Number{} ? z : Number{};
+        else if constexpr (act == Activation::Sigmoid)
+            return Number{1} / (Number{1} + std::exp(-z));
+        else if constexpr (act == Activation::Tanh)
+            return std::tanh(z);
+        else
+            return z;
+    }
+    // act'(z) expressed through y = act(z), so the backward pass only needs the stored output.
+    template<Activation act, std::floating_point Number>
+    constexpr Number derivativeFromOutput(Number y) noexcept
+    {
+        if constexpr (act == Activation::ReLU)
+            return y > Number{} ? Number{1} : Number{};
+        else if constexpr (act == Activation::Sigmoid)
+            return y * (Number{1} - y);
+        else if constexpr (act == Activation::Tanh)
+            return Number{1} - y * y;
+        else
+            return Number{1};
+    }
+
+    // Turns the runtime activation into a compile-time one: fn(std::integral_constant<Activation, ...>).
+    // One switch per call, the loops inside fn are compiled separately for every activation.
+    template<typename Fn>
+    decltype(auto) withActivation(Activation activation, Fn&& fn)
+    {
+        switch (activation)
+        {
+            case Activation::ReLU:    return fn(std::integral_constant<Activation, Activation::ReLU>{});
+            case Activation::Sigmoid: return fn(std::integral_constant<Activation, Activation::Sigmoid>{});
+            case Activation::Tanh:    return fn(std::integral_constant<Activation, Activation::Tanh>{});
+            default:                  return fn(std::integral_constant<Activation, Activation::Identity>{});
+        }
+    }
+
+    namespace detail
+    {
+        // gemm epilogue of the forward pass: tile = act(tile + bias).
+        template<Activation act, std::floating_point Number>
+        struct BiasActivation
+        {
+            const Number* bias;
+            void operator()(Number* tile, size_t rsC, size_t csC, size_t, size_t col, size_t mr, size_t nr) const noexcept
+            {
+                for (size_t i = 0; i < mr; ++i)
+                {
+                    Number* c = tile + i * rsC;
+                    for (size_t j = 0; j < nr; ++j)
+                        c[j * csC] = activate<act>(c[j * csC] + bias[col + j]);
+                }
+            }
+        };
+
+        // gemm pack transform of the backward pass: dY(row, col) -> dZ(row, col).
+        template<Activation act, std::floating_point Number>
+        struct ActivationGrad
+        {
+            const Number* output;
+            size_t rsY;
+            Number operator()(Number grad, size_t row, size_t col) const noexcept
+            {
+                return grad * derivativeFromOutput<act>(output[row * rsY + col]);
+            }
+        };
+    }
+
+    // Y = act(X W + b) into output (resized to X.rows() x W.cols() when it is not that already),
+    // with the weights wherever they live: Dense's own, or the mapped pages of a checkpoint.
+    template<std::floating_point Number, typename Allocator>
+    void denseForward(std::type_identity_t<LinAlg::MatrixView<const Number>> X, std::type_identity_t<LinAlg::MatrixView<const Number>> W,
+                      const Number* bias, Activation activation, LinAlg::MatrixX<Number, Allocator>& output)
+    {
+        assert(X.cols() == W.rows());
+        if (output.rows() != X.rows() || output.cols() != W.cols())
+            output.resize(X.rows(), W.cols());
+        withActivation(activation, [&](auto act)
+        {
+            LinAlg::gemmFused(X.rows(), W.cols(), W.rows(), Number{1},
+                              X.data(), X.rowStride(), X.colStride(),
+                              W.data(), W.rowStride(), W.colStride(),
+                              Number{}, output.data(), W.cols(), size_t{1},
+                              LinAlg::PackCopy{}, LinAlg::PackCopy{},
+                              detail::BiasActivation<decltype(act)::value, Number>{bias});
+        });
+    }
+
+    // Allocator is the storage allocator of every buffer the layer owns (parameters, gradients,
+    // activations), e.g. LinAlg::PoolAllocator<float> to keep them out of the global heap.
+    template<std::floating_point Number, typename Allocator = LinAlg::AlignedAllocator<Number>>
+    class Dense
+    {
+    public:
+        using Matrix = LinAlg::MatrixX<Number, Allocator>;
+        using Vector = LinAlg::VectorX<Number, Allocator>;
+
+        // Weights start uniform in +-sqrt(3 / fan) with fan = inputs / 2 for ReLU (He) and
+        // (inputs + outputs) / 2 otherwise (Glorot); the bias starts at zero.
+        Dense(size_t inputs, size_t outputs, Activation activation = Activation::Identity, uint64_t seed = 0,
+              const Allocator& allocator = Allocator())
+            : m_weights(inputs, outputs, allocator), m_bias(outputs, allocator), m_weightGrad(inputs, outputs, allocator),
+              m_biasGrad(outputs, allocator), m_output(allocator), m_inputGrad(allocator), m_activation(activation)
+        {
+            const double fan = activation == Activation::ReLU ? static_cast<double>(inputs) / 2.0
+                                                              : static_cast<double>(inputs + outputs) / 2.0;
+            const double limit = std::sqrt(3.0 / std::max(fan, 1.0));
+            std::mt19937_64 rng(seed);
+            std::uniform_real_distribution<double> dist(-limit, limit);
+            for (size_t i = 0; i < m_weights.size(); ++i)
+                m_weights.data()[i] = static_cast<Number>(dist(rng));
+        }
+
+        [[nodiscard]] size_t inputs() const noexcept { return m_weights.rows(); }
+        [[nodiscard]] size_t outputs() const noexcept { return m_weights.cols(); }
+        [[nodiscard]] Activation activation() const noexcept { return m_activation; }
+        auto& weights(this auto&& self) noexcept { return self.m_weights; }
+        auto& bias(this auto&& self) noexcept { return self.m_bias; }
+        [[nodiscard]] const Matrix& weightGrad() const noexcept { return m_weightGrad; }
+        [[nodiscard]] const Vector& biasGrad() const noexcept { return m_biasGrad; }
+        [[nodiscard]] const Matrix& output() const noexcept { return m_output; }
+
+        // X(i, f) = X[i * rsX + f * csX]. X must stay alive until backward() has run.
+        auto forward(const Number* X, size_t rows, size_t rsX, size_t csX) -> const Matrix&
+        {
+            m_input = X;
+            m_rsX = rsX;
+            m_csX = csX;
+            denseForward(LinAlg::MatrixView<const Number>(X, rows, inputs(), rsX, csX), m_weights.view(), m_bias.data(),
+                         m_activation, m_output);
+            return m_output;
+        }
+        // Any strided view works as the input: a batch of a dataset, a block, a transpose.
+        auto forward(LinAlg::MatrixView<const Number> input) -> const Matrix&
+        {
+            assert(input.cols() == inputs());
+            return forward(input.data(), input.rows(), input.rowStride(), input.colStride());
+        }
+        template<typename InputAllocator>
+        auto forward(const LinAlg::MatrixX<Number, InputAllocator>& input) -> const Matrix&
+        {
+            return forward(input.view());
+        }
+
+        // outputGrad = dLoss/dY of the last forward(). Fills weightGrad() / biasGrad() and returns
+        // dLoss/dX (left untouched when needInputGrad is false, e.g. for the first layer).
+        template<typename GradAllocator>
+        auto backward(const LinAlg::MatrixX<Number, GradAllocator>& outputGrad, bool needInputGrad = true) -> const Matrix&
+        {
+            const size_t rows = m_output.rows();
+            assert(m_input != nullptr);
+            assert(outputGrad.rows() == rows && outputGrad.cols() == outputs());
+            withActivation(m_activation, [&](auto act)
+            {
+                constexpr Activation a = decltype(act)::value;
+                const detail::ActivationGrad<a, Number> toPreActivation{m_output.data(), outputs()};
+                // dW = X^T dZ
+                LinAlg::gemmFused(inputs(), outputs(), rows, Number{1},
+                                  m_input, m_csX, m_rsX,
+                                  outputGrad.data(), outputs(), size_t{1},
+                                  Number{}, m_weightGrad.data(), outputs(), size_t{1},
+                                  LinAlg::PackCopy{}, toPreActivation, LinAlg::NoEpilogue{});
+                // db = column sums of dZ
+                Number* db = m_biasGrad.data();
+                std::fill_n(db, outputs(), Number{});
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    const Number* g = outputGrad.data() + i * outputs();
+                    const Number* y = m_output.data() + i * outputs();
+                    for (size_t j = 0; j < outputs(); ++j)
+                        db[j] += g[j] * derivativeFromOutput<a>(y[j]);
+                }
+                // dX = dZ W^T
+                if (needInputGrad)
+                {
+                    if (m_inputGrad.rows() != rows || m_inputGrad.cols() != inputs())
+                        m_inputGrad.resize(rows, inputs());
+                    LinAlg::gemmFused(rows, inputs(), outputs(), Number{1},
+                                      outputGrad.data(), outputs(), size_t{1},
+                                      m_weights.data(), size_t{1}, outputs(),
+                                      Number{}, m_inputGrad.data(), inputs(), size_t{1},
+                                      toPreActivation, LinAlg::PackCopy{}, LinAlg::NoEpilogue{});
+                }
+            });
+            return m_inputGrad;
+        }
+
+        // Plain gradient descent step: W -= lr * dW, b -= lr * db.
+        void step(Number learningRate) noexcept
+        {
+            LinAlg::Simd::axpy(m_weights.data(), m_weightGrad.data(), static_cast<Number>(-learningRate), m_weights.size());
+            LinAlg::Simd::axpy(m_bias.data(), m_biasGrad.data(), static_cast<Number>(-learningRate), m_bias.size());
+        }
+        // Weights and bias as optimizer slots (Optimizers.h).
+        auto parameters() noexcept -> std::array<Parameter<Number>, 2>
+        {
+            return {{{m_weights.data(), m_weightGrad.data(), m_weights.size()},
+                     {m_bias.data(), m_biasGrad.data(), m_bias.size()}}};
+        }
+    private:
+        Matrix m_weights;
+        Vector m_bias;
+        Matrix m_weightGrad;
+        Vector m_biasGrad;
+        Matrix m_output;
+        Matrix m_inputGrad;
+        const Number* m_input = nullptr;
+        size_t m_rsX = 0;
+        size_t m_csX = 0;
+        Activation m_activation;
+    };
+
+    struct LayerSpec
+    {
+        size_t inputs = 0;
+        size_t outputs = 0;
+        Activation activation = Activation::Identity;
+    };
+
+    // Sequential stack of Dense layers: ML::Mlp<double> net({{2, 16, Activation::Tanh}, {16, 1}});
+    template<std::floating_point Number, typename Allocator = LinAlg::AlignedAllocator<Number>>
+    class Mlp
+    {
+    public:
+        using Matrix = typename Dense<Number, Allocator>::Matrix;
+
+        explicit Mlp(std::initializer_list<LayerSpec> specs, uint64_t seed = 0, const Allocator& allocator = Allocator())
+        {
+            m_layers.reserve(specs.size());
+            for (const auto& spec : specs)
+            {
+                assert(m_layers.empty() || m_layers.back().outputs() == spec.inputs);
+                m_layers.emplace_back(spec.inputs, spec.outputs, spec.activation, seed + m_layers.size(), allocator);
+            }
+        }
+
+        auto& layers(this auto&& self) noexcept { return self.m_layers; }
+        [[nodiscard]] size_t inputs() const noexcept { return m_layers.front().inputs(); }
+        [[nodiscard]] size_t outputs() const noexcept { return m_layers.back().outputs(); }
+
+        auto forward(const Number* X, size_t rows, size_t rsX, size_t csX) -> const Matrix&
+        {
+            assert(!m_layers.empty());
+            const Matrix* activations = &m_layers.front().forward(X, rows, rsX, csX);
+            for (size_t l = 1; l < m_layers.size(); ++l)
+                activations = &m_layers[l].forward(*activations);
+            return *activations;
+        }
+        auto forward(LinAlg::MatrixView<const Number> input) -> const Matrix&
+        {
+            return forward(input.data(), input.rows(), input.rowStride(), input.colStride());
+        }
+        template<typename InputAllocator>
+        auto forward(const LinAlg::MatrixX<Number, InputAllocator>& input) -> const Matrix&
+        {
+            return forward(input.view());
+        }
+        // The input gradient of the first layer is never needed, so it is not computed.
+        template<typename GradAllocator>
+        void backward(const LinAlg::MatrixX<Number, GradAllocator>& outputGrad)
+        {
+            if (m_layers.size() == 1)
+            {
+                m_layers.front().backward(outputGrad, false);
+                return;
+            }
+            const Matrix* grad = &m_layers.back().backward(outputGrad, true);
+            for (size_t l = m_layers.size() - 1; l-- > 0;)
+                grad = &m_layers[l].backward(*grad, l != 0);
+        }
+        void step(Number learningRate) noexcept
+        {
+            for (auto& layer : m_layers)
+                layer.step(learningRate);
+        }
+        // Every layer's weights and bias, in order: optimizer.step(net.parameters()).
+        auto parameters() -> std::vector<Parameter<Number>>
+        {
+            std::vector<Parameter<Number>> slots;
+            slots.reserve(2 * m_layers.size());
+            for (auto& layer : m_layers)
+                for (const auto& slot : layer.parameters())
+                    slots.push_back(slot);
+            return slots;
+        }
+    private:
+        std::vector<Dense<Number, Allocator>> m_layers;
+    };
+
+    namespace detail
+    {
+        // One update of the net on the batch X (one sample per row, any strides) with targets y;
+        // parameters are net.parameters(). Adds the batch's squared error to totalError
+        // and returns the squared norm of all weight and bias gradients for gradientNorm.
+        template<std::floating_point Number, typename Allocator, Optimizer<Number> Opt>
+        double mlpStep(Mlp<Number, Allocator>& net, LinAlg::MatrixView<const Number> X, const Number* y,
+                       LinAlg::MatrixX<Number>& lossGrad, Opt& optimizer, const std::vector<Parameter<Number>>& parameters,
+                       double& totalError)
+        {
+            const size_t rows = X.rows();
+            const auto& prediction = net.forward(X);
+            if (lossGrad.rows() != rows)
+                lossGrad.resize(rows, 1);
+            const Number scale = Number{1} / static_cast<Number>(rows);
+            LinAlg::Simd::sub(lossGrad.data(), prediction.data(), y, rows);
+            totalError += static_cast<double>(LinAlg::squaredNorm(lossGrad.data(), rows, LOSS_SUMMATION));
+            LinAlg::Simd::mulScalar(lossGrad.data(), lossGrad.data(), scale, rows);
+            net.backward(lossGrad);
+            double gradientSquares = 0.0;
+            for (const auto& layer : net.layers())
+                gradientSquares += static_cast<double>(layer.weightGrad().squaredNorm(LOSS_SUMMATION)) +
+                                   static_cast<double>(layer.biasGrad().squaredNorm(LOSS_SUMMATION));
+            optimizer.step(parameters, 1.0);
+            return gradientSquares;
+        }
+    }
+
+    // Mini-batch gradient descent on squared error, same loop and reporting as trainLinear.
+    // The batch is read straight out of the SoA dataset (X_B is column-major with featureStride),
+    // so no rows are copied. A single Identity layer reproduces trainLinear exactly.
+    // The update is the optimizer's (Optimizers.h); the overload without one is plain gradient
+    // descent at config.learningRate.
+    template<std::floating_point Number, typename Allocator, Optimizer<Number> Opt>
+    auto trainMlp(Mlp<Number, Allocator>& net, const DatasetView<Number>& data, const TrainConfig& config,
+                  Opt& optimizer) -> TrainResult
+    {
+        assert(net.inputs() == data.features && net.outputs() == 1);
+        TrainResult result;
+        if (data.rows == 0 || config.epochs == 0)
+            return result;
+        const size_t batchSize = std::clamp<size_t>(config.batchSize, 1, data.rows);
+        const size_t batchCount = (data.rows + batchSize - 1) / batchSize;
+
+        LinAlg::MatrixX<Number> lossGrad(batchSize, 1);
+        const auto parameters = net.parameters();
+        std::vector<size_t> order(batchCount);
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::mt19937_64 rng(config.seed);
+        result.history.reserve(config.epochs);
+        size_t epochsWithoutImprovement = 0;
+
+        for (size_t epoch = 0; epoch < config.epochs; ++epoch)
+        {
+            LINALG_PROFILE_SCOPE("trainMlp.epoch");
+            const auto start = std::chrono::steady_clock::now();
+            if (config.shuffleBatches)
+                std::ranges::shuffle(order, rng);
+            double totalError = 0.0;
+            double gradientSquares = 0.0;
+            for (const size_t batch : order)
+            {
+                const size_t begin = batch * batchSize;
+                const size_t rows = std::min(batchSize, data.rows - begin);
+                gradientSquares += detail::mlpStep(net, data.batch(begin, rows), data.targets.data() + begin, lossGrad,
+                                                   optimizer, parameters, totalError);
+            }
+
+            EpochReport report;
+            report.epoch = epoch;
+            report.loss = totalError / static_cast<double>(data.rows);
+            report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report.samplesPerSecond = report.seconds > 0.0 ? static_cast<double>(data.rows) / report.seconds : 0.0;
+            report.gradientNorm = std::sqrt(gradientSquares / static_cast<double>(batchCount));
+            if (!detail::finishEpoch(result, report, config, epochsWithoutImprovement))
+                break;
+        }
+        return result;
+    }
+    template<std::floating_point Number, typename Allocator>
+    auto trainMlp(Mlp<Number, Allocator>& net, const DatasetView<Number>& data, const TrainConfig& config) -> TrainResult
+    {
+        auto optimizer = detail::gradientDescent<Number>(config);
+        return trainMlp(net, data, config, optimizer);
+    }
+}
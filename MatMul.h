@@ -0,0 +1,614 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "AlignedAllocator.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Profiling.h"
+#include "Matrices.h"
+#include "Vectors.h"
+#include "DynamicMatrices.h"
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <concepts>
+#include <utility>
+#include <type_traits>
+namespace LinAlg
+{
+    // Matrix products.
+    //   gemm : C = alpha * A * B + beta * C      (A is M x K, B is K x N, C is M x N)
+    //   gemv : y = alpha * A * x + beta * y      (A is M x N)
+    // Every operand is described by a pointer plus a row stride and a column stride,
+    // so row-major (rs = cols, cs = 1), column-major (rs = 1, cs = rows) and transposed
+    // operands (swap rs and cs) all go through the same code without copying.
+    //
+    // gemm follows the usual BLIS/GotoBLAS structure:
+    //   jc loop : NC columns of B/C           (B panel lives in L3)
+    //   pc loop : KC slice of the shared dimension, B panel packed once
+    //   ic loop : MC rows of A/C               (A block lives in L2), A block packed once
+    //   jr, ir  : NR x MR register tile, computed by the micro-kernel out of the packed panels
+    //
+    // gemmFused adds two kinds of hooks to that structure so callers can fuse element-wise work
+    // into the product instead of running extra passes over memory:
+    //   transformA / transformB : value(i, k) -> value applied while an operand is packed, i.e. the
+    //                             product reads f(A) or g(B) without f(A) ever being stored
+    //   epilogue                : runs on every finished register tile while it is still in L1
+    //                             (bias add, activation, ...)
+    // Hooks are called concurrently from the pool's threads and must not write shared state.
+
+    // Default hooks: operands packed as they are, C left as the product wrote it.
+    struct PackCopy
+    {
+        template<typename Number>
+        constexpr Number operator()(Number value, size_t, size_t) const noexcept { return value; }
+    };
+    struct NoEpilogue
+    {
+        // tile = &C(row, col); the tile is mr x nr and uses C's strides.
+        template<typename Number>
+        constexpr void operator()(Number*, size_t, size_t, size_t, size_t, size_t, size_t) const noexcept {}
+    };
+
+    namespace detail
+    {
+        template<Numeric Number>
+        struct GemmBlocking
+        {
+            // Register tile: MR rows x NR columns of C stay in registers for the whole kc loop.
+            // NR spans two 32-byte vectors (16 floats / 8 doubles) and MR = 6 keeps the
+            // accumulators at 12 ymm registers on AVX2 -> room left for the A broadcast and B loads.
+            static constexpr size_t MR = 6;
+            static constexpr size_t NR = std::max<size_t>(4, 64 / sizeof(Number));
+            // Cache blocks: A block (MC x KC) ~ half of L2, B panel (KC x NC) ~ a slice of L3.
+            static constexpr size_t KC = 256;
+            static constexpr size_t MC = std::max<size_t>(MR, (128 * 1024 / (KC * sizeof(Number))) / MR * MR);
+            static constexpr size_t NC = std::max<size_t>(NR, (4 * 1024 * 1024 / (KC * sizeof(Number))) / NR * NR);
+        };
+
+        template<Numeric Number>
+        using PackBuffer = std::vector<Number, AlignedAllocator<Number>>;
+
+        // Packs an mc x kc block of A into MR-row slivers: sliver s holds, for every k,
+        // the MR values A(s*MR + 0..MR-1, k) next to each other. Edge slivers are zero padded
+        // so the micro-kernel never has to branch on the tile shape.
+        // (row0, col0) is the block's position in the whole A, handed to the transform.
+        template<Numeric Number, typename Transform = PackCopy>
+        void packA(size_t mc, size_t kc, const Number* A, size_t rsA, size_t csA, Number* packed,
+                   const Transform& transform = {}, size_t row0 = 0, size_t col0 = 0) noexcept
+        {
+            constexpr size_t MR = GemmBlocking<Number>::MR;
+            for (size_t i0 = 0; i0 < mc; i0 += MR)
+            {
+                const size_t mr = std::min(MR, mc - i0);
+                for (size_t k = 0; k < kc; ++k)
+                {
+                    for (size_t i = 0; i < mr; ++i)
+                    {
+                        if constexpr (std::same_as<Transform, PackCopy>)
+                            packed[i] = A[(i0 + i) * rsA + k * csA];
+                        else
+                            packed[i] = transform(A[(i0 + i) * rsA + k * csA], row0 + i0 + i, col0 + k);
+                    }
+                    for (size_t i = mr; i < MR; ++i)
+                        packed[i] = T_zero_init<Number>();
+                    packed += MR;
+                }
+            }
+        }
+
+        // Packs a kc x nc panel of B into NR-column slivers (same idea as packA, transposed).
+        template<Numeric Number, typename Transform = PackCopy>
+        void packB(size_t kc, size_t nc, const Number* B, size_t rsB, size_t csB, Number* packed,
+                   const Transform& transform = {}, size_t row0 = 0, size_t col0 = 0) noexcept
+        {
+            constexpr size_t NR = GemmBlocking<Number>::NR;
+            for (size_t j0 = 0; j0 < nc; j0 += NR)
+            {
+                const size_t nr = std::min(NR, nc - j0);
+                for (size_t k = 0; k < kc; ++k)
+                {
+                    const Number* src = B + k * rsB + j0 * csB;
+                    if constexpr (!std::same_as<Transform, PackCopy>)
+                        for (size_t j = 0; j < nr; ++j)
+                            packed[j] = transform(src[j * csB], row0 + k, col0 + j0 + j);
+                    else if (csB == 1)
+                        std::copy_n(src, nr, packed);
+                    else
+                        for (size_t j = 0; j < nr; ++j)
+                            packed[j] = src[j * csB];
+                    for (size_t j = nr; j < NR; ++j)
+                        packed[j] = T_zero_init<Number>();
+                    packed += NR;
+                }
+            }
+        }
+
+        // MR x NR register tile: acc += a_sliver * b_sliver over kc, then
+        // C(0..mr, 0..nr) = alpha * acc + beta * C. The fixed trip counts let the compiler
+        // keep 'acc' entirely in vector registers and unroll the inner two loops.
+        template<Numeric Number>
+        [[gnu::always_inline]] inline void microKernel(size_t kc, const Number* __restrict a, const Number* __restrict b,
+                                                       Number* C, size_t rsC, size_t csC, size_t mr, size_t nr,
+                                                       Number alpha, Number beta) noexcept
+        {
+            constexpr size_t MR = GemmBlocking<Number>::MR;
+            constexpr size_t NR = GemmBlocking<Number>::NR;
+            Number acc[MR][NR]{};
+            for (size_t k = 0; k < kc; ++k)
+            {
+#pragma GCC unroll 8
+                for (size_t i = 0; i < MR; ++i)
+                {
+                    const Number ai = a[i];
+#pragma GCC unroll 16
+                    for (size_t j = 0; j < NR; ++j)
+                        acc[i][j] += ai * b[j];
+                }
+                a += MR;
+                b += NR;
+            }
+            for (size_t i = 0; i < mr; ++i)
+            {
+                Number* c = C + i * rsC;
+                // beta == 0 must not read C: it may hold NaNs / uninitialised memory.
+                if (beta == Number{})
+                    for (size_t j = 0; j < nr; ++j)
+                        c[j * csC] = alpha * acc[i][j];
+                else
+                    for (size_t j = 0; j < nr; ++j)
+                        c[j * csC] = alpha * acc[i][j] + beta * c[j * csC];
+            }
+        }
+
+        // The same tile code compiled once per instruction set; gemm picks one per call
+        // (see SimdKernels.h for the dispatch).
+        template<Numeric Number>
+        using MicroKernelFn = void (*)(size_t, const Number*, const Number*, Number*, size_t, size_t,
+                                       size_t, size_t, Number, Number) noexcept;
+
+        template<Numeric Number>
+        void microKernelScalar(size_t kc, const Number* a, const Number* b, Number* C, size_t rsC, size_t csC,
+                               size_t mr, size_t nr, Number alpha, Number beta) noexcept
+        {
+            microKernel(kc, a, b, C, rsC, csC, mr, nr, alpha, beta);
+        }
+#if LINALG_SIMD_X86
+        template<Numeric Number>
+        LINALG_TARGET_AVX512 void microKernelAvx512(size_t kc, const Number* a, const Number* b, Number* C, size_t rsC, size_t csC,
+                                                    size_t mr, size_t nr, Number alpha, Number beta) noexcept
+        {
+            microKernel(kc, a, b, C, rsC, csC, mr, nr, alpha, beta);
+        }
+        template<Numeric Number>
+        LINALG_TARGET_AVX2 void microKernelAvx2(size_t kc, const Number* a, const Number* b, Number* C, size_t rsC, size_t csC,
+                                                size_t mr, size_t nr, Number alpha, Number beta) noexcept
+        {
+            microKernel(kc, a, b, C, rsC, csC, mr, nr, alpha, beta);
+        }
+#endif
+        template<Numeric Number>
+        MicroKernelFn<Number> selectMicroKernel() noexcept
+        {
+#if LINALG_SIMD_X86
+            if constexpr (Simd::SimdElement<Number>)
+            {
+                switch (Simd::activeIsa())
+                {
+                    case Simd::Isa::AVX512: return &microKernelAvx512<Number>;
+                    case Simd::Isa::AVX2:   return &microKernelAvx2<Number>;
+                    default: break;
+                }
+            }
+#endif
+            return &microKernelScalar<Number>;
+        }
+
+        // y[first..last) of gemv.
+        template<Numeric Number>
+        void gemvRows(size_t first, size_t last, size_t N, Number alpha, const Number* A, size_t rsA, size_t csA,
+                      const Number* x, size_t incx, Number beta, Number* y, size_t incy) noexcept
+        {
+            if (csA == 1)
+            {
+                // Row-major: every y[i] is a contiguous dot product. Four rows at a time so each x
+                // element is loaded once per four multiply-adds.
+                size_t i = first;
+                for (; i + 4 <= last; i += 4)
+                {
+                    const Number* a0 = A + i * rsA;
+                    const Number* a1 = a0 + rsA;
+                    const Number* a2 = a1 + rsA;
+                    const Number* a3 = a2 + rsA;
+                    Number s0{}, s1{}, s2{}, s3{};
+                    for (size_t j = 0; j < N; ++j)
+                    {
+                        const Number xj = x[j * incx];
+                        s0 += a0[j] * xj;
+                        s1 += a1[j] * xj;
+                        s2 += a2[j] * xj;
+                        s3 += a3[j] * xj;
+                    }
+                    const Number sums[4]{s0, s1, s2, s3};
+                    for (size_t r = 0; r < 4; ++r)
+                    {
+                        Number& yi = y[(i + r) * incy];
+                        yi = beta == Number{} ? alpha * sums[r] : alpha * sums[r] + beta * yi;
+                    }
+                }
+                for (; i < last; ++i)
+                {
+                    const Number* a = A + i * rsA;
+                    Number sum{};
+                    for (size_t j = 0; j < N; ++j)
+                        sum += a[j] * x[j * incx];
+                    Number& yi = y[i * incy];
+                    yi = beta == Number{} ? alpha * sum : alpha * sum + beta * yi;
+                }
+                return;
+            }
+            // Column-major (or any other layout): y = beta * y, then one axpy per column.
+            for (size_t i = first; i < last; ++i)
+                y[i * incy] = beta == Number{} ? Number{} : beta * y[i * incy];
+            for (size_t j = 0; j < N; ++j)
+            {
+                const Number xj = alpha * x[j * incx];
+                const Number* a = A + j * csA;
+                if (rsA == 1 && incy == 1)
+                    for (size_t i = first; i < last; ++i)
+                        y[i] += a[i] * xj;
+                else
+                    for (size_t i = first; i < last; ++i)
+                        y[i * incy] += a[i * rsA] * xj;
+            }
+        }
+
+        // gemvRows for 16-bit storage: x is widened once per thread, then four rows of A at a time,
+        // one L1 block of columns after the other, and Simd::dot4 multiplies the blocks. A (the
+        // bulk of the traffic) is read at 2 bytes per element, every sum is a float.
+        template<ReducedFloat Number>
+        void gemvRowsWidened(size_t first, size_t last, size_t N, Number alpha, const Number* A, size_t rsA, size_t csA,
+                             const Number* x, size_t incx, Number beta, Number* y, size_t incy) noexcept
+        {
+            using F = ComputeType<Number>;
+            thread_local PackBuffer<F> wideX, wideA;
+            wideX.resize(N);
+            if (incx == 1)
+                Simd::widen(wideX.data(), x, N);
+            else
+                for (size_t j = 0; j < N; ++j)
+                    wideX[j] = static_cast<F>(x[j * incx]);
+            const auto store = [&](size_t i, F sum)
+            {
+                Number& yi = y[i * incy];
+                yi = static_cast<Number>(beta == Number{} ? static_cast<F>(alpha) * sum
+                                                          : static_cast<F>(alpha) * sum + static_cast<F>(beta) * static_cast<F>(yi));
+            };
+            if (csA != 1)
+            {
+                for (size_t i = first; i < last; ++i)
+                {
+                    F sum{};
+                    for (size_t j = 0; j < N; ++j)
+                        sum += static_cast<F>(A[i * rsA + j * csA]) * wideX[j];
+                    store(i, sum);
+                }
+                return;
+            }
+            constexpr size_t BLOCK = Simd::detail::WIDEN_BLOCK;
+            wideA.resize(4 * BLOCK);
+            const F* blocks[4]{wideA.data(), wideA.data() + BLOCK, wideA.data() + 2 * BLOCK, wideA.data() + 3 * BLOCK};
+            for (size_t i = first; i < last; i += 4)
+            {
+                // Fewer than four rows left: the missing ones repeat the last row and are dropped.
+                const size_t rows = std::min<size_t>(4, last - i);
+                F sums[4]{}, partial[4];
+                for (size_t j = 0; j < N; j += BLOCK)
+                {
+                    const size_t count = std::min(BLOCK, N - j);
+                    for (size_t r = 0; r < 4; ++r)
+                        Simd::widen(wideA.data() + r * BLOCK, A + (i + std::min(r, rows - 1)) * rsA + j, count);
+                    Simd::dot4(blocks, wideX.data() + j, count, partial);
+                    for (size_t r = 0; r < 4; ++r)
+                        sums[r] += partial[r];
+                }
+                for (size_t r = 0; r < rows; ++r)
+                    store(i + r, sums[r]);
+            }
+        }
+
+        template<Numeric Number>
+        void scaleC(size_t M, size_t N, Number beta, Number* C, size_t rsC, size_t csC) noexcept
+        {
+            for (size_t i = 0; i < M; ++i)
+                for (size_t j = 0; j < N; ++j)
+                    C[i * rsC + j * csC] = beta == Number{} ? Number{} : beta * C[i * rsC + j * csC];
+        }
+    }
+
+    // Reference triple loop. Slow on purpose: it is the ground truth gemm is checked against.
+    template<Numeric Number>
+    void gemmReference(size_t M, size_t N, size_t K, Number alpha,
+                       const Number* A, size_t rsA, size_t csA,
+                       const Number* B, size_t rsB, size_t csB,
+                       Number beta, Number* C, size_t rsC, size_t csC) noexcept
+    {
+        for (size_t i = 0; i < M; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                ComputeType<Number> sum{};
+                for (size_t k = 0; k < K; ++k)
+                    sum += A[i * rsA + k * csA] * B[k * rsB + j * csB];
+                Number& c = C[i * rsC + j * csC];
+                c = static_cast<Number>(beta == Number{} ? alpha * sum : alpha * sum + beta * c);
+            }
+        }
+    }
+
+    // Work is split over (ic block, group of jr tiles) pairs: every worker packs the A block it
+    // needs into its own thread-local buffer and shares the packed B panel of the caller.
+    // Products smaller than policy.minElements (measured in M*N*K / 64 multiply-adds) stay on the
+    // calling thread.
+    //   C = epilogue(alpha * transformA(A) * transformB(B) + beta * C)
+    template<Numeric Number, typename TransformA, typename TransformB, typename Epilogue>
+    void gemmFused(size_t M, size_t N, size_t K, Number alpha,
+                   const Number* A, size_t rsA, size_t csA,
+                   const Number* B, size_t rsB, size_t csB,
+                   Number beta, Number* C, size_t rsC, size_t csC,
+                   const TransformA& transformA, const TransformB& transformB, const Epilogue& epilogue,
+                   const Parallel& policy = Parallel::current())
+    {
+        using Blocking = detail::GemmBlocking<Number>;
+        constexpr size_t MR = Blocking::MR, NR = Blocking::NR;
+        constexpr size_t MC = Blocking::MC, NC = Blocking::NC, KC = Blocking::KC;
+        constexpr bool hasEpilogue = !std::same_as<Epilogue, NoEpilogue>;
+        if (M == 0 || N == 0)
+            return;
+        LINALG_PROFILE_KERNEL("gemm", (M * K + K * N + M * N) * sizeof(Number), 2 * M * N * K);
+        if (K == 0 || alpha == Number{})
+        {
+            detail::scaleC(M, N, beta, C, rsC, csC);
+            if constexpr (hasEpilogue)
+                epilogue(C, rsC, csC, size_t{0}, size_t{0}, M, N);
+            return;
+        }
+        // Packing buffers are reused across calls on the same thread -> no allocation in steady state.
+        // The B panel is leased for this call: the workers read it while this thread, waiting,
+        // may run another gemm (ThreadPool.h, ScratchLease).
+        const ScratchLease<Number> packedB(KC * NC);
+        const auto kernel = detail::selectMicroKernel<Number>();
+        const size_t work = M * N * (K / 64 + 1);
+        const size_t threads = std::min(policy.threads == 0 ? ThreadPool::global().concurrency() : policy.threads,
+                                        ThreadPool::global().concurrency());
+
+        for (size_t jc = 0; jc < N; jc += NC)
+        {
+            const size_t nc = std::min(NC, N - jc);
+            const size_t icBlocks = (M + MC - 1) / MC;
+            const size_t jrTiles = (nc + NR - 1) / NR;
+            // Not enough row blocks to feed every thread -> also cut the columns.
+            const size_t jSplits = std::min(jrTiles, std::max<size_t>(1, (threads + icBlocks - 1) / icBlocks));
+            const size_t tilesPerSplit = (jrTiles + jSplits - 1) / jSplits;
+            for (size_t pc = 0; pc < K; pc += KC)
+            {
+                const size_t kc = std::min(KC, K - pc);
+                // Only the first slice of K applies the caller's beta, the rest accumulate.
+                const Number betaBlock = pc == 0 ? beta : Number{1};
+                // The epilogue sees every tile exactly once, after its last slice of K.
+                const bool lastSlice = pc + kc == K;
+                detail::packB(kc, nc, B + pc * rsB + jc * csB, rsB, csB, packedB.data(), transformB, pc, jc);
+                const Number* panelB = packedB.data();
+                parallelFor(icBlocks * jSplits, policy, [&](size_t first, size_t last)
+                {
+                    LINALG_PROFILE_SCOPE("gemm.blocks");
+                    // Only used within this chunk, which never waits -> a plain thread_local is enough.
+                    thread_local detail::PackBuffer<Number> packedA;
+                    packedA.resize(std::max(packedA.size(), MC * KC));
+                    size_t packedIc = SIZE_MAX;
+                    for (size_t item = first; item < last; ++item)
+                    {
+                        const size_t ic = (item / jSplits) * MC;
+                        const size_t mc = std::min(MC, M - ic);
+                        const size_t jrBegin = (item % jSplits) * tilesPerSplit * NR;
+                        const size_t jrEnd = std::min(nc, jrBegin + tilesPerSplit * NR);
+                        if (packedIc != ic)
+                        {
+                            detail::packA(mc, kc, A + ic * rsA + pc * csA, rsA, csA, packedA.data(), transformA, ic, pc);
+                            packedIc = ic;
+                        }
+                        for (size_t jr = jrBegin; jr < jrEnd; jr += NR)
+                        {
+                            const size_t nr = std::min(NR, nc - jr);
+                            for (size_t ir = 0; ir < mc; ir += MR)
+                            {
+                                const size_t mr = std::min(MR, mc - ir);
+                                Number* tile = C + (ic + ir) * rsC + (jc + jr) * csC;
+                                kernel(kc, packedA.data() + ir * kc, panelB + jr * kc, tile, rsC, csC,
+                                       mr, nr, alpha, betaBlock);
+                                if constexpr (hasEpilogue)
+                                    if (lastSlice)
+                                        epilogue(tile, rsC, csC, ic + ir, jc + jr, mr, nr);
+                            }
+                        }
+                    }
+                }, work);
+            }
+        }
+    }
+
+    // 16-bit operands are widened to float once (O(n^2) next to the O(n^3) product), multiplied
+    // by the float kernels, and C is narrowed at the end; transforms and the epilogue see floats.
+    // The float copies are leased like the B panel, so repeated calls do not allocate.
+    template<ReducedFloat Number, typename TransformA, typename TransformB, typename Epilogue>
+    void gemmFused(size_t M, size_t N, size_t K, Number alpha,
+                   const Number* A, size_t rsA, size_t csA,
+                   const Number* B, size_t rsB, size_t csB,
+                   Number beta, Number* C, size_t rsC, size_t csC,
+                   const TransformA& transformA, const TransformB& transformB, const Epilogue& epilogue,
+                   const Parallel& policy = Parallel::current())
+    {
+        using F = ComputeType<Number>;
+        const auto widen = [](F* wide, const Number* src, size_t rows, size_t cols, size_t rs, size_t cs)
+        {
+            for (size_t i = 0; i < rows; ++i)
+            {
+                if (cs == 1)
+                    Simd::widen(wide + i * cols, src + i * rs, cols);
+                else
+                    for (size_t j = 0; j < cols; ++j)
+                        wide[i * cols + j] = static_cast<F>(src[i * rs + j * cs]);
+            }
+        };
+        const ScratchLease<F> wideA(M * K), wideB(K * N), wideC(M * N);
+        widen(wideA.data(), A, M, K, rsA, csA);
+        widen(wideB.data(), B, K, N, rsB, csB);
+        // beta == 0 never reads C, so its float copy only needs the values when beta is used.
+        if (beta != Number{})
+            widen(wideC.data(), C, M, N, rsC, csC);
+        gemmFused(M, N, K, static_cast<F>(alpha), wideA.data(), K, size_t{1}, wideB.data(), N, size_t{1},
+                  static_cast<F>(beta), wideC.data(), N, size_t{1}, transformA, transformB, epilogue, policy);
+        for (size_t i = 0; i < M; ++i)
+        {
+            if (csC == 1)
+                Simd::narrow(C + i * rsC, wideC.data() + i * N, N);
+            else
+                for (size_t j = 0; j < N; ++j)
+                    C[i * rsC + j * csC] = static_cast<Number>(wideC[i * N + j]);
+        }
+    }
+
+    template<Numeric Number>
+    void gemm(size_t M, size_t N, size_t K, Number alpha,
+              const Number* A, size_t rsA, size_t csA,
+              const Number* B, size_t rsB, size_t csB,
+              Number beta, Number* C, size_t rsC, size_t csC,
+              const Parallel& policy = Parallel::current())
+    {
+        gemmFused(M, N, K, alpha, A, rsA, csA, B, rsB, csB, beta, C, rsC, csC,
+                  PackCopy{}, PackCopy{}, NoEpilogue{}, policy);
+    }
+
+    template<Numeric Number>
+    void gemvReference(size_t M, size_t N, Number alpha, const Number* A, size_t rsA, size_t csA,
+                       const Number* x, size_t incx, Number beta, Number* y, size_t incy) noexcept
+    {
+        gemmReference(M, 1, N, alpha, A, rsA, csA, x, incx, 1, beta, y, incy, 1);
+    }
+
+    // Rows are independent, so large products are split into row ranges across the pool.
+    template<Numeric Number>
+    void gemv(size_t M, size_t N, Number alpha, const Number* A, size_t rsA, size_t csA,
+              const Number* x, size_t incx, Number beta, Number* y, size_t incy,
+              const Parallel& policy = Parallel::current()) noexcept
+    {
+        if (M == 0)
+            return;
+        LINALG_PROFILE_KERNEL("gemv", (M * N + N + M) * sizeof(Number), 2 * M * N);
+        parallelFor(M, policy, [&](size_t first, size_t last)
+        {
+            LINALG_PROFILE_SCOPE("gemv.rows");
+            if constexpr (ReducedFloat<Number>)
+                detail::gemvRowsWidened(first, last, N, alpha, A, rsA, csA, x, incx, beta, y, incy);
+            else
+                detail::gemvRows(first, last, N, alpha, A, rsA, csA, x, incx, beta, y, incy);
+        }, M * N);
+    }
+
+    // The same products on views (Views.h): the pointer and strides come from the view, so blocks,
+    // columns and transposes (a.view().transpose()) go in without copying. Number follows C / y.
+    template<Numeric Number>
+    void gemm(Number alpha, std::type_identity_t<MatrixView<const Number>> A, std::type_identity_t<MatrixView<const Number>> B,
+              Number beta, MatrixView<Number> C, const Parallel& policy = Parallel::current())
+    {
+        assert(A.cols() == B.rows() && C.rows() == A.rows() && C.cols() == B.cols());
+        gemm(C.rows(), C.cols(), A.cols(), alpha, A.data(), A.rowStride(), A.colStride(),
+             B.data(), B.rowStride(), B.colStride(), beta, C.data(), C.rowStride(), C.colStride(), policy);
+    }
+    template<Numeric Number>
+    void gemv(Number alpha, std::type_identity_t<MatrixView<const Number>> A, std::type_identity_t<VectorView<const Number>> x,
+              Number beta, VectorView<Number> y, const Parallel& policy = Parallel::current()) noexcept
+    {
+        assert(A.cols() == x.size() && A.rows() == y.size());
+        gemv(A.rows(), A.cols(), alpha, A.data(), A.rowStride(), A.colStride(),
+             x.data(), x.stride(), beta, y.data(), y.stride(), policy);
+    }
+
+    // Convenience wrappers over the library containers (the result uses a's allocator).
+    template<Numeric Number, typename AllocA, typename AllocB>
+    auto matmul(const MatrixX<Number, AllocA>& a, const MatrixX<Number, AllocB>& b) -> MatrixX<Number, AllocA>
+    {
+        assert(a.cols() == b.rows());
+        MatrixX<Number, AllocA> result(a.rows(), b.cols(), a.get_allocator());
+        gemm(a.rows(), b.cols(), a.cols(), Number{1},
+             a.data(), a.cols(), size_t{1},
+             b.data(), b.cols(), size_t{1},
+             Number{}, result.data(), result.cols(), size_t{1});
+        return result;
+    }
+    template<Numeric Number, typename AllocA, typename AllocX>
+    auto matvec(const MatrixX<Number, AllocA>& a, const VectorX<Number, AllocX>& x) -> VectorX<Number, AllocX>
+    {
+        assert(a.cols() == x.size());
+        VectorX<Number, AllocX> result(a.rows(), x.get_allocator());
+        gemv(a.rows(), a.cols(), Number{1}, a.data(), a.cols(), size_t{1},
+             x.data(), size_t{1}, Number{}, result.data(), size_t{1});
+        return result;
+    }
+    // Products of views into a new MatrixX / VectorX.
+    template<typename NumberA, typename NumberB> requires std::same_as<std::remove_const_t<NumberA>, std::remove_const_t<NumberB>>
+    auto matmul(MatrixView<NumberA> a, MatrixView<NumberB> b) -> MatrixX<std::remove_const_t<NumberA>>
+    {
+        using Number = std::remove_const_t<NumberA>;
+        MatrixX<Number> result(a.rows(), b.cols());
+        gemm(Number{1}, a, b, Number{}, result.view());
+        return result;
+    }
+    template<typename NumberA, typename NumberX> requires std::same_as<std::remove_const_t<NumberA>, std::remove_const_t<NumberX>>
+    auto matvec(MatrixView<NumberA> a, VectorView<NumberX> x) -> VectorX<std::remove_const_t<NumberA>>
+    {
+        using Number = std::remove_const_t<NumberA>;
+        VectorX<Number> result(a.rows());
+        gemv(Number{1}, a, x, Number{}, result.view());
+        return result;
+    }
+    // Fixed sizes (2..5) are far below one register tile: packing would cost more than the
+    // product itself. Every element is written as one expression instead, expanded over
+    // compile-time indices, so there is no loop left and the operands stay in registers.
+    namespace detail
+    {
+        // a(row, 0) * b(0, col) + a(row, 1) * b(1, col) + ...
+        template<size_t row, size_t col, uint8_t size, Numeric Number, size_t... k>
+        constexpr Number productElement(const Matrix<size, Number>& a, const Matrix<size, Number>& b,
+                                        std::index_sequence<k...>) noexcept
+        {
+            return static_cast<Number>(((a(row, k) * b(k, col)) + ...));
+        }
+        template<size_t row, uint8_t size, Numeric Number, size_t... k>
+        constexpr Number rowDot(const Matrix<size, Number>& a, const Vector<size_t{size}, Number>& x, std::index_sequence<k...>) noexcept
+        {
+            return static_cast<Number>(((a(row, k) * x.data[k]) + ...));
+        }
+    }
+    template<uint8_t size, Numeric Number>
+    constexpr auto matmul(const Matrix<size, Number>& a, const Matrix<size, Number>& b) noexcept -> Matrix<size, Number>
+    {
+        Matrix<size, Number> result;
+        [&]<size_t... e>(std::index_sequence<e...>)
+        {
+            ((result(e / size, e % size) = detail::productElement<e / size, e % size>(a, b, std::make_index_sequence<size>{})), ...);
+        }(std::make_index_sequence<size * size>{});
+        return result;
+    }
+    // The size is deduced from the matrix only (Matrix counts in uint8_t, Vector in size_t).
+    template<uint8_t size, Numeric Number>
+    constexpr auto matvec(const Matrix<size, Number>& a, const Vector<size_t{size}, Number>& x) noexcept -> Vector<size, Number>
+    {
+        Vector<size, Number> result;
+        [&]<size_t... i>(std::index_sequence<i...>)
+        {
+            ((result.data[i] = detail::rowDot<i>(a, x, std::make_index_sequence<size>{})), ...);
+        }(std::make_index_sequence<size>{});
+        return result;
+    }
+}
@@ -1,189 +1,257 @@
 #pragma once
 #include "TemplateConstraint.h"
+#include "Expression.h"
+#include "SimdKernels.h"
+#include "Reductions.h"
+#include "Views.h"
 #include <print>
 #include <array>
+#include <span>
 #include <ranges>
 #include <algorithm>
+#include <bit>
+#include <utility>
+#include <cassert>
+#include <concepts>
 namespace LinAlg
 {
     template<uint8_t size, Numeric Number>
     class Matrix
     {
     public:
+        using value_type = Number;
         Matrix() noexcept = default;
         Matrix(const Matrix& other) noexcept = default;
         Matrix(Matrix&& other) noexcept = default;
         Matrix& operator=(const Matrix& other) noexcept = default;
         Matrix& operator=(Matrix&& other) noexcept = default;
         ~Matrix() = default;
-        explicit Matrix(std::initializer_list<std::initializer_list<Number>> init)
+        constexpr explicit Matrix(std::initializer_list<std::initializer_list<Number>> init)
         {
             auto input_view = init | std::views::join | std::views::take(size * size);
             std::ranges::copy(input_view, this->flat().begin());
         }
-        explicit Matrix(Number scalar) noexcept
+        constexpr explicit Matrix(Number scalar) noexcept
         {
             std::ranges::fill(this->flat(), scalar);
         }
+        // Evaluates a lazy expression (e.g. 'Mat3f r = a + b * 2.0f;') in a single pass.
+        template<Expression E> requires std::same_as<typename E::result_type, Matrix>
+        constexpr Matrix(const E& expr) noexcept
+        {
+            evaluateExpr(m_matrixArr.data(), expr, ExprAssign{});
+        }
+        template<Expression E> requires std::same_as<typename E::result_type, Matrix>
+        constexpr Matrix& operator=(const E& expr) noexcept
+        {
+            evaluateExpr(m_matrixArr.data(), expr, ExprAssign{});
+            return *this;
+        }
         friend void printMatrix(const Matrix& mat) noexcept
         {
             std::println("Matrix {}x{}: ", size, size);
-            for (const auto& row : mat.m_matrixArr)
+            for (size_t r = 0; r < size; ++r)
             {
-                std::println("{}", row); // much better
+                std::println("{}", std::span{mat.m_matrixArr}.subspan(r * size, size)); // much better
             }
             std::println();
         }
     public:
-        friend constexpr auto operator+(const Matrix& other, const Matrix& other2) noexcept -> Matrix
+        // Element (row, col), writable when the matrix is.
+        constexpr auto& operator()(this auto&& self, size_t row, size_t col) noexcept
+        {
+            return self.m_matrixArr[row * size + col];
+        }
+        // Leaf used by the lazy operators in Expression.h: a + b, a - b, a + scalar, a * scalar...
+        constexpr auto expr() const noexcept -> ExprLeaf<Matrix, Number>
+        {
+            return {{}, m_matrixArr.data(), size * size, size, size};
+        }
+        // Strided views (Views.h) over the storage, writable when the matrix is: rows, columns,
+        // blocks and view().transpose() without copying.
+        [[nodiscard]] constexpr auto view(this auto&& self) noexcept
+        {
+            return MatrixView{self.m_matrixArr.data(), size, size, size};
+        }
+        [[nodiscard]] constexpr auto row(this auto&& self, size_t r) noexcept { return self.view().row(r); }
+        [[nodiscard]] constexpr auto col(this auto&& self, size_t c) noexcept { return self.view().col(c); }
+        [[nodiscard]] constexpr auto block(this auto&& self, size_t row, size_t col, size_t rows, size_t cols) noexcept
         {
-            Matrix result;
-            std::ranges::transform(
-                other.flat(),           // Input Range 1: The flattened Left-Hand Side matrix.
-                other2.flat(),          // Input Range 2: The flattened Right-Hand Side matrix.
-                result.flat().begin(), // Output Iterator: Where to start writing the results.
-                std::plus{}          // The Operation: A standard functor that performs addition (x + y).
-            );
-            return result;
+            return self.view().block(row, col, rows, cols);
         }
+    public:
         constexpr auto operator+=(this auto& self,const Matrix& other) noexcept -> Matrix&
         {
-            std::ranges::transform(
-                self.flat(),           // Input Range 1: The flattened Left-Hand Side matrix.
-                other.flat(),          // Input Range 2: The flattened Right-Hand Side matrix.
-                self.flat().begin(), // Output Iterator: Where to start writing the results.
-                std::plus{}          // The Operation: A standard functor that performs addition (x + y).
-            );
+            // One SIMD pass over the flat storage (widest instruction set the CPU has).
+            Simd::add(self.m_matrixArr.data(), self.m_matrixArr.data(), other.m_matrixArr.data(), size * size);
             return self;
         }
-        constexpr auto operator+(this auto& self, Number scalar) noexcept -> Matrix
+        constexpr auto operator+=(this auto& self, const Expression auto& expr) noexcept -> Matrix&
         {
-            Matrix result;
-            std::ranges::transform(
-                self.flat(),
-                result.flat().begin(),
-                [scalar](Number n)
-                {
-                    // We return the sum, which 'transform' writes into the Output location.
-                    return n + scalar;
-                }
-            );
-            return result;
+            evaluateExpr(self.m_matrixArr.data(), expr, std::plus{});
+            return self;
         }
         constexpr auto operator+=(this auto& self, Number scalar) noexcept -> Matrix&
         {
-            std::ranges::transform(
-                self.flat(),
-                self.flat().begin(),
-                [scalar](Number n)
-                {
-                    return n + scalar;
-                }
-            );
+            Simd::addScalar(self.m_matrixArr.data(), self.m_matrixArr.data(), scalar, size * size);
             return self;
         }
     public:
-        friend constexpr auto operator-(const Matrix& other, const Matrix& other2) noexcept -> Matrix
-        {
-            Matrix result;
-            std::ranges::transform(
-                other.flat(),           // Input Range 1: The flattened Left-Hand Side matrix.
-                other2.flat(),          // Input Range 2: The flattened Right-Hand Side matrix.
-                result.flat().begin(), // Output Iterator: Where to start writing the results.
-                std::minus{}          // The Operation: A standard functor that performs addition (x + y).
-            );
-            return result;
-        }
         constexpr auto operator-=(this auto& self,const Matrix& other) noexcept -> Matrix&
         {
-            std::ranges::transform(
-                self.flat(),           // Input Range 1: The flattened Left-Hand Side matrix.
-                other.flat(),          // Input Range 2: The flattened Right-Hand Side matrix.
-                self.flat().begin(), // Output Iterator: Where to start writing the results.
-                std::minus{}          // The Operation: A standard functor that performs addition (x + y).
-            );
+            // One SIMD pass over the flat storage (widest instruction set the CPU has).
+            Simd::sub(self.m_matrixArr.data(), self.m_matrixArr.data(), other.m_matrixArr.data(), size * size);
             return self;
         }
-        constexpr auto operator-(this auto& self, Number scalar) noexcept -> Matrix
+        constexpr auto operator-=(this auto& self, const Expression auto& expr) noexcept -> Matrix&
         {
-            // Left-Hand Side = LHS, Right-Hand Size = RHS
-            Matrix result;
-            std::ranges::transform(
-                self.flat(),
-                result.flat().begin(),
-                [scalar](Number n)
-                {
-                    // We return the sum, which 'transform' writes into the Output location.
-                    return n - scalar;
-                }
-            );
-            return result;
+            evaluateExpr(self.m_matrixArr.data(), expr, std::minus{});
+            return self;
         }
         constexpr auto operator-=(this auto& self, Number scalar) noexcept -> Matrix&
         {
-            std::ranges::transform(
-                self.flat(),
-                self.flat().begin(),
-                [scalar](Number n)
-                {
-                    return n - scalar;
-                }
-            );
+            Simd::subScalar(self.m_matrixArr.data(), self.m_matrixArr.data(), scalar, size * size);
             return self;
         }
     public:
-        constexpr auto operator*(this auto& self, Number scalar) noexcept -> Matrix
-        {
-            // Left-Hand Side = LHS, Right-Hand Size = RHS
-            Matrix result;
-            std::ranges::transform(
-                self.flat(),
-                result.flat().begin(),
-                [scalar](Number n)
-                {
-                    // We return the sum, which 'transform' writes into the Output location.
-                    return n * scalar;
-                }
-            );
-            return result;
-        }
         constexpr auto operator*=(this auto& self, Number scalar) noexcept -> Matrix&
         {
-            std::ranges::transform(
-                self.flat(),
-                self.flat().begin(),
-                [scalar](Number n)
-                {
-                    return n * scalar;
-                }
-            );
+            Simd::mulScalar(self.m_matrixArr.data(), self.m_matrixArr.data(), scalar, size * size);
             return self;
         }
+    public:
+        // Reductions over all elements (Reductions.h), on the calling thread: norm() is the
+        // Frobenius norm, dot() the Frobenius inner product, argmin / argmax the row-major
+        // position (row = index / size, col = index % size).
+        [[nodiscard]] constexpr auto sum(Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::sum(m_matrixArr.data(), size * size, mode, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto dot(const Matrix& other, Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::dot(m_matrixArr.data(), other.m_matrixArr.data(), size * size, mode, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto squaredNorm(Reduction mode = {}) const -> ReduceType<Number>
+        {
+            return LinAlg::squaredNorm(m_matrixArr.data(), size * size, mode, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto norm(Reduction mode = {}) const -> NormType<Number>
+        {
+            return LinAlg::norm(m_matrixArr.data(), size * size, mode, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto minValue() const -> Number { return LinAlg::minValue(m_matrixArr.data(), size * size, Parallel{.threads = 1}); }
+        [[nodiscard]] constexpr auto maxValue() const -> Number { return LinAlg::maxValue(m_matrixArr.data(), size * size, Parallel{.threads = 1}); }
+        [[nodiscard]] constexpr auto argmin() const -> size_t { return LinAlg::argmin(m_matrixArr.data(), size * size, Parallel{.threads = 1}); }
+        [[nodiscard]] constexpr auto argmax() const -> size_t { return LinAlg::argmax(m_matrixArr.data(), size * size, Parallel{.threads = 1}); }
     public:
         friend void roundOff(Matrix& mat, uint8_t decimalDigit) noexcept
         {
-            auto TenPower = TenRaise(decimalDigit);
-            std::ranges::transform(
-                mat.m_matrixArr | std::views::join,
-                (mat.m_matrixArr | std::views::join).begin(),
-                [TenPower](Number n)
-                {
-                    return std::round(n * TenPower) / TenPower;
-                }
-            );
+            Simd::roundOff(mat.m_matrixArr.data(), mat.m_matrixArr.data(), decimalDigit, size * size);
         }
     private:
-        constexpr auto flat(this auto&& self) {return self.m_matrixArr | std::views::join;};
-        // "std::views::join" treats the 2D array as a single continuous 1D sequence.
-        // Flattened means
+        constexpr auto& flat(this auto&& self) {return self.m_matrixArr;};
+        // The elements are stored row after row in ONE array (row-major), so the matrix already
+        // is a continuous 1D sequence and every operator is one SIMD loop.
         // Row1: [1,2,3], Row2: [4,5,6]
-        // Sequence: [1,2,3,4,5,6]
-        std::array<std::array<Number, size>, size> m_matrixArr{T_zero_init<Number>()};
+        // Storage: [1,2,3,4,5,6]
+        std::array<Number, size * size> m_matrixArr{T_zero_init<Number>()};
         static constexpr std::pair<uint8_t, uint8_t> MATRIX_SIZES_LIMITS{2,5};
         static_assert(size >= MATRIX_SIZES_LIMITS.first && size <= MATRIX_SIZES_LIMITS.second, "Not Valid Size!");
 
     };
 
+    // Transpose, determinant and inverse of the fixed sizes (2..5).
+    // Every loop is a pack expansion over compile-time indices, so each function is one
+    // straight-line expression over the 4..25 elements: nothing is indexed at run time, the
+    // elements stay in registers, and all of it works in constant expressions.
+    namespace detail
+    {
+        // Positions of the set bits of 'mask', lowest first.
+        template<unsigned mask>
+        inline constexpr auto SET_BITS = []
+        {
+            std::array<size_t, std::popcount(mask)> bits{};
+            for (size_t bit = 0, n = 0; n < bits.size(); ++bit)
+                if (mask >> bit & 1u)
+                    bits[n++] = bit;
+            return bits;
+        }();
+
+        // Determinant of the sub-matrix of the rows in 'rows' and the columns in 'cols' (masks with
+        // the same number of bits), expanded along its first row. The same sub-minor appears in
+        // several expansions with identical operands, so after inlining the compiler computes it
+        // once (2x2 minors of a 4x4 are shared like in the usual hand-written formula).
+        // M is a Matrix or anything else with m(row, col) (the batched kernels of Batch.h pass a
+        // matrix of SIMD registers, one element per lane).
+        template<unsigned rows, unsigned cols, typename M>
+        constexpr auto minorDeterminant(const M& m) noexcept
+        {
+            using Number = std::remove_cvref_t<decltype(m(0, 0))>;
+            constexpr size_t row = SET_BITS<rows>.front();
+            if constexpr (std::popcount(rows) == 1)
+                return m(row, SET_BITS<cols>.front());
+            else
+            {
+                return [&]<size_t... i>(std::index_sequence<i...>)
+                {
+                    // Column i of the sub-matrix -> sign (-1)^i.
+                    const auto term = [&]<size_t n>(std::integral_constant<size_t, n>)
+                    {
+                        constexpr size_t col = SET_BITS<cols>[n];
+                        const Number product = static_cast<Number>(
+                            m(row, col) * minorDeterminant<rows & (rows - 1), cols & ~(1u << col)>(m));
+                        return n % 2 == 0 ? product : static_cast<Number>(-product);
+                    };
+                    return static_cast<Number>((term(std::integral_constant<size_t, i>{}) + ...));
+                }(std::make_index_sequence<std::popcount(cols)>{});
+            }
+        }
+
+        template<size_t row, size_t col, size_t size, typename M>
+        constexpr auto cofactor(const M& m) noexcept
+        {
+            using Number = std::remove_cvref_t<decltype(m(0, 0))>;
+            constexpr unsigned all = (1u << size) - 1;
+            const Number minor = minorDeterminant<all & ~(1u << row), all & ~(1u << col)>(m);
+            return (row + col) % 2 == 0 ? minor : static_cast<Number>(-minor);
+        }
+    }
+
+    template<uint8_t size, Numeric Number>
+    constexpr auto transpose(const Matrix<size, Number>& m) noexcept -> Matrix<size, Number>
+    {
+        Matrix<size, Number> result;
+        [&]<size_t... e>(std::index_sequence<e...>)
+        {
+            ((result(e / size, e % size) = m(e % size, e / size)), ...);
+        }(std::make_index_sequence<size * size>{});
+        return result;
+    }
+
+    // Signed types only: with unsigned elements every subtraction would wrap.
+    template<uint8_t size, Numeric Number> requires std::is_signed_v<Number>
+    constexpr auto determinant(const Matrix<size, Number>& m) noexcept -> Number
+    {
+        constexpr unsigned all = (1u << size) - 1;
+        return detail::minorDeterminant<all, all>(m);
+    }
+
+    // Adjugate over determinant: inverse(i, j) = cofactor(j, i) / det. The cofactors reuse the
+    // determinant's sub-minors. A singular matrix yields inf / nan (asserted in debug builds).
+    template<uint8_t size, std::floating_point Number>
+    constexpr auto inverse(const Matrix<size, Number>& m) noexcept -> Matrix<size, Number>
+    {
+        const Number det = determinant(m);
+        assert(det != Number{} && "inverse of a singular matrix");
+        const Number invDet = Number{1} / det;
+        Matrix<size, Number> result;
+        [&]<size_t... e>(std::index_sequence<e...>)
+        {
+            ((result(e / size, e % size) = detail::cofactor<e % size, e / size, size>(m) * invDet), ...);
+        }(std::make_index_sequence<size * size>{});
+        return result;
+    }
+
     using Mat2u8        =  Matrix<2, uint8_t>;
     using Mat2u16       =  Matrix<2, uint16_t>;
     using Mat2u32       =  Matrix<2, uint32_t>;
@@ -194,6 +262,8 @@ namespace LinAlg
     using Mat2st        =  Matrix<2, size_t>;
     using Mat2f         =  Matrix<2, float>;
     using Mat2d         =  Matrix<2, double>;
+    using Mat2h         =  Matrix<2, Float16>;
+    using Mat2bf        =  Matrix<2, BFloat16>;
 
     using Mat3u8        =  Matrix<3, uint8_t>;
     using Mat3u16       =  Matrix<3, uint16_t>;
@@ -205,6 +275,8 @@ namespace LinAlg
     using Mat3st        =  Matrix<3, size_t>;
     using Mat3f         =  Matrix<3, float>;
     using Mat3d         =  Matrix<3, double>;
+    using Mat3h         =  Matrix<3, Float16>;
+    using Mat3bf        =  Matrix<3, BFloat16>;
 
     using Mat4u8        =  Matrix<4, uint8_t>;
     using Mat4u16       =  Matrix<4, uint16_t>;
@@ -216,6 +288,8 @@ namespace LinAlg
     using Mat4st        =  Matrix<4, size_t>;
     using Mat4f         =  Matrix<4, float>;
     using Mat4d         =  Matrix<4, double>;
+    using Mat4h         =  Matrix<4, Float16>;
+    using Mat4bf        =  Matrix<4, BFloat16>;
 
     using Mat5u8        =  Matrix<5, uint8_t>;
     using Mat5u16       =  Matrix<5, uint16_t>;
@@ -227,4 +301,6 @@ namespace LinAlg
     using Mat5st        =  Matrix<5, size_t>;
     using Mat5f         =  Matrix<5, float>;
     using Mat5d         =  Matrix<5, double>;
+    using Mat5h         =  Matrix<5, Float16>;
+    using Mat5bf        =  Matrix<5, BFloat16>;
 }
@@ -0,0 +1,336 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "SimdKernels.h"
+#include "Profiling.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <cmath>
+#include <numbers>
+#include <concepts>
+#include <algorithm>
+#include <cassert>
+namespace ML
+{
+    // Optimizers: how a step turns the gradients g into new parameters w.
+    //   Sgd   : v = momentum * v + g;  w -= lr * v          (Nesterov: w -= lr * (g + momentum * v))
+    //           momentum 0 is plain gradient descent, w -= lr * g, and keeps no state.
+    //   Adam  : m = beta1 * m + (1 - beta1) * g;  v = beta2 * v + (1 - beta2) * g^2
+    //           w -= lr / (1 - beta1^t) * m / (sqrt(v) / sqrt(1 - beta2^t) + epsilon)
+    //   AdamW : Adam with the weight decay applied to w directly (w *= 1 - lr * weightDecay)
+    //           instead of being added to g, where Adam would rescale it by 1 / sqrt(v).
+    // A model hands its parameters over as Parameter slots, each one flat contiguous buffer of
+    // values and one of gradients (a layer's weight matrix, its bias, ...). The optimizer keeps each
+    // moment in one flat buffer covering all slots in order, and updates a slot in a single fused
+    // SIMD pass that reads w, g and the moments once and writes w and the moments once. Adam put
+    // together from the element-wise kernels takes about five passes over the weights (scale g,
+    // two moment updates, the denominator, the axpy); the step is memory-bound, so that is close to
+    // five times the time.
+    // The learning rate comes from a LearningRateSchedule evaluated at the optimizer's step count.
+    enum class LearningRateDecay : uint8_t
+    {
+        Constant,
+        Step,           // initial * gamma^floor(t)
+        Exponential,    // initial * gamma^t, the smooth version of Step
+        Cosine          // minimum + (initial - minimum) * (1 + cos(pi * t)) / 2 up to t = 1, then minimum
+    };
+
+    // Learning rate of step s (updates done so far): with t = (s - warmup) / period, decayed as above.
+    // During the first 'warmup' steps it ramps up linearly to initial instead.
+    struct LearningRateSchedule
+    {
+        double initial = 0.01;
+        LearningRateDecay decay = LearningRateDecay::Constant;
+        double gamma = 0.1;
+        size_t period = 1000;
+        double minimum = 0.0;
+        size_t warmup = 0;
+
+        [[nodiscard]] double operator()(size_t step) const noexcept
+        {
+            if (step < warmup)
+                return initial * static_cast<double>(step + 1) / static_cast<double>(warmup);
+            const double t = static_cast<double>(step - warmup) / static_cast<double>(std::max<size_t>(period, 1));
+            switch (decay)
+            {
+                case LearningRateDecay::Constant:    return initial;
+                case LearningRateDecay::Step:        return initial * std::pow(gamma, std::floor(t));
+                case LearningRateDecay::Exponential: return initial * std::pow(gamma, t);
+                case LearningRateDecay::Cosine:
+                    return t >= 1.0 ? minimum : minimum + (initial - minimum) * 0.5 * (1.0 + std::cos(std::numbers::pi * t));
+            }
+            return initial;
+        }
+    };
+
+    // One flat buffer of parameters and its gradients (same length).
+    template<LinAlg::Numeric Number>
+    struct Parameter
+    {
+        Number* values = nullptr;
+        const Number* gradients = nullptr;
+        size_t size = 0;
+    };
+
+    // What the trainers accept: step(slots, gradientScale) updates every slot with its gradients
+    // times gradientScale (1 / batch rows when the gradients are sums over the batch).
+    template<typename O, typename Number>
+    concept Optimizer = requires(O& optimizer, std::span<const Parameter<Number>> parameters)
+    {
+        optimizer.step(parameters, 1.0);
+    };
+
+    struct SgdConfig
+    {
+        LearningRateSchedule learningRate{};
+        double momentum = 0.9;
+        bool nesterov = false;
+        // L2 penalty: weightDecay * w is added to the gradient.
+        double weightDecay = 0.0;
+    };
+
+    struct AdamConfig
+    {
+        LearningRateSchedule learningRate{.initial = 0.001};
+        double beta1 = 0.9;
+        double beta2 = 0.999;
+        double epsilon = 1e-8;
+        // Adam adds weightDecay * w to the gradient, AdamW shrinks w by lr * weightDecay.
+        double weightDecay = 0.0;
+    };
+
+    namespace detail
+    {
+        // The fused updates, written like the Simd ops: the same body runs on one element (tail)
+        // and on a whole register. w and the moments are updated in place; g is scaled first.
+        template<typename T>
+        struct MomentumOp
+        {
+            static constexpr const char* NAME = "ML::Sgd";
+            static constexpr size_t FLOPS = 7;
+            static constexpr size_t MOMENTS = 1;
+            T scale;
+            T weightDecay;
+            T momentum;
+            T learningRate;
+            bool nesterov;
+            template<typename V>
+            [[gnu::always_inline]] void operator()(V& w, V g, V& velocity, V&) const noexcept
+            {
+                g = g * scale + w * weightDecay;
+                velocity = velocity * momentum + g;
+                w -= (nesterov ? g + velocity * momentum : velocity) * learningRate;
+            }
+        };
+        template<typename T>
+        struct AdamOp
+        {
+            static constexpr const char* NAME = "ML::Adam";
+            static constexpr size_t FLOPS = 14;
+            static constexpr size_t MOMENTS = 2;
+            T scale;
+            T weightDecay;      // coupled (Adam)
+            T shrink;           // decoupled (AdamW): 1 - lr * weightDecay
+            T beta1;
+            T beta2;
+            T stepSize;         // lr / (1 - beta1^t)
+            T correction;       // 1 / sqrt(1 - beta2^t)
+            T epsilon;
+            template<typename V>
+            [[gnu::always_inline]] void operator()(V& w, V g, V& m, V& v) const noexcept
+            {
+                g = g * scale + w * weightDecay;
+                m = m * beta1 + g * (T{1} - beta1);
+                v = v * beta2 + g * g * (T{1} - beta2);
+                w = w * shrink - m * stepSize / (LinAlg::Simd::detail::sqrtLanes(v) * correction + epsilon);
+            }
+        };
+
+        // Elements [first, n), computed in ComputeType (float for the 16-bit types).
+        template<typename Op, typename T>
+        void updateScalar(T* w, const T* g, T* m, T* v, size_t first, size_t n, const Op& op) noexcept
+        {
+            using F = LinAlg::ComputeType<T>;
+            for (size_t i = first; i < n; ++i)
+            {
+                F wi = static_cast<F>(w[i]), mi{}, vi{};
+                if constexpr (Op::MOMENTS > 0)
+                    mi = static_cast<F>(m[i]);
+                if constexpr (Op::MOMENTS > 1)
+                    vi = static_cast<F>(v[i]);
+                op(wi, static_cast<F>(g[i]), mi, vi);
+                w[i] = static_cast<T>(wi);
+                if constexpr (Op::MOMENTS > 0)
+                    m[i] = static_cast<T>(mi);
+                if constexpr (Op::MOMENTS > 1)
+                    v[i] = static_cast<T>(vi);
+            }
+        }
+
+#if LINALG_SIMD_X86
+        template<size_t Bytes, typename Op, typename T>
+        [[gnu::always_inline]] inline void updateLoop(T* w, const T* g, T* m, T* v, size_t n, const Op& op) noexcept
+        {
+            using V = typename LinAlg::Simd::detail::VecOf<T, Bytes>::type;
+            using U = typename LinAlg::Simd::detail::VecOf<T, Bytes>::unaligned;
+            constexpr size_t lanes = Bytes / sizeof(T);
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes)
+            {
+                V wi = *reinterpret_cast<const U*>(w + i), mi{}, vi{};
+                if constexpr (Op::MOMENTS > 0)
+                    mi = *reinterpret_cast<const U*>(m + i);
+                if constexpr (Op::MOMENTS > 1)
+                    vi = *reinterpret_cast<const U*>(v + i);
+                op(wi, V(*reinterpret_cast<const U*>(g + i)), mi, vi);
+                *reinterpret_cast<U*>(w + i) = wi;
+                if constexpr (Op::MOMENTS > 0)
+                    *reinterpret_cast<U*>(m + i) = mi;
+                if constexpr (Op::MOMENTS > 1)
+                    *reinterpret_cast<U*>(v + i) = vi;
+            }
+            updateScalar(w, g, m, v, i, n, op);
+        }
+
+        template<typename Op, typename T>
+        LINALG_TARGET_AVX512 void updateAvx512(T* w, const T* g, T* m, T* v, size_t n, Op op) noexcept
+        {
+            updateLoop<64>(w, g, m, v, n, op);
+        }
+        template<typename Op, typename T>
+        LINALG_TARGET_AVX2 void updateAvx2(T* w, const T* g, T* m, T* v, size_t n, Op op) noexcept
+        {
+            updateLoop<32>(w, g, m, v, n, op);
+        }
+        template<typename Op, typename T>
+        LINALG_TARGET_SSE41 void updateSse41(T* w, const T* g, T* m, T* v, size_t n, Op op) noexcept
+        {
+            updateLoop<16>(w, g, m, v, n, op);
+        }
+#endif
+
+        // One slot: n parameters w with gradients g and the op's moments m (and v).
+        template<typename Op, typename T>
+        void update(T* w, const T* g, T* m, T* v, size_t n, const Op& op) noexcept
+        {
+            LINALG_PROFILE_KERNEL(Op::NAME, (3 + 2 * Op::MOMENTS) * n * sizeof(T), Op::FLOPS * n);
+#if LINALG_SIMD_X86
+            if constexpr (LinAlg::Simd::SimdElement<T>)
+            {
+                switch (LinAlg::Simd::activeIsa())
+                {
+                    case LinAlg::Simd::Isa::AVX512: updateAvx512(w, g, m, v, n, op); return;
+                    case LinAlg::Simd::Isa::AVX2:   updateAvx2(w, g, m, v, n, op);   return;
+                    case LinAlg::Simd::Isa::SSE41:  updateSse41(w, g, m, v, n, op);  return;
+                    case LinAlg::Simd::Isa::Scalar: break;
+                }
+            }
+#endif
+            updateScalar(w, g, m, v, size_t{0}, n, op);
+        }
+
+        // A moment buffer covering all slots: zeros on the first step, the same size on every later one.
+        template<typename Number>
+        Number* momentsFor(LinAlg::VectorX<Number>& moments, std::span<const Parameter<Number>> parameters)
+        {
+            size_t total = 0;
+            for (const auto& parameter : parameters)
+                total += parameter.size;
+            if (moments.size() == 0)
+                moments.resize(total);
+            assert(moments.size() == total && "an optimizer must see the same parameters on every step");
+            return moments.data();
+        }
+    }
+
+    // ML::Sgd<float> sgd({.learningRate = {.initial = 0.05}, .momentum = 0.9});
+    // sgd.step(net.parameters());
+    template<LinAlg::Numeric Number>
+    class Sgd
+    {
+    public:
+        explicit Sgd(const SgdConfig& config = {}) : m_config(config) {}
+
+        [[nodiscard]] const SgdConfig& config() const noexcept { return m_config; }
+        [[nodiscard]] size_t steps() const noexcept { return m_steps; }
+        // The learning rate the next step uses.
+        [[nodiscard]] double learningRate() const noexcept { return m_config.learningRate(m_steps); }
+        [[nodiscard]] const LinAlg::VectorX<Number>& velocity() const noexcept { return m_velocity; }
+
+        void step(std::span<const Parameter<Number>> parameters, double gradientScale = 1.0)
+        {
+            const double rate = learningRate();
+            ++m_steps;
+            if (m_config.momentum == 0.0 && m_config.weightDecay == 0.0)
+            {
+                // Plain gradient descent: one axpy per slot, no state.
+                const Number factor = static_cast<Number>(-rate * gradientScale);
+                for (const auto& parameter : parameters)
+                    LinAlg::Simd::axpy(parameter.values, parameter.gradients, factor, parameter.size);
+                return;
+            }
+            using F = LinAlg::ComputeType<Number>;
+            const detail::MomentumOp<F> op{.scale = static_cast<F>(gradientScale),
+                                           .weightDecay = static_cast<F>(m_config.weightDecay),
+                                           .momentum = static_cast<F>(m_config.momentum),
+                                           .learningRate = static_cast<F>(rate),
+                                           .nesterov = m_config.nesterov};
+            Number* velocity = detail::momentsFor(m_velocity, parameters);
+            for (const auto& parameter : parameters)
+            {
+                detail::update(parameter.values, parameter.gradients, velocity, static_cast<Number*>(nullptr), parameter.size, op);
+                velocity += parameter.size;
+            }
+        }
+    private:
+        SgdConfig m_config;
+        LinAlg::VectorX<Number> m_velocity;
+        size_t m_steps = 0;
+    };
+
+    // Decoupled = true is AdamW (see the top of this file).
+    template<std::floating_point Number, bool Decoupled = false>
+    class Adam
+    {
+    public:
+        explicit Adam(const AdamConfig& config = {}) : m_config(config) {}
+
+        [[nodiscard]] const AdamConfig& config() const noexcept { return m_config; }
+        [[nodiscard]] size_t steps() const noexcept { return m_steps; }
+        [[nodiscard]] double learningRate() const noexcept { return m_config.learningRate(m_steps); }
+        [[nodiscard]] const LinAlg::VectorX<Number>& firstMoment() const noexcept { return m_first; }
+        [[nodiscard]] const LinAlg::VectorX<Number>& secondMoment() const noexcept { return m_second; }
+
+        void step(std::span<const Parameter<Number>> parameters, double gradientScale = 1.0)
+        {
+            const double rate = learningRate();
+            const double t = static_cast<double>(++m_steps);
+            const detail::AdamOp<Number> op{
+                .scale = static_cast<Number>(gradientScale),
+                .weightDecay = static_cast<Number>(Decoupled ? 0.0 : m_config.weightDecay),
+                .shrink = static_cast<Number>(Decoupled ? 1.0 - rate * m_config.weightDecay : 1.0),
+                .beta1 = static_cast<Number>(m_config.beta1),
+                .beta2 = static_cast<Number>(m_config.beta2),
+                .stepSize = static_cast<Number>(rate / (1.0 - std::pow(m_config.beta1, t))),
+                .correction = static_cast<Number>(1.0 / std::sqrt(1.0 - std::pow(m_config.beta2, t))),
+                .epsilon = static_cast<Number>(m_config.epsilon)};
+            Number* first = detail::momentsFor(m_first, parameters);
+            Number* second = detail::momentsFor(m_second, parameters);
+            for (const auto& parameter : parameters)
+            {
+                detail::update(parameter.values, parameter.gradients, first, second, parameter.size, op);
+                first += parameter.size;
+                second += parameter.size;
+            }
+        }
+    private:
+        AdamConfig m_config;
+        LinAlg::VectorX<Number> m_first;
+        LinAlg::VectorX<Number> m_second;
+        size_t m_steps = 0;
+    };
+
+    template<std::floating_point Number>
+    using AdamW = Adam<Number, true>;
+}
@@ -0,0 +1,409 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "Training.h"
+#include "Layers.h"
+#include "Dataset.h"
+#include "Profiling.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <cassert>
+namespace ML
+{
+    // Per-feature standardization x' = (x - mean) * invStd, fitted on a dataset. Keep it with the
+    // model: inputs at inference time need the same transform. Constant features get invStd = 1.
+    template<DatasetElement Number>
+    struct FeatureScaler
+    {
+        LinAlg::VectorX<Number> mean;
+        LinAlg::VectorX<Number> invStd;
+
+        static FeatureScaler fit(const DatasetView<Number>& data)
+        {
+            FeatureScaler scaler{LinAlg::VectorX<Number>(data.features), LinAlg::VectorX<Number>(data.features)};
+            const double rows = static_cast<double>(std::max<size_t>(data.rows, 1));
+            for (size_t f = 0; f < data.features; ++f)
+            {
+                const Number* column = data.feature(f);
+                const double mean = static_cast<double>(LinAlg::sum(column, data.rows, detail::LOSS_SUMMATION)) / rows;
+                double squares = 0.0;
+                for (size_t r = 0; r < data.rows; ++r)
+                {
+                    const double d = static_cast<double>(column[r]) - mean;
+                    squares += d * d;
+                }
+                const double deviation = std::sqrt(squares / rows);
+                scaler.mean[f] = static_cast<Number>(mean);
+                scaler.invStd[f] = static_cast<Number>(deviation > 0.0 ? 1.0 / deviation : 1.0);
+            }
+            return scaler;
+        }
+    };
+
+    struct PipelineConfig
+    {
+        size_t batchSize = 32;
+        // Ring of preallocated batches: the one the trainer holds plus (buffers - 1) being filled or
+        // waiting. 2 is classic double buffering; more absorbs jitter in the producers.
+        size_t buffers = 4;
+        // Producer threads, each filling whole batches.
+        size_t workers = 2;
+        // Rows are reshuffled every epoch (seeded). The batch stream depends only on the seed, never
+        // on the number of workers or on timing.
+        bool shuffle = true;
+        uint64_t seed = 0;
+        // Standardize features with the dataset's FeatureScaler while batching.
+        bool normalize = false;
+    };
+
+    struct PipelineStats
+    {
+        size_t batchesProduced = 0;
+        size_t batchesConsumed = 0;
+        // Trainer blocked in next(): data preparation is the bottleneck.
+        double consumerWaitSeconds = 0.0;
+        // Producers blocked on a full ring (backpressure, summed over workers): the trainer is the bottleneck.
+        double producerWaitSeconds = 0.0;
+        // Producers gathering and normalizing (summed over workers).
+        double produceSeconds = 0.0;
+    };
+
+    // One batch in the ring, SoA like the dataset it came from: feature f of row r is
+    // inputs[f * capacity + r]. capacity is batchSize rounded up to 64 bytes so every column is aligned.
+    template<DatasetElement Number>
+    struct PipelineBatch
+    {
+        LinAlg::VectorX<Number> inputs;
+        LinAlg::VectorX<Number> targets;
+        size_t rows = 0;
+        size_t features = 0;
+        size_t capacity = 0;
+        size_t epoch = 0;
+        size_t index = 0;          // within the epoch
+        bool lastOfEpoch = false;
+
+        [[nodiscard]] auto view() const noexcept -> DatasetView<Number>
+        {
+            return {std::span<const Number>(inputs.data(), inputs.size()), std::span<const Number>(targets.data(), rows),
+                    rows, features, capacity};
+        }
+    };
+
+    // Asynchronous batching of a dataset for the trainers:
+    //   ML::DataPipeline<float> pipeline(dataset.view<float>(), {.batchSize = 256, .normalize = true});
+    //   ML::trainLinear(model, pipeline, {.epochs = 10});
+    // Producer threads shuffle, gather and normalize batches into a bounded ring while the trainer
+    // computes on the previous one. A producer blocks when the ring is full (backpressure), the
+    // trainer when the next batch is not ready; both waits are measured in stats().
+    // The stream is endless (epoch after epoch, the last batch of an epoch may be short) and batches
+    // are delivered strictly in order whatever the number of workers.
+    // The producers are dedicated threads rather than ThreadPool tasks: they block, and a blocked
+    // task would hold a worker the compute kernels of the trainer need.
+    template<DatasetElement Number>
+    class DataPipeline
+    {
+    public:
+        // 'data' must outlive the pipeline; it is only read.
+        explicit DataPipeline(const DatasetView<Number>& data, const PipelineConfig& config = {})
+            : m_data(data), m_config(config),
+              m_batchSize(std::clamp<size_t>(config.batchSize, 1, std::max<size_t>(data.rows, 1))),
+              m_batchesPerEpoch((data.rows + m_batchSize - 1) / m_batchSize),
+              m_order(data.rows), m_rng(config.seed)
+        {
+            assert(data.rows != 0);
+            if (config.normalize)
+                m_scaler = FeatureScaler<Number>::fit(data);
+            std::iota(m_order.begin(), m_order.end(), size_t{0});
+            if (config.shuffle)
+                std::ranges::shuffle(m_order, m_rng);
+
+            constexpr size_t ALIGN = 64 / sizeof(Number);
+            const size_t capacity = (m_batchSize + ALIGN - 1) / ALIGN * ALIGN;
+            m_ring.resize(std::max<size_t>(config.buffers, 2));
+            for (auto& batch : m_ring)
+            {
+                batch.inputs = LinAlg::VectorX<Number>(data.features * capacity);
+                batch.targets = LinAlg::VectorX<Number>(capacity);
+                batch.features = data.features;
+                batch.capacity = capacity;
+            }
+            m_slotSequence.assign(m_ring.size(), NONE);
+            const size_t workers = std::max<size_t>(config.workers, 1);
+            m_workers.reserve(workers);
+            for (size_t w = 0; w < workers; ++w)
+                m_workers.emplace_back([this] { produce(); });
+        }
+        ~DataPipeline()
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = true;
+            }
+            m_space.notify_all();
+            for (auto& worker : m_workers)
+                worker.join();
+        }
+        DataPipeline(const DataPipeline&) = delete;
+        DataPipeline& operator=(const DataPipeline&) = delete;
+
+        // The next batch of the stream. Blocks until it is ready; hands the batch returned by the
+        // previous call back to the producers, so that reference must not be used any more.
+        auto next() -> const PipelineBatch<Number>&
+        {
+            std::unique_lock lock(m_mutex);
+            if (m_next != m_released)
+            {
+                m_released = m_next;
+                m_space.notify_all();
+            }
+            const size_t slot = m_next % m_ring.size();
+            if (m_slotSequence[slot] != m_next)
+            {
+                LINALG_PROFILE_SCOPE("DataPipeline.wait");
+                const auto start = std::chrono::steady_clock::now();
+                m_ready.wait(lock, [&] { return m_slotSequence[slot] == m_next; });
+                m_stats.consumerWaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            ++m_next;
+            ++m_stats.batchesConsumed;
+            return m_ring[slot];
+        }
+
+        [[nodiscard]] PipelineStats stats() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_stats;
+        }
+        [[nodiscard]] size_t rows() const noexcept { return m_data.rows; }
+        [[nodiscard]] size_t features() const noexcept { return m_data.features; }
+        [[nodiscard]] size_t batchSize() const noexcept { return m_batchSize; }
+        [[nodiscard]] size_t batchesPerEpoch() const noexcept { return m_batchesPerEpoch; }
+        // Empty unless config.normalize.
+        [[nodiscard]] const FeatureScaler<Number>& scaler() const noexcept { return m_scaler; }
+    private:
+        static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+        void produce()
+        {
+            std::vector<size_t> rows(m_batchSize);
+            while (true)
+            {
+                size_t sequence, count;
+                {
+                    std::unique_lock lock(m_mutex);
+                    if (m_stopping)
+                        return;
+                    // Claimed in sequence order under the lock, so epochs are reshuffled in order and
+                    // the row order of every batch is fixed before any worker touches it.
+                    sequence = m_claimed++;
+                    count = planRows(sequence, rows);
+                    // Backpressure: the slot is free once the trainer has released the batch ring.size() earlier.
+                    const auto start = std::chrono::steady_clock::now();
+                    m_space.wait(lock, [&] { return m_stopping || sequence < m_released + m_ring.size(); });
+                    m_stats.producerWaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    if (m_stopping)
+                        return;
+                }
+                const auto start = std::chrono::steady_clock::now();
+                auto& batch = m_ring[sequence % m_ring.size()];
+                fill(batch, std::span<const size_t>(rows.data(), count));
+                batch.epoch = sequence / m_batchesPerEpoch;
+                batch.index = sequence % m_batchesPerEpoch;
+                batch.lastOfEpoch = batch.index + 1 == m_batchesPerEpoch;
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_slotSequence[sequence % m_ring.size()] = sequence;
+                    ++m_stats.batchesProduced;
+                    m_stats.produceSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+                m_ready.notify_one();
+            }
+        }
+
+        // Row indices of batch 'sequence' into 'rows'; returns how many. Called under m_mutex.
+        size_t planRows(size_t sequence, std::vector<size_t>& rows)
+        {
+            const size_t epoch = sequence / m_batchesPerEpoch;
+            if (epoch != m_orderEpoch)
+            {
+                if (m_config.shuffle)
+                    std::ranges::shuffle(m_order, m_rng);
+                m_orderEpoch = epoch;
+            }
+            const size_t begin = sequence % m_batchesPerEpoch * m_batchSize;
+            const size_t count = std::min(m_batchSize, m_data.rows - begin);
+            std::copy_n(m_order.begin() + static_cast<std::ptrdiff_t>(begin), count, rows.begin());
+            return count;
+        }
+
+        // Gathers the rows column by column (a contiguous copy when not shuffled), normalizing on the way.
+        void fill(PipelineBatch<Number>& batch, std::span<const size_t> rows) const
+        {
+            LINALG_PROFILE_SCOPE("DataPipeline.fill");
+            const size_t count = rows.size();
+            const bool contiguous = !m_config.shuffle;
+            for (size_t f = 0; f < m_data.features; ++f)
+            {
+                const Number* column = m_data.feature(f);
+                Number* out = batch.inputs.data() + f * batch.capacity;
+                if (contiguous)
+                    std::copy_n(column + rows.front(), count, out);
+                else
+                    for (size_t r = 0; r < count; ++r)
+                        out[r] = column[rows[r]];
+                if (m_config.normalize)
+                {
+                    const Number mean = m_scaler.mean[f], invStd = m_scaler.invStd[f];
+                    for (size_t r = 0; r < count; ++r)
+                        out[r] = (out[r] - mean) * invStd;
+                }
+            }
+            if (contiguous)
+                std::copy_n(m_data.targets.data() + rows.front(), count, batch.targets.data());
+            else
+                for (size_t r = 0; r < count; ++r)
+                    batch.targets[r] = m_data.targets[rows[r]];
+            batch.rows = count;
+        }
+
+        DatasetView<Number> m_data;
+        PipelineConfig m_config;
+        size_t m_batchSize;
+        size_t m_batchesPerEpoch;
+        FeatureScaler<Number> m_scaler;
+        std::vector<PipelineBatch<Number>> m_ring;
+
+        // Guarded by m_mutex.
+        mutable std::mutex m_mutex;
+        std::condition_variable m_ready;          // a batch became ready (-> trainer)
+        std::condition_variable m_space;          // a slot was released (-> producers)
+        std::vector<size_t> m_order;              // row order of epoch m_orderEpoch
+        size_t m_orderEpoch = 0;
+        std::mt19937_64 m_rng;
+        std::vector<size_t> m_slotSequence;       // batch ready in each slot, NONE while empty / filling
+        size_t m_claimed = 0;                     // next batch a producer takes
+        size_t m_next = 0;                        // next batch the trainer gets
+        size_t m_released = 0;                    // batches the trainer is done with
+        bool m_stopping = false;
+        PipelineStats m_stats;
+
+        std::vector<std::thread> m_workers;       // last: started once everything above exists
+    };
+
+    // trainLinear fed by a pipeline: one epoch is pipeline.batchesPerEpoch() batches. The pipeline
+    // owns batching and shuffling (config.batchSize and shuffleBatches are not used), and the time the
+    // trainer waits for it is reported as EpochReport::dataWaitSeconds.
+    template<DatasetElement Number, Optimizer<Number> Opt>
+    auto trainLinear(LinearModel<Number>& model, DataPipeline<Number>& pipeline, const TrainConfig& config,
+                     Opt& optimizer) -> TrainResult
+    {
+        assert(model.weights.size() == pipeline.features());
+        TrainResult result;
+        LinAlg::VectorX<Number> prediction(pipeline.batchSize());
+        LinAlg::VectorX<Number> gradient(pipeline.features());
+        result.history.reserve(config.epochs);
+        size_t epochsWithoutImprovement = 0;
+
+        for (size_t epoch = 0; epoch < config.epochs; ++epoch)
+        {
+            LINALG_PROFILE_SCOPE("trainLinear.epoch");
+            const auto start = std::chrono::steady_clock::now();
+            const double waited = pipeline.stats().consumerWaitSeconds;
+            double totalError = 0.0;
+            double gradientSquares = 0.0;
+            bool last = false;
+            while (!last)
+            {
+                const auto& batch = pipeline.next();
+                const auto data = batch.view();
+                last = batch.lastOfEpoch;
+                gradientSquares += detail::linearStep(model, size_t{0}, data.rows, data.targets.data(), prediction.data(),
+                    gradient, optimizer,
+                    [&](size_t, size_t rows, Number* out)
+                    {
+                        LinAlg::gemv(Number{1}, data.batch(0, rows), model.weights.view(), Number{}, {out, rows});
+                    },
+                    [&](size_t, size_t rows, const Number* error, Number* out)
+                    {
+                        LinAlg::gemv(Number{1}, data.batch(0, rows).transpose(), {error, rows}, Number{}, {out, data.features});
+                    }, totalError);
+            }
+
+            EpochReport report;
+            report.epoch = epoch;
+            report.loss = totalError / static_cast<double>(pipeline.rows());
+            report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report.samplesPerSecond = report.seconds > 0.0 ? static_cast<double>(pipeline.rows()) / report.seconds : 0.0;
+            report.gradientNorm = std::sqrt(gradientSquares / static_cast<double>(pipeline.batchesPerEpoch()));
+            report.dataWaitSeconds = pipeline.stats().consumerWaitSeconds - waited;
+            if (!detail::finishEpoch(result, report, config, epochsWithoutImprovement))
+                break;
+        }
+        return result;
+    }
+    template<DatasetElement Number>
+    auto trainLinear(LinearModel<Number>& model, DataPipeline<Number>& pipeline, const TrainConfig& config) -> TrainResult
+    {
+        auto optimizer = detail::gradientDescent<Number>(config);
+        return trainLinear(model, pipeline, config, optimizer);
+    }
+
+    // trainMlp fed by a pipeline, see trainLinear above.
+    template<DatasetElement Number, typename Allocator, Optimizer<Number> Opt>
+    auto trainMlp(Mlp<Number, Allocator>& net, DataPipeline<Number>& pipeline, const TrainConfig& config,
+                  Opt& optimizer) -> TrainResult
+    {
+        assert(net.inputs() == pipeline.features() && net.outputs() == 1);
+        TrainResult result;
+        LinAlg::MatrixX<Number> lossGrad(pipeline.batchSize(), 1);
+        const auto parameters = net.parameters();
+        result.history.reserve(config.epochs);
+        size_t epochsWithoutImprovement = 0;
+
+        for (size_t epoch = 0; epoch < config.epochs; ++epoch)
+        {
+            LINALG_PROFILE_SCOPE("trainMlp.epoch");
+            const auto start = std::chrono::steady_clock::now();
+            const double waited = pipeline.stats().consumerWaitSeconds;
+            double totalError = 0.0;
+            double gradientSquares = 0.0;
+            bool last = false;
+            while (!last)
+            {
+                const auto& batch = pipeline.next();
+                const auto data = batch.view();
+                last = batch.lastOfEpoch;
+                gradientSquares += detail::mlpStep(net, data.batch(0, data.rows), data.targets.data(), lossGrad, optimizer,
+                                                   parameters, totalError);
+            }
+
+            EpochReport report;
+            report.epoch = epoch;
+            report.loss = totalError / static_cast<double>(pipeline.rows());
+            report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report.samplesPerSecond = report.seconds > 0.0 ? static_cast<double>(pipeline.rows()) / report.seconds : 0.0;
+            report.gradientNorm = std::sqrt(gradientSquares / static_cast<double>(pipeline.batchesPerEpoch()));
+            report.dataWaitSeconds = pipeline.stats().consumerWaitSeconds - waited;
+            if (!detail::finishEpoch(result, report, config, epochsWithoutImprovement))
+                break;
+        }
+        return result;
+    }
+    template<DatasetElement Number, typename Allocator>
+    auto trainMlp(Mlp<Number, Allocator>& net, DataPipeline<Number>& pipeline, const TrainConfig& config) -> TrainResult
+    {
+        auto optimizer = detail::gradientDescent<Number>(config);
+        return trainMlp(net, pipeline, config, optimizer);
+    }
+}
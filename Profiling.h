@@ -0,0 +1,261 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#ifndef LINALG_PROFILING
+#define LINALG_PROFILING 0
+#endif
+#if LINALG_PROFILING
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <print>
+#include <stdexcept>
+#include <string_view>
+#endif
+namespace LinAlg
+{
+    // Hot-path instrumentation, compiled in only when LINALG_PROFILING is 1 (CMake option
+    // LINALG_PROFILING). Without it both macros expand to nothing and Profiler's functions are
+    // empty, so instrumented kernels are exactly the uninstrumented code.
+    //   LINALG_PROFILE_KERNEL(name, bytes, flops) : times the enclosing block and adds one call,
+    //                                               'bytes' touched and 'flops' to the call site
+    //   LINALG_PROFILE_SCOPE(name)                : times the enclosing block (epochs, phases)
+    // Counters are per call site (relaxed atomics, no locks) and merged by name in
+    // Profiler::kernels(). While Profiler::setTracing(true) every timed block also becomes a
+    // Chrome trace event in a per-thread buffer; Profiler::writeChromeTrace() dumps them for
+    // chrome://tracing or Perfetto.
+    //   LinAlg::Profiler::setTracing(true);
+    //   ... train ...
+    //   LinAlg::Profiler::printSummary();
+    //   LinAlg::Profiler::writeChromeTrace("trace.json");
+
+    struct KernelStats
+    {
+        std::string name;
+        uint64_t calls = 0;
+        uint64_t nanoseconds = 0;
+        uint64_t bytes = 0;
+        uint64_t flops = 0;
+    };
+
+#if LINALG_PROFILING
+    // One instrumented call site (a function-local static created by the macros).
+    struct ProfileSite
+    {
+        const char* name;
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> nanoseconds{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> flops{0};
+
+        explicit ProfileSite(const char* siteName);
+    };
+
+    class Profiler
+    {
+    public:
+        static constexpr bool enabled = true;
+        // Events kept per thread while tracing; later ones are dropped (and counted).
+        static constexpr size_t MAX_EVENTS_PER_THREAD = size_t{1} << 20;
+
+        struct TraceEvent
+        {
+            const char* name;
+            uint64_t start;     // ns since the first timed block of the process
+            uint64_t duration;  // ns
+            uint64_t bytes;
+            uint64_t flops;
+        };
+
+        static void setTracing(bool on) noexcept { state().tracing.store(on, std::memory_order_relaxed); }
+        [[nodiscard]] static bool tracing() noexcept { return state().tracing.load(std::memory_order_relaxed); }
+
+        // Per-name totals since the last reset(), most expensive first.
+        [[nodiscard]] static std::vector<KernelStats> kernels()
+        {
+            std::vector<KernelStats> result;
+            std::scoped_lock lock(state().mutex);
+            for (const ProfileSite* site : state().sites)
+            {
+                const uint64_t calls = site->calls.load(std::memory_order_relaxed);
+                if (calls == 0)
+                    continue;
+                auto it = std::ranges::find(result, std::string_view(site->name), &KernelStats::name);
+                if (it == result.end())
+                    it = result.insert(result.end(), KernelStats{site->name});
+                it->calls += calls;
+                it->nanoseconds += site->nanoseconds.load(std::memory_order_relaxed);
+                it->bytes += site->bytes.load(std::memory_order_relaxed);
+                it->flops += site->flops.load(std::memory_order_relaxed);
+            }
+            std::ranges::sort(result, std::ranges::greater{}, &KernelStats::nanoseconds);
+            return result;
+        }
+        // Clears the counters and the recorded trace. Call while no kernel is running.
+        static void reset() noexcept
+        {
+            std::scoped_lock lock(state().mutex);
+            for (ProfileSite* site : state().sites)
+            {
+                site->calls.store(0, std::memory_order_relaxed);
+                site->nanoseconds.store(0, std::memory_order_relaxed);
+                site->bytes.store(0, std::memory_order_relaxed);
+                site->flops.store(0, std::memory_order_relaxed);
+            }
+            for (const auto& buffer : state().buffers)
+            {
+                buffer->events.clear();
+                buffer->dropped = 0;
+            }
+        }
+
+        static void printSummary(std::FILE* file = stdout)
+        {
+            std::println(file, "{:<28} {:>12} {:>12} {:>12} {:>9} {:>9}", "kernel", "calls", "total ms", "avg ns", "GB/s", "GFLOP/s");
+            for (const KernelStats& k : kernels())
+            {
+                const double ns = static_cast<double>(std::max<uint64_t>(k.nanoseconds, 1));
+                std::println(file, "{:<28} {:>12} {:>12.3f} {:>12.1f} {:>9.2f} {:>9.2f}", k.name, k.calls, ns * 1e-6,
+                             ns / static_cast<double>(k.calls), static_cast<double>(k.bytes) / ns, static_cast<double>(k.flops) / ns);
+            }
+        }
+
+        // Chrome trace-event JSON ("X" complete events, one tid per thread). Call while no kernel
+        // is running.
+        static void writeChromeTrace(const std::string& path)
+        {
+            std::FILE* file = std::fopen(path.c_str(), "w");
+            if (file == nullptr)
+                throw std::runtime_error("cannot write trace file " + path);
+            std::scoped_lock lock(state().mutex);
+            std::print(file, "{{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+            const char* separator = "\n";
+            for (const auto& buffer : state().buffers)
+            {
+                std::print(file, "{}{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, \"args\": {{\"name\": \"thread {}\"}}}}",
+                           separator, buffer->thread, buffer->thread);
+                separator = ",\n";
+                for (const TraceEvent& e : buffer->events)
+                    std::print(file, ",\n{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}, "
+                                     "\"args\": {{\"bytes\": {}, \"flops\": {}}}}}",
+                               e.name, buffer->thread, static_cast<double>(e.start) * 1e-3, static_cast<double>(e.duration) * 1e-3,
+                               e.bytes, e.flops);
+                if (buffer->dropped != 0)
+                    std::print(file, ",\n{{\"name\": \"{} events dropped\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": {}, \"ts\": 0}}",
+                               buffer->dropped, buffer->thread);
+            }
+            std::println(file, "\n]}}");
+            const bool failed = std::ferror(file) != 0;
+            if (std::fclose(file) != 0 || failed)
+                throw std::runtime_error("cannot write trace file " + path);
+        }
+
+        [[nodiscard]] static uint64_t now() noexcept
+        {
+            static const auto epoch = std::chrono::steady_clock::now();
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+        }
+        static void record(const TraceEvent& event)
+        {
+            ThreadBuffer& buffer = threadBuffer();
+            if (buffer.events.size() < MAX_EVENTS_PER_THREAD)
+                buffer.events.push_back(event);
+            else
+                ++buffer.dropped;
+        }
+    private:
+        friend struct ProfileSite;
+        struct ThreadBuffer
+        {
+            uint32_t thread = 0;
+            uint64_t dropped = 0;
+            std::vector<TraceEvent> events;
+        };
+        struct State
+        {
+            std::mutex mutex;
+            std::atomic<bool> tracing{false};
+            std::vector<ProfileSite*> sites;
+            // Shared so a thread's events outlive the thread.
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        };
+        static State& state() noexcept
+        {
+            static State instance;
+            return instance;
+        }
+        static ThreadBuffer& threadBuffer()
+        {
+            thread_local const std::shared_ptr<ThreadBuffer> buffer = []
+            {
+                auto created = std::make_shared<ThreadBuffer>();
+                std::scoped_lock lock(state().mutex);
+                created->thread = static_cast<uint32_t>(state().buffers.size());
+                state().buffers.push_back(created);
+                return created;
+            }();
+            return *buffer;
+        }
+    };
+
+    inline ProfileSite::ProfileSite(const char* siteName) : name(siteName)
+    {
+        std::scoped_lock lock(Profiler::state().mutex);
+        Profiler::state().sites.push_back(this);
+    }
+
+    class ProfileScope
+    {
+    public:
+        ProfileScope(ProfileSite& site, uint64_t bytes, uint64_t flops) noexcept
+            : m_site(site), m_bytes(bytes), m_flops(flops), m_start(Profiler::now()) {}
+        ~ProfileScope()
+        {
+            const uint64_t duration = Profiler::now() - m_start;
+            m_site.calls.fetch_add(1, std::memory_order_relaxed);
+            m_site.nanoseconds.fetch_add(duration, std::memory_order_relaxed);
+            m_site.bytes.fetch_add(m_bytes, std::memory_order_relaxed);
+            m_site.flops.fetch_add(m_flops, std::memory_order_relaxed);
+            if (Profiler::tracing())
+                Profiler::record({m_site.name, m_start, duration, m_bytes, m_flops});
+        }
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+    private:
+        ProfileSite& m_site;
+        uint64_t m_bytes;
+        uint64_t m_flops;
+        uint64_t m_start;
+    };
+#else
+    class Profiler
+    {
+    public:
+        static constexpr bool enabled = false;
+        static void setTracing(bool) noexcept {}
+        [[nodiscard]] static bool tracing() noexcept { return false; }
+        [[nodiscard]] static std::vector<KernelStats> kernels() { return {}; }
+        static void reset() noexcept {}
+        static void printSummary(std::FILE* = stdout) {}
+        static void writeChromeTrace(const std::string&) {}
+    };
+#endif
+}
+
+#if LINALG_PROFILING
+#define LINALG_PROFILE_CONCAT_(a, b) a##b
+#define LINALG_PROFILE_CONCAT(a, b) LINALG_PROFILE_CONCAT_(a, b)
+#define LINALG_PROFILE_KERNEL(name, bytes, flops)                                                              \
+    static ::LinAlg::ProfileSite LINALG_PROFILE_CONCAT(linalgProfileSite, __LINE__){name};                    \
+    const ::LinAlg::ProfileScope LINALG_PROFILE_CONCAT(linalgProfileScope, __LINE__)(                          \
+        LINALG_PROFILE_CONCAT(linalgProfileSite, __LINE__), static_cast<uint64_t>(bytes), static_cast<uint64_t>(flops))
+#define LINALG_PROFILE_SCOPE(name) LINALG_PROFILE_KERNEL(name, 0, 0)
+#else
+#define LINALG_PROFILE_KERNEL(name, bytes, flops) static_cast<void>(0)
+#define LINALG_PROFILE_SCOPE(name) static_cast<void>(0)
+#endif
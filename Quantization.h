@@ -0,0 +1,307 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Profiling.h"
+#include "Matrices.h"
+#include "Vectors.h"
+#include "DynamicMatrices.h"
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <concepts>
+#include <cassert>
+namespace LinAlg
+{
+    // 8-bit affine quantization:  real = scale * (q - zeroPoint).
+    //   weights     : int8, symmetric (zeroPoint 0) by default, one (scale, zeroPoint) per tensor
+    //                 or per row (= per output channel of a layer)
+    //   activations : uint8, asymmetric, one (scale, zeroPoint) per tensor
+    // Products run on the integers and accumulate exactly in int32:
+    //   sum_k (a_k - za)(b_k - zb) = sum a*b - zb * sum a - za * sum b + K * za * zb
+    // where sum b is precomputed per weight row and sum a once per activation row, so the inner
+    // loop is a plain u8 x s8 dot product (widened to 16 bits and multiply-added into int32 lanes
+    // with pmaddwd; 255 * 127 * 2 always fits, unlike the saturating pmaddubsw).
+    // The int32 results go to a per-row epilogue that rescales (dequantize / requantize), so the
+    // accumulators never travel through memory.
+
+    template<typename T>
+    concept QuantElement = std::same_as<T, int8_t> || std::same_as<T, uint8_t>;
+
+    enum class QuantGranularity : uint8_t
+    {
+        PerTensor,
+        PerChannel  // one set of parameters per row
+    };
+
+    struct QuantParams
+    {
+        float scale = 1.0f;
+        int32_t zeroPoint = 0;
+
+        // Parameters covering [min, max] (always widened to contain 0, so 0 is exact).
+        template<QuantElement Q>
+        static QuantParams fromRange(float min, float max, bool symmetric) noexcept
+        {
+            constexpr float qmin = std::numeric_limits<Q>::min(), qmax = std::numeric_limits<Q>::max();
+            min = std::min(min, 0.0f);
+            max = std::max(max, 0.0f);
+            if (symmetric)
+            {
+                const float bound = std::max(-min, max);
+                // int8 -> [-127, 127] so negation stays in range; uint8 -> centred on 128.
+                const float half = std::same_as<Q, int8_t> ? 127.0f : 127.5f;
+                return {bound > 0.0f ? bound / half : 1.0f, std::same_as<Q, int8_t> ? 0 : 128};
+            }
+            if (max == min)
+                return {1.0f, 0};
+            const float scale = (max - min) / (qmax - qmin);
+            const auto zeroPoint = static_cast<int32_t>(std::clamp(std::nearbyint(qmin - min / scale), qmin, qmax));
+            return {scale, zeroPoint};
+        }
+
+        [[nodiscard]] float dequantize(int32_t q) const noexcept { return scale * static_cast<float>(q - zeroPoint); }
+    };
+
+    // dst[i] = clamp(round(src[i] / scale) + zeroPoint)
+    template<QuantElement Q, std::floating_point Number>
+    void quantize(Q* dst, const Number* src, size_t n, QuantParams params) noexcept
+    {
+        constexpr float qmin = std::numeric_limits<Q>::min(), qmax = std::numeric_limits<Q>::max();
+        const float inverse = 1.0f / params.scale;
+        const auto zero = static_cast<float>(params.zeroPoint);
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<Q>(std::clamp(std::nearbyint(static_cast<float>(src[i]) * inverse) + zero, qmin, qmax));
+    }
+    template<std::floating_point Number, QuantElement Q>
+    void dequantize(Number* dst, const Q* src, size_t n, QuantParams params) noexcept
+    {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<Number>(params.scale * static_cast<float>(static_cast<int32_t>(src[i]) - params.zeroPoint));
+    }
+
+    // Fixed-size containers: the u8 / s8 aliases (V4u8, Mat4u8, ...) hold the quantized values.
+    template<QuantElement Q, size_t size, std::floating_point Number>
+    auto quantize(const Vector<size, Number>& v, QuantParams params) noexcept -> Vector<size, Q>
+    {
+        Vector<size, Q> result;
+        quantize(result.data.data(), v.data.data(), size, params);
+        return result;
+    }
+    template<std::floating_point Number, size_t size, QuantElement Q>
+    auto dequantize(const Vector<size, Q>& v, QuantParams params) noexcept -> Vector<size, Number>
+    {
+        Vector<size, Number> result;
+        dequantize(result.data.data(), v.data.data(), size, params);
+        return result;
+    }
+    template<QuantElement Q, uint8_t size, std::floating_point Number>
+    auto quantize(const Matrix<size, Number>& m, QuantParams params) noexcept -> Matrix<size, Q>
+    {
+        Matrix<size, Q> result;
+        quantize(&result(0, 0), &m(0, 0), size_t{size} * size, params);
+        return result;
+    }
+    template<std::floating_point Number, uint8_t size, QuantElement Q>
+    auto dequantize(const Matrix<size, Q>& m, QuantParams params) noexcept -> Matrix<size, Number>
+    {
+        Matrix<size, Number> result;
+        dequantize(&result(0, 0), &m(0, 0), size_t{size} * size, params);
+        return result;
+    }
+
+    // Quantized rows x cols matrix (row-major) with per-tensor or per-row parameters, plus the
+    // row sums the zero-point correction needs.
+    template<QuantElement Q>
+    struct QuantizedMatrix
+    {
+        MatrixX<Q> values;
+        std::vector<QuantParams> params;   // 1 (PerTensor) or rows() entries (PerChannel)
+        std::vector<int32_t> rowSums;      // sum_k values(r, k)
+
+        QuantizedMatrix() = default;
+        // Element (r, c) of the source is src[r * rs + c * cs] (pass rs = 1, cs = rows to quantize
+        // the transpose of a row-major matrix).
+        template<std::floating_point Number>
+        QuantizedMatrix(const Number* src, size_t rows, size_t cols, size_t rs, size_t cs,
+                        QuantGranularity granularity, bool symmetric)
+            : values(rows, cols), rowSums(rows)
+        {
+            const auto rangeOf = [&](size_t first, size_t last)
+            {
+                float min = 0.0f, max = 0.0f;
+                for (size_t r = first; r < last; ++r)
+                    for (size_t c = 0; c < cols; ++c)
+                    {
+                        const auto x = static_cast<float>(src[r * rs + c * cs]);
+                        min = std::min(min, x);
+                        max = std::max(max, x);
+                    }
+                return QuantParams::fromRange<Q>(min, max, symmetric);
+            };
+            if (granularity == QuantGranularity::PerTensor)
+                params.assign(1, rangeOf(0, rows));
+            else
+            {
+                params.resize(rows);
+                for (size_t r = 0; r < rows; ++r)
+                    params[r] = rangeOf(r, r + 1);
+            }
+            std::vector<Number> row(cols);
+            for (size_t r = 0; r < rows; ++r)
+            {
+                for (size_t c = 0; c < cols; ++c)
+                    row[c] = src[r * rs + c * cs];
+                Q* out = values.data() + r * cols;
+                quantize(out, row.data(), cols, rowParams(r));
+                rowSums[r] = std::accumulate(out, out + cols, int32_t{0}, [](int32_t sum, Q q) { return sum + q; });
+            }
+        }
+
+        [[nodiscard]] size_t rows() const noexcept { return values.rows(); }
+        [[nodiscard]] size_t cols() const noexcept { return values.cols(); }
+        [[nodiscard]] const QuantParams& rowParams(size_t r) const noexcept { return params.size() == 1 ? params.front() : params[r]; }
+        [[nodiscard]] size_t bytes() const noexcept
+        {
+            return values.size() * sizeof(Q) + params.size() * sizeof(QuantParams) + rowSums.size() * sizeof(int32_t);
+        }
+    };
+
+    namespace detail
+    {
+        inline void dotU8S8Scalar(const uint8_t* a, const int8_t* const* b, size_t count, size_t begin, size_t n, int32_t* out) noexcept
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                int32_t sum = 0;
+                for (size_t i = begin; i < n; ++i)
+                    sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[j][i]);
+                out[j] += sum;
+            }
+        }
+#if LINALG_SIMD_X86
+        // Up to 4 rows of b against one row of a: every activation chunk is widened once and
+        // reused by all of them.
+        LINALG_TARGET_AVX512 inline void dotU8S8Avx512(const uint8_t* a, const int8_t* const* b, size_t count, size_t n, int32_t* out) noexcept
+        {
+            __m512i acc[4] = {_mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512()};
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32)
+            {
+                const __m512i va = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[j] + i)));
+                    acc[j] = _mm512_add_epi32(acc[j], _mm512_madd_epi16(va, vb));
+                }
+            }
+            for (size_t j = 0; j < count; ++j)
+            {
+                alignas(64) int32_t lanes[16];
+                _mm512_store_si512(lanes, acc[j]);
+                out[j] = std::accumulate(lanes, lanes + 16, int32_t{0});
+            }
+            dotU8S8Scalar(a, b, count, i, n, out);
+        }
+        LINALG_TARGET_AVX2 inline void dotU8S8Avx2(const uint8_t* a, const int8_t* const* b, size_t count, size_t n, int32_t* out) noexcept
+        {
+            __m256i acc[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                const __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b[j] + i)));
+                    acc[j] = _mm256_add_epi32(acc[j], _mm256_madd_epi16(va, vb));
+                }
+            }
+            for (size_t j = 0; j < count; ++j)
+            {
+                const __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc[j]), _mm256_extracti128_si256(acc[j], 1));
+                const __m128i quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+                out[j] = _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, 0xB1)));
+            }
+            dotU8S8Scalar(a, b, count, i, n, out);
+        }
+        LINALG_TARGET_SSE41 inline void dotU8S8Sse41(const uint8_t* a, const int8_t* const* b, size_t count, size_t n, int32_t* out) noexcept
+        {
+            __m128i acc[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m128i va = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i)));
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const __m128i vb = _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b[j] + i)));
+                    acc[j] = _mm_add_epi32(acc[j], _mm_madd_epi16(va, vb));
+                }
+            }
+            for (size_t j = 0; j < count; ++j)
+            {
+                const __m128i half = _mm_add_epi32(acc[j], _mm_shuffle_epi32(acc[j], 0x4E));
+                out[j] = _mm_cvtsi128_si32(_mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1)));
+            }
+            dotU8S8Scalar(a, b, count, i, n, out);
+        }
+#endif
+        // out[j] = sum_i a[i] * b[j][i] for j < count (count <= 4).
+        inline void dotU8S8(const uint8_t* a, const int8_t* const* b, size_t count, size_t n, int32_t* out) noexcept
+        {
+            assert(count <= 4);
+#if LINALG_SIMD_X86
+            switch (Simd::activeIsa())
+            {
+                case Simd::Isa::AVX512: dotU8S8Avx512(a, b, count, n, out); return;
+                case Simd::Isa::AVX2:   dotU8S8Avx2(a, b, count, n, out);   return;
+                case Simd::Isa::SSE41:  dotU8S8Sse41(a, b, count, n, out);  return;
+                case Simd::Isa::Scalar: break;
+            }
+#endif
+            std::fill_n(out, count, 0);
+            dotU8S8Scalar(a, b, count, 0, n, out);
+        }
+    }
+
+    // Integer product of uint8 activations A (M x K, row-major, row stride lda, one zero point)
+    // and the transpose of int8 weights W (N x K, one row per output channel):
+    //   acc(i, j) = sum_k (A(i, k) - zA) * (W(j, k) - zW(j))      exact in int32
+    // epilogue(i, acc) receives the N accumulators of row i (a thread-local buffer) and must
+    // consume them before returning. Rows are split across the pool.
+    template<typename Epilogue>
+    void gemmQuantized(size_t M, const uint8_t* A, size_t lda, int32_t zA,
+                       const QuantizedMatrix<int8_t>& W, const Epilogue& epilogue,
+                       const Parallel& policy = Parallel::current())
+    {
+        const size_t N = W.rows(), K = W.cols();
+        LINALG_PROFILE_KERNEL("gemmQuantized", M * K + N * K + 4 * M * N, 2 * M * N * K);
+        parallelFor(M, policy, [&](size_t first, size_t last)
+        {
+            thread_local std::vector<int32_t> acc;
+            acc.resize(N);
+            for (size_t i = first; i < last; ++i)
+            {
+                const uint8_t* a = A + i * lda;
+                const int32_t rowSum = std::accumulate(a, a + K, int32_t{0});
+                for (size_t j = 0; j < N; j += 4)
+                {
+                    const size_t count = std::min<size_t>(4, N - j);
+                    const int8_t* rows[4]{};
+                    for (size_t c = 0; c < count; ++c)
+                        rows[c] = W.values.data() + (j + c) * K;
+                    detail::dotU8S8(a, rows, count, K, acc.data() + j);
+                    for (size_t c = 0; c < count; ++c)
+                    {
+                        const int32_t zW = W.rowParams(j + c).zeroPoint;
+                        acc[j + c] += -zW * rowSum - zA * W.rowSums[j + c] + static_cast<int32_t>(K) * zA * zW;
+                    }
+                }
+                epilogue(i, static_cast<const int32_t*>(acc.data()));
+            }
+        }, M * N * K);
+    }
+}
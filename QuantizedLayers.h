@@ -0,0 +1,197 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "Quantization.h"
+#include "Layers.h"
+#include "Training.h"
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <concepts>
+#include <algorithm>
+#include <cassert>
+namespace ML
+{
+    // Post-training 8-bit inference for a trained Mlp:
+    //   ML::DatasetView<float> calibration = ...;       // a representative sample of inputs
+    //   ML::QuantizedMlp<float> q(net, calibration);
+    //   const auto& Y = q.forward(X, rows, rsX, csX);   // same contract as Mlp::forward
+    // Weights become int8 (per output channel by default, symmetric), activations between layers
+    // uint8 with one (scale, zeroPoint) per layer taken from the ranges the float network produced
+    // on the calibration data. Every layer is one LinAlg::gemmQuantized whose epilogue turns the
+    // exact int32 sums into  act(sX * sW[o] * acc + b[o])  and requantizes them straight into the
+    // next layer's uint8 input, so only the 8-bit activations touch memory. The last layer writes
+    // Number. Bias and activation stay in floating point.
+    struct QuantizeConfig
+    {
+        LinAlg::QuantGranularity granularity = LinAlg::QuantGranularity::PerChannel;
+        bool symmetricWeights = true;
+        size_t calibrationBatch = 4096;  // rows per float forward pass while calibrating
+    };
+
+    template<std::floating_point Number>
+    class QuantizedDense
+    {
+    public:
+        template<typename Allocator>
+        explicit QuantizedDense(const Dense<Number, Allocator>& layer, const QuantizeConfig& config = {})
+            // W is inputs x outputs; quantize its transpose so every output channel is one row.
+            : m_weights(layer.weights().data(), layer.outputs(), layer.inputs(), size_t{1}, layer.outputs(),
+                        config.granularity, config.symmetricWeights),
+              m_bias(layer.bias().data(), layer.bias().data() + layer.outputs()),
+              m_activation(layer.activation())
+        {
+        }
+
+        [[nodiscard]] size_t inputs() const noexcept { return m_weights.cols(); }
+        [[nodiscard]] size_t outputs() const noexcept { return m_weights.rows(); }
+        [[nodiscard]] Activation activation() const noexcept { return m_activation; }
+        [[nodiscard]] const LinAlg::QuantizedMatrix<int8_t>& weights() const noexcept { return m_weights; }
+        [[nodiscard]] size_t bytes() const noexcept { return m_weights.bytes() + m_bias.size() * sizeof(Number); }
+
+        // X : rows x inputs() uint8 (row-major) quantized with 'input'.
+        // Y : rows x outputs() row-major, either uint8 quantized with 'output' or Number.
+        void forward(const uint8_t* X, size_t rows, LinAlg::QuantParams input, uint8_t* Y, LinAlg::QuantParams output) const
+        {
+            const float inverse = 1.0f / output.scale;
+            const auto zero = static_cast<float>(output.zeroPoint);
+            run(X, rows, input, [&](size_t i, size_t o, float y)
+            {
+                Y[i * outputs() + o] = static_cast<uint8_t>(std::clamp(std::nearbyint(y * inverse) + zero, 0.0f, 255.0f));
+            });
+        }
+        void forward(const uint8_t* X, size_t rows, LinAlg::QuantParams input, Number* Y) const
+        {
+            run(X, rows, input, [&](size_t i, size_t o, float y) { Y[i * outputs() + o] = static_cast<Number>(y); });
+        }
+    private:
+        template<typename Store>
+        void run(const uint8_t* X, size_t rows, LinAlg::QuantParams input, const Store& store) const
+        {
+            withActivation(m_activation, [&](auto act)
+            {
+                LinAlg::gemmQuantized(rows, X, inputs(), input.zeroPoint, m_weights, [&](size_t i, const int32_t* acc)
+                {
+                    for (size_t o = 0; o < outputs(); ++o)
+                    {
+                        const float scale = input.scale * m_weights.rowParams(o).scale;
+                        const auto z = static_cast<Number>(scale * static_cast<float>(acc[o])) + m_bias[o];
+                        store(i, o, static_cast<float>(activate<decltype(act)::value>(z)));
+                    }
+                });
+            });
+        }
+
+        LinAlg::QuantizedMatrix<int8_t> m_weights;
+        std::vector<Number> m_bias;
+        Activation m_activation;
+    };
+
+    template<std::floating_point Number>
+    class QuantizedMlp
+    {
+    public:
+        using Matrix = LinAlg::MatrixX<Number>;
+
+        // Runs 'net' over the calibration inputs (in batches of config.calibrationBatch) to pick
+        // the activation ranges, then quantizes every layer.
+        template<typename Allocator>
+        QuantizedMlp(Mlp<Number, Allocator>& net, const DatasetView<Number>& calibration, const QuantizeConfig& config = {})
+        {
+            const auto& layers = net.layers();
+            assert(!layers.empty() && calibration.rows > 0 && calibration.features == net.inputs());
+            std::vector<float> lows(layers.size() + 1, 0.0f), highs(layers.size() + 1, 0.0f);
+            const auto widen = [&](size_t slot, const Number* values, size_t count)
+            {
+                const auto [low, high] = std::minmax_element(values, values + count);
+                lows[slot] = std::min(lows[slot], static_cast<float>(*low));
+                highs[slot] = std::max(highs[slot], static_cast<float>(*high));
+            };
+            for (size_t f = 0; f < calibration.features; ++f)
+                widen(0, calibration.feature(f), calibration.rows);
+            const size_t batch = std::max<size_t>(config.calibrationBatch, 1);
+            for (size_t begin = 0; begin < calibration.rows; begin += batch)
+            {
+                const size_t rows = std::min(batch, calibration.rows - begin);
+                net.forward(calibration.batch(begin, rows));
+                for (size_t l = 0; l < layers.size(); ++l)
+                    widen(l + 1, layers[l].output().data(), layers[l].output().size());
+            }
+            m_layers.reserve(layers.size());
+            m_params.reserve(layers.size());
+            m_inputs.resize(layers.size());
+            for (size_t l = 0; l < layers.size(); ++l)
+            {
+                m_layers.emplace_back(layers[l], config);
+                m_params.push_back(LinAlg::QuantParams::fromRange<uint8_t>(lows[l], highs[l], false));
+            }
+        }
+
+        [[nodiscard]] const std::vector<QuantizedDense<Number>>& layers() const noexcept { return m_layers; }
+        [[nodiscard]] size_t inputs() const noexcept { return m_layers.front().inputs(); }
+        [[nodiscard]] size_t outputs() const noexcept { return m_layers.back().outputs(); }
+        // Parameters of layer l's uint8 input.
+        [[nodiscard]] LinAlg::QuantParams inputParams(size_t l) const noexcept { return m_params[l]; }
+        [[nodiscard]] size_t weightBytes() const noexcept
+        {
+            size_t bytes = 0;
+            for (const auto& layer : m_layers)
+                bytes += layer.bytes();
+            return bytes;
+        }
+
+        // X(i, f) = X[i * rsX + f * csX]. Buffers are only resized when the batch shape changes.
+        auto forward(const Number* X, size_t rows, size_t rsX, size_t csX) -> const Matrix&
+        {
+            const LinAlg::QuantParams first = m_params.front();
+            const size_t n = inputs();
+            for (size_t l = 0; l < m_layers.size(); ++l)
+                if (m_inputs[l].rows() != rows)
+                    m_inputs[l].resize(rows, m_layers[l].inputs());
+            if (m_output.rows() != rows || m_output.cols() != outputs())
+                m_output.resize(rows, outputs());
+            // Whole rows per quantize call; strided rows (e.g. a column-major batch) are gathered first.
+            uint8_t* quantized = m_inputs.front().data();
+            if (csX == 1 && rsX == n)
+                LinAlg::quantize(quantized, X, rows * n, first);
+            else if (csX == 1)
+                for (size_t i = 0; i < rows; ++i)
+                    LinAlg::quantize(quantized + i * n, X + i * rsX, n, first);
+            else
+            {
+                m_row.resize(n);
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    for (size_t f = 0; f < n; ++f)
+                        m_row[f] = X[i * rsX + f * csX];
+                    LinAlg::quantize(quantized + i * n, m_row.data(), n, first);
+                }
+            }
+            for (size_t l = 0; l < m_layers.size(); ++l)
+            {
+                const auto& layer = m_layers[l];
+                if (l + 1 == m_layers.size())
+                    layer.forward(m_inputs[l].data(), rows, m_params[l], m_output.data());
+                else
+                    layer.forward(m_inputs[l].data(), rows, m_params[l], m_inputs[l + 1].data(), m_params[l + 1]);
+            }
+            return m_output;
+        }
+        auto forward(LinAlg::MatrixView<const Number> input) -> const Matrix&
+        {
+            return forward(input.data(), input.rows(), input.rowStride(), input.colStride());
+        }
+        auto forward(const Matrix& input) -> const Matrix&
+        {
+            return forward(input.view());
+        }
+    private:
+        std::vector<QuantizedDense<Number>> m_layers;
+        std::vector<LinAlg::QuantParams> m_params;
+        // uint8 input of every layer. One each rather than two ping-pong buffers, whose shape would
+        // change (and be zero-filled) from layer to layer on every call.
+        std::vector<LinAlg::MatrixX<uint8_t>> m_inputs;
+        std::vector<Number> m_row;  // gathered row of a strided input
+        Matrix m_output;
+    };
+}
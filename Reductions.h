@@ -0,0 +1,573 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Profiling.h"
+#include <array>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+namespace LinAlg
+{
+    // Reductions over contiguous elements: sum, dot, norms, min / max and where they are.
+    // A sum never runs one accumulator down the whole input (rounding error growing with n):
+    //   Pairwise : blocks of PAIRWISE_BLOCK elements go into the SIMD lanes (four registers, a few
+    //              elements per lane) and the block sums are added in a balanced tree, so the
+    //              error grows with log(n) instead of n. As fast as the naive loop.
+    //   Kahan    : every lane also carries the low bits its additions lost (compensated
+    //              summation), so the error does not grow with n at all; about twice the adds.
+    // Partial results are (sum, compensation) pairs joined with an exact TwoSum, so joining blocks
+    // and threads loses nothing on top of that.
+    // Threads: by default every thread of the policy reduces one contiguous range and the ranges
+    // are joined in order, so the last bits depend on the thread count. With
+    // Reduction::reproducible the input is cut at fixed positions (REPRODUCIBLE_CHUNK elements)
+    // and the chunks are joined in the very tree one thread builds over the blocks: the same bits
+    // for any Parallel::threads, at no extra cost. (The lane count is part of the order too, so
+    // runs compare bit for bit under one instruction set, see Simd::setActiveIsa.)
+    // Sums accumulate in ComputeType (float for the 16-bit types); integers sum exactly in 64 bits.
+    enum class Summation : uint8_t
+    {
+        Pairwise,
+        Kahan
+    };
+
+    struct Reduction
+    {
+        Summation summation = Summation::Pairwise;
+        bool reproducible = false;
+    };
+
+    // Type the sums are returned in: 64-bit for integers (int8 sums do not wrap), ComputeType otherwise.
+    template<Numeric T>
+    using ReduceType = std::conditional_t<std::is_integral_v<T>,
+                                          std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>,
+                                          ComputeType<T>>;
+    // Norms of integer data are irrational: double.
+    template<Numeric T>
+    using NormType = std::conditional_t<std::is_integral_v<T>, double, ComputeType<T>>;
+
+    namespace detail
+    {
+        inline constexpr size_t PAIRWISE_BLOCK = 1024;
+        inline constexpr size_t KAHAN_BLOCK = 4096;
+        // A power-of-two number of blocks of either kind: every chunk is one complete subtree of
+        // the pairwise tree, which is what makes chunked and single-pass sums identical.
+        inline constexpr size_t REPRODUCIBLE_CHUNK = size_t{1} << 15;
+
+        template<typename F>
+        struct SumPartial
+        {
+            F sum{};
+            F compensation{};   // what the roundings of 'sum' lost
+            [[nodiscard]] constexpr F value() const noexcept { return sum + compensation; }
+        };
+
+        // Knuth's TwoSum: returns s = fl(a + b) and sets error so that s + error == a + b exactly.
+        // Works on whole registers as well.
+        template<typename A>
+        [[gnu::always_inline]] constexpr A twoSum(A a, A b, A& error) noexcept
+        {
+            const A s = a + b;
+            const A bPart = s - a;
+            error = (a - (s - bPart)) + (b - bPart);
+            return s;
+        }
+        template<typename F>
+        [[nodiscard]] constexpr SumPartial<F> joinPartials(SumPartial<F> a, SumPartial<F> b) noexcept
+        {
+            if constexpr (std::is_integral_v<F>)
+                return {a.sum + b.sum, F{}};
+            else
+            {
+                F error{};
+                const F s = twoSum(a.sum, b.sum, error);
+                return {s, (a.compensation + b.compensation) + error};
+            }
+        }
+
+        // Joins partials in a balanced tree as they arrive: pushing the k-th one merges it with
+        // the top of the stack once per trailing one bit of k (the carries of a binary counter),
+        // so the stack holds at most log2(count) entries and the tree only depends on the count.
+        // result() joins what is left from the top down.
+        template<typename F>
+        class PairwiseSum
+        {
+        public:
+            constexpr void push(SumPartial<F> partial) noexcept
+            {
+                for (size_t k = m_count++; k & 1; k >>= 1)
+                    partial = joinPartials(m_stack[--m_depth], partial);
+                m_stack[m_depth++] = partial;
+            }
+            [[nodiscard]] constexpr SumPartial<F> result() const noexcept
+            {
+                if (m_depth == 0)
+                    return {};
+                SumPartial<F> total = m_stack[m_depth - 1];
+                for (size_t i = m_depth - 1; i-- > 0;)
+                    total = joinPartials(m_stack[i], total);
+                return total;
+            }
+        private:
+            std::array<SumPartial<F>, 64> m_stack{};
+            size_t m_depth = 0;
+            size_t m_count = 0;
+        };
+
+        // sum += term (Kahan: compensation keeps the negated low part the add dropped).
+        template<bool Kahan, typename A>
+        [[gnu::always_inline]] constexpr void accumulate(A& sum, A& compensation, A term) noexcept
+        {
+            if constexpr (Kahan)
+            {
+                const A y = term - compensation;
+                const A t = sum + y;
+                compensation = (t - sum) - y;
+                sum = t;
+            }
+            else
+                sum += term;
+        }
+
+        // What is summed per element. Like the Simd ops, one body serves a lane and a register.
+        struct SumTerm
+        {
+            static constexpr const char* NAME = "LinAlg::sum";
+            static constexpr size_t FLOPS = 1;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a) const noexcept { return a; }
+        };
+        struct AbsTerm
+        {
+            static constexpr const char* NAME = "LinAlg::norm1";
+            static constexpr size_t FLOPS = 2;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a) const noexcept
+            {
+                if constexpr (std::is_unsigned_v<A>)
+                    return a;
+                else
+                    return a < A{} ? -a : a;
+            }
+        };
+        struct SquareTerm
+        {
+            static constexpr const char* NAME = "LinAlg::squaredNorm";
+            static constexpr size_t FLOPS = 2;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a) const noexcept { return a * a; }
+        };
+        struct ProductTerm
+        {
+            static constexpr const char* NAME = "LinAlg::dot";
+            static constexpr size_t FLOPS = 2;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a, A b) const noexcept { return a * b; }
+        };
+
+        // Joins the lanes of an accumulator in a fixed tree (lanes is a power of two).
+        template<bool Kahan, typename F>
+        constexpr SumPartial<F> joinLanes(SumPartial<F>* lane, size_t lanes) noexcept
+        {
+            for (size_t width = lanes / 2; width > 0; width /= 2)
+                for (size_t l = 0; l < width; ++l)
+                {
+                    if constexpr (Kahan)
+                        lane[l] = joinPartials(lane[l], lane[l + width]);
+                    else
+                        lane[l].sum += lane[l + width].sum;
+                }
+            return lane[0];
+        }
+
+        // The portable block: eight scalar lanes, so no lane runs down a whole block either.
+        template<bool Kahan, typename F, typename Term, typename T, typename... Src>
+        constexpr SumPartial<F> blockSumScalar(size_t n, const Term& term, const T* x, const Src*... rest) noexcept
+        {
+            constexpr size_t LANES = 8;
+            F sums[LANES]{};
+            F compensations[LANES]{};
+            size_t i = 0;
+            for (; i + LANES <= n; i += LANES)
+                for (size_t l = 0; l < LANES; ++l)
+                    accumulate<Kahan>(sums[l], compensations[l], term(static_cast<F>(x[i + l]), static_cast<F>(rest[i + l])...));
+            F tail{};
+            F tailCompensation{};
+            for (; i < n; ++i)
+                accumulate<Kahan>(tail, tailCompensation, term(static_cast<F>(x[i]), static_cast<F>(rest[i])...));
+            SumPartial<F> lane[LANES];
+            for (size_t l = 0; l < LANES; ++l)
+                lane[l] = {sums[l], -compensations[l]};
+            return joinPartials(joinLanes<Kahan>(lane, LANES), SumPartial<F>{tail, -tailCompensation});
+        }
+
+#if LINALG_SIMD_X86
+        // One block: four registers of independent add chains, joined lane-wise, then the lanes
+        // in a fixed tree, then the tail (less than four registers) through the portable block.
+        template<size_t Bytes, bool Kahan, typename Term, typename T, typename... Src>
+        [[gnu::always_inline]] inline SumPartial<T> blockSumLoop(size_t n, const Term& term, const T* x, const Src*... rest) noexcept
+        {
+            using V = typename Simd::detail::VecOf<T, Bytes>::type;
+            using U = typename Simd::detail::VecOf<T, Bytes>::unaligned;
+            constexpr size_t lanes = Bytes / sizeof(T);
+            V s0{}, s1{}, s2{}, s3{};
+            V c0{}, c1{}, c2{}, c3{};
+            size_t i = 0;
+            for (; i + 4 * lanes <= n; i += 4 * lanes)
+            {
+                accumulate<Kahan>(s0, c0, term(V(*reinterpret_cast<const U*>(x + i)), V(*reinterpret_cast<const U*>(rest + i))...));
+                accumulate<Kahan>(s1, c1, term(V(*reinterpret_cast<const U*>(x + i + lanes)),
+                                               V(*reinterpret_cast<const U*>(rest + i + lanes))...));
+                accumulate<Kahan>(s2, c2, term(V(*reinterpret_cast<const U*>(x + i + 2 * lanes)),
+                                               V(*reinterpret_cast<const U*>(rest + i + 2 * lanes))...));
+                accumulate<Kahan>(s3, c3, term(V(*reinterpret_cast<const U*>(x + i + 3 * lanes)),
+                                               V(*reinterpret_cast<const U*>(rest + i + 3 * lanes))...));
+            }
+            V sums, compensations{};
+            if constexpr (Kahan)
+            {
+                V e01, e23, e;
+                const V s01 = twoSum(s0, s1, e01);
+                const V s23 = twoSum(s2, s3, e23);
+                sums = twoSum(s01, s23, e);
+                compensations = (e01 + e23 + e) - ((c0 + c1) + (c2 + c3));
+            }
+            else
+                sums = (s0 + s1) + (s2 + s3);
+
+            SumPartial<T> lane[lanes];
+            for (size_t l = 0; l < lanes; ++l)
+                lane[l] = {sums[l], compensations[l]};
+            return joinPartials(joinLanes<Kahan>(lane, lanes), blockSumScalar<Kahan, T>(n - i, term, x + i, (rest + i)...));
+        }
+
+        template<bool Kahan, typename Term, typename T, typename... Src>
+        LINALG_TARGET_AVX512 SumPartial<T> blockSumAvx512(size_t n, Term term, const T* x, const Src*... rest) noexcept
+        {
+            return blockSumLoop<64, Kahan>(n, term, x, rest...);
+        }
+        template<bool Kahan, typename Term, typename T, typename... Src>
+        LINALG_TARGET_AVX2 SumPartial<T> blockSumAvx2(size_t n, Term term, const T* x, const Src*... rest) noexcept
+        {
+            return blockSumLoop<32, Kahan>(n, term, x, rest...);
+        }
+        template<bool Kahan, typename Term, typename T, typename... Src>
+        LINALG_TARGET_SSE41 SumPartial<T> blockSumSse41(size_t n, Term term, const T* x, const Src*... rest) noexcept
+        {
+            return blockSumLoop<16, Kahan>(n, term, x, rest...);
+        }
+#endif
+
+        // float / double block on the widest instruction set.
+        template<bool Kahan, typename Term, typename T, typename... Src>
+        SumPartial<T> blockSum(size_t n, const Term& term, const T* x, const Src*... rest) noexcept
+        {
+#if LINALG_SIMD_X86
+            switch (Simd::activeIsa())
+            {
+                case Simd::Isa::AVX512: return blockSumAvx512<Kahan>(n, term, x, rest...);
+                case Simd::Isa::AVX2:   return blockSumAvx2<Kahan>(n, term, x, rest...);
+                case Simd::Isa::SSE41:  return blockSumSse41<Kahan>(n, term, x, rest...);
+                case Simd::Isa::Scalar: break;
+            }
+#endif
+            return blockSumScalar<Kahan, T>(n, term, x, rest...);
+        }
+
+        // Sum of term(x[i], rest[i]...) over one contiguous range: its blocks joined pairwise.
+        // 16-bit operands are widened one block at a time and summed by the float kernel.
+        template<typename Term, typename T, typename... Src>
+        constexpr SumPartial<ReduceType<T>> rangeSum(size_t n, Summation summation, const Term& term,
+                                                    const T* x, const Src*... rest) noexcept
+        {
+            using R = ReduceType<T>;
+            if constexpr (std::is_integral_v<T>)
+            {
+                R total{};
+                for (size_t i = 0; i < n; ++i)
+                    total += term(static_cast<R>(x[i]), static_cast<R>(rest[i])...);
+                return {total, R{}};
+            }
+            else
+            {
+                const bool kahan = summation == Summation::Kahan;
+                const size_t block = kahan ? KAHAN_BLOCK : PAIRWISE_BLOCK;
+                PairwiseSum<R> total;
+                for (size_t i = 0; i < n; i += block)
+                {
+                    const size_t m = std::min(block, n - i);
+                    if consteval
+                    {
+                        total.push(kahan ? blockSumScalar<true, R>(m, term, x + i, (rest + i)...)
+                                         : blockSumScalar<false, R>(m, term, x + i, (rest + i)...));
+                    }
+                    else
+                    {
+                        if constexpr (ReducedFloat<T>)
+                        {
+                            alignas(64) R wide[1 + sizeof...(Src)][KAHAN_BLOCK];
+                            [&]<size_t... s>(std::index_sequence<s...>)
+                            {
+                                Simd::widen(wide[0], x + i, m);
+                                (Simd::widen(wide[s + 1], rest + i, m), ...);
+                                total.push(kahan ? blockSum<true>(m, term, static_cast<const R*>(wide[0]), static_cast<const R*>(wide[s + 1])...)
+                                                 : blockSum<false>(m, term, static_cast<const R*>(wide[0]), static_cast<const R*>(wide[s + 1])...));
+                            }(std::index_sequence_for<Src...>{});
+                        }
+                        else
+                            total.push(kahan ? blockSum<true>(m, term, x + i, (rest + i)...)
+                                             : blockSum<false>(m, term, x + i, (rest + i)...));
+                    }
+                }
+                return total.result();
+            }
+        }
+
+        template<typename Term, typename T, typename... Src>
+        constexpr ReduceType<T> reduceSum(size_t n, const Reduction& mode, const Parallel& policy, const Term& term,
+                                          const T* x, const Src*... rest)
+        {
+            using R = ReduceType<T>;
+            if consteval
+            {
+                return rangeSum(n, mode.summation, term, x, rest...).value();
+            }
+            else
+            {
+                LINALG_PROFILE_KERNEL(Term::NAME, (sizeof...(Src) + 1) * n * sizeof(T), Term::FLOPS * n);
+                const auto range = [&](size_t begin, size_t end)
+                {
+                    return rangeSum(end - begin, mode.summation, term, x + begin, (rest + begin)...);
+                };
+                if (!mode.reproducible)
+                    return parallelReduce(n, SumPartial<R>{}, policy, range, joinPartials<R>).value();
+
+                const size_t chunks = (n + REPRODUCIBLE_CHUNK - 1) / REPRODUCIBLE_CHUNK;
+                if (chunks <= 1)
+                    return range(0, n).value();
+                const ScratchLease<SumPartial<R>> partial(chunks);
+                parallelFor(chunks, policy, [&](size_t first, size_t last)
+                {
+                    for (size_t c = first; c < last; ++c)
+                        partial[c] = range(c * REPRODUCIBLE_CHUNK, std::min(n, (c + 1) * REPRODUCIBLE_CHUNK));
+                }, n);
+                PairwiseSum<R> total;
+                for (size_t c = 0; c < chunks; ++c)
+                    total.push(partial[c]);
+                return total.result().value();
+            }
+        }
+
+        // Min / max skip NaNs (a comparison with NaN is false, so it never replaces the best).
+        template<bool Max, typename A>
+        [[gnu::always_inline]] constexpr A better(A candidate, A best) noexcept
+        {
+            if constexpr (Max)
+                return candidate > best ? candidate : best;
+            else
+                return candidate < best ? candidate : best;
+        }
+        // Identity of min / max over T's values: what an empty (or all-NaN) range gives.
+        template<bool Max, typename T>
+        constexpr ReduceType<T> extremeIdentity() noexcept
+        {
+            using R = ReduceType<T>;
+            if constexpr (std::is_integral_v<T>)
+                return static_cast<R>(Max ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max());
+            else
+                return Max ? -std::numeric_limits<R>::infinity() : std::numeric_limits<R>::infinity();
+        }
+
+        template<bool Max, typename Term, typename T>
+        constexpr T extremeScalar(size_t n, const Term& term, const T* x, T best) noexcept
+        {
+            for (size_t i = 0; i < n; ++i)
+                best = better<Max>(term(static_cast<T>(x[i])), best);
+            return best;
+        }
+#if LINALG_SIMD_X86
+        template<size_t Bytes, bool Max, typename Term, typename T>
+        [[gnu::always_inline]] inline T extremeLoop(size_t n, const Term& term, const T* x, T best) noexcept
+        {
+            using V = typename Simd::detail::VecOf<T, Bytes>::type;
+            using U = typename Simd::detail::VecOf<T, Bytes>::unaligned;
+            constexpr size_t lanes = Bytes / sizeof(T);
+            V b0 = V{} + best;
+            V b1 = b0;
+            size_t i = 0;
+            for (; i + 2 * lanes <= n; i += 2 * lanes)
+            {
+                b0 = better<Max>(term(V(*reinterpret_cast<const U*>(x + i))), b0);
+                b1 = better<Max>(term(V(*reinterpret_cast<const U*>(x + i + lanes))), b1);
+            }
+            b0 = better<Max>(b1, b0);
+            for (size_t l = 0; l < lanes; ++l)
+                best = better<Max>(b0[l], best);
+            return extremeScalar<Max>(n - i, term, x + i, best);
+        }
+        template<bool Max, typename Term, typename T>
+        LINALG_TARGET_AVX512 T extremeAvx512(size_t n, Term term, const T* x, T best) noexcept
+        {
+            return extremeLoop<64, Max>(n, term, x, best);
+        }
+        template<bool Max, typename Term, typename T>
+        LINALG_TARGET_AVX2 T extremeAvx2(size_t n, Term term, const T* x, T best) noexcept
+        {
+            return extremeLoop<32, Max>(n, term, x, best);
+        }
+        template<bool Max, typename Term, typename T>
+        LINALG_TARGET_SSE41 T extremeSse41(size_t n, Term term, const T* x, T best) noexcept
+        {
+            return extremeLoop<16, Max>(n, term, x, best);
+        }
+#endif
+        template<bool Max, typename Term, typename T>
+        T extremeRuntime(size_t n, const Term& term, const T* x, T best) noexcept
+        {
+#if LINALG_SIMD_X86
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                switch (Simd::activeIsa())
+                {
+                    case Simd::Isa::AVX512: return extremeAvx512<Max>(n, term, x, best);
+                    case Simd::Isa::AVX2:   return extremeAvx2<Max>(n, term, x, best);
+                    case Simd::Isa::SSE41:  return extremeSse41<Max>(n, term, x, best);
+                    case Simd::Isa::Scalar: break;
+                }
+            }
+#endif
+            return extremeScalar<Max>(n, term, x, best);
+        }
+
+        // max / min of term(x[i]) in ReduceType. Order does not matter here, so plain ranges.
+        template<bool Max, typename Term, typename T>
+        constexpr ReduceType<T> reduceExtreme(size_t n, const Parallel& policy, const Term& term, const T* x)
+        {
+            using R = ReduceType<T>;
+            const R identity = extremeIdentity<Max, T>();
+            const auto range = [&](size_t begin, size_t end)
+            {
+                if constexpr (std::is_integral_v<T>)
+                {
+                    R best = identity;
+                    for (size_t i = begin; i < end; ++i)
+                        best = better<Max>(term(static_cast<R>(x[i])), best);
+                    return best;
+                }
+                else if constexpr (ReducedFloat<T>)
+                {
+                    alignas(64) R wide[Simd::detail::WIDEN_BLOCK];
+                    R best = identity;
+                    for (size_t i = begin; i < end; i += Simd::detail::WIDEN_BLOCK)
+                    {
+                        const size_t m = std::min(Simd::detail::WIDEN_BLOCK, end - i);
+                        Simd::widen(wide, x + i, m);
+                        best = extremeRuntime<Max>(m, term, static_cast<const R*>(wide), best);
+                    }
+                    return best;
+                }
+                else
+                    return extremeRuntime<Max>(end - begin, term, x + begin, identity);
+            };
+            if consteval
+            {
+                R best = identity;
+                for (size_t i = 0; i < n; ++i)
+                    best = better<Max>(term(static_cast<R>(x[i])), best);
+                return best;
+            }
+            else
+            {
+                LINALG_PROFILE_KERNEL(Max ? "LinAlg::max" : "LinAlg::min", n * sizeof(T), n);
+                return parallelReduce(n, identity, policy, range, [](R a, R b) { return better<Max>(b, a); });
+            }
+        }
+
+        // First position holding 'value' (n when none does): every range finds its first match
+        // and the lowest one wins, so ties always resolve to the first occurrence.
+        template<typename T>
+        constexpr size_t findFirst(const T* x, size_t n, ReduceType<T> value, const Parallel& policy)
+        {
+            const auto range = [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                    if (static_cast<ReduceType<T>>(x[i]) == value)
+                        return i;
+                return n;
+            };
+            if consteval
+            {
+                return range(0, n);
+            }
+            else
+            {
+                return parallelReduce(n, n, policy, range, [](size_t a, size_t b) { return std::min(a, b); });
+            }
+        }
+    }
+
+    // sum_i x[i]
+    template<Numeric T>
+    constexpr ReduceType<T> sum(const T* x, size_t n, Reduction mode = {}, const Parallel& policy = Parallel::current())
+    {
+        return detail::reduceSum(n, mode, policy, detail::SumTerm{}, x);
+    }
+    // sum_i x[i] * y[i]
+    template<Numeric T>
+    constexpr ReduceType<T> dot(const T* x, const T* y, size_t n, Reduction mode = {}, const Parallel& policy = Parallel::current())
+    {
+        return detail::reduceSum(n, mode, policy, detail::ProductTerm{}, x, y);
+    }
+    // sum_i x[i]^2
+    template<Numeric T>
+    constexpr ReduceType<T> squaredNorm(const T* x, size_t n, Reduction mode = {}, const Parallel& policy = Parallel::current())
+    {
+        return detail::reduceSum(n, mode, policy, detail::SquareTerm{}, x);
+    }
+    // sqrt(sum_i x[i]^2)  (Euclidean / Frobenius)
+    template<Numeric T>
+    constexpr NormType<T> norm(const T* x, size_t n, Reduction mode = {}, const Parallel& policy = Parallel::current())
+    {
+        return std::sqrt(static_cast<NormType<T>>(squaredNorm(x, n, mode, policy)));
+    }
+    // sum_i |x[i]|
+    template<Numeric T>
+    constexpr ReduceType<T> norm1(const T* x, size_t n, Reduction mode = {}, const Parallel& policy = Parallel::current())
+    {
+        return detail::reduceSum(n, mode, policy, detail::AbsTerm{}, x);
+    }
+    // max_i |x[i]|  (0 for an empty range)
+    template<Numeric T>
+    constexpr ReduceType<T> normInf(const T* x, size_t n, const Parallel& policy = Parallel::current())
+    {
+        return n == 0 ? ReduceType<T>{} : detail::reduceExtreme<true>(n, policy, detail::AbsTerm{}, x);
+    }
+
+    // Smallest / largest element, NaNs skipped. An empty range gives the identity (+inf / -inf,
+    // max() / lowest() for integers).
+    template<Numeric T>
+    constexpr T minValue(const T* x, size_t n, const Parallel& policy = Parallel::current())
+    {
+        return static_cast<T>(detail::reduceExtreme<false>(n, policy, detail::SumTerm{}, x));
+    }
+    template<Numeric T>
+    constexpr T maxValue(const T* x, size_t n, const Parallel& policy = Parallel::current())
+    {
+        return static_cast<T>(detail::reduceExtreme<true>(n, policy, detail::SumTerm{}, x));
+    }
+    // Index of the first smallest / largest element; n when the range is empty or all NaN.
+    template<Numeric T>
+    constexpr size_t argmin(const T* x, size_t n, const Parallel& policy = Parallel::current())
+    {
+        return detail::findFirst(x, n, detail::reduceExtreme<false>(n, policy, detail::SumTerm{}, x), policy);
+    }
+    template<Numeric T>
+    constexpr size_t argmax(const T* x, size_t n, const Parallel& policy = Parallel::current())
+    {
+        return detail::findFirst(x, n, detail::reduceExtreme<true>(n, policy, detail::SumTerm{}, x), policy);
+    }
+}
@@ -0,0 +1,707 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "Profiling.h"
+#include "HalfPrecision.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <utility>
+#include <concepts>
+#include <type_traits>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define LINALG_SIMD_X86 1
+#else
+#define LINALG_SIMD_X86 0
+#endif
+
+#if LINALG_SIMD_X86
+#define LINALG_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,fma")))
+#define LINALG_TARGET_AVX2   __attribute__((target("avx2,fma,f16c")))
+#define LINALG_TARGET_SSE41  __attribute__((target("sse4.1")))
+#endif
+namespace LinAlg::Simd
+{
+    // Element-wise kernel layer used by every container operator.
+    // Each kernel exists once per instruction set and the widest one the CPU supports is picked
+    // at runtime (detected once), so one binary runs on any x86-64 and still uses AVX-512 where
+    // it exists:
+    //   AVX512 -> 64-byte registers, AVX2 -> 32 bytes, SSE41 -> 16 bytes, Scalar -> plain loop.
+    // The loop bodies are written once with GCC/Clang vector extensions and instantiated inside
+    // functions carrying the matching 'target' attribute; what does not fill a whole register
+    // (the tail) is finished by the scalar loop.
+    // In constant evaluation every kernel falls back to the scalar loop, so constexpr
+    // operators on Vector / Matrix keep working.
+    // 16-bit floats (HalfPrecision.h) run the float kernels on blocks widened with widen() and
+    // narrow() the results; the AVX2 level therefore also requires F16C (every AVX2 CPU has it).
+    enum class Isa : uint8_t
+    {
+        Scalar,
+        SSE41,
+        AVX2,
+        AVX512
+    };
+
+    inline Isa detectIsa() noexcept
+    {
+#if LINALG_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl"))
+            return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c"))
+            return Isa::AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return Isa::SSE41;
+#endif
+        return Isa::Scalar;
+    }
+
+    namespace detail
+    {
+        inline std::atomic<Isa>& isaSlot() noexcept
+        {
+            static std::atomic<Isa> isa{detectIsa()};
+            return isa;
+        }
+    }
+    inline Isa activeIsa() noexcept
+    {
+        return detail::isaSlot().load(std::memory_order_relaxed);
+    }
+    // Lets benchmarks compare paths. Requests wider than the CPU supports are clamped.
+    inline void setActiveIsa(Isa isa) noexcept
+    {
+        detail::isaSlot().store(isa < detectIsa() ? isa : detectIsa(), std::memory_order_relaxed);
+    }
+
+    // bool / long double / anything exotic have no vector lanes -> scalar path only.
+    template<typename T>
+    concept SimdElement = (std::is_integral_v<T> && !std::same_as<T, bool>) ||
+                          std::same_as<T, float> || std::same_as<T, double>;
+
+    namespace detail
+    {
+        // Operations, written so that the same body works on one element (tail) and on a
+        // whole register. Scalars are broadcast by the vector extension automatically.
+        // NAME and FLOPS (per element) label the kernel in the profiler counters (Profiling.h).
+        struct AddOp
+        {
+            static constexpr const char* NAME = "Simd::add";
+            static constexpr size_t FLOPS = 1;
+            template<typename A, typename B>
+            [[gnu::always_inline]] constexpr A operator()(A a, B b) const noexcept { return a + b; }
+        };
+        struct SubOp
+        {
+            static constexpr const char* NAME = "Simd::sub";
+            static constexpr size_t FLOPS = 1;
+            template<typename A, typename B>
+            [[gnu::always_inline]] constexpr A operator()(A a, B b) const noexcept { return a - b; }
+        };
+        struct MulOp
+        {
+            static constexpr const char* NAME = "Simd::mul";
+            static constexpr size_t FLOPS = 1;
+            template<typename A, typename B>
+            [[gnu::always_inline]] constexpr A operator()(A a, B b) const noexcept { return a * b; }
+        };
+        template<typename T>
+        struct AddScalarOp
+        {
+            static constexpr const char* NAME = "Simd::addScalar";
+            static constexpr size_t FLOPS = 1;
+            T scalar;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a) const noexcept { return a + scalar; }
+        };
+        template<typename T>
+        struct SubScalarOp
+        {
+            static constexpr const char* NAME = "Simd::subScalar";
+            static constexpr size_t FLOPS = 1;
+            T scalar;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a) const noexcept { return a - scalar; }
+        };
+        template<typename T>
+        struct MulScalarOp
+        {
+            static constexpr const char* NAME = "Simd::mulScalar";
+            static constexpr size_t FLOPS = 1;
+            T scalar;
+            template<typename A>
+            [[gnu::always_inline]] constexpr A operator()(A a) const noexcept { return a * scalar; }
+        };
+        // a * b + c. Inside the AVX2 / AVX-512 targets floating point contracts into a single
+        // vfmadd (GNU mode compiles with -ffp-contract=fast, clang contracts within an expression).
+        struct FmaOp
+        {
+            static constexpr const char* NAME = "Simd::fma";
+            static constexpr size_t FLOPS = 2;
+            template<typename A, typename B, typename C>
+            [[gnu::always_inline]] constexpr A operator()(A a, B b, C c) const noexcept { return a * b + c; }
+        };
+        // a * scalar + b  (axpy)
+        template<typename T>
+        struct FmaScalarOp
+        {
+            static constexpr const char* NAME = "Simd::axpy";
+            static constexpr size_t FLOPS = 2;
+            T scalar;
+            template<typename A, typename B>
+            [[gnu::always_inline]] constexpr A operator()(A a, B b) const noexcept { return a * scalar + b; }
+        };
+
+        template<typename Op, typename T, typename... Src>
+        constexpr void mapScalar(T* dst, size_t n, const Op& op, const Src*... src) noexcept
+        {
+            for (size_t i = 0; i < n; ++i)
+                dst[i] = static_cast<T>(op(src[i]...));
+        }
+
+        // Square root of every lane, for op bodies that need one (the vector extensions have no sqrt).
+        template<std::floating_point T>
+        [[gnu::always_inline]] inline T sqrtLanes(T x) noexcept { return std::sqrt(x); }
+
+#if LINALG_SIMD_X86
+        template<typename T, size_t Bytes>
+        struct VecOf
+        {
+            typedef T type __attribute__((vector_size(Bytes)));
+            // Same register, but only element-aligned and allowed to alias T: what an unaligned
+            // load/store through a T* needs.
+            typedef T unaligned __attribute__((vector_size(Bytes), aligned(alignof(T)), may_alias));
+        };
+
+        // The register versions wrap the intrinsics, so they carry the target attribute and are
+        // plain inline: the always_inline op calling them is first inlined into the mapAvx2-style
+        // function of the same target, where the optimizer then inlines these (an always_inline
+        // body without the attribute may not contain AVX instructions itself).
+        // (The AVX-512 ones are the zero-masked form with every lane selected: _mm512_sqrt_* passes an
+        // undefined register that GCC 12 reports as maybe-uninitialized.)
+        LINALG_TARGET_AVX512 inline VecOf<float, 64>::type sqrtLanes(VecOf<float, 64>::type v) noexcept { return _mm512_maskz_sqrt_ps(0xFFFF, v); }
+        LINALG_TARGET_AVX512 inline VecOf<double, 64>::type sqrtLanes(VecOf<double, 64>::type v) noexcept { return _mm512_maskz_sqrt_pd(0xFF, v); }
+        LINALG_TARGET_AVX2 inline VecOf<float, 32>::type sqrtLanes(VecOf<float, 32>::type v) noexcept { return _mm256_sqrt_ps(v); }
+        LINALG_TARGET_AVX2 inline VecOf<double, 32>::type sqrtLanes(VecOf<double, 32>::type v) noexcept { return _mm256_sqrt_pd(v); }
+        LINALG_TARGET_SSE41 inline VecOf<float, 16>::type sqrtLanes(VecOf<float, 16>::type v) noexcept { return _mm_sqrt_ps(v); }
+        LINALG_TARGET_SSE41 inline VecOf<double, 16>::type sqrtLanes(VecOf<double, 16>::type v) noexcept { return _mm_sqrt_pd(v); }
+
+        // Two registers per iteration hide the latency of dependent adds/multiplies.
+        template<size_t Bytes, typename Op, typename T, typename... Src>
+        [[gnu::always_inline]] inline void mapLoop(T* dst, size_t n, const Op& op, const Src*... src) noexcept
+        {
+            using V = typename VecOf<T, Bytes>::type;
+            using U = typename VecOf<T, Bytes>::unaligned;
+            constexpr size_t lanes = Bytes / sizeof(T);
+            size_t i = 0;
+            for (; i + 2 * lanes <= n; i += 2 * lanes)
+            {
+                const V r0 = op(V(*reinterpret_cast<const U*>(src + i))...);
+                const V r1 = op(V(*reinterpret_cast<const U*>(src + i + lanes))...);
+                *reinterpret_cast<U*>(dst + i) = r0;
+                *reinterpret_cast<U*>(dst + i + lanes) = r1;
+            }
+            for (; i + lanes <= n; i += lanes)
+                *reinterpret_cast<U*>(dst + i) = op(V(*reinterpret_cast<const U*>(src + i))...);
+            mapScalar(dst + i, n - i, op, (src + i)...);
+        }
+
+        template<typename Op, typename T, typename... Src>
+        LINALG_TARGET_AVX512 void mapAvx512(T* dst, size_t n, Op op, const Src*... src) noexcept
+        {
+            mapLoop<64>(dst, n, op, src...);
+        }
+        template<typename Op, typename T, typename... Src>
+        LINALG_TARGET_AVX2 void mapAvx2(T* dst, size_t n, Op op, const Src*... src) noexcept
+        {
+            mapLoop<32>(dst, n, op, src...);
+        }
+        template<typename Op, typename T, typename... Src>
+        LINALG_TARGET_SSE41 void mapSse41(T* dst, size_t n, Op op, const Src*... src) noexcept
+        {
+            mapLoop<16>(dst, n, op, src...);
+        }
+
+        // Four dot products against the same x, so every x register is loaded once per four
+        // multiply-adds. Lanes are summed at the end (a different order than a sequential loop).
+        template<size_t Bytes, typename T>
+        [[gnu::always_inline]] inline void dot4Loop(const T* const* rows, const T* x, size_t n, T* out) noexcept
+        {
+            using V = typename VecOf<T, Bytes>::type;
+            using U = typename VecOf<T, Bytes>::unaligned;
+            constexpr size_t lanes = Bytes / sizeof(T);
+            V acc0{}, acc1{}, acc2{}, acc3{};
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes)
+            {
+                const V xv = *reinterpret_cast<const U*>(x + i);
+                acc0 += V(*reinterpret_cast<const U*>(rows[0] + i)) * xv;
+                acc1 += V(*reinterpret_cast<const U*>(rows[1] + i)) * xv;
+                acc2 += V(*reinterpret_cast<const U*>(rows[2] + i)) * xv;
+                acc3 += V(*reinterpret_cast<const U*>(rows[3] + i)) * xv;
+            }
+            const V acc[4]{acc0, acc1, acc2, acc3};
+            for (size_t r = 0; r < 4; ++r)
+            {
+                T sum{};
+                for (size_t l = 0; l < lanes; ++l)
+                    sum += acc[r][l];
+                for (size_t j = i; j < n; ++j)
+                    sum += rows[r][j] * x[j];
+                out[r] = sum;
+            }
+        }
+        template<typename T>
+        LINALG_TARGET_AVX512 void dot4Avx512(const T* const* rows, const T* x, size_t n, T* out) noexcept
+        {
+            dot4Loop<64>(rows, x, n, out);
+        }
+        template<typename T>
+        LINALG_TARGET_AVX2 void dot4Avx2(const T* const* rows, const T* x, size_t n, T* out) noexcept
+        {
+            dot4Loop<32>(rows, x, n, out);
+        }
+        template<typename T>
+        LINALG_TARGET_SSE41 void dot4Sse41(const T* const* rows, const T* x, size_t n, T* out) noexcept
+        {
+            dot4Loop<16>(rows, x, n, out);
+        }
+
+        // std::round semantics (halfway cases away from zero): trunc(x + copysign(0.5 - ulp, x)).
+        // Using the largest value below 0.5 keeps 0.49999997f from rounding up.
+        template<typename T>
+        inline constexpr T HALF_BELOW = std::same_as<T, float> ? T(0.49999997f) : T(0.49999999999999994);
+
+        template<typename T>
+        LINALG_TARGET_AVX512 void roundAvx512(T* dst, const T* src, T scale, size_t n) noexcept
+        {
+            size_t i = 0;
+            if constexpr (std::same_as<T, float>)
+            {
+                const __m512 vs = _mm512_set1_ps(scale), half = _mm512_set1_ps(HALF_BELOW<T>), sign = _mm512_set1_ps(-0.0f);
+                for (; i + 16 <= n; i += 16)
+                {
+                    const __m512 x = _mm512_mul_ps(_mm512_loadu_ps(src + i), vs);
+                    const __m512 bias = _mm512_or_ps(half, _mm512_and_ps(x, sign));
+                    const __m512 r = _mm512_roundscale_ps(_mm512_add_ps(x, bias), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    _mm512_storeu_ps(dst + i, _mm512_div_ps(r, vs));
+                }
+            }
+            else
+            {
+                const __m512d vs = _mm512_set1_pd(scale), half = _mm512_set1_pd(HALF_BELOW<T>), sign = _mm512_set1_pd(-0.0);
+                for (; i + 8 <= n; i += 8)
+                {
+                    const __m512d x = _mm512_mul_pd(_mm512_loadu_pd(src + i), vs);
+                    const __m512d bias = _mm512_or_pd(half, _mm512_and_pd(x, sign));
+                    const __m512d r = _mm512_roundscale_pd(_mm512_add_pd(x, bias), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    _mm512_storeu_pd(dst + i, _mm512_div_pd(r, vs));
+                }
+            }
+            for (; i < n; ++i)
+                dst[i] = std::round(src[i] * scale) / scale;
+        }
+        template<typename T>
+        LINALG_TARGET_AVX2 void roundAvx2(T* dst, const T* src, T scale, size_t n) noexcept
+        {
+            size_t i = 0;
+            if constexpr (std::same_as<T, float>)
+            {
+                const __m256 vs = _mm256_set1_ps(scale), half = _mm256_set1_ps(HALF_BELOW<T>), sign = _mm256_set1_ps(-0.0f);
+                for (; i + 8 <= n; i += 8)
+                {
+                    const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), vs);
+                    const __m256 bias = _mm256_or_ps(half, _mm256_and_ps(x, sign));
+                    const __m256 r = _mm256_round_ps(_mm256_add_ps(x, bias), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    _mm256_storeu_ps(dst + i, _mm256_div_ps(r, vs));
+                }
+            }
+            else
+            {
+                const __m256d vs = _mm256_set1_pd(scale), half = _mm256_set1_pd(HALF_BELOW<T>), sign = _mm256_set1_pd(-0.0);
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m256d x = _mm256_mul_pd(_mm256_loadu_pd(src + i), vs);
+                    const __m256d bias = _mm256_or_pd(half, _mm256_and_pd(x, sign));
+                    const __m256d r = _mm256_round_pd(_mm256_add_pd(x, bias), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    _mm256_storeu_pd(dst + i, _mm256_div_pd(r, vs));
+                }
+            }
+            for (; i < n; ++i)
+                dst[i] = std::round(src[i] * scale) / scale;
+        }
+        template<typename T>
+        LINALG_TARGET_SSE41 void roundSse41(T* dst, const T* src, T scale, size_t n) noexcept
+        {
+            size_t i = 0;
+            if constexpr (std::same_as<T, float>)
+            {
+                const __m128 vs = _mm_set1_ps(scale), half = _mm_set1_ps(HALF_BELOW<T>), sign = _mm_set1_ps(-0.0f);
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), vs);
+                    const __m128 bias = _mm_or_ps(half, _mm_and_ps(x, sign));
+                    const __m128 r = _mm_round_ps(_mm_add_ps(x, bias), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    _mm_storeu_ps(dst + i, _mm_div_ps(r, vs));
+                }
+            }
+            else
+            {
+                const __m128d vs = _mm_set1_pd(scale), half = _mm_set1_pd(HALF_BELOW<T>), sign = _mm_set1_pd(-0.0);
+                for (; i + 2 <= n; i += 2)
+                {
+                    const __m128d x = _mm_mul_pd(_mm_loadu_pd(src + i), vs);
+                    const __m128d bias = _mm_or_pd(half, _mm_and_pd(x, sign));
+                    const __m128d r = _mm_round_pd(_mm_add_pd(x, bias), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    _mm_storeu_pd(dst + i, _mm_div_pd(r, vs));
+                }
+            }
+            for (; i < n; ++i)
+                dst[i] = std::round(src[i] * scale) / scale;
+        }
+
+        // 16-bit <-> float conversions. binary16 uses the hardware conversions (F16C on AVX2,
+        // AVX-512F), bfloat16 is a shift one way and round-to-nearest-even on the integer bits the
+        // other way. NaNs stay NaNs (quieted).
+        template<HalfFormat format>
+        LINALG_TARGET_AVX512 void widenAvx512(float* dst, const uint16_t* src, size_t n) noexcept
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+                if constexpr (format == HalfFormat::Binary16)
+                    _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(h));
+                else
+                    _mm512_storeu_si512(dst + i, _mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+            }
+            for (; i < n; ++i)
+                dst[i] = format == HalfFormat::Binary16 ? LinAlg::detail::binary16ToFloat(src[i]) : LinAlg::detail::bfloat16ToFloat(src[i]);
+        }
+        template<HalfFormat format>
+        LINALG_TARGET_AVX512 void narrowAvx512(uint16_t* dst, const float* src, size_t n) noexcept
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                const __m512 x = _mm512_loadu_ps(src + i);
+                __m256i h;
+                if constexpr (format == HalfFormat::Binary16)
+                    h = _mm512_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                else
+                {
+                    const __m512i bits = _mm512_castps_si512(x);
+                    const __m512i odd = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+                    __m512i rounded = _mm512_add_epi32(bits, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7FFF)));
+                    const __mmask16 nan = _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q);
+                    rounded = _mm512_mask_mov_epi32(rounded, nan, _mm512_or_si512(bits, _mm512_set1_epi32(0x00400000)));
+                    h = _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), h);
+            }
+            for (; i < n; ++i)
+                dst[i] = format == HalfFormat::Binary16 ? LinAlg::detail::floatToBinary16(src[i]) : LinAlg::detail::floatToBFloat16(src[i]);
+        }
+        template<HalfFormat format>
+        LINALG_TARGET_AVX2 void widenAvx2(float* dst, const uint16_t* src, size_t n) noexcept
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                if constexpr (format == HalfFormat::Binary16)
+                    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+                else
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+            }
+            for (; i < n; ++i)
+                dst[i] = format == HalfFormat::Binary16 ? LinAlg::detail::binary16ToFloat(src[i]) : LinAlg::detail::bfloat16ToFloat(src[i]);
+        }
+        template<HalfFormat format>
+        LINALG_TARGET_AVX2 void narrowAvx2(uint16_t* dst, const float* src, size_t n) noexcept
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m256 x = _mm256_loadu_ps(src + i);
+                __m128i h;
+                if constexpr (format == HalfFormat::Binary16)
+                    h = _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                else
+                {
+                    const __m256i bits = _mm256_castps_si256(x);
+                    const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+                    const __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF)));
+                    const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+                    const __m256i quiet = _mm256_or_si256(bits, _mm256_set1_epi32(0x00400000));
+                    const __m256i high = _mm256_srli_epi32(_mm256_blendv_epi8(rounded, quiet, nan), 16);
+                    // packus works per 128-bit lane: gather the two packed quarters into the low half.
+                    h = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(high, high), 0x08));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+            }
+            for (; i < n; ++i)
+                dst[i] = format == HalfFormat::Binary16 ? LinAlg::detail::floatToBinary16(src[i]) : LinAlg::detail::floatToBFloat16(src[i]);
+        }
+        // No F16C below AVX2: binary16 stays on the scalar conversion there.
+        template<HalfFormat format>
+        LINALG_TARGET_SSE41 void widenSse41(float* dst, const uint16_t* src, size_t n) noexcept
+        {
+            size_t i = 0;
+            if constexpr (format == HalfFormat::BFloat16)
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_slli_epi32(_mm_cvtepu16_epi32(h), 16));
+                }
+            for (; i < n; ++i)
+                dst[i] = format == HalfFormat::Binary16 ? LinAlg::detail::binary16ToFloat(src[i]) : LinAlg::detail::bfloat16ToFloat(src[i]);
+        }
+        template<HalfFormat format>
+        LINALG_TARGET_SSE41 void narrowSse41(uint16_t* dst, const float* src, size_t n) noexcept
+        {
+            size_t i = 0;
+            if constexpr (format == HalfFormat::BFloat16)
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m128 x = _mm_loadu_ps(src + i);
+                    const __m128i bits = _mm_castps_si128(x);
+                    const __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+                    const __m128i rounded = _mm_add_epi32(bits, _mm_add_epi32(odd, _mm_set1_epi32(0x7FFF)));
+                    const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(x, x));
+                    const __m128i quiet = _mm_or_si128(bits, _mm_set1_epi32(0x00400000));
+                    const __m128i high = _mm_srli_epi32(_mm_blendv_epi8(rounded, quiet, nan), 16);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi32(high, high));
+                }
+            for (; i < n; ++i)
+                dst[i] = format == HalfFormat::Binary16 ? LinAlg::detail::floatToBinary16(src[i]) : LinAlg::detail::floatToBFloat16(src[i]);
+        }
+#endif
+
+        template<typename Op, typename T, typename... Src>
+        void mapRuntime(T* dst, size_t n, const Op& op, const Src*... src) noexcept
+        {
+#if LINALG_SIMD_X86
+            if constexpr (SimdElement<T>)
+            {
+                switch (activeIsa())
+                {
+                    case Isa::AVX512: mapAvx512(dst, n, op, src...); return;
+                    case Isa::AVX2:   mapAvx2(dst, n, op, src...);   return;
+                    case Isa::SSE41:  mapSse41(dst, n, op, src...);  return;
+                    case Isa::Scalar: break;
+                }
+            }
+#endif
+            mapScalar(dst, n, op, src...);
+        }
+
+        // The op the widened kernels run: ops carrying a 16-bit scalar get it as float.
+        template<typename Op>
+        struct ComputeOp
+        {
+            static constexpr const Op& make(const Op& op) noexcept { return op; }
+        };
+        template<template<typename> typename Op, ReducedFloat T>
+        struct ComputeOp<Op<T>>
+        {
+            static constexpr Op<ComputeType<T>> make(const Op<T>& op) noexcept { return {static_cast<ComputeType<T>>(op.scalar)}; }
+        };
+
+        // Elements per widened block: every operand's block stays in L1 next to the result's.
+        inline constexpr size_t WIDEN_BLOCK = 512;
+    }
+
+    // dst[i] = float(src[i]) / dst[i] = T(src[i]) (round to nearest even) for the 16-bit types.
+    template<ReducedFloat T>
+    void widen(ComputeType<T>* dst, const T* src, size_t n) noexcept
+    {
+        [[maybe_unused]] const auto* bits = reinterpret_cast<const uint16_t*>(src);
+#if LINALG_SIMD_X86
+        constexpr HalfFormat format = HALF_FORMAT_OF<T>;
+        switch (activeIsa())
+        {
+            case Isa::AVX512: detail::widenAvx512<format>(dst, bits, n); return;
+            case Isa::AVX2:   detail::widenAvx2<format>(dst, bits, n);   return;
+            case Isa::SSE41:  detail::widenSse41<format>(dst, bits, n);  return;
+            case Isa::Scalar: break;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<ComputeType<T>>(src[i]);
+    }
+    template<ReducedFloat T>
+    void narrow(T* dst, const ComputeType<T>* src, size_t n) noexcept
+    {
+        [[maybe_unused]] auto* bits = reinterpret_cast<uint16_t*>(dst);
+#if LINALG_SIMD_X86
+        constexpr HalfFormat format = HALF_FORMAT_OF<T>;
+        switch (activeIsa())
+        {
+            case Isa::AVX512: detail::narrowAvx512<format>(bits, src, n); return;
+            case Isa::AVX2:   detail::narrowAvx2<format>(bits, src, n);   return;
+            case Isa::SSE41:  detail::narrowSse41<format>(bits, src, n);  return;
+            case Isa::Scalar: break;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<T>(src[i]);
+    }
+
+    // out[r] = sum_i rows[r][i] * x[i] for the four rows, accumulated in T.
+    template<Numeric T>
+    void dot4(const T* const* rows, const T* x, size_t n, T* out) noexcept
+    {
+#if LINALG_SIMD_X86
+        if constexpr (SimdElement<T>)
+        {
+            switch (activeIsa())
+            {
+                case Isa::AVX512: detail::dot4Avx512(rows, x, n, out); return;
+                case Isa::AVX2:   detail::dot4Avx2(rows, x, n, out);   return;
+                case Isa::SSE41:  detail::dot4Sse41(rows, x, n, out);  return;
+                case Isa::Scalar: break;
+            }
+        }
+#endif
+        for (size_t r = 0; r < 4; ++r)
+        {
+            T sum{};
+            for (size_t i = 0; i < n; ++i)
+                sum += rows[r][i] * x[i];
+            out[r] = sum;
+        }
+    }
+
+    namespace detail
+    {
+        // 16-bit operands: widen one block of every source, run the float kernel on it, narrow the
+        // block of results. Only the 16-bit values travel through memory.
+        template<typename Op, ReducedFloat T, typename... Src>
+        void mapWidened(T* dst, size_t n, const Op& op, const Src*... src) noexcept
+        {
+            using F = ComputeType<T>;
+            const auto wideOp = ComputeOp<Op>::make(op);
+            alignas(64) F in[sizeof...(Src)][WIDEN_BLOCK];
+            alignas(64) F out[WIDEN_BLOCK];
+            for (size_t i = 0; i < n; i += WIDEN_BLOCK)
+            {
+                const size_t m = std::min(WIDEN_BLOCK, n - i);
+                [&]<size_t... s>(std::index_sequence<s...>)
+                {
+                    (widen(in[s], src + i, m), ...);
+                    mapRuntime(out, m, wideOp, static_cast<const F*>(in[s])...);
+                }(std::index_sequence_for<Src...>{});
+                narrow(dst + i, out, m);
+            }
+        }
+
+        template<typename Op, typename T, typename... Src>
+        constexpr void map(T* dst, size_t n, const Op& op, const Src*... src) noexcept
+        {
+            if consteval
+            {
+                mapScalar(dst, n, op, src...);
+            }
+            else
+            {
+                LINALG_PROFILE_KERNEL(Op::NAME, (sizeof...(Src) + 1) * n * sizeof(T), Op::FLOPS * n);
+                if constexpr (ReducedFloat<T>)
+                    mapWidened(dst, n, op, src...);
+                else
+                    mapRuntime(dst, n, op, src...);
+            }
+        }
+    }
+
+    // dst[i] = a[i] + b[i]   (dst may alias a or b)
+    template<Numeric T>
+    constexpr void add(T* dst, const T* a, const T* b, size_t n) noexcept { detail::map(dst, n, detail::AddOp{}, a, b); }
+    // dst[i] = a[i] - b[i]
+    template<Numeric T>
+    constexpr void sub(T* dst, const T* a, const T* b, size_t n) noexcept { detail::map(dst, n, detail::SubOp{}, a, b); }
+    // dst[i] = a[i] * b[i]
+    template<Numeric T>
+    constexpr void mul(T* dst, const T* a, const T* b, size_t n) noexcept { detail::map(dst, n, detail::MulOp{}, a, b); }
+    // dst[i] = a[i] + scalar
+    template<Numeric T>
+    constexpr void addScalar(T* dst, const T* a, T scalar, size_t n) noexcept { detail::map(dst, n, detail::AddScalarOp<T>{scalar}, a); }
+    // dst[i] = a[i] - scalar
+    template<Numeric T>
+    constexpr void subScalar(T* dst, const T* a, T scalar, size_t n) noexcept { detail::map(dst, n, detail::SubScalarOp<T>{scalar}, a); }
+    // dst[i] = a[i] * scalar
+    template<Numeric T>
+    constexpr void mulScalar(T* dst, const T* a, T scalar, size_t n) noexcept { detail::map(dst, n, detail::MulScalarOp<T>{scalar}, a); }
+    // dst[i] = a[i] * b[i] + c[i]
+    template<Numeric T>
+    constexpr void fma(T* dst, const T* a, const T* b, const T* c, size_t n) noexcept { detail::map(dst, n, detail::FmaOp{}, a, b, c); }
+    // dst[i] = a[i] * scalar + dst[i]
+    template<Numeric T>
+    constexpr void axpy(T* dst, const T* a, T scalar, size_t n) noexcept { detail::map(dst, n, detail::FmaScalarOp<T>{scalar}, a, static_cast<const T*>(dst)); }
+
+    // dst[i] = round(src[i] * 10^decimalDigit) / 10^decimalDigit, halfway cases away from zero
+    // like std::round. Integers are already "rounded": for them this only copies.
+    template<Numeric T>
+    constexpr void roundOff(T* dst, const T* src, uint8_t decimalDigit, size_t n) noexcept
+    {
+        if constexpr (ReducedFloat<T>)
+        {
+            // Rounded in float, one widened block at a time.
+            using F = ComputeType<T>;
+            if consteval
+            {
+                const F scale = static_cast<F>(TenRaise(decimalDigit));
+                for (size_t i = 0; i < n; ++i)
+                    dst[i] = static_cast<T>(std::round(static_cast<F>(src[i]) * scale) / scale);
+            }
+            else
+            {
+                alignas(64) F block[detail::WIDEN_BLOCK];
+                for (size_t i = 0; i < n; i += detail::WIDEN_BLOCK)
+                {
+                    const size_t m = std::min(detail::WIDEN_BLOCK, n - i);
+                    widen(block, src + i, m);
+                    roundOff(block, block, decimalDigit, m);
+                    narrow(dst + i, block, m);
+                }
+            }
+        }
+        else if constexpr (!std::is_floating_point_v<T>)
+        {
+            if (dst != src)
+                for (size_t i = 0; i < n; ++i) dst[i] = src[i];
+        }
+        else
+        {
+            const T scale = static_cast<T>(TenRaise(decimalDigit));
+            const auto roundScalar = [&]
+            {
+                for (size_t i = 0; i < n; ++i)
+                    dst[i] = std::round(src[i] * scale) / scale;
+            };
+            if !consteval
+            {
+                LINALG_PROFILE_KERNEL("Simd::roundOff", 2 * n * sizeof(T), n);
+#if LINALG_SIMD_X86
+                if constexpr (std::same_as<T, float> || std::same_as<T, double>)
+                {
+                    switch (activeIsa())
+                    {
+                        case Isa::AVX512: detail::roundAvx512(dst, src, scale, n); return;
+                        case Isa::AVX2:   detail::roundAvx2(dst, src, scale, n);   return;
+                        case Isa::SSE41:  detail::roundSse41(dst, src, scale, n);  return;
+                        case Isa::Scalar: break;
+                    }
+                }
+#endif
+                roundScalar();
+                return;
+            }
+            roundScalar();
+        }
+    }
+}
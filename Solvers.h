@@ -0,0 +1,499 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "MatMul.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Reductions.h"
+#include "Profiling.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <concepts>
+#include <cassert>
+#include <cmath>
+namespace LinAlg
+{
+    // Direct solvers for dense systems: LU with partial pivoting, Cholesky and Householder QR.
+    // Like gemm, the kernels take a pointer plus a leading dimension (row-major, element (i, j) at
+    // A[i * lda + j]); LuDecomposition, CholeskyDecomposition and QrDecomposition wrap them for MatrixX.
+    //
+    // All three factorizations are blocked and right-looking: a panel of SOLVER_BLOCK columns is
+    // factored with the textbook (level-2) algorithm, then the rest of the matrix is updated with
+    // gemm. For n >> SOLVER_BLOCK nearly all the flops end up in gemm, which is cache-blocked and
+    // multithreaded (policy), so the factorizations run at close to gemm speed.
+    // Failure (singular, not positive definite) is reported, never asserted: it depends on the data.
+    namespace detail
+    {
+        inline constexpr size_t SOLVER_BLOCK = 64;
+        inline constexpr Parallel SOLVER_SERIAL{.threads = 1};
+
+        // Solves T X = B in place, T n x n triangular (strides rsT / csT, so a transposed factor
+        // needs no copy), B n x nrhs with row stride ldb. Only one block of columns of B, on the
+        // calling thread: rows of SOLVER_BLOCK, the rows solved before a block update it with one
+        // gemm, the block itself is substituted row by row.
+        template<std::floating_point Number>
+        void triangularSolveColumns(bool lower, bool unit, size_t n, size_t nrhs, const Number* T, size_t rsT, size_t csT,
+                                    Number* B, size_t ldb)
+        {
+            for (size_t step = 0; step < n; step += SOLVER_BLOCK)
+            {
+                const size_t nb = std::min(SOLVER_BLOCK, n - step);
+                const size_t i0 = lower ? step : n - step - nb;
+                const size_t s0 = lower ? 0 : i0 + nb;
+                const size_t solved = lower ? i0 : n - i0 - nb;
+                if (solved != 0)
+                {
+                    if (nrhs == 1)
+                        gemv(nb, solved, Number{-1}, T + i0 * rsT + s0 * csT, rsT, csT, B + s0 * ldb, ldb,
+                             Number{1}, B + i0 * ldb, ldb, SOLVER_SERIAL);
+                    else
+                        gemm(nb, nrhs, solved, Number{-1}, T + i0 * rsT + s0 * csT, rsT, csT, B + s0 * ldb, ldb, size_t{1},
+                             Number{1}, B + i0 * ldb, ldb, size_t{1}, SOLVER_SERIAL);
+                }
+                for (size_t t = 0; t < nb; ++t)
+                {
+                    const size_t i = lower ? i0 + t : i0 + nb - 1 - t;
+                    const size_t first = lower ? i0 : i + 1;
+                    const size_t last = lower ? i : i0 + nb;
+                    Number* row = B + i * ldb;
+                    if (nrhs == 1)
+                    {
+                        Number value = row[0];
+                        for (size_t k = first; k < last; ++k)
+                            value -= T[i * rsT + k * csT] * B[k * ldb];
+                        row[0] = unit ? value : value / T[i * rsT + i * csT];
+                        continue;
+                    }
+                    for (size_t k = first; k < last; ++k)
+                        Simd::axpy(row, B + k * ldb, -T[i * rsT + k * csT], nrhs);
+                    if (!unit)
+                        Simd::mulScalar(row, row, Number{1} / T[i * rsT + i * csT], nrhs);
+                }
+            }
+        }
+    }
+
+    // Solves T X = B in place for a lower (or upper) triangular T; unit: the diagonal is taken as 1
+    // and not read. Columns of B are independent, so wide right-hand sides are split across the pool.
+    template<std::floating_point Number>
+    void triangularSolve(bool lower, bool unit, size_t n, size_t nrhs, const Number* T, size_t rsT, size_t csT,
+                         Number* B, size_t ldb, const Parallel& policy = Parallel::current())
+    {
+        LINALG_PROFILE_KERNEL("triangularSolve", (n * n / 2 + 2 * n * nrhs) * sizeof(Number), n * n * nrhs);
+        parallelFor(nrhs, policy, [&](size_t first, size_t last)
+        {
+            detail::triangularSolveColumns(lower, unit, n, last - first, T, rsT, csT, B + first, ldb);
+        }, n * n * nrhs / 2);
+    }
+
+    // P A = L U, blocked. A (n x n) is overwritten with L (unit lower triangle, diagonal implied)
+    // and U; row k was swapped with row pivots[k] at step k. Returns n when A is nonsingular, else
+    // the first k with U(k, k) == 0; the factorization is completed either way (as LAPACK getrf).
+    template<std::floating_point Number>
+    auto luFactor(size_t n, Number* A, size_t lda, size_t* pivots, const Parallel& policy = Parallel::current()) -> size_t
+    {
+        LINALG_PROFILE_KERNEL("luFactor", n * n * sizeof(Number), 2 * n * n * n / 3);
+        size_t singular = n;
+        for (size_t k0 = 0; k0 < n; k0 += detail::SOLVER_BLOCK)
+        {
+            const size_t nb = std::min(detail::SOLVER_BLOCK, n - k0);
+            const size_t panelEnd = k0 + nb;
+            // Panel [k0, n) x [k0, panelEnd). Whole rows are swapped, which also applies the swap
+            // to the finished columns of L and to the columns still to be updated.
+            for (size_t j = k0; j < panelEnd; ++j)
+            {
+                size_t p = j;
+                for (size_t i = j + 1; i < n; ++i)
+                    if (std::abs(A[i * lda + j]) > std::abs(A[p * lda + j]))
+                        p = i;
+                pivots[j] = p;
+                if (p != j)
+                    std::swap_ranges(A + j * lda, A + j * lda + n, A + p * lda);
+                const Number pivot = A[j * lda + j];
+                if (pivot == Number{})
+                {
+                    singular = std::min(singular, j);
+                    continue;
+                }
+                const Number inverse = Number{1} / pivot;
+                const Number* pivotRow = A + j * lda + j + 1;
+                const size_t width = panelEnd - j - 1;
+                parallelFor(n - j - 1, policy, [&](size_t first, size_t last)
+                {
+                    for (size_t i = j + 1 + first; i < j + 1 + last; ++i)
+                    {
+                        Number* row = A + i * lda;
+                        row[j] *= inverse;
+                        if (width != 0 && row[j] != Number{})
+                            Simd::axpy(row + j + 1, pivotRow, -row[j], width);
+                    }
+                }, (n - j) * (width + 1));
+            }
+            const size_t rest = n - panelEnd;
+            if (rest == 0)
+                continue;
+            // U12 = L11^-1 A12, then A22 -= L21 U12.
+            triangularSolve(true, true, nb, rest, A + k0 * lda + k0, lda, size_t{1}, A + k0 * lda + panelEnd, lda, policy);
+            gemm(rest, rest, nb, Number{-1}, A + panelEnd * lda + k0, lda, size_t{1}, A + k0 * lda + panelEnd, lda, size_t{1},
+                 Number{1}, A + panelEnd * lda + panelEnd, lda, size_t{1}, policy);
+        }
+        return singular;
+    }
+
+    // Solves A X = B with the output of luFactor; B (n x nrhs) is overwritten with X.
+    template<std::floating_point Number>
+    void luSolve(size_t n, size_t nrhs, const Number* LU, size_t lda, const size_t* pivots, Number* B, size_t ldb,
+                 const Parallel& policy = Parallel::current())
+    {
+        for (size_t k = 0; k < n; ++k)
+            if (pivots[k] != k)
+                std::swap_ranges(B + k * ldb, B + k * ldb + nrhs, B + pivots[k] * ldb);
+        triangularSolve(true, true, n, nrhs, LU, lda, size_t{1}, B, ldb, policy);
+        triangularSolve(false, false, n, nrhs, LU, lda, size_t{1}, B, ldb, policy);
+    }
+
+    // A = L L^T for a symmetric positive definite A, blocked. Reads the lower triangle of A (n x n)
+    // and overwrites it with L; the strict upper triangle is set to zero. Returns n on success, else
+    // the first k at which A turned out not to be positive definite (L is then incomplete).
+    template<std::floating_point Number>
+    auto choleskyFactor(size_t n, Number* A, size_t lda, const Parallel& policy = Parallel::current()) -> size_t
+    {
+        LINALG_PROFILE_KERNEL("choleskyFactor", n * n * sizeof(Number), n * n * n / 3);
+        std::vector<Number> transposed;
+        for (size_t k0 = 0; k0 < n; k0 += detail::SOLVER_BLOCK)
+        {
+            const size_t nb = std::min(detail::SOLVER_BLOCK, n - k0);
+            const size_t panelEnd = k0 + nb;
+            // Diagonal block; the blocks to its left have already been applied to it.
+            for (size_t j = k0; j < panelEnd; ++j)
+            {
+                Number* rowJ = A + j * lda;
+                const Number d = rowJ[j] - LinAlg::squaredNorm(rowJ + k0, j - k0, {}, detail::SOLVER_SERIAL);
+                if (!(d > Number{}))
+                    return j;
+                rowJ[j] = std::sqrt(d);
+                for (size_t i = j + 1; i < panelEnd; ++i)
+                {
+                    Number* rowI = A + i * lda;
+                    rowI[j] = (rowI[j] - LinAlg::dot(rowI + k0, rowJ + k0, j - k0, {}, detail::SOLVER_SERIAL)) / rowJ[j];
+                }
+            }
+            const size_t rest = n - panelEnd;
+            if (rest == 0)
+                continue;
+            // L21 = A21 L11^-T, i.e. L11 L21^T = A21^T: transposed into a buffer so the solve runs
+            // on long contiguous rows (and in parallel over them), then transposed back.
+            const Number* L11 = A + k0 * lda + k0;
+            transposed.resize(nb * rest);
+            for (size_t i = 0; i < rest; ++i)
+                for (size_t j = 0; j < nb; ++j)
+                    transposed[j * rest + i] = A[(panelEnd + i) * lda + k0 + j];
+            triangularSolve(true, false, nb, rest, L11, lda, size_t{1}, transposed.data(), rest, policy);
+            for (size_t i = 0; i < rest; ++i)
+                for (size_t j = 0; j < nb; ++j)
+                    A[(panelEnd + i) * lda + k0 + j] = transposed[j * rest + i];
+            // A22 -= L21 L21^T, lower triangle only: one gemm per block of rows, up to its diagonal.
+            const Number* L21 = A + panelEnd * lda + k0;
+            for (size_t i0 = panelEnd; i0 < n; i0 += detail::SOLVER_BLOCK)
+            {
+                const size_t rows = std::min(detail::SOLVER_BLOCK, n - i0);
+                gemm(rows, i0 + rows - panelEnd, nb, Number{-1}, A + i0 * lda + k0, lda, size_t{1}, L21, size_t{1}, lda,
+                     Number{1}, A + i0 * lda + panelEnd, lda, size_t{1}, policy);
+            }
+        }
+        for (size_t i = 0; i + 1 < n; ++i)
+            std::fill_n(A + i * lda + i + 1, n - i - 1, Number{});
+        return n;
+    }
+
+    // Solves A X = B with the L of choleskyFactor (L Y = B, then L^T X = Y); B is overwritten with X.
+    template<std::floating_point Number>
+    void choleskySolve(size_t n, size_t nrhs, const Number* L, size_t lda, Number* B, size_t ldb,
+                       const Parallel& policy = Parallel::current())
+    {
+        triangularSolve(true, false, n, nrhs, L, lda, size_t{1}, B, ldb, policy);
+        triangularSolve(false, false, n, nrhs, L, size_t{1}, lda, B, ldb, policy);
+    }
+
+    // A = Q R by Householder reflections, m >= n, blocked: a panel's reflectors are accumulated
+    // into the compact WY form H_0 ... H_nb-1 = I - V T V^T and applied to the rest of A at once
+    // (three gemms) instead of one rank-1 update per column.
+    // A (m x n) is overwritten with R (upper triangle) and the reflectors below the diagonal:
+    // H_k = I - tau[k] v_k v_k^T with v_k(k) = 1 implied and v_k(k + 1 ..) = A(k + 1 .., k).
+    template<std::floating_point Number>
+    void qrFactor(size_t m, size_t n, Number* A, size_t lda, Number* tau, const Parallel& policy = Parallel::current())
+    {
+        assert(m >= n);
+        LINALG_PROFILE_KERNEL("qrFactor", m * n * sizeof(Number), 2 * m * n * n - 2 * n * n * n / 3);
+        std::vector<Number> w(detail::SOLVER_BLOCK);
+        std::vector<Number> V, T, S, W, TW;
+        for (size_t k0 = 0; k0 < n; k0 += detail::SOLVER_BLOCK)
+        {
+            const size_t nb = std::min(detail::SOLVER_BLOCK, n - k0);
+            const size_t panelEnd = k0 + nb;
+            for (size_t j = k0; j < panelEnd; ++j)
+            {
+                // Reflector zeroing A(j + 1 .., j): beta = -sign(alpha) |x|, v = x / (alpha - beta).
+                const Number alpha = A[j * lda + j];
+                Number scale{}, squares{1};
+                for (size_t i = j + 1; i < m; ++i)
+                {
+                    // Scaled sum of squares (as LAPACK's nrm2): no overflow for huge entries.
+                    const Number a = std::abs(A[i * lda + j]);
+                    if (a == Number{})
+                        continue;
+                    if (scale < a)
+                    {
+                        squares = Number{1} + squares * (scale / a) * (scale / a);
+                        scale = a;
+                    }
+                    else
+                        squares += (a / scale) * (a / scale);
+                }
+                const Number tail = scale * std::sqrt(squares);
+                if (tail == Number{})
+                {
+                    tau[j] = Number{};
+                    continue;
+                }
+                const Number beta = -std::copysign(std::hypot(alpha, tail), alpha);
+                tau[j] = (beta - alpha) / beta;
+                const Number inverse = Number{1} / (alpha - beta);
+                for (size_t i = j + 1; i < m; ++i)
+                    A[i * lda + j] *= inverse;
+                A[j * lda + j] = beta;
+
+                // Rest of the panel: A -= tau v (v^T A), rows j .. m, columns j + 1 .. panelEnd.
+                const size_t width = panelEnd - j - 1;
+                if (width == 0)
+                    continue;
+                Number* right = A + j * lda + j + 1;
+                std::copy_n(right, width, w.begin());
+                for (size_t i = j + 1; i < m; ++i)
+                    Simd::axpy(w.data(), A + i * lda + j + 1, A[i * lda + j], width);
+                parallelFor(m - j, policy, [&](size_t first, size_t last)
+                {
+                    for (size_t i = j + first; i < j + last; ++i)
+                    {
+                        const Number v = i == j ? Number{1} : A[i * lda + j];
+                        Simd::axpy(A + i * lda + j + 1, w.data(), -tau[j] * v, width);
+                    }
+                }, (m - j) * width);
+            }
+            const size_t rest = n - panelEnd;
+            if (rest == 0)
+                continue;
+
+            // V: the panel's reflectors as an explicit (m - k0) x nb unit lower trapezoid.
+            const size_t rows = m - k0;
+            V.assign(rows * nb, Number{});
+            for (size_t i = 0; i < rows; ++i)
+            {
+                const Number* a = A + (k0 + i) * lda + k0;
+                Number* v = V.data() + i * nb;
+                std::copy_n(a, std::min(i, nb), v);
+                if (i < nb)
+                    v[i] = Number{1};
+            }
+            // T upper triangular with T(i, i) = tau_i, T(0 .. i, i) = -tau_i T(0 .. i, 0 .. i) V^T v_i.
+            S.assign(nb * nb, Number{});
+            gemm(nb, nb, rows, Number{1}, V.data(), size_t{1}, nb, V.data(), nb, size_t{1}, Number{}, S.data(), nb, size_t{1}, policy);
+            T.assign(nb * nb, Number{});
+            for (size_t i = 0; i < nb; ++i)
+            {
+                const Number t = tau[k0 + i];
+                T[i * nb + i] = t;
+                for (size_t r = 0; r < i; ++r)
+                {
+                    Number value{};
+                    for (size_t c = r; c < i; ++c)
+                        value += T[r * nb + c] * S[c * nb + i];
+                    T[r * nb + i] = -t * value;
+                }
+            }
+            // A2 = (I - V T^T V^T) A2 = A2 - V (T^T (V^T A2)).
+            Number* A2 = A + k0 * lda + panelEnd;
+            W.assign(nb * rest, Number{});
+            TW.assign(nb * rest, Number{});
+            gemm(nb, rest, rows, Number{1}, V.data(), size_t{1}, nb, A2, lda, size_t{1}, Number{}, W.data(), rest, size_t{1}, policy);
+            gemm(nb, rest, nb, Number{1}, T.data(), size_t{1}, nb, W.data(), rest, size_t{1}, Number{}, TW.data(), rest, size_t{1}, policy);
+            gemm(rows, rest, nb, Number{-1}, V.data(), nb, size_t{1}, TW.data(), rest, size_t{1}, Number{1}, A2, lda, size_t{1}, policy);
+        }
+    }
+
+    // Least-squares solution of A X ~ B with the output of qrFactor: B (m x nrhs) is overwritten
+    // with Q^T B, whose first n rows are then replaced by X = R^-1 (Q^T B)(0 .. n).
+    template<std::floating_point Number>
+    void qrSolve(size_t m, size_t n, size_t nrhs, const Number* QR, size_t lda, const Number* tau, Number* B, size_t ldb,
+                 const Parallel& policy = Parallel::current())
+    {
+        std::vector<Number> w(nrhs);
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (tau[k] == Number{})
+                continue;
+            std::copy_n(B + k * ldb, nrhs, w.begin());
+            for (size_t i = k + 1; i < m; ++i)
+                Simd::axpy(w.data(), B + i * ldb, QR[i * lda + k], nrhs);
+            Simd::axpy(B + k * ldb, w.data(), -tau[k], nrhs);
+            for (size_t i = k + 1; i < m; ++i)
+                Simd::axpy(B + i * ldb, w.data(), -tau[k] * QR[i * lda + k], nrhs);
+        }
+        triangularSolve(false, false, n, nrhs, QR, lda, size_t{1}, B, ldb, policy);
+    }
+
+    // LU factorization of a square MatrixX: solve / inverse / determinant.
+    //   LinAlg::LuDecomposition lu(a); auto x = lu.solve(b);
+    // A singular matrix is reported by singular(); solving with it yields inf / nan.
+    template<std::floating_point Number, typename Allocator = AlignedAllocator<Number>>
+    class LuDecomposition
+    {
+    public:
+        explicit LuDecomposition(MatrixX<Number, Allocator> a, const Parallel& policy = Parallel::current())
+            : m_factors(std::move(a)), m_pivots(m_factors.rows())
+        {
+            assert(m_factors.rows() == m_factors.cols());
+            m_firstZeroPivot = luFactor(m_factors.rows(), m_factors.data(), m_factors.cols(), m_pivots.data(), policy);
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return m_factors.rows(); }
+        [[nodiscard]] bool singular() const noexcept { return m_firstZeroPivot != size(); }
+        // L below the diagonal (unit diagonal implied), U on and above it.
+        [[nodiscard]] const MatrixX<Number, Allocator>& factors() const noexcept { return m_factors; }
+        [[nodiscard]] const std::vector<size_t>& pivots() const noexcept { return m_pivots; }
+
+        [[nodiscard]] auto determinant() const noexcept -> Number
+        {
+            Number det{1};
+            for (size_t k = 0; k < size(); ++k)
+                det *= m_pivots[k] == k ? m_factors(k, k) : -m_factors(k, k);
+            return det;
+        }
+        template<typename OtherAllocator>
+        [[nodiscard]] auto solve(VectorX<Number, OtherAllocator> b, const Parallel& policy = Parallel::current()) const
+            -> VectorX<Number, OtherAllocator>
+        {
+            assert(b.size() == size());
+            luSolve(size(), size_t{1}, m_factors.data(), size(), m_pivots.data(), b.data(), size_t{1}, policy);
+            return b;
+        }
+        template<typename OtherAllocator>
+        [[nodiscard]] auto solve(MatrixX<Number, OtherAllocator> b, const Parallel& policy = Parallel::current()) const
+            -> MatrixX<Number, OtherAllocator>
+        {
+            assert(b.rows() == size());
+            luSolve(size(), b.cols(), m_factors.data(), size(), m_pivots.data(), b.data(), b.cols(), policy);
+            return b;
+        }
+        [[nodiscard]] auto inverse(const Parallel& policy = Parallel::current()) const -> MatrixX<Number, Allocator>
+        {
+            MatrixX<Number, Allocator> identity(size(), size(), m_factors.get_allocator());
+            for (size_t k = 0; k < size(); ++k)
+                identity(k, k) = Number{1};
+            return solve(std::move(identity), policy);
+        }
+    private:
+        MatrixX<Number, Allocator> m_factors;
+        std::vector<size_t> m_pivots;
+        size_t m_firstZeroPivot = 0;
+    };
+
+    // Cholesky factorization of a symmetric positive definite MatrixX (only its lower triangle is
+    // read). About half the work of LU and no pivoting; positiveDefinite() is false when A is not
+    // (then nothing may be solved with it).
+    template<std::floating_point Number, typename Allocator = AlignedAllocator<Number>>
+    class CholeskyDecomposition
+    {
+    public:
+        explicit CholeskyDecomposition(MatrixX<Number, Allocator> a, const Parallel& policy = Parallel::current())
+            : m_factor(std::move(a))
+        {
+            assert(m_factor.rows() == m_factor.cols());
+            m_positiveDefinite = choleskyFactor(m_factor.rows(), m_factor.data(), m_factor.cols(), policy) == m_factor.rows();
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return m_factor.rows(); }
+        [[nodiscard]] bool positiveDefinite() const noexcept { return m_positiveDefinite; }
+        // L, lower triangular.
+        [[nodiscard]] const MatrixX<Number, Allocator>& factor() const noexcept { return m_factor; }
+
+        template<typename OtherAllocator>
+        [[nodiscard]] auto solve(VectorX<Number, OtherAllocator> b, const Parallel& policy = Parallel::current()) const
+            -> VectorX<Number, OtherAllocator>
+        {
+            assert(m_positiveDefinite && b.size() == size());
+            choleskySolve(size(), size_t{1}, m_factor.data(), size(), b.data(), size_t{1}, policy);
+            return b;
+        }
+        template<typename OtherAllocator>
+        [[nodiscard]] auto solve(MatrixX<Number, OtherAllocator> b, const Parallel& policy = Parallel::current()) const
+            -> MatrixX<Number, OtherAllocator>
+        {
+            assert(m_positiveDefinite && b.rows() == size());
+            choleskySolve(size(), b.cols(), m_factor.data(), size(), b.data(), b.cols(), policy);
+            return b;
+        }
+    private:
+        MatrixX<Number, Allocator> m_factor;
+        bool m_positiveDefinite = false;
+    };
+
+    // Householder QR of an m x n MatrixX, m >= n: least-squares solutions of A x ~ b without
+    // forming A^T A (whose condition number is the square of A's).
+    // rankDeficient() flags an R with a diagonal entry negligible next to the largest one; the
+    // least-squares solution is then not unique and solve() yields huge or inf / nan values.
+    template<std::floating_point Number, typename Allocator = AlignedAllocator<Number>>
+    class QrDecomposition
+    {
+    public:
+        explicit QrDecomposition(MatrixX<Number, Allocator> a, const Parallel& policy = Parallel::current())
+            : m_factors(std::move(a)), m_tau(m_factors.cols())
+        {
+            assert(m_factors.rows() >= m_factors.cols());
+            qrFactor(m_factors.rows(), m_factors.cols(), m_factors.data(), m_factors.cols(), m_tau.data(), policy);
+        }
+
+        [[nodiscard]] size_t rows() const noexcept { return m_factors.rows(); }
+        [[nodiscard]] size_t cols() const noexcept { return m_factors.cols(); }
+        // R on and above the diagonal, the Householder vectors below it.
+        [[nodiscard]] const MatrixX<Number, Allocator>& factors() const noexcept { return m_factors; }
+        [[nodiscard]] const std::vector<Number>& tau() const noexcept { return m_tau; }
+        [[nodiscard]] bool rankDeficient() const noexcept
+        {
+            Number largest{};
+            for (size_t k = 0; k < cols(); ++k)
+                largest = std::max(largest, std::abs(m_factors(k, k)));
+            const Number tolerance = largest * static_cast<Number>(rows()) * std::numeric_limits<Number>::epsilon();
+            for (size_t k = 0; k < cols(); ++k)
+                if (!(std::abs(m_factors(k, k)) > tolerance))
+                    return true;
+            return false;
+        }
+
+        // argmin |A x - b|, x has cols() entries.
+        template<typename OtherAllocator>
+        [[nodiscard]] auto solve(VectorX<Number, OtherAllocator> b, const Parallel& policy = Parallel::current()) const
+            -> VectorX<Number, OtherAllocator>
+        {
+            assert(b.size() == rows());
+            qrSolve(rows(), cols(), size_t{1}, m_factors.data(), cols(), m_tau.data(), b.data(), size_t{1}, policy);
+            VectorX<Number, OtherAllocator> x(cols(), b.get_allocator());
+            std::copy_n(b.data(), cols(), x.data());
+            return x;
+        }
+        template<typename OtherAllocator>
+        [[nodiscard]] auto solve(MatrixX<Number, OtherAllocator> b, const Parallel& policy = Parallel::current()) const
+            -> MatrixX<Number, OtherAllocator>
+        {
+            assert(b.rows() == rows());
+            qrSolve(rows(), cols(), b.cols(), m_factors.data(), cols(), m_tau.data(), b.data(), b.cols(), policy);
+            MatrixX<Number, OtherAllocator> x(cols(), b.cols(), b.get_allocator());
+            std::copy_n(b.data(), x.size(), x.data());
+            return x;
+        }
+    private:
+        MatrixX<Number, Allocator> m_factors;
+        std::vector<Number> m_tau;
+    };
+}
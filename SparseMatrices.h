@@ -0,0 +1,552 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "AlignedAllocator.h"
+#include "DynamicMatrices.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Profiling.h"
+#include <span>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+namespace LinAlg
+{
+    // Compressed sparse matrices.
+    //   CsrMatrix (RowMajor) : row r owns the entries offsets[r] .. offsets[r + 1] - 1, whose column
+    //                          indices (ascending, no duplicates) and values are in indices / values
+    //   CscMatrix (ColMajor) : the same with the roles of rows and columns swapped
+    // "outer" is the compressed dimension (rows of a CSR matrix), "inner" the other one.
+    // The CSC arrays of A are the CSR arrays of A^T, so transposing a view is free and every kernel
+    // comes in two shapes:
+    //   gather  : one outer line produces one output element / row  (CSR * x), lines are independent
+    //   scatter : one outer line adds into many outputs              (CSC * x, CSR^T * x)
+    // Kernels take a SparseView (pointers + sizes, like the strided pointers of gemm / gemv), the
+    // owning SparseMatrix hands one out with view().
+    enum class SparseLayout : uint8_t
+    {
+        RowMajor,   // CSR
+        ColMajor    // CSC
+    };
+
+    // 32-bit indices: half the index traffic of size_t, every dimension must stay below 2^32.
+    using SparseIndex = uint32_t;
+
+    template<Numeric Number>
+    struct Triplet
+    {
+        size_t row = 0;
+        size_t col = 0;
+        Number value{};
+    };
+
+    template<Numeric Number, SparseLayout Layout>
+    struct SparseView
+    {
+        static constexpr SparseLayout layout = Layout;
+        static constexpr SparseLayout transposedLayout =
+            Layout == SparseLayout::RowMajor ? SparseLayout::ColMajor : SparseLayout::RowMajor;
+
+        size_t rows = 0;
+        size_t cols = 0;
+        const size_t* offsets = nullptr;        // outer() + 1 absolute positions into indices / values
+        const SparseIndex* indices = nullptr;
+        const Number* values = nullptr;
+
+        [[nodiscard]] constexpr size_t outer() const noexcept { return Layout == SparseLayout::RowMajor ? rows : cols; }
+        [[nodiscard]] constexpr size_t inner() const noexcept { return Layout == SparseLayout::RowMajor ? cols : rows; }
+        [[nodiscard]] constexpr size_t nonZeros() const noexcept { return outer() == 0 ? 0 : offsets[outer()] - offsets[0]; }
+
+        // Outer lines [first, last) (rows of a CSR view, columns of a CSC view), sharing the storage:
+        // the mini-batches of a CSR dataset.
+        [[nodiscard]] constexpr auto slice(size_t first, size_t last) const noexcept -> SparseView
+        {
+            assert(first <= last && last <= outer());
+            SparseView view = *this;
+            (Layout == SparseLayout::RowMajor ? view.rows : view.cols) = last - first;
+            view.offsets = offsets + first;
+            return view;
+        }
+        // A^T: the same arrays read in the other layout.
+        [[nodiscard]] constexpr auto transposed() const noexcept -> SparseView<Number, transposedLayout>
+        {
+            return {cols, rows, offsets, indices, values};
+        }
+    };
+
+    template<Numeric Number>
+    using CsrView = SparseView<Number, SparseLayout::RowMajor>;
+    template<Numeric Number>
+    using CscView = SparseView<Number, SparseLayout::ColMajor>;
+
+    template<Numeric Number, SparseLayout Layout, typename Allocator = AlignedAllocator<Number>>
+    class SparseMatrix
+    {
+    public:
+        using value_type = Number;
+        using allocator_type = Allocator;
+        using Storage = std::vector<Number, Allocator>;
+        using View = SparseView<Number, Layout>;
+        static constexpr SparseLayout layout = Layout;
+
+        SparseMatrix() = default;
+        // rows x cols, no stored entries.
+        SparseMatrix(size_t rows, size_t cols) : m_rows(rows), m_cols(cols), m_offsets(outerOf(rows, cols) + 1, 0)
+        {
+            assert(rows <= MAX_DIMENSION && cols <= MAX_DIMENSION);
+        }
+        // Adopts already compressed arrays (e.g. read from a file); they must satisfy the layout
+        // invariants above.
+        SparseMatrix(size_t rows, size_t cols, std::vector<size_t> offsets, std::vector<SparseIndex> indices, Storage values)
+            : m_rows(rows), m_cols(cols), m_offsets(std::move(offsets)), m_indices(std::move(indices)), m_values(std::move(values))
+        {
+            assert(m_offsets.size() == outer() + 1 && m_offsets.front() == 0);
+            assert(m_offsets.back() == m_indices.size() && m_indices.size() == m_values.size());
+        }
+
+        // Triplets may come in any order; duplicates of one (row, col) are summed.
+        [[nodiscard]] static auto fromTriplets(size_t rows, size_t cols, std::span<const Triplet<Number>> triplets) -> SparseMatrix
+        {
+            SparseMatrix result(rows, cols);
+            const auto outerIndex = [](const Triplet<Number>& t) { return Layout == SparseLayout::RowMajor ? t.row : t.col; };
+            const auto innerIndex = [](const Triplet<Number>& t) { return Layout == SparseLayout::RowMajor ? t.col : t.row; };
+            // Counting sort by outer index, then every line sorted and merged on its own.
+            std::vector<size_t> start(result.outer() + 1, 0);
+            for (const auto& t : triplets)
+            {
+                assert(t.row < rows && t.col < cols);
+                ++start[outerIndex(t) + 1];
+            }
+            std::partial_sum(start.begin(), start.end(), start.begin());
+            std::vector<SparseIndex> indices(triplets.size());
+            std::vector<ComputeType<Number>> values(triplets.size());
+            {
+                std::vector<size_t> next(start.begin(), start.end() - 1);
+                for (const auto& t : triplets)
+                {
+                    const size_t slot = next[outerIndex(t)]++;
+                    indices[slot] = static_cast<SparseIndex>(innerIndex(t));
+                    values[slot] = static_cast<ComputeType<Number>>(t.value);
+                }
+            }
+            result.m_indices.reserve(triplets.size());
+            result.m_values.reserve(triplets.size());
+            std::vector<size_t> permutation;
+            for (size_t o = 0; o < result.outer(); ++o)
+            {
+                permutation.resize(start[o + 1] - start[o]);
+                std::iota(permutation.begin(), permutation.end(), start[o]);
+                std::ranges::sort(permutation, {}, [&](size_t p) { return indices[p]; });
+                for (size_t k = 0; k < permutation.size();)
+                {
+                    const SparseIndex index = indices[permutation[k]];
+                    ComputeType<Number> sum{};
+                    for (; k < permutation.size() && indices[permutation[k]] == index; ++k)
+                        sum += values[permutation[k]];
+                    result.m_indices.push_back(index);
+                    result.m_values.push_back(static_cast<Number>(sum));
+                }
+                result.m_offsets[o + 1] = result.m_indices.size();
+            }
+            return result;
+        }
+        [[nodiscard]] static auto fromTriplets(size_t rows, size_t cols, std::initializer_list<Triplet<Number>> triplets) -> SparseMatrix
+        {
+            return fromTriplets(rows, cols, std::span<const Triplet<Number>>(triplets.begin(), triplets.size()));
+        }
+        // Keeps the entries with |value| > tolerance.
+        template<typename DenseAllocator>
+        [[nodiscard]] static auto fromDense(const MatrixX<Number, DenseAllocator>& dense, Number tolerance = Number{}) -> SparseMatrix
+        {
+            SparseMatrix result(dense.rows(), dense.cols());
+            const auto limit = static_cast<ComputeType<Number>>(tolerance);
+            for (size_t o = 0; o < result.outer(); ++o)
+            {
+                for (size_t i = 0; i < result.inner(); ++i)
+                {
+                    const Number value = Layout == SparseLayout::RowMajor ? dense.data()[o * dense.cols() + i]
+                                                                          : dense.data()[i * dense.cols() + o];
+                    const auto wide = static_cast<ComputeType<Number>>(value);
+                    bool keep;
+                    if constexpr (std::is_unsigned_v<ComputeType<Number>>)
+                        keep = wide > limit;   // already a magnitude, and std::abs has no unsigned overloads
+                    else
+                        keep = std::abs(wide) > limit;
+                    if (keep)
+                    {
+                        result.m_indices.push_back(static_cast<SparseIndex>(i));
+                        result.m_values.push_back(value);
+                    }
+                }
+                result.m_offsets[o + 1] = result.m_indices.size();
+            }
+            return result;
+        }
+
+        [[nodiscard]] auto toDense() const -> MatrixX<Number>
+        {
+            MatrixX<Number> dense(m_rows, m_cols);
+            for (size_t o = 0; o < outer(); ++o)
+                for (size_t p = m_offsets[o]; p < m_offsets[o + 1]; ++p)
+                {
+                    const size_t r = Layout == SparseLayout::RowMajor ? o : m_indices[p];
+                    const size_t c = Layout == SparseLayout::RowMajor ? m_indices[p] : o;
+                    dense.data()[r * m_cols + c] = m_values[p];
+                }
+            return dense;
+        }
+        // The same matrix in the other compression (CSR <-> CSC): one counting pass, O(nnz + outer).
+        [[nodiscard]] auto convert() const -> SparseMatrix<Number, View::transposedLayout, Allocator>
+        {
+            std::vector<size_t> offsets(inner() + 1, 0);
+            for (const SparseIndex index : m_indices)
+                ++offsets[index + 1];
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            std::vector<SparseIndex> indices(m_indices.size());
+            Storage values(m_values.size(), Number{}, m_values.get_allocator());
+            std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+            // Walking the outer lines in order leaves every new line sorted.
+            for (size_t o = 0; o < outer(); ++o)
+                for (size_t p = m_offsets[o]; p < m_offsets[o + 1]; ++p)
+                {
+                    const size_t slot = next[m_indices[p]]++;
+                    indices[slot] = static_cast<SparseIndex>(o);
+                    values[slot] = m_values[p];
+                }
+            return {m_rows, m_cols, std::move(offsets), std::move(indices), std::move(values)};
+        }
+        // A^T with the same arrays: a CSR matrix becomes the CSC matrix of its transpose.
+        [[nodiscard]] auto transposed() const& -> SparseMatrix<Number, View::transposedLayout, Allocator>
+        {
+            return {m_cols, m_rows, m_offsets, m_indices, m_values};
+        }
+        [[nodiscard]] auto transposed() && -> SparseMatrix<Number, View::transposedLayout, Allocator>
+        {
+            return {m_cols, m_rows, std::move(m_offsets), std::move(m_indices), std::move(m_values)};
+        }
+
+        [[nodiscard]] auto view() const noexcept -> View
+        {
+            return {m_rows, m_cols, m_offsets.data(), m_indices.data(), m_values.data()};
+        }
+        [[nodiscard]] size_t rows() const noexcept { return m_rows; }
+        [[nodiscard]] size_t cols() const noexcept { return m_cols; }
+        [[nodiscard]] size_t outer() const noexcept { return outerOf(m_rows, m_cols); }
+        [[nodiscard]] size_t inner() const noexcept { return Layout == SparseLayout::RowMajor ? m_cols : m_rows; }
+        [[nodiscard]] size_t nonZeros() const noexcept { return m_values.size(); }
+        [[nodiscard]] double density() const noexcept
+        {
+            return m_rows == 0 || m_cols == 0 ? 0.0 : static_cast<double>(nonZeros()) / (static_cast<double>(m_rows) * static_cast<double>(m_cols));
+        }
+        // Memory held by the three arrays.
+        [[nodiscard]] size_t bytes() const noexcept
+        {
+            return m_offsets.size() * sizeof(size_t) + m_indices.size() * sizeof(SparseIndex) + m_values.size() * sizeof(Number);
+        }
+        [[nodiscard]] std::span<const size_t> offsets() const noexcept { return m_offsets; }
+        [[nodiscard]] std::span<const SparseIndex> indices() const noexcept { return m_indices; }
+        [[nodiscard]] std::span<const Number> values() const noexcept { return m_values; }
+        // The pattern is fixed, the stored values can be updated in place.
+        [[nodiscard]] std::span<Number> values() noexcept { return m_values; }
+
+        // Element (r, c), zero when it is not stored (binary search in the line).
+        [[nodiscard]] auto operator()(size_t r, size_t c) const noexcept -> Number
+        {
+            assert(r < m_rows && c < m_cols);
+            const size_t o = Layout == SparseLayout::RowMajor ? r : c;
+            const auto i = static_cast<SparseIndex>(Layout == SparseLayout::RowMajor ? c : r);
+            const auto first = m_indices.begin() + static_cast<std::ptrdiff_t>(m_offsets[o]);
+            const auto last = m_indices.begin() + static_cast<std::ptrdiff_t>(m_offsets[o + 1]);
+            const auto it = std::lower_bound(first, last, i);
+            return it != last && *it == i ? m_values[static_cast<size_t>(it - m_indices.begin())] : Number{};
+        }
+    private:
+        static constexpr size_t MAX_DIMENSION = size_t{std::numeric_limits<SparseIndex>::max()};
+
+        static constexpr size_t outerOf(size_t rows, size_t cols) noexcept
+        {
+            return Layout == SparseLayout::RowMajor ? rows : cols;
+        }
+
+        size_t m_rows = 0;
+        size_t m_cols = 0;
+        std::vector<size_t> m_offsets{0};
+        std::vector<SparseIndex> m_indices;
+        Storage m_values;
+    };
+
+    template<Numeric Number, typename Allocator = AlignedAllocator<Number>>
+    using CsrMatrix = SparseMatrix<Number, SparseLayout::RowMajor, Allocator>;
+    template<Numeric Number, typename Allocator = AlignedAllocator<Number>>
+    using CscMatrix = SparseMatrix<Number, SparseLayout::ColMajor, Allocator>;
+
+    using CsrMatXf = CsrMatrix<float>;
+    using CsrMatXd = CsrMatrix<double>;
+    using CscMatXf = CscMatrix<float>;
+    using CscMatXd = CscMatrix<double>;
+
+    namespace detail
+    {
+        // Threads one sparse call may use, with the same rule as parallelFor.
+        inline size_t sparseThreads(const Parallel& policy, size_t work) noexcept
+        {
+            const size_t pool = ThreadPool::global().concurrency();
+            const size_t threads = std::min(policy.threads == 0 ? pool : policy.threads, pool);
+            return work < policy.minElements ? 1 : std::max<size_t>(threads, 1);
+        }
+
+        // Sum of values[p] * x[indices[p] * incx] over one line; four accumulators so consecutive
+        // entries do not wait on each other's add.
+        template<Numeric Number>
+        [[gnu::always_inline]] inline auto sparseDot(const SparseIndex* indices, const Number* values, size_t count,
+                                                     const Number* x, size_t incx) noexcept -> ComputeType<Number>
+        {
+            using Wide = ComputeType<Number>;
+            Wide s0{}, s1{}, s2{}, s3{};
+            size_t p = 0;
+            for (; p + 4 <= count; p += 4)
+            {
+                s0 += static_cast<Wide>(values[p + 0]) * static_cast<Wide>(x[indices[p + 0] * incx]);
+                s1 += static_cast<Wide>(values[p + 1]) * static_cast<Wide>(x[indices[p + 1] * incx]);
+                s2 += static_cast<Wide>(values[p + 2]) * static_cast<Wide>(x[indices[p + 2] * incx]);
+                s3 += static_cast<Wide>(values[p + 3]) * static_cast<Wide>(x[indices[p + 3] * incx]);
+            }
+            for (; p < count; ++p)
+                s0 += static_cast<Wide>(values[p]) * static_cast<Wide>(x[indices[p] * incx]);
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        // y[first..last) of a gather SpMV (A in CSR: line o is y[o]).
+        template<Numeric Number>
+        void spmvGather(size_t first, size_t last, Number alpha, const CsrView<Number>& A,
+                        const Number* x, size_t incx, Number beta, Number* y, size_t incy) noexcept
+        {
+            using Wide = ComputeType<Number>;
+            for (size_t o = first; o < last; ++o)
+            {
+                const size_t begin = A.offsets[o];
+                const Wide sum = sparseDot(A.indices + begin, A.values + begin, A.offsets[o + 1] - begin, x, incx);
+                Number& yo = y[o * incy];
+                yo = beta == Number{} ? static_cast<Number>(static_cast<Wide>(alpha) * sum)
+                                      : static_cast<Number>(static_cast<Wide>(alpha) * sum + static_cast<Wide>(beta) * static_cast<Wide>(yo));
+            }
+        }
+
+        // Scatter SpMV (A in CSC: line o adds x[o] * column o into y). Lines of different threads
+        // hit the same y entries, so every part of the outer range accumulates into its own dense
+        // buffer and the buffers are summed in part order afterwards: no atomics, and the result
+        // only depends on the number of parts.
+        template<Numeric Number>
+        void spmvScatter(Number alpha, const CscView<Number>& A, const Number* x, size_t incx,
+                         Number beta, Number* y, size_t incy, const Parallel& policy)
+        {
+            using Wide = ComputeType<Number>;
+            const size_t outer = A.outer(), inner = A.inner();
+            const size_t parts = std::min(sparseThreads(policy, A.nonZeros() + inner), std::max<size_t>(outer, 1));
+            // Leased for this call (ThreadPool.h): reused across calls -> no allocation in steady state,
+            // and a nested call run by this thread while it waits gets a buffer of its own.
+            const ScratchLease<Wide> scratch(parts * inner);
+            Wide* const partial = scratch.data();
+            std::fill_n(partial, parts * inner, Wide{});
+            const auto accumulate = [&](size_t part)
+            {
+                Wide* acc = partial + part * inner;
+                for (size_t o = outer * part / parts, end = outer * (part + 1) / parts; o < end; ++o)
+                {
+                    const Wide xo = static_cast<Wide>(x[o * incx]);
+                    if (xo == Wide{})
+                        continue;
+                    for (size_t p = A.offsets[o]; p < A.offsets[o + 1]; ++p)
+                        acc[A.indices[p]] += static_cast<Wide>(A.values[p]) * xo;
+                }
+            };
+            if (parts == 1)
+                accumulate(0);
+            else
+                parallelFor(parts, {.threads = parts, .minElements = 0}, [&](size_t first, size_t last)
+                {
+                    for (size_t part = first; part < last; ++part)
+                        accumulate(part);
+                });
+            parallelFor(inner, policy, [&](size_t first, size_t last)
+            {
+                for (size_t i = first; i < last; ++i)
+                {
+                    Wide sum = partial[i];
+                    for (size_t part = 1; part < parts; ++part)
+                        sum += partial[part * inner + i];
+                    Number& yi = y[i * incy];
+                    yi = beta == Number{} ? static_cast<Number>(static_cast<Wide>(alpha) * sum)
+                                          : static_cast<Number>(static_cast<Wide>(alpha) * sum + static_cast<Wide>(beta) * static_cast<Wide>(yi));
+                }
+            }, inner * parts);
+        }
+
+        // acc[0..N) += value * B(k, 0..N), in the compute type.
+        template<Numeric Number>
+        [[gnu::always_inline]] inline void sparseAxpyRow(ComputeType<Number>* acc, ComputeType<Number> value, const Number* Bk,
+                                                         size_t csB, size_t N, ComputeType<Number>* widened) noexcept
+        {
+            using Wide = ComputeType<Number>;
+            if (csB == 1)
+            {
+                if constexpr (ReducedFloat<Number>)
+                {
+                    Simd::widen(widened, Bk, N);
+                    Simd::axpy(acc, widened, value, N);
+                }
+                else
+                    Simd::axpy(acc, Bk, value, N);
+                return;
+            }
+            for (size_t j = 0; j < N; ++j)
+                acc[j] += value * static_cast<Wide>(Bk[j * csB]);
+        }
+
+        // C(i, j) = alpha * acc[j] + beta * C(i, j) for one row of C.
+        template<Numeric Number>
+        [[gnu::always_inline]] inline void sparseStoreRow(Number* Ci, size_t csC, const ComputeType<Number>* acc, size_t N,
+                                                          Number alpha, Number beta) noexcept
+        {
+            using Wide = ComputeType<Number>;
+            const auto a = static_cast<Wide>(alpha);
+            const auto b = static_cast<Wide>(beta);
+            for (size_t j = 0; j < N; ++j)
+            {
+                Number& c = Ci[j * csC];
+                c = beta == Number{} ? static_cast<Number>(a * acc[j]) : static_cast<Number>(a * acc[j] + b * static_cast<Wide>(c));
+            }
+        }
+    }
+
+    // y = alpha * A * x + beta * y   (A is rows x cols, x has cols and y rows elements).
+    // CSR: rows are split across the pool. CSC: see detail::spmvScatter.
+    template<Numeric Number, SparseLayout Layout>
+    void spmv(Number alpha, const SparseView<Number, Layout>& A, const Number* x, size_t incx,
+              Number beta, Number* y, size_t incy, const Parallel& policy = Parallel::current())
+    {
+        if (A.rows == 0)
+            return;
+        LINALG_PROFILE_KERNEL("spmv", A.nonZeros() * (sizeof(Number) + sizeof(SparseIndex)) + (A.outer() + 1) * sizeof(size_t) +
+                              (A.rows + A.cols) * sizeof(Number), 2 * A.nonZeros());
+        if constexpr (Layout == SparseLayout::RowMajor)
+            parallelFor(A.rows, policy, [&](size_t first, size_t last)
+            {
+                LINALG_PROFILE_SCOPE("spmv.rows");
+                detail::spmvGather(first, last, alpha, A, x, incx, beta, y, incy);
+            }, A.nonZeros() + A.rows);
+        else
+            detail::spmvScatter(alpha, A, x, incx, beta, y, incy, policy);
+    }
+
+    // y = alpha * A^T * x + beta * y   (x has rows and y cols elements): the backward pass of
+    // y = A x, e.g. the weight gradient X^T * error of a sparse batch X.
+    template<Numeric Number, SparseLayout Layout>
+    void spmvTransposed(Number alpha, const SparseView<Number, Layout>& A, const Number* x, size_t incx,
+                        Number beta, Number* y, size_t incy, const Parallel& policy = Parallel::current())
+    {
+        spmv(alpha, A.transposed(), x, incx, beta, y, incy, policy);
+    }
+
+    // C = alpha * A * B + beta * C   (A sparse rows x K, B dense K x N, C dense rows x N), dense
+    // operands with row / column strides as in gemm.
+    //   CSR : rows of C split across the pool; every stored A(i, k) adds A(i, k) * B(k, :) into a
+    //         row accumulator (an axpy over N), which is written to C once.
+    //   CSC : every stored A(i, k) adds into row i of C, so the pool splits the N columns of C
+    //         instead and every part keeps a rows x width accumulator.
+    // Accumulators use ComputeType<Number>, so 16-bit operands are only rounded once.
+    template<Numeric Number, SparseLayout Layout>
+    void spmm(size_t N, Number alpha, const SparseView<Number, Layout>& A, const Number* B, size_t rsB, size_t csB,
+              Number beta, Number* C, size_t rsC, size_t csC, const Parallel& policy = Parallel::current())
+    {
+        using Wide = ComputeType<Number>;
+        if (A.rows == 0 || N == 0)
+            return;
+        LINALG_PROFILE_KERNEL("spmm", A.nonZeros() * (sizeof(Number) + sizeof(SparseIndex)) + (A.outer() + 1) * sizeof(size_t) +
+                              (A.cols + 2 * A.rows) * N * sizeof(Number), 2 * A.nonZeros() * N);
+        if constexpr (Layout == SparseLayout::RowMajor)
+        {
+            parallelFor(A.rows, policy, [&](size_t first, size_t last)
+            {
+                LINALG_PROFILE_SCOPE("spmm.rows");
+                // Only used within this chunk, which never waits -> reused per thread, like gemm's A block.
+                thread_local std::vector<Wide, AlignedAllocator<Wide>> acc, widened;
+                acc.resize(std::max(acc.size(), N));
+                if constexpr (ReducedFloat<Number>)
+                    widened.resize(std::max(widened.size(), N));
+                for (size_t i = first; i < last; ++i)
+                {
+                    std::fill_n(acc.data(), N, Wide{});
+                    for (size_t p = A.offsets[i]; p < A.offsets[i + 1]; ++p)
+                        detail::sparseAxpyRow(acc.data(), static_cast<Wide>(A.values[p]), B + A.indices[p] * rsB, csB, N, widened.data());
+                    detail::sparseStoreRow(C + i * rsC, csC, acc.data(), N, alpha, beta);
+                }
+            }, (A.nonZeros() + A.rows) * N);
+        }
+        else
+        {
+            const size_t parts = std::min(detail::sparseThreads(policy, (A.nonZeros() + A.rows) * N), N);
+            parallelFor(parts, {.threads = parts, .minElements = 0}, [&](size_t first, size_t last)
+            {
+                LINALG_PROFILE_SCOPE("spmm.columns");
+                thread_local std::vector<Wide, AlignedAllocator<Wide>> acc, widened;
+                for (size_t part = first; part < last; ++part)
+                {
+                    const size_t j0 = N * part / parts, width = N * (part + 1) / parts - j0;
+                    acc.resize(std::max(acc.size(), A.rows * width));
+                    std::fill_n(acc.data(), A.rows * width, Wide{});
+                    if constexpr (ReducedFloat<Number>)
+                        widened.resize(std::max(widened.size(), width));
+                    for (size_t k = 0; k < A.cols; ++k)
+                    {
+                        const Number* Bk = B + k * rsB + j0 * csB;
+                        for (size_t p = A.offsets[k]; p < A.offsets[k + 1]; ++p)
+                            detail::sparseAxpyRow(acc.data() + A.indices[p] * width, static_cast<Wide>(A.values[p]), Bk, csB, width, widened.data());
+                    }
+                    for (size_t i = 0; i < A.rows; ++i)
+                        detail::sparseStoreRow(C + i * rsC + j0 * csC, csC, acc.data() + i * width, width, alpha, beta);
+                }
+            });
+        }
+    }
+
+    // C = alpha * A^T * B + beta * C   (B dense rows x N, C dense cols x N).
+    template<Numeric Number, SparseLayout Layout>
+    void spmmTransposed(size_t N, Number alpha, const SparseView<Number, Layout>& A, const Number* B, size_t rsB, size_t csB,
+                        Number beta, Number* C, size_t rsC, size_t csC, const Parallel& policy = Parallel::current())
+    {
+        spmm(N, alpha, A.transposed(), B, rsB, csB, beta, C, rsC, csC, policy);
+    }
+
+    // Convenience wrappers over the library containers, like matmul / matvec.
+    template<Numeric Number, SparseLayout Layout, typename AllocA, typename AllocX>
+    auto matvec(const SparseMatrix<Number, Layout, AllocA>& a, const VectorX<Number, AllocX>& x) -> VectorX<Number, AllocX>
+    {
+        assert(a.cols() == x.size());
+        VectorX<Number, AllocX> result(a.rows(), x.get_allocator());
+        spmv(Number{1}, a.view(), x.data(), size_t{1}, Number{}, result.data(), size_t{1});
+        return result;
+    }
+    template<Numeric Number, SparseLayout Layout, typename AllocA, typename AllocB>
+    auto matmul(const SparseMatrix<Number, Layout, AllocA>& a, const MatrixX<Number, AllocB>& b) -> MatrixX<Number, AllocB>
+    {
+        assert(a.cols() == b.rows());
+        MatrixX<Number, AllocB> result(a.rows(), b.cols(), b.get_allocator());
+        spmm(b.cols(), Number{1}, a.view(), b.data(), b.cols(), size_t{1}, Number{}, result.data(), result.cols(), size_t{1});
+        return result;
+    }
+    // Dense * sparse: (B^T A^T)^T, i.e. the CSR arrays of A read as the CSC arrays of A^T and
+    // written into C through swapped strides.
+    template<Numeric Number, typename AllocA, SparseLayout Layout, typename AllocB>
+    auto matmul(const MatrixX<Number, AllocA>& a, const SparseMatrix<Number, Layout, AllocB>& b) -> MatrixX<Number, AllocA>
+    {
+        assert(a.cols() == b.rows());
+        MatrixX<Number, AllocA> result(a.rows(), b.cols(), a.get_allocator());
+        spmm(a.rows(), Number{1}, b.view().transposed(), a.data(), size_t{1}, a.cols(),
+             Number{}, result.data(), size_t{1}, result.cols());
+        return result;
+    }
+}
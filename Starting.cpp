@@ -3,6 +3,11 @@
 //
 
 #include "Starting.h"
+#include "Training.h"
+#include "Checkpoint.h"
+#include "Pipeline.h"
+#include <filesystem>
+#include <stdexcept>
 void Start::Run()
 {
     static constexpr std::array<Start::TrainingData, 4> dataset
@@ -15,32 +20,91 @@ void Start::Run()
         }
     };
 
+    // The same four samples in structure-of-arrays form for the training engine.
+    std::array<double, dataset.size()> inputs{};
+    std::array<double, dataset.size()> targets{};
+    for (size_t i = 0; i < dataset.size(); ++i)
+    {
+        inputs[i] = dataset[i].input;
+        targets[i] = dataset[i].expectedOutput;
+    }
+
     Start::Neuron n;
     n.weight = 0.5;
     n.bias = 0.0;
 
+    // Resume from the previous run's weights when it left a checkpoint behind.
+    static constexpr const char* checkpointPath = "neuron.ckpt";
+    ML::LinearModel<double> model(1, n.weight, n.bias);
+    if (std::filesystem::exists(checkpointPath))
+    {
+        try
+        {
+            ML::loadCheckpoint(ML::MappedCheckpoint(checkpointPath), model);
+            n.weight = model.weights[0];
+            n.bias = model.bias;
+            std::println("Resumed from {}", checkpointPath);
+        }
+        catch (const std::runtime_error& error)
+        {
+            std::println("Ignoring checkpoint: {}", error.what());
+            model = ML::LinearModel<double>(1, n.weight, n.bias);
+        }
+    }
+
     double learningRate = 0.05;
     uint16_t epochs = 500;
     std::println("Initial Guess: {}", n.predict(5.0));
     std::println("Training Daw......");
 
-    for (uint16_t i = 0; i < epochs; ++i)
-    {
-        double totalError = 0.0;
-        for (const auto& data : dataset)
-        {
-            double prediction = n.predict(data.input);
-            double error = prediction - data.expectedOutput;
+    // batchSize 1 keeps the original per-sample SGD: update after every sample. The pipeline
+    // prepares the next sample on its own thread while the current one trains; unshuffled, it
+    // delivers them in the original order.
+    ML::DataPipeline<double> pipeline(ML::DatasetView<double>::packed(inputs, targets, 1),
+                                      {.batchSize = 1, .buffers = 2, .workers = 1, .shuffle = false});
+    const ML::LinearModel<double> initial = model;
+    const auto result = ML::trainLinear(model, pipeline,
+                                        {.epochs = epochs, .learningRate = learningRate,
+                                         .onEpoch = [](const ML::EpochReport& report)
+                                         {
+                                             if ((report.epoch + 1) % 100 == 0)
+                                                 std::println("Epoch {}: loss {:.6f}, gradient norm {:.6f}, {:.0f} samples/s",
+                                                              report.epoch + 1, report.loss, report.gradientNorm, report.samplesPerSecond);
+                                         }});
+    const auto stats = pipeline.stats();
+    std::println("Data pipeline: {} batches, trainer waited {:.3f} ms, producer waited {:.3f} ms",
+                 stats.batchesConsumed, stats.consumerWaitSeconds * 1e3, stats.producerWaitSeconds * 1e3);
 
-            n.weight -= learningRate * (error * data.input);
-            n.bias -= learningRate * (error * 1.0);
-            totalError += (error * error);
-        }
+    n.weight = model.weights[0];
+    n.bias = model.bias;
+    // The demo still finishes where the checkpoint cannot be written (e.g. a read-only directory).
+    try
+    {
+        ML::saveCheckpoint(checkpointPath, model);
     }
+    catch (const std::runtime_error& error)
+    {
+        std::println("Checkpoint not saved: {}", error.what());
+    }
+
     std::println("Training Complete");
+    std::println("Final Loss: {}", result.history.back().loss);
     std::println("Final Weight: {}", n.weight);
     std::println("Final Bias: {}", n.bias);
 
+    // The same start trained with SGD plus momentum instead; momentum carries the update across
+    // samples, so it needs a smaller step (0.05 with momentum 0.9 diverges on these inputs).
+    auto momentumModel = initial;
+    ML::Sgd<double> optimizer({.learningRate = {.initial = 0.01}, .momentum = 0.9});
+    const auto momentum = ML::trainLinear(momentumModel, ML::DatasetView<double>::packed(inputs, targets, 1),
+                                          {.epochs = epochs, .batchSize = 1}, optimizer);
+    std::println("SGD + momentum 0.9 at lr 0.01: final loss {}, weight {}, bias {}",
+                 momentum.history.back().loss, momentumModel.weights[0], momentumModel.bias);
+
+    // The same fit in one step: least squares on the normal equations (Cholesky).
+    const auto direct = ML::fitLinear(ML::DatasetView<double>::packed(inputs, targets, 1));
+    std::println("Closed-form fit: weight {}, bias {}", direct.weights[0], direct.bias);
+
     double testValue = 10; // (10 * 2) + (5 * 10) = 20 + 50 = 70
     std::println("Result: {:.1f}", n.predict(testValue));
 }
\ No newline at end of file
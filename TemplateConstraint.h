@@ -2,8 +2,26 @@
 #include <type_traits>
 namespace LinAlg
 {
+    // 16-bit storage formats (Float16 / BFloat16 in HalfPrecision.h, std::float16_t / std::bfloat16_t
+    // where the compiler has them) opt in here. They are Numeric, but kernels never compute in
+    // them: values are widened to ComputeType<T> (float), combined, and only the stored result is
+    // narrowed again.
     template<typename T>
-    concept Numeric = std::is_arithmetic_v<T>; // only numeric data types
+    inline constexpr bool is_reduced_float_v = false;
+    template<typename T>
+    concept ReducedFloat = is_reduced_float_v<T>;
+
+    template<typename T>
+    concept Numeric = std::is_arithmetic_v<T> || ReducedFloat<T>; // only numeric data types
+
+    // Type the kernels compute and accumulate in: T itself, float for the 16-bit formats.
+    template<typename T>
+    struct ComputeTypeOf
+    {
+        using type = T;
+    };
+    template<typename T>
+    using ComputeType = typename ComputeTypeOf<T>::type;
 
     template<Numeric Number>
     constexpr Number T_zero_init()
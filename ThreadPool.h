@@ -0,0 +1,325 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace LinAlg
+{
+    // Per-call execution policy for the parallel kernels.
+    //   threads     : upper bound on threads working on ONE call (caller included). 0 = whole pool.
+    //   minElements : below this amount of work the call stays on the calling thread, so the small
+    //                 fixed-size Matrix / Vector types never pay for waking workers up.
+    // Operators that cannot take an extra argument (a += b on MatrixX, ...) use
+    // Parallel::current(), which ParallelScope overrides for the current thread.
+    struct Parallel
+    {
+        size_t threads = 0;
+        size_t minElements = size_t{1} << 15;
+
+        static Parallel& current() noexcept
+        {
+            thread_local Parallel policy{};
+            return policy;
+        }
+    };
+
+    // RAII override of Parallel::current():
+    //   { LinAlg::ParallelScope scope{{.threads = 4}}; weights += gradient; }
+    class ParallelScope
+    {
+    public:
+        explicit ParallelScope(Parallel policy) noexcept : m_previous(Parallel::current())
+        {
+            Parallel::current() = policy;
+        }
+        ~ParallelScope() { Parallel::current() = m_previous; }
+        ParallelScope(const ParallelScope&) = delete;
+        ParallelScope& operator=(const ParallelScope&) = delete;
+    private:
+        Parallel m_previous;
+    };
+
+    // Work-stealing pool.
+    // Every worker owns a deque: it pops its own work from the back (hot in cache) and, when empty,
+    // steals from the front of the other deques. A parallel call does not enqueue one task per
+    // chunk; it enqueues (threads - 1) "join tokens". Whoever runs a token (or the caller itself)
+    // keeps grabbing chunks from the call's shared counter until none are left, so at most
+    // 'threads' threads ever touch one call and the chunks balance themselves dynamically.
+    // The calling thread always participates and, while waiting, runs any queued task, so nested
+    // parallel calls from inside a worker cannot deadlock.
+    // Kernels passed to the pool must not throw (an escaping exception terminates).
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(size_t workers = defaultWorkerCount()) : m_queues(workers)
+        {
+            for (auto& queue : m_queues)
+                queue = std::make_unique<Queue>();
+            m_threads.reserve(workers);
+            for (size_t i = 0; i < workers; ++i)
+                m_threads.emplace_back([this, i] { workerLoop(i); });
+        }
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard lock(m_sleepMutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (auto& thread : m_threads)
+                thread.join();
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        static ThreadPool& global()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+        // LINALG_NUM_THREADS (total threads, caller included) overrides the hardware count.
+        static size_t defaultWorkerCount() noexcept
+        {
+            size_t threads = std::thread::hardware_concurrency();
+            if (const char* env = std::getenv("LINALG_NUM_THREADS"))
+                threads = std::strtoul(env, nullptr, 10);
+            return threads > 1 ? threads - 1 : 0; // the caller is the extra thread
+        }
+        // Threads available to one call (workers + the caller).
+        [[nodiscard]] size_t concurrency() const noexcept { return m_threads.size() + 1; }
+
+        // Runs fn(chunkIndex) for every chunk in [0, chunkCount) on up to 'threads' threads.
+        template<typename Fn>
+        void run(size_t chunkCount, size_t threads, Fn&& fn)
+        {
+            threads = std::min({threads == 0 ? concurrency() : threads, concurrency(), chunkCount});
+            if (threads <= 1)
+            {
+                for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+                    fn(chunk);
+                return;
+            }
+            Job job{&invoke<std::remove_reference_t<Fn>>, &fn, chunkCount};
+            job.tokens.store(threads - 1, std::memory_order_relaxed);
+            for (size_t t = 0; t < threads - 1; ++t)
+                push(Task{&job}, t);
+            job.work();
+            // Tokens still queued must be consumed before 'job' leaves the stack.
+            while (job.tokens.load(std::memory_order_acquire) != 0)
+            {
+                if (!runOne(m_queues.size()))
+                    std::this_thread::yield();
+            }
+        }
+    private:
+        struct Job
+        {
+            void (*call)(void*, size_t);
+            void* fn;
+            size_t chunkCount;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> tokens{0};
+
+            void work() noexcept
+            {
+                for (size_t chunk = next.fetch_add(1, std::memory_order_relaxed); chunk < chunkCount;
+                     chunk = next.fetch_add(1, std::memory_order_relaxed))
+                    call(fn, chunk);
+            }
+        };
+        struct Task
+        {
+            Job* job;
+        };
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        template<typename Fn>
+        static void invoke(void* fn, size_t chunk) { (*static_cast<Fn*>(fn))(chunk); }
+
+        static void execute(Task task) noexcept
+        {
+            task.job->work();
+            task.job->tokens.fetch_sub(1, std::memory_order_release);
+        }
+
+        void push(Task task, size_t hint)
+        {
+            auto& queue = *m_queues[(m_nextQueue.fetch_add(1, std::memory_order_relaxed) + hint) % m_queues.size()];
+            {
+                std::lock_guard lock(queue.mutex);
+                queue.tasks.push_back(task);
+            }
+            {
+                std::lock_guard lock(m_sleepMutex);
+                m_pending.fetch_add(1, std::memory_order_release);
+            }
+            m_wake.notify_one();
+        }
+
+        // Own queue from the back, everybody else's from the front. 'self' == m_queues.size()
+        // means "not a worker" (a caller helping out) -> steal only.
+        bool runOne(size_t self)
+        {
+            Task task{};
+            bool found = false;
+            if (self < m_queues.size())
+            {
+                auto& own = *m_queues[self];
+                std::lock_guard lock(own.mutex);
+                if (!own.tasks.empty())
+                {
+                    task = own.tasks.back();
+                    own.tasks.pop_back();
+                    found = true;
+                }
+            }
+            for (size_t i = 1; !found && i <= m_queues.size(); ++i)
+            {
+                auto& victim = *m_queues[(self + i) % m_queues.size()];
+                std::lock_guard lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    found = true;
+                }
+            }
+            if (!found)
+                return false;
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            execute(task);
+            return true;
+        }
+
+        void workerLoop(size_t self)
+        {
+            while (true)
+            {
+                if (runOne(self))
+                    continue;
+                std::unique_lock lock(m_sleepMutex);
+                m_wake.wait(lock, [this] { return m_stopping || m_pending.load(std::memory_order_acquire) != 0; });
+                if (m_stopping)
+                    return;
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_threads;
+        std::atomic<size_t> m_nextQueue{0};
+        std::atomic<size_t> m_pending{0};
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+    };
+
+    // Scratch memory of one kernel call that shares it with the pool, e.g. gemm's packed B panel.
+    // A plain thread_local buffer is not enough: while the caller waits in parallelFor it runs
+    // queued tasks, which may be another call of the same kernel on the same thread that would
+    // resize or overwrite the buffer under the outer call's workers. A lease takes the thread's
+    // buffer for the current nesting depth instead, and buffers are kept for the next calls ->
+    // no allocation in steady state. Holds at least 'count' elements of unspecified value.
+    template<typename T>
+    class ScratchLease
+    {
+    public:
+        explicit ScratchLease(size_t count)
+        {
+            size_t& level = depth();
+            auto& buffers = stack();
+            if (buffers.size() == level)
+                buffers.emplace_back();
+            m_buffer = &buffers[level];
+            if (m_buffer->size() < count)
+                m_buffer->resize(count);
+            ++level;
+        }
+        ~ScratchLease() { --depth(); }
+        ScratchLease(const ScratchLease&) = delete;
+        ScratchLease& operator=(const ScratchLease&) = delete;
+
+        [[nodiscard]] T* data() const noexcept { return m_buffer->data(); }
+        [[nodiscard]] T& operator[](size_t i) const noexcept { return m_buffer->data()[i]; }
+    private:
+        using Buffer = std::vector<T, AlignedAllocator<T>>;
+        static size_t& depth() noexcept
+        {
+            thread_local size_t level = 0;
+            return level;
+        }
+        // A deque never moves its elements, so growing it leaves the outer leases' buffers alone.
+        static std::deque<Buffer>& stack() noexcept
+        {
+            thread_local std::deque<Buffer> buffers;
+            return buffers;
+        }
+        Buffer* m_buffer = nullptr;
+    };
+
+    // fn(begin, end) over [0, count) split into contiguous ranges.
+    // 'work' is the cost of the whole call in elements; it defaults to count and is compared against
+    // policy.minElements to decide whether going parallel is worth it at all.
+    template<typename Fn>
+    void parallelFor(size_t count, const Parallel& policy, Fn&& fn, size_t work = 0)
+    {
+        if (work == 0)
+            work = count;
+        auto& pool = ThreadPool::global();
+        const size_t threads = std::min(policy.threads == 0 ? pool.concurrency() : policy.threads, pool.concurrency());
+        if (count == 0)
+            return;
+        if (threads <= 1 || work < policy.minElements || count < 2)
+        {
+            fn(size_t{0}, count);
+            return;
+        }
+        // A few chunks per thread so a slow (or late) thread does not hold everyone up.
+        const size_t chunkCount = std::min(count, threads * 4);
+        const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        pool.run((count + chunkSize - 1) / chunkSize, threads, [&](size_t chunk)
+        {
+            const size_t begin = chunk * chunkSize;
+            fn(begin, std::min(count, begin + chunkSize));
+        });
+    }
+
+    // Reduces map(begin, end) -> T over contiguous ranges with combine(T, T).
+    // Partial results are combined in chunk order, so for a fixed chunk count the result does not
+    // depend on which thread ran which chunk.
+    template<typename T, typename Map, typename Combine>
+    T parallelReduce(size_t count, T init, const Parallel& policy, Map&& map, Combine&& combine)
+    {
+        auto& pool = ThreadPool::global();
+        const size_t threads = std::min(policy.threads == 0 ? pool.concurrency() : policy.threads, pool.concurrency());
+        if (count == 0)
+            return init;
+        if (threads <= 1 || count < policy.minElements)
+            return combine(init, map(size_t{0}, count));
+        const size_t chunkCount = std::min(count, threads * 4);
+        const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        const size_t chunks = (count + chunkSize - 1) / chunkSize;
+        // Leased: reductions run in hot loops and must not allocate once warmed up.
+        const ScratchLease<T> partial(chunks);
+        pool.run(chunks, threads, [&](size_t chunk)
+        {
+            const size_t begin = chunk * chunkSize;
+            partial[chunk] = map(begin, std::min(count, begin + chunkSize));
+        });
+        T result = init;
+        for (size_t chunk = 0; chunk < chunks; ++chunk)
+            result = combine(result, partial[chunk]);
+        return result;
+    }
+}
@@ -0,0 +1,385 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "DynamicMatrices.h"
+#include "MatMul.h"
+#include "SparseMatrices.h"
+#include "Reductions.h"
+#include "Solvers.h"
+#include "Optimizers.h"
+#include "SimdKernels.h"
+#include "Profiling.h"
+#include <span>
+#include <vector>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+namespace ML
+{
+    // A dataset in structure-of-arrays layout: every feature is one contiguous column
+    //   inputs  : feature 0 of rows 0..N-1, then feature 1 of rows 0..N-1, ...
+    //   targets : expected output of rows 0..N-1
+    // so a mini-batch [begin, end) is 'features' contiguous slices plus one target slice, and every
+    // step of the training loop below is a vector kernel over those slices.
+    // featureStride is the distance (in elements) between two feature columns; it is rows() for a
+    // tightly packed buffer and can be larger when columns are padded for alignment.
+    template<LinAlg::Numeric Number>
+    struct DatasetView
+    {
+        std::span<const Number> inputs;
+        std::span<const Number> targets;
+        size_t rows = 0;
+        size_t features = 0;
+        size_t featureStride = 0;
+
+        static DatasetView packed(std::span<const Number> inputs, std::span<const Number> targets, size_t features) noexcept
+        {
+            const size_t rows = targets.size();
+            assert(inputs.size() == rows * features);
+            return {inputs, targets, rows, features, rows};
+        }
+        [[nodiscard]] const Number* feature(size_t f) const noexcept { return inputs.data() + f * featureStride; }
+        // Samples [begin, begin + count) as a count x features matrix, read in place (column-major).
+        [[nodiscard]] auto batch(size_t begin, size_t count) const noexcept -> LinAlg::MatrixView<const Number>
+        {
+            assert(begin + count <= rows);
+            return {inputs.data() + begin, count, features, size_t{1}, featureStride};
+        }
+    };
+
+    template<LinAlg::Numeric Number>
+    struct LinearModel
+    {
+        LinAlg::VectorX<Number> weights;
+        Number bias{};
+
+        LinearModel() = default;
+        explicit LinearModel(size_t features, Number initialWeight = Number{}, Number initialBias = Number{})
+            : weights(features, initialWeight), bias(initialBias) {}
+
+        auto predict(std::span<const Number> input) const noexcept -> Number
+        {
+            assert(input.size() == weights.size());
+            Number sum = bias;
+            for (size_t f = 0; f < input.size(); ++f)
+                sum += weights[f] * input[f];
+            return sum;
+        }
+    };
+
+    struct EpochReport
+    {
+        size_t epoch = 0;
+        double loss = 0.0;          // mean squared error over the epoch (measured before each update)
+        double seconds = 0.0;
+        double samplesPerSecond = 0.0;
+        // Root mean square over the epoch's batches of the L2 norm of the gradient each update
+        // applies (all weights and biases). Shrinks towards 0 as training converges; blowing up
+        // means the learning rate is too high.
+        double gradientNorm = 0.0;
+        // Time the trainer spent blocked waiting for batches from a DataPipeline (0 when it trains
+        // on an in-memory dataset directly). Close to 0 means data preparation is fully hidden.
+        double dataWaitSeconds = 0.0;
+    };
+
+    struct TrainConfig
+    {
+        size_t epochs = 500;
+        size_t batchSize = 32;
+        // Step size of the trainers' default optimizer, plain gradient descent (Optimizers.h). The
+        // overloads taking an optimizer use its schedule instead.
+        double learningRate = 0.05;
+        // Batches stay contiguous; only their order is shuffled (seeded, reproducible).
+        bool shuffleBatches = false;
+        uint64_t seed = 0;
+        // Early stopping: stop after 'patience' epochs without the loss improving by more than
+        // minDelta. 0 disables it.
+        size_t patience = 0;
+        double minDelta = 0.0;
+        // Called after every epoch (optional).
+        std::function<void(const EpochReport&)> onEpoch;
+    };
+
+    struct TrainResult
+    {
+        std::vector<EpochReport> history;
+        double bestLoss = std::numeric_limits<double>::infinity();
+        size_t bestEpoch = 0;
+        bool stoppedEarly = false;
+    };
+
+    namespace detail
+    {
+        // How every trainer sums its loss and gradient norms.
+        inline constexpr LinAlg::Reduction LOSS_SUMMATION{.summation = LinAlg::Summation::Kahan};
+
+        // Records the epoch, reports it and applies early stopping. false = stop training.
+        inline bool finishEpoch(TrainResult& result, const EpochReport& report, const TrainConfig& config,
+                                size_t& epochsWithoutImprovement)
+        {
+            result.history.push_back(report);
+            if (config.onEpoch)
+                config.onEpoch(report);
+            if (report.loss < result.bestLoss - config.minDelta)
+            {
+                result.bestLoss = report.loss;
+                result.bestEpoch = report.epoch;
+                epochsWithoutImprovement = 0;
+            }
+            else if (config.patience != 0 && ++epochsWithoutImprovement >= config.patience)
+            {
+                result.stoppedEarly = true;
+                return false;
+            }
+            return true;
+        }
+
+        // The optimizer of the overloads without one.
+        template<LinAlg::Numeric Number>
+        auto gradientDescent(const TrainConfig& config) -> Sgd<Number>
+        {
+            return Sgd<Number>({.learningRate = {.initial = config.learningRate}, .momentum = 0.0});
+        }
+
+        // One update of the linear model on the batch [begin, begin + rows) (predict / gradientOf as
+        // below, y the batch's targets, err scratch for 'rows' values). Adds the batch's squared error
+        // to totalError and returns its squared gradient norm (per-sample scaled) for gradientNorm.
+        template<LinAlg::Numeric Number, Optimizer<Number> Opt, typename Predict, typename Gradient>
+        double linearStep(LinearModel<Number>& model, size_t begin, size_t rows, const Number* y, Number* err,
+                          LinAlg::VectorX<Number>& gradient, Opt& optimizer, const Predict& predict,
+                          const Gradient& gradientOf, double& totalError)
+        {
+            predict(begin, rows, err);
+            LinAlg::Simd::addScalar(err, err, model.bias, rows);
+            LinAlg::Simd::sub(err, err, y, rows);
+
+            // Compensated sums: a float batch loses no more than one rounding of the result.
+            const Number errorSum = static_cast<Number>(LinAlg::sum(err, rows, LOSS_SUMMATION));
+            totalError += static_cast<double>(LinAlg::squaredNorm(err, rows, LOSS_SUMMATION));
+            gradientOf(begin, rows, static_cast<const Number*>(err), gradient.data());
+
+            const double squares = static_cast<double>(errorSum) * static_cast<double>(errorSum) +
+                                   static_cast<double>(gradient.squaredNorm(LOSS_SUMMATION));
+
+            // Both gradients are sums over the batch: the optimizer averages them.
+            const Parameter<Number> parameters[]{{model.weights.data(), gradient.data(), gradient.size()},
+                                                 {&model.bias, &errorSum, 1}};
+            optimizer.step(parameters, 1.0 / static_cast<double>(rows));
+            return squares / (static_cast<double>(rows) * static_cast<double>(rows));
+        }
+
+        // The mini-batch loop shared by the dense and sparse trainLinear. Per batch [begin, begin + rows):
+        //   predict(begin, rows, out)             : out = X_B w          (rows values)
+        //   gradient(begin, rows, error, out)     : out = X_B^T error    (features values)
+        template<LinAlg::Numeric Number, Optimizer<Number> Opt, typename Predict, typename Gradient>
+        auto trainLinearLoop(LinearModel<Number>& model, size_t rowCount, std::span<const Number> targets,
+                             const TrainConfig& config, Opt& optimizer, const Predict& predict,
+                             const Gradient& gradientOf) -> TrainResult
+        {
+            TrainResult result;
+            if (rowCount == 0 || config.epochs == 0)
+                return result;
+            const size_t features = model.weights.size();
+            const size_t batchSize = std::clamp<size_t>(config.batchSize, 1, rowCount);
+            const size_t batchCount = (rowCount + batchSize - 1) / batchSize;
+
+            // Everything the loop touches is allocated once up front.
+            LinAlg::VectorX<Number> prediction(batchSize);
+            LinAlg::VectorX<Number> gradient(features);
+            std::vector<size_t> order(batchCount);
+            std::iota(order.begin(), order.end(), size_t{0});
+            std::mt19937_64 rng(config.seed);
+            result.history.reserve(config.epochs);
+            size_t epochsWithoutImprovement = 0;
+
+            for (size_t epoch = 0; epoch < config.epochs; ++epoch)
+            {
+                LINALG_PROFILE_SCOPE("trainLinear.epoch");
+                const auto start = std::chrono::steady_clock::now();
+                if (config.shuffleBatches)
+                    std::ranges::shuffle(order, rng);
+                double totalError = 0.0;
+                double gradientSquares = 0.0;
+                for (const size_t batch : order)
+                {
+                    const size_t begin = batch * batchSize;
+                    const size_t rows = std::min(batchSize, rowCount - begin);
+                    gradientSquares += linearStep(model, begin, rows, targets.data() + begin, prediction.data(), gradient,
+                                                  optimizer, predict, gradientOf, totalError);
+                }
+
+                EpochReport report;
+                report.epoch = epoch;
+                report.loss = totalError / static_cast<double>(rowCount);
+                report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                report.samplesPerSecond = report.seconds > 0.0 ? static_cast<double>(rowCount) / report.seconds : 0.0;
+                report.gradientNorm = std::sqrt(gradientSquares / static_cast<double>(batchCount));
+                if (!finishEpoch(result, report, config, epochsWithoutImprovement))
+                    break;
+            }
+            return result;
+        }
+    }
+
+    // Mini-batch gradient descent on squared error for y = w . x + b.
+    // Per batch of B rows (X_B is B x features, column-major straight out of the dataset):
+    //   prediction = X_B w + b                    (gemv, one axpy per feature column)
+    //   error      = prediction - y_B             (SIMD sub)
+    //   gradient   = X_B^T error                  (gemv, one dot product per feature column)
+    //   w -= (lr / B) * gradient,  b -= (lr / B) * sum(error)
+    // With batchSize = 1 this is exactly the per-sample SGD of the original Start::Run.
+    // The last two lines are the default optimizer; with one (Optimizers.h) it gets both gradients
+    // divided by B instead.
+    template<LinAlg::Numeric Number, Optimizer<Number> Opt>
+    auto trainLinear(LinearModel<Number>& model, const DatasetView<Number>& data, const TrainConfig& config,
+                     Opt& optimizer) -> TrainResult
+    {
+        assert(model.weights.size() == data.features);
+        return detail::trainLinearLoop(model, data.rows, data.targets, config, optimizer,
+            [&](size_t begin, size_t rows, Number* out)
+            {
+                LinAlg::gemv(Number{1}, data.batch(begin, rows), model.weights.view(), Number{}, {out, rows});
+            },
+            [&](size_t begin, size_t rows, const Number* error, Number* out)
+            {
+                LinAlg::gemv(Number{1}, data.batch(begin, rows).transpose(), {error, rows}, Number{}, {out, data.features});
+            });
+    }
+    template<LinAlg::Numeric Number>
+    auto trainLinear(LinearModel<Number>& model, const DatasetView<Number>& data, const TrainConfig& config) -> TrainResult
+    {
+        auto optimizer = detail::gradientDescent<Number>(config);
+        return trainLinear(model, data, config, optimizer);
+    }
+
+    // The same training on sparse inputs: X is rows x features in CSR (one sample per row, e.g.
+    // hashed / one-hot features with millions of columns), targets one value per row. A batch is
+    // a row slice of X, the prediction an SpMV over it and the gradient a transposed SpMV, so a
+    // step costs O(nonzeros of the batch + features) instead of O(rows * features).
+    template<LinAlg::Numeric Number, Optimizer<Number> Opt>
+    auto trainLinear(LinearModel<Number>& model, const LinAlg::CsrView<Number>& inputs, std::span<const Number> targets,
+                     const TrainConfig& config, Opt& optimizer) -> TrainResult
+    {
+        assert(model.weights.size() == inputs.cols && targets.size() == inputs.rows);
+        return detail::trainLinearLoop(model, inputs.rows, targets, config, optimizer,
+            [&](size_t begin, size_t rows, Number* out)
+            {
+                LinAlg::spmv(Number{1}, inputs.slice(begin, begin + rows), model.weights.data(), size_t{1}, Number{}, out, size_t{1});
+            },
+            [&](size_t begin, size_t rows, const Number* error, Number* out)
+            {
+                LinAlg::spmvTransposed(Number{1}, inputs.slice(begin, begin + rows), error, size_t{1}, Number{}, out, size_t{1});
+            });
+    }
+    template<LinAlg::Numeric Number>
+    auto trainLinear(LinearModel<Number>& model, const LinAlg::CsrView<Number>& inputs, std::span<const Number> targets,
+                     const TrainConfig& config) -> TrainResult
+    {
+        auto optimizer = detail::gradientDescent<Number>(config);
+        return trainLinear(model, inputs, targets, config, optimizer);
+    }
+
+    enum class LinearSolver : uint8_t
+    {
+        Cholesky,   // normal equations: one pass over the data, then a features x features solve
+        Qr          // Householder QR of the data itself: slower, but accurate on ill-conditioned features
+    };
+
+    struct FitConfig
+    {
+        // Ridge penalty lambda on the weights (not on the bias). 0 = ordinary least squares.
+        double ridge = 0.0;
+        LinearSolver solver = LinearSolver::Cholesky;
+    };
+
+    // Closed-form fit of y = w . x + b: the model minimizing
+    //   sum over rows of (w . x + b - y)^2  +  ridge * |w|^2
+    // i.e. what trainLinear converges to (for ridge = 0), in one pass instead of many epochs.
+    // Features and targets are centered first, so the bias drops out of the system and is not
+    // penalized, and everything is computed in double whatever Number is:
+    //   Cholesky : (Xc^T Xc + ridge I) w = Xc^T yc, accumulated over blocks of rows with gemm
+    //   Qr       : least squares on [Xc; sqrt(ridge) I] w ~ [yc; 0] (copies the data)
+    //   b = mean(y) - w . mean(x)
+    // Throws std::runtime_error when the features are linearly dependent (use ridge > 0).
+    template<LinAlg::Numeric Number>
+    auto fitLinear(const DatasetView<Number>& data, const FitConfig& config = {}) -> LinearModel<Number>
+    {
+        const size_t rows = data.rows, features = data.features;
+        LinearModel<Number> model(features);
+        if (rows == 0)
+            return model;
+
+        std::vector<double> mean(features);
+        for (size_t f = 0; f < features; ++f)
+            mean[f] = static_cast<double>(LinAlg::sum(data.feature(f), rows, detail::LOSS_SUMMATION)) / static_cast<double>(rows);
+        const double targetMean = static_cast<double>(LinAlg::sum(data.targets.data(), rows, detail::LOSS_SUMMATION)) /
+                                  static_cast<double>(rows);
+
+        LinAlg::VectorX<double> weights;
+        if (config.solver == LinearSolver::Cholesky)
+        {
+            // Xc^T for a block of rows is features x block, straight out of the SoA columns.
+            const size_t block = std::min(std::max<size_t>((size_t{1} << 21) / std::max<size_t>(features, 1), 64), rows);
+            LinAlg::MatrixX<double> gram(features, features);
+            LinAlg::VectorX<double> moment(features);
+            LinAlg::MatrixX<double> centered(features, block);
+            LinAlg::VectorX<double> target(block);
+            for (size_t begin = 0; begin < rows; begin += block)
+            {
+                const size_t count = std::min(block, rows - begin);
+                for (size_t f = 0; f < features; ++f)
+                {
+                    const Number* column = data.feature(f) + begin;
+                    for (size_t r = 0; r < count; ++r)
+                        centered(f, r) = static_cast<double>(column[r]) - mean[f];
+                }
+                for (size_t r = 0; r < count; ++r)
+                    target[r] = static_cast<double>(data.targets[begin + r]) - targetMean;
+                LinAlg::gemm(features, features, count, 1.0, centered.data(), block, size_t{1}, centered.data(), size_t{1}, block,
+                             1.0, gram.data(), features, size_t{1});
+                LinAlg::gemv(features, count, 1.0, centered.data(), block, size_t{1}, target.data(), size_t{1},
+                             1.0, moment.data(), size_t{1});
+            }
+            for (size_t f = 0; f < features; ++f)
+                gram(f, f) += config.ridge;
+            const LinAlg::CholeskyDecomposition cholesky(std::move(gram));
+            if (!cholesky.positiveDefinite())
+                throw std::runtime_error("fitLinear: the features are linearly dependent (use ridge > 0)");
+            weights = cholesky.solve(std::move(moment));
+        }
+        else
+        {
+            const size_t penalty = config.ridge > 0.0 ? features : 0;
+            LinAlg::MatrixX<double> system(rows + penalty, features);
+            LinAlg::VectorX<double> target(rows + penalty);
+            for (size_t r = 0; r < rows; ++r)
+            {
+                for (size_t f = 0; f < features; ++f)
+                    system(r, f) = static_cast<double>(data.feature(f)[r]) - mean[f];
+                target[r] = static_cast<double>(data.targets[r]) - targetMean;
+            }
+            for (size_t f = 0; f < penalty; ++f)
+                system(rows + f, f) = std::sqrt(config.ridge);
+            if (system.rows() < features)
+                throw std::runtime_error("fitLinear: fewer rows than features (use ridge > 0)");
+            const LinAlg::QrDecomposition qr(std::move(system));
+            if (qr.rankDeficient())
+                throw std::runtime_error("fitLinear: the features are linearly dependent (use ridge > 0)");
+            weights = qr.solve(std::move(target));
+        }
+
+        double bias = targetMean;
+        for (size_t f = 0; f < features; ++f)
+        {
+            model.weights[f] = static_cast<Number>(weights[f]);
+            bias -= weights[f] * mean[f];
+        }
+        model.bias = static_cast<Number>(bias);
+        return model;
+    }
+}
@@ -1,5 +1,8 @@
 #pragma once
 #include "TemplateConstraint.h"
+#include "Expression.h"
+#include "SimdKernels.h"
+#include "Reductions.h"
 #include <print>
 
 #include "Vectors.h"
@@ -23,100 +26,107 @@ namespace LinAlg
         //constexpr const auto& data(this const auto& self){return self.data;}
         //constexpr auto& data(this auto& self){return self.data;}
         // Addition
-        constexpr auto operator+(this const auto& self, Number scalar) -> Derived
-        {
-            auto result = self;
-            self += scalar;
-            return result;
-        }
         constexpr auto operator+=(this auto& self, Number scalar) -> Derived&
         {
-            for (auto& n : self.data) n += scalar;
+            Simd::addScalar(self.data.data(), self.data.data(), scalar, size);
             return self;
         }
         constexpr auto operator+=(this auto& self, const VectorLike auto& other) -> Derived&
         {
-            for (size_t i = 0; i < other.data.size(); ++i)
-                self.data[i] = self.data[i] + other.data[i];
+            if constexpr (std::same_as<std::remove_cvref_t<decltype(other.data[0])>, Number>)
+                Simd::add(self.data.data(), self.data.data(), other.data.data(), other.data.size());
+            else
+                for (size_t i = 0; i < other.data.size(); ++i)
+                    self.data[i] = self.data[i] + other.data[i];
             return self;
         }
-        friend constexpr auto operator+(const auto& self, const auto& other) -> Derived
-        {
-            auto result = self;
-            result += other;
-            return result;
-        }
-        friend constexpr auto operator+(const auto& self, Number scalar) -> Derived
+        constexpr auto operator+=(this auto& self, const Expression auto& expr) -> Derived&
         {
-            auto result = self;
-            result += scalar;
-            return result;
+            evaluateExpr(self.data.data(), expr, std::plus{});
+            return self;
         }
         // Subtraction
-        constexpr auto operator-(this const auto& self, Number scalar) -> Derived
-        {
-            auto result = self;
-            self -= scalar;
-            return result;
-        }
         constexpr auto operator-=(this auto& self, Number scalar) -> Derived&
         {
-            for (auto& n : self.data) n -= scalar;
+            Simd::subScalar(self.data.data(), self.data.data(), scalar, size);
             return self;
         }
         constexpr auto operator-=(this auto& self, const VectorLike auto& other) -> Derived&
         {
-            for (size_t i = 0; i < other.data.size(); ++i)
-                self.data[i] = self.data[i] - other.data[i];
+            if constexpr (std::same_as<std::remove_cvref_t<decltype(other.data[0])>, Number>)
+                Simd::sub(self.data.data(), self.data.data(), other.data.data(), other.data.size());
+            else
+                for (size_t i = 0; i < other.data.size(); ++i)
+                    self.data[i] = self.data[i] - other.data[i];
             return self;
         }
-        friend constexpr auto operator-(const auto& self, const auto& other) -> Derived
+        constexpr auto operator-=(this auto& self, const Expression auto& expr) -> Derived&
         {
-            auto result = self;
-            result -= other;
-            return result;
-        }
-        friend constexpr auto operator-(const auto& self, Number scalar) -> Derived
-        {
-            auto result = self;
-            result -= scalar;
-            return result;
+            evaluateExpr(self.data.data(), expr, std::minus{});
+            return self;
         }
         // Multiplication
-        constexpr auto operator*(this const auto& self, Number scalar) -> Derived
-        {
-            auto result = self;
-            self *= scalar;
-            return result;
-        }
         constexpr auto operator*=(this auto& self, Number scalar) -> Derived&
         {
-            for (auto& n : self.data) n *= scalar;
+            Simd::mulScalar(self.data.data(), self.data.data(), scalar, size);
             return self;
         }
         constexpr auto operator*=(this auto& self, const VectorLike auto& other) -> Derived&
         {
-            for (size_t i = 0; i < other.data.size(); ++i)
-                self.data[i] = self.data[i] * other.data[i];
+            if constexpr (std::same_as<std::remove_cvref_t<decltype(other.data[0])>, Number>)
+                Simd::mul(self.data.data(), self.data.data(), other.data.data(), other.data.size());
+            else
+                for (size_t i = 0; i < other.data.size(); ++i)
+                    self.data[i] = self.data[i] * other.data[i];
             return self;
         }
-        friend constexpr auto operator*(const auto& self, const auto& other) -> Derived
+        constexpr auto operator*=(this auto& self, const Expression auto& expr) -> Derived&
         {
-            auto result = self;
-            result *= other;
-            return result;
+            evaluateExpr(self.data.data(), expr, std::multiplies{});
+            return self;
+        }
+        // Reductions (Reductions.h). A fixed-size vector is far below any parallel threshold, so
+        // they stay on the calling thread and keep working in constant expressions.
+        [[nodiscard]] constexpr auto sum(this const auto& self, Reduction mode = {}) -> ReduceType<Number>
+        {
+            return LinAlg::sum(self.data.data(), size, mode, Parallel{.threads = 1});
         }
-        friend constexpr auto operator*(const auto& self, Number scalar) -> Derived
+        [[nodiscard]] constexpr auto dot(this const auto& self, const Derived& other, Reduction mode = {}) -> ReduceType<Number>
         {
-            auto result = self;
-            result *= scalar;
-            return result;
+            return LinAlg::dot(self.data.data(), other.data.data(), size, mode, Parallel{.threads = 1});
         }
+        [[nodiscard]] constexpr auto squaredNorm(this const auto& self, Reduction mode = {}) -> ReduceType<Number>
+        {
+            return LinAlg::squaredNorm(self.data.data(), size, mode, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto norm(this const auto& self, Reduction mode = {}) -> NormType<Number>
+        {
+            return LinAlg::norm(self.data.data(), size, mode, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto minValue(this const auto& self) -> Number
+        {
+            return LinAlg::minValue(self.data.data(), size, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto maxValue(this const auto& self) -> Number
+        {
+            return LinAlg::maxValue(self.data.data(), size, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto argmin(this const auto& self) -> size_t
+        {
+            return LinAlg::argmin(self.data.data(), size, Parallel{.threads = 1});
+        }
+        [[nodiscard]] constexpr auto argmax(this const auto& self) -> size_t
+        {
+            return LinAlg::argmax(self.data.data(), size, Parallel{.threads = 1});
+        }
+        // The binary operators (+, -, *) are the lazy ones from Expression.h:
+        // Vector is an ExprSource through Vector::expr().
     };
 
     template<size_t size, Numeric Number>
     struct Vector : public VectorBase<Vector<size, Number>,size, Number>
     {
+        using value_type = Number;
         std::array<Number, size> data{T_zero_init<Number>()};
         // 1. Mutable versions (Existing)
         // Accessors (instead of raw x, y, z members)
@@ -143,6 +153,22 @@ namespace LinAlg
             std::copy_n(init.begin(), std::min(init.size(), size), data.begin());
         }
         Vector() = default;
+        // Evaluates a lazy expression (e.g. 'V3f r = a + b * c;') in a single pass.
+        template<Expression E> requires std::same_as<typename E::result_type, Vector>
+        constexpr Vector(const E& expr) noexcept
+        {
+            evaluateExpr(data.data(), expr, ExprAssign{});
+        }
+        template<Expression E> requires std::same_as<typename E::result_type, Vector>
+        constexpr Vector& operator=(const E& expr) noexcept
+        {
+            evaluateExpr(data.data(), expr, ExprAssign{});
+            return *this;
+        }
+        constexpr auto expr() const noexcept -> ExprLeaf<Vector, Number>
+        {
+            return {{}, data.data(), size, size, 1};
+        }
         friend void printVector(const Vector& v) noexcept
         {
             if constexpr  (size == 3)
@@ -164,18 +190,15 @@ namespace LinAlg
         }
         friend void roundOff(Vector& v,uint8_t decimalDigit) noexcept
         {
-            auto TenPower = TenRaise(decimalDigit);
-            if (!std::is_floating_point_v<Number>)
+            if (!std::is_floating_point_v<Number> && !ReducedFloat<Number>)
                 return;
-            std::ranges::transform(v.data,
-                v.data.begin(),
-                [TenPower](Number n)
-                {
-                    return std::round(n * TenPower) / TenPower;
-                });
+            Simd::roundOff(v.data.data(), v.data.data(), decimalDigit, size);
         }
     };
 
+    template<size_t size, typename Number>
+    inline constexpr bool ElementwiseProduct<Vector<size, Number>> = true;
+
     using V1u8      =    Vector<1, uint8_t>;
     using V1u16     =    Vector<1, uint16_t>;
     using V1u32     =    Vector<1, uint32_t>;
@@ -186,6 +209,8 @@ namespace LinAlg
     using V1st      =    Vector<1, size_t>;
     using V1f       =    Vector<1, float>;
     using V1d       =    Vector<1, double>;
+    using V1h       =    Vector<1, Float16>;
+    using V1bf      =    Vector<1, BFloat16>;
 
     using V2u8      =    Vector<2, uint8_t>;
     using V2u16     =    Vector<2, uint16_t>;
@@ -197,6 +222,8 @@ namespace LinAlg
     using V2st      =    Vector<2, size_t>;
     using V2f       =    Vector<2, float>;
     using V2d       =    Vector<2, double>;
+    using V2h       =    Vector<2, Float16>;
+    using V2bf      =    Vector<2, BFloat16>;
 
     using V3u8      =    Vector<3, uint8_t>;
     using V3u16     =    Vector<3, uint16_t>;
@@ -208,6 +235,8 @@ namespace LinAlg
     using V3st      =    Vector<3, size_t>;
     using V3f       =    Vector<3, float>;
     using V3d       =    Vector<3, double>;
+    using V3h       =    Vector<3, Float16>;
+    using V3bf      =    Vector<3, BFloat16>;
 
     using V4u8      =    Vector<4, uint8_t>;
     using V4u16     =    Vector<4, uint16_t>;
@@ -219,6 +248,8 @@ namespace LinAlg
     using V4st      =    Vector<4, size_t>;
     using V4f       =    Vector<4, float>;
     using V4d       =    Vector<4, double>;
+    using V4h       =    Vector<4, Float16>;
+    using V4bf      =    Vector<4, BFloat16>;
 
     using V10u8      =    Vector<10, uint8_t>;
     using V10u16     =    Vector<10, uint16_t>;
@@ -230,4 +261,6 @@ namespace LinAlg
     using V10st      =    Vector<10, size_t>;
     using V10f       =    Vector<10, float>;
     using V10d       =    Vector<10, double>;
+    using V10h       =    Vector<10, Float16>;
+    using V10bf      =    Vector<10, BFloat16>;
 }
@@ -0,0 +1,440 @@
+#pragma once
+#include "TemplateConstraint.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Reductions.h"
+#include <cstddef>
+#include <array>
+#include <span>
+#include <tuple>
+#include <algorithm>
+#include <utility>
+#include <concepts>
+#include <type_traits>
+#include <cassert>
+namespace LinAlg
+{
+    // Non-owning strided windows over matrix elements (like std::span, they never own or keep
+    // alive what they point into):
+    //   MatrixView : element (r, c) at data[r * rowStride + c * colStride]
+    //   VectorView : element i at data[i * stride]
+    // Rows, columns, blocks and the transpose of a view are views again: only the pointer, the
+    // extents and the strides change, so slicing never allocates or copies. A row-major MatrixX
+    // or Matrix is the view (rowStride = cols, colStride = 1); its transpose swaps the strides.
+    // MatrixView<float> writes through, MatrixView<const float> only reads.
+    //
+    // The element-wise operators, the reductions and the products (MatMul.h) take views directly.
+    // Element-wise work is cut into runs: the whole view when it is one dense block, else rows
+    // (all colStride 1) or columns (all rowStride 1). A run whose elements are not adjacent
+    // (a column of a row-major matrix, rows of a transposed view mixed with untransposed ones) is
+    // gathered VIEW_BLOCK elements at a time into a buffer, the contiguous kernel runs on the
+    // buffer and written operands are scattered back, the way the 16-bit kernels widen blocks.
+    // Views in one operation may be the same view but must not partially overlap.
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    class VectorView;
+
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    class MatrixView
+    {
+    public:
+        using element_type = Number;
+        using value_type = std::remove_const_t<Number>;
+
+        constexpr MatrixView() noexcept = default;
+        constexpr MatrixView(Number* data, size_t rows, size_t cols, size_t rowStride, size_t colStride = 1) noexcept
+            : m_data(data), m_rows(rows), m_cols(cols), m_rowStride(rowStride), m_colStride(colStride) {}
+        // Writable -> read-only.
+        constexpr MatrixView(const MatrixView<value_type>& other) noexcept requires std::is_const_v<Number>
+            : MatrixView(other.data(), other.rows(), other.cols(), other.rowStride(), other.colStride()) {}
+
+        [[nodiscard]] constexpr Number* data() const noexcept { return m_data; }
+        [[nodiscard]] constexpr size_t rows() const noexcept { return m_rows; }
+        [[nodiscard]] constexpr size_t cols() const noexcept { return m_cols; }
+        [[nodiscard]] constexpr size_t size() const noexcept { return m_rows * m_cols; }
+        [[nodiscard]] constexpr size_t rowStride() const noexcept { return m_rowStride; }
+        [[nodiscard]] constexpr size_t colStride() const noexcept { return m_colStride; }
+        // One dense row-major block: the view is data()[0, size()).
+        [[nodiscard]] constexpr bool contiguous() const noexcept
+        {
+            return (m_colStride == 1 || m_cols <= 1) && (m_rowStride == m_cols || m_rows <= 1);
+        }
+        [[nodiscard]] constexpr Number& operator()(size_t r, size_t c) const noexcept
+        {
+            assert(r < m_rows && c < m_cols);
+            return m_data[r * m_rowStride + c * m_colStride];
+        }
+
+        [[nodiscard]] constexpr auto row(size_t r) const noexcept -> VectorView<Number>
+        {
+            assert(r < m_rows);
+            return {m_data + r * m_rowStride, m_cols, m_colStride};
+        }
+        [[nodiscard]] constexpr auto col(size_t c) const noexcept -> VectorView<Number>
+        {
+            assert(c < m_cols);
+            return {m_data + c * m_colStride, m_rows, m_rowStride};
+        }
+        // rows x cols elements starting at (row, col).
+        [[nodiscard]] constexpr auto block(size_t row, size_t col, size_t rows, size_t cols) const noexcept -> MatrixView
+        {
+            assert(row + rows <= m_rows && col + cols <= m_cols);
+            return {m_data + row * m_rowStride + col * m_colStride, rows, cols, m_rowStride, m_colStride};
+        }
+        [[nodiscard]] constexpr auto transpose() const noexcept -> MatrixView
+        {
+            return {m_data, m_cols, m_rows, m_colStride, m_rowStride};
+        }
+    public:
+        // Element-wise, in place (writable views only).
+        auto operator+=(const MatrixView<const value_type>& other) const -> const MatrixView&
+            requires (!std::is_const_v<Number>);
+        auto operator-=(const MatrixView<const value_type>& other) const -> const MatrixView&
+            requires (!std::is_const_v<Number>);
+        auto operator+=(value_type scalar) const -> const MatrixView& requires (!std::is_const_v<Number>);
+        auto operator-=(value_type scalar) const -> const MatrixView& requires (!std::is_const_v<Number>);
+        auto operator*=(value_type scalar) const -> const MatrixView& requires (!std::is_const_v<Number>);
+        // Copies other's elements in (same shape), e.g. view.assign(other.transpose()). other may be
+        // this same view (a no-op) or share no elements with it; when the two partially overlap
+        // (view.assign(view.transpose()), a block shifted by one row) runs are copied through
+        // buffers in no particular order and the result is unspecified: copy through a MatrixX.
+        // Overlapping dense blocks are caught by an assert.
+        void assign(const MatrixView<const value_type>& other) const requires (!std::is_const_v<Number>);
+        void fill(value_type value) const requires (!std::is_const_v<Number>);
+    public:
+        // Reductions over all elements, like the containers' members; runs are reduced with the
+        // kernels of Reductions.h and joined in a pairwise tree.
+        [[nodiscard]] auto sum(Reduction mode = {}) const -> ReduceType<value_type>;
+        [[nodiscard]] auto dot(const MatrixView<const value_type>& other, Reduction mode = {}) const -> ReduceType<value_type>;
+        [[nodiscard]] auto squaredNorm(Reduction mode = {}) const -> ReduceType<value_type>;
+        [[nodiscard]] auto norm(Reduction mode = {}) const -> NormType<value_type>
+        {
+            return std::sqrt(static_cast<NormType<value_type>>(squaredNorm(mode)));
+        }
+        [[nodiscard]] auto minValue() const -> value_type;
+        [[nodiscard]] auto maxValue() const -> value_type;
+        // Row-major position of the first smallest / largest element (row = index / cols(),
+        // col = index % cols(), as for MatrixX); size() when the view is empty or all NaN.
+        [[nodiscard]] auto argmin() const -> size_t;
+        [[nodiscard]] auto argmax() const -> size_t;
+    private:
+        Number* m_data = nullptr;
+        size_t m_rows = 0;
+        size_t m_cols = 0;
+        size_t m_rowStride = 0;
+        size_t m_colStride = 1;
+    };
+
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    class VectorView
+    {
+    public:
+        using element_type = Number;
+        using value_type = std::remove_const_t<Number>;
+
+        constexpr VectorView() noexcept = default;
+        constexpr VectorView(Number* data, size_t size, size_t stride = 1) noexcept
+            : m_data(data), m_size(size), m_stride(stride) {}
+        constexpr VectorView(std::span<Number> span) noexcept : VectorView(span.data(), span.size()) {}
+        constexpr VectorView(const VectorView<value_type>& other) noexcept requires std::is_const_v<Number>
+            : VectorView(other.data(), other.size(), other.stride()) {}
+
+        [[nodiscard]] constexpr Number* data() const noexcept { return m_data; }
+        [[nodiscard]] constexpr size_t size() const noexcept { return m_size; }
+        [[nodiscard]] constexpr size_t stride() const noexcept { return m_stride; }
+        [[nodiscard]] constexpr bool contiguous() const noexcept { return m_stride == 1 || m_size <= 1; }
+        [[nodiscard]] constexpr Number& operator[](size_t i) const noexcept
+        {
+            assert(i < m_size);
+            return m_data[i * m_stride];
+        }
+        // count elements starting at begin.
+        [[nodiscard]] constexpr auto slice(size_t begin, size_t count) const noexcept -> VectorView
+        {
+            assert(begin + count <= m_size);
+            return {m_data + begin * m_stride, count, m_stride};
+        }
+        // The same elements as a size x 1 matrix (what the kernels below run on).
+        [[nodiscard]] constexpr auto matrix() const noexcept -> MatrixView<Number>
+        {
+            return {m_data, m_size, 1, m_stride, 1};
+        }
+    public:
+        auto operator+=(const VectorView<const value_type>& other) const -> const VectorView& requires (!std::is_const_v<Number>)
+        {
+            matrix() += other.matrix();
+            return *this;
+        }
+        auto operator-=(const VectorView<const value_type>& other) const -> const VectorView& requires (!std::is_const_v<Number>)
+        {
+            matrix() -= other.matrix();
+            return *this;
+        }
+        auto operator+=(value_type scalar) const -> const VectorView& requires (!std::is_const_v<Number>)
+        {
+            matrix() += scalar;
+            return *this;
+        }
+        auto operator-=(value_type scalar) const -> const VectorView& requires (!std::is_const_v<Number>)
+        {
+            matrix() -= scalar;
+            return *this;
+        }
+        auto operator*=(value_type scalar) const -> const VectorView& requires (!std::is_const_v<Number>)
+        {
+            matrix() *= scalar;
+            return *this;
+        }
+        void assign(const VectorView<const value_type>& other) const requires (!std::is_const_v<Number>) { matrix().assign(other.matrix()); }
+        void fill(value_type value) const requires (!std::is_const_v<Number>) { matrix().fill(value); }
+    public:
+        [[nodiscard]] auto sum(Reduction mode = {}) const -> ReduceType<value_type> { return matrix().sum(mode); }
+        [[nodiscard]] auto dot(const VectorView<const value_type>& other, Reduction mode = {}) const -> ReduceType<value_type>
+        {
+            return matrix().dot(other.matrix(), mode);
+        }
+        [[nodiscard]] auto squaredNorm(Reduction mode = {}) const -> ReduceType<value_type> { return matrix().squaredNorm(mode); }
+        [[nodiscard]] auto norm(Reduction mode = {}) const -> NormType<value_type> { return matrix().norm(mode); }
+        [[nodiscard]] auto minValue() const -> value_type { return matrix().minValue(); }
+        [[nodiscard]] auto maxValue() const -> value_type { return matrix().maxValue(); }
+        [[nodiscard]] auto argmin() const -> size_t { return matrix().argmin(); }
+        [[nodiscard]] auto argmax() const -> size_t { return matrix().argmax(); }
+    private:
+        Number* m_data = nullptr;
+        size_t m_size = 0;
+        size_t m_stride = 1;
+    };
+
+    namespace detail
+    {
+        // Elements per gathered block of a strided run. A transposed operand touches one line and
+        // one page per element, so a block stays within what the L2 TLB covers.
+        inline constexpr size_t VIEW_BLOCK = 256;
+        // Runs gathered side by side, one block each: VIEW_TILE x VIEW_BLOCK floats of a transpose
+        // are 512 cache lines, which still fit L1 until the tile moves on.
+        inline constexpr size_t VIEW_TILE = 32;
+        // Runs of a reduction are visited in order (the pairwise tree only depends on the count);
+        // the kernel on each run still spreads a long one across the pool.
+        inline constexpr Parallel VIEW_SERIAL{.threads = 1};
+
+        template<typename T>
+        void gatherRun(std::remove_const_t<T>* block, const T* source, size_t stride, size_t count) noexcept
+        {
+            for (size_t e = 0; e < count; ++e)
+                block[e] = source[e * stride];
+        }
+        template<typename T>
+        void scatterRun(T* target, size_t stride, const std::remove_const_t<T>* block, size_t count) noexcept
+        {
+            if constexpr (!std::is_const_v<T>)
+                for (size_t e = 0; e < count; ++e)
+                    target[e * stride] = block[e];
+        }
+
+        // Elements [begin, end) of run 'run': handed over as they are when every operand is
+        // contiguous along it, else VIEW_BLOCK at a time through the gather buffers.
+        template<typename Fn, typename... T, size_t... k>
+        void visitRun(const Fn& fn, const std::tuple<T*...>& views, const std::array<size_t, sizeof...(T)>& inner,
+                      const std::array<size_t, sizeof...(T)>& outer, size_t run, size_t begin, size_t end,
+                      std::index_sequence<k...>)
+        {
+            const std::tuple<T*...> base{(std::get<k>(views) + run * outer[k])...};
+            if (((inner[k] == 1) && ...))
+            {
+                fn((std::get<k>(base) + begin)..., end - begin);
+                return;
+            }
+            alignas(64) std::common_type_t<std::remove_const_t<T>...> blocks[sizeof...(T)][VIEW_BLOCK];
+            for (size_t i = begin; i < end; i += VIEW_BLOCK)
+            {
+                const size_t m = std::min(VIEW_BLOCK, end - i);
+                ((inner[k] != 1 ? gatherRun(blocks[k], std::get<k>(base) + i * inner[k], inner[k], m) : void()), ...);
+                fn((inner[k] == 1 ? std::get<k>(base) + i : blocks[k])..., m);
+                // Written operands go back where they were gathered from.
+                ((inner[k] != 1 ? scatterRun(std::get<k>(base) + i * inner[k], inner[k], blocks[k], m) : void()), ...);
+            }
+        }
+
+        // Calls fn(p..., n) with one pointer per view to n consecutive elements, until every element
+        // of the same-shaped views has been passed exactly once (see the top of this file). Runs are
+        // split across the pool like the containers' operators; the reductions pass one thread.
+        template<typename Fn, typename... T>
+        void forEachRun(const Parallel& policy, const Fn& fn, const MatrixView<T>&... views)
+        {
+            constexpr size_t N = sizeof...(T);
+            const auto& lead = std::get<0>(std::forward_as_tuple(views...));
+            const size_t rows = lead.rows(), cols = lead.cols();
+            assert(((views.rows() == rows && views.cols() == cols) && ...));
+            if (rows == 0 || cols == 0)
+                return;
+
+            // Runs go along whichever axis is contiguous in every view; the longer one on a tie.
+            const bool rowsDense = cols > 1 && ((views.colStride() == 1) && ...);
+            const bool colsDense = rows > 1 && ((views.rowStride() == 1) && ...);
+            const bool byColumns = rowsDense == colsDense ? rows > cols : colsDense;
+            size_t count = byColumns ? cols : rows;
+            size_t length = byColumns ? rows : cols;
+            std::array<size_t, N> inner{(byColumns ? views.rowStride() : views.colStride())...};
+            const std::array<size_t, N> outer{(byColumns ? views.colStride() : views.rowStride())...};
+            if (length == 1)
+                inner.fill(1);
+            // Runs that follow each other in memory in every view are one run.
+            if (std::ranges::all_of(inner, [](size_t s) { return s == 1; }) &&
+                std::ranges::all_of(outer, [&](size_t s) { return s == length; }))
+            {
+                length *= count;
+                count = 1;
+            }
+
+            const std::tuple<T*...> base{views.data()...};
+            if (count == 1)
+                parallelFor(length, policy, [&](size_t first, size_t last)
+                {
+                    visitRun(fn, base, inner, outer, 0, first, last, std::make_index_sequence<N>{});
+                });
+            else if (std::ranges::all_of(inner, [](size_t s) { return s == 1; }))
+                parallelFor(count, policy, [&](size_t first, size_t last)
+                {
+                    for (size_t run = first; run < last; ++run)
+                        visitRun(fn, base, inner, outer, run, 0, length, std::make_index_sequence<N>{});
+                }, count * length);
+            else
+                parallelFor(count, policy, [&](size_t first, size_t last)
+                {
+                    // Neighbouring runs share the cache lines (and pages) of a strided operand, e.g. the
+                    // rows of a transpose: take VIEW_TILE of them one block at a time, so a line is
+                    // used for all its elements before it is evicted.
+                    for (size_t tile = first; tile < last; tile += VIEW_TILE)
+                        for (size_t begin = 0; begin < length; begin += VIEW_BLOCK)
+                            for (size_t run = tile; run < std::min(tile + VIEW_TILE, last); ++run)
+                                visitRun(fn, base, inner, outer, run, begin, std::min(begin + VIEW_BLOCK, length),
+                                         std::make_index_sequence<N>{});
+                }, count * length);
+        }
+
+        // Two dense blocks that share elements without being the same block.
+        template<typename T>
+        constexpr bool partiallyOverlaps(const MatrixView<const T>& a, const MatrixView<const T>& b) noexcept
+        {
+            if (!a.contiguous() || !b.contiguous() || a.size() == 0 || b.size() == 0)
+                return false;
+            const bool same = a.data() == b.data() && a.rows() == b.rows() && a.cols() == b.cols();
+            return !same && a.data() < b.data() + b.size() && b.data() < a.data() + a.size();
+        }
+
+        // argmin / argmax of a view: the value comes from the run reductions, then the first
+        // element equal to it is searched in row-major order (runs may be columns).
+        template<bool Max, typename T>
+        size_t viewArgExtreme(const MatrixView<const T>& view)
+        {
+            if (view.contiguous())
+                return Max ? LinAlg::argmax(view.data(), view.size()) : LinAlg::argmin(view.data(), view.size());
+            const auto value = static_cast<ReduceType<T>>(Max ? view.maxValue() : view.minValue());
+            for (size_t r = 0; r < view.rows(); ++r)
+                for (size_t c = 0; c < view.cols(); ++c)
+                    if (static_cast<ReduceType<T>>(view(r, c)) == value)
+                        return r * view.cols() + c;
+            return view.size();
+        }
+    }
+
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::operator+=(const MatrixView<const value_type>& other) const -> const MatrixView&
+        requires (!std::is_const_v<Number>)
+    {
+        detail::forEachRun(Parallel::current(), [](value_type* a, const value_type* b, size_t n) { Simd::add(a, a, b, n); }, *this, other);
+        return *this;
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::operator-=(const MatrixView<const value_type>& other) const -> const MatrixView&
+        requires (!std::is_const_v<Number>)
+    {
+        detail::forEachRun(Parallel::current(), [](value_type* a, const value_type* b, size_t n) { Simd::sub(a, a, b, n); }, *this, other);
+        return *this;
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::operator+=(value_type scalar) const -> const MatrixView& requires (!std::is_const_v<Number>)
+    {
+        detail::forEachRun(Parallel::current(), [scalar](value_type* a, size_t n) { Simd::addScalar(a, a, scalar, n); }, *this);
+        return *this;
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::operator-=(value_type scalar) const -> const MatrixView& requires (!std::is_const_v<Number>)
+    {
+        detail::forEachRun(Parallel::current(), [scalar](value_type* a, size_t n) { Simd::subScalar(a, a, scalar, n); }, *this);
+        return *this;
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::operator*=(value_type scalar) const -> const MatrixView& requires (!std::is_const_v<Number>)
+    {
+        detail::forEachRun(Parallel::current(), [scalar](value_type* a, size_t n) { Simd::mulScalar(a, a, scalar, n); }, *this);
+        return *this;
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    void MatrixView<Number>::assign(const MatrixView<const value_type>& other) const requires (!std::is_const_v<Number>)
+    {
+        assert(!detail::partiallyOverlaps(MatrixView<const value_type>(*this), other));
+        detail::forEachRun(Parallel::current(), [](value_type* a, const value_type* b, size_t n) { std::copy_n(b, n, a); }, *this, other);
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    void MatrixView<Number>::fill(value_type value) const requires (!std::is_const_v<Number>)
+    {
+        detail::forEachRun(Parallel::current(), [value](value_type* a, size_t n) { std::fill_n(a, n, value); }, *this);
+    }
+
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::sum(Reduction mode) const -> ReduceType<value_type>
+    {
+        detail::PairwiseSum<ReduceType<value_type>> total;
+        detail::forEachRun(detail::VIEW_SERIAL, [&](const value_type* x, size_t n) { total.push({LinAlg::sum(x, n, mode)}); },
+                           MatrixView<const value_type>(*this));
+        return total.result().value();
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::dot(const MatrixView<const value_type>& other, Reduction mode) const -> ReduceType<value_type>
+    {
+        detail::PairwiseSum<ReduceType<value_type>> total;
+        detail::forEachRun(detail::VIEW_SERIAL, [&](const value_type* x, const value_type* y, size_t n)
+        {
+            total.push({LinAlg::dot(x, y, n, mode)});
+        }, MatrixView<const value_type>(*this), other);
+        return total.result().value();
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::squaredNorm(Reduction mode) const -> ReduceType<value_type>
+    {
+        detail::PairwiseSum<ReduceType<value_type>> total;
+        detail::forEachRun(detail::VIEW_SERIAL, [&](const value_type* x, size_t n) { total.push({LinAlg::squaredNorm(x, n, mode)}); },
+                           MatrixView<const value_type>(*this));
+        return total.result().value();
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::minValue() const -> value_type
+    {
+        auto best = detail::extremeIdentity<false, value_type>();
+        detail::forEachRun(detail::VIEW_SERIAL, [&](const value_type* x, size_t n)
+        {
+            best = detail::better<false>(static_cast<ReduceType<value_type>>(LinAlg::minValue(x, n)), best);
+        }, MatrixView<const value_type>(*this));
+        return static_cast<value_type>(best);
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::maxValue() const -> value_type
+    {
+        auto best = detail::extremeIdentity<true, value_type>();
+        detail::forEachRun(detail::VIEW_SERIAL, [&](const value_type* x, size_t n)
+        {
+            best = detail::better<true>(static_cast<ReduceType<value_type>>(LinAlg::maxValue(x, n)), best);
+        }, MatrixView<const value_type>(*this));
+        return static_cast<value_type>(best);
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::argmin() const -> size_t
+    {
+        return detail::viewArgExtreme<false>(MatrixView<const value_type>(*this));
+    }
+    template<typename Number> requires Numeric<std::remove_const_t<Number>>
+    auto MatrixView<Number>::argmax() const -> size_t
+    {
+        return detail::viewArgExtreme<true>(MatrixView<const value_type>(*this));
+    }
+}
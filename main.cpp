@@ -1,8 +1,20 @@
 #include "Starting.h"
 #include "Matrices.h"
 #include "Vectors.h"
+#include "DynamicMatrices.h"
+#include "MatMul.h"
+#include "Layers.h"
+#include "Autodiff.h"
+#include "Checkpoint.h"
+#include "Profiling.h"
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 int main()
 {
+    // Only does something in a LINALG_PROFILING build.
+    LinAlg::Profiler::setTracing(true);
     //Start::Run();
     LinAlg::V2d v1{1,2};
     LinAlg::V2d v2{1,2};
@@ -14,6 +26,8 @@ int main()
     v1 -= 1;
     v1 *= 1;
     printVector(v1);
+    LinAlg::V2d v4 = v1 + v2 * v2 - 1.0; // one fused loop, no temporaries
+    printVector(v4);
     LinAlg::Mat2d mat1{{1,2},{3,4}};
     LinAlg::Mat2d mat2{{5,6},{7,8}};
     mat1 += mat2;
@@ -29,4 +43,117 @@ int main()
     printMatrix(mat3);
     LinAlg::V10d v3{5.2, 10.2};
     printVector(v3);
+    LinAlg::MatXd mat5{{1,2,3},{4,5,6}};
+    mat5 += LinAlg::MatXd(2, 3, 1.5);
+    mat5 *= 2;
+    printMatrix(mat5);
+    // The fixed-size products against the reference loops.
+    LinAlg::Mat3d a{{1,2,3},{4,5,6},{7,8,10}};
+    LinAlg::Mat3d b{{2,0,1},{1,3,0},{0,1,4}};
+    LinAlg::V3d x{1,-2,3};
+    const LinAlg::Mat3d ab = LinAlg::matmul(a, b);
+    const LinAlg::V3d ax = LinAlg::matvec(a, x);
+    std::array<double, 9> flatA{}, flatB{}, flatAB{};
+    std::array<double, 3> flatAx{};
+    for (size_t r = 0; r < 3; ++r)
+        for (size_t c = 0; c < 3; ++c)
+        {
+            flatA[r * 3 + c] = a(r, c);
+            flatB[r * 3 + c] = b(r, c);
+        }
+    LinAlg::gemmReference<double>(3, 3, 3, 1, flatA.data(), 3, 1, flatB.data(), 3, 1, 0, flatAB.data(), 3, 1);
+    LinAlg::gemvReference<double>(3, 3, 1, flatA.data(), 3, 1, x.data.data(), 1, 0, flatAx.data(), 1);
+    double productError = 0;
+    for (size_t r = 0; r < 3; ++r)
+    {
+        productError = std::max(productError, std::abs(ax.data[r] - flatAx[r]));
+        for (size_t c = 0; c < 3; ++c)
+            productError = std::max(productError, std::abs(ab(r, c) - flatAB[r * 3 + c]));
+    }
+    std::println("matmul / matvec vs reference: max error {}", productError);
+    // XOR needs a hidden layer: a single neuron cannot fit it.
+    std::vector<double> xorInputs{0, 0, 1, 1,  0, 1, 0, 1};
+    std::vector<double> xorTargets{0, 1, 1, 0};
+    ML::Mlp<double> net({{2, 8, ML::Activation::Tanh}, {8, 1, ML::Activation::Sigmoid}}, 1);
+    const auto xorResult = ML::trainMlp(net, ML::DatasetView<double>::packed(xorInputs, xorTargets, 2),
+                                        {.epochs = 3000, .batchSize = 4, .learningRate = 2.0});
+    std::println("XOR loss: {}", xorResult.history.back().loss);
+    // Checkpoint round trip, including a tensor without elements: a {5, 0} shape is legal.
+    try
+    {
+        const std::vector<float> none;
+        ML::CheckpointWriter().add("empty", std::span<const float>(none), {5, 0}).write("empty.ckpt");
+        const ML::MappedCheckpoint stored("empty.ckpt", ML::CheckpointVerify::Full);
+        const auto empty = stored.view<float>("empty");
+        std::println("Checkpoint {{5, 0}} round trip: {} x {}, {} values", empty.rows(), empty.cols(), empty.size());
+        // The trained net served from the mapped file, without copying its weights.
+        ML::saveCheckpoint("xor.ckpt", net);
+        const ML::MappedCheckpoint served("xor.ckpt");
+        ML::MappedMlp<double> mapped(served);
+        const LinAlg::MatrixView<const double> batch(xorInputs.data(), 4, 2, 1, 4);
+        const auto& expected = net.forward(batch);
+        const auto& actual = mapped.forward(batch);
+        double servedError = 0;
+        for (size_t i = 0; i < actual.size(); ++i)
+            servedError = std::max(servedError, std::abs(actual.data()[i] - expected.data()[i]));
+        std::println("Mapped XOR net vs trained net: max error {}", servedError);
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::println("Checkpoint round trip failed: {}", error.what());
+    }
+    // The XOR net again with its buffers drawn from a SizeClassPool, stats taken once per epoch.
+    // Batches of 3 end every epoch on a 1-row batch, so the activations change shape every step:
+    // every buffer is allocated in the first epoch, and training after that allocates nothing.
+    {
+        LinAlg::SizeClassPool pool;
+        LinAlg::AllocationStats first, steady;
+        {
+            LinAlg::PoolScope scope(pool);
+            ML::Mlp<double, LinAlg::PoolAllocator<double>> pooled({{2, 8, ML::Activation::Tanh}, {8, 1, ML::Activation::Sigmoid}}, 1);
+            pool.takeStats(); // the parameters, allocated once up front
+            ML::TrainConfig config{.epochs = 100, .batchSize = 3, .learningRate = 2.0};
+            config.onEpoch = [&](const ML::EpochReport& report)
+            {
+                const auto stats = pool.takeStats();
+                auto& total = report.epoch == 0 ? first : steady;
+                total.allocations += stats.allocations;
+                total.systemAllocations += stats.systemAllocations;
+            };
+            ML::trainMlp(pooled, ML::DatasetView<double>::packed(xorInputs, xorTargets, 2), config);
+        }
+        std::println("Pooled XOR training: epoch 0 {} allocations ({} global), epochs 1-99 {} ({} global)",
+                     first.allocations, first.systemAllocations, steady.allocations, steady.systemAllocations);
+    }
+    // Same fit as Start::Run, gradients from the tape instead of by hand.
+    LinAlg::V4d xs{1, 2, 4, 6};
+    LinAlg::V4d ys{7, 14, 28, 42};
+    LinAlg::VXd weight(1, 0.5);
+    LinAlg::VXd bias(1, 0.0);
+    ML::Tape<double> tape;
+    for (int step = 0; step < 500; ++step)
+    {
+        tape.reset();
+        auto w = tape.parameter(weight);
+        auto b = tape.parameter(bias);
+        auto loss = tape.mse(tape.addBias(tape.matmul(tape.constant(xs.data.data(), 4, 1), w), b), tape.constant(ys));
+        tape.backward(loss);
+        LinAlg::Simd::axpy(weight.data(), tape.grad(w).data(), -0.01, 1);
+        LinAlg::Simd::axpy(bias.data(), tape.grad(b).data(), -0.01, 1);
+    }
+    std::println("Autodiff weight: {} bias: {}", weight[0], bias[0]);
+    // Fixed-size matrices go onto the tape the same way: d mse(P, Q) / dP = 2 (P - Q) / 4.
+    LinAlg::Mat2d p{{1, 2}, {3, 4}};
+    LinAlg::Mat2d q{{1, 1}, {1, 1}};
+    tape.reset();
+    auto pVar = tape.parameter(p);
+    tape.backward(tape.mse(pVar, tape.constant(q)));
+    std::println("Autodiff Mat2d gradient: {}", tape.grad(pVar));
+
+    if constexpr (LinAlg::Profiler::enabled)
+    {
+        LinAlg::Profiler::printSummary();
+        LinAlg::Profiler::writeChromeTrace("MachineLearning2026.trace.json");
+        std::println("Trace written to MachineLearning2026.trace.json");
+    }
 }
\ No newline at end of file